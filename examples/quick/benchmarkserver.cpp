@@ -0,0 +1,39 @@
+/*
+ * Copyright (C) 2008-2016 The Communi Project
+ *
+ * This example is free, and not covered by the BSD license. There is no
+ * restriction applied to their modification, redistribution, using and so on.
+ * You can study them, modify them, use them in your own program - either
+ * completely or partially.
+ */
+
+#include "benchmarkserver.h"
+#include <QTcpSocket>
+
+BenchmarkServer::BenchmarkServer(int users, QObject* parent) : QTcpServer(parent), users(users)
+{
+    connect(this, SIGNAL(newConnection()), this, SLOT(welcome()));
+}
+
+void BenchmarkServer::welcome()
+{
+    QTcpSocket* socket = nextPendingConnection();
+    socket->write(":irc.communi.test 001 communi :Welcome to the benchmark\r\n");
+    socket->write(":irc.communi.test 005 communi PREFIX=(ov)@+ CHANTYPES=# :are supported by this server\r\n");
+    socket->write(":communi!communi@localhost JOIN #benchmark\r\n");
+
+    static const char* prefixes[] = { "@", "+", "", "", "", "", "", "" };
+    QByteArray line;
+    for (int i = 0; i < users; ++i) {
+        if (line.isEmpty())
+            line = ":irc.communi.test 353 communi = #benchmark :";
+        else
+            line += ' ';
+        line += prefixes[i % 8] + QByteArray("user") + QByteArray::number(i);
+        if (line.length() > 400 || i == users - 1) {
+            socket->write(line + "\r\n");
+            line.clear();
+        }
+    }
+    socket->write(":irc.communi.test 366 communi #benchmark :End of /NAMES list.\r\n");
+}
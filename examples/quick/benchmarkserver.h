@@ -0,0 +1,31 @@
+/*
+ * Copyright (C) 2008-2016 The Communi Project
+ *
+ * This example is free, and not covered by the BSD license. There is no
+ * restriction applied to their modification, redistribution, using and so on.
+ * You can study them, modify them, use them in your own program - either
+ * completely or partially.
+ */
+
+#ifndef BENCHMARKSERVER_H
+#define BENCHMARKSERVER_H
+
+#include <QTcpServer>
+
+// A fake local IRC server that welcomes the client and joins
+// it to a channel with the requested amount of users.
+class BenchmarkServer : public QTcpServer
+{
+    Q_OBJECT
+
+public:
+    BenchmarkServer(int users, QObject* parent = 0);
+
+private slots:
+    void welcome();
+
+private:
+    int users;
+};
+
+#endif // BENCHMARKSERVER_H
@@ -9,6 +9,9 @@
 
 #include <QGuiApplication>
 #include <QQmlApplicationEngine>
+#include <QQmlContext>
+#include <QHostAddress>
+#include "benchmarkserver.h"
 
 #ifdef QT_STATIC
 #include <QtPlugin>
@@ -20,6 +23,24 @@ int main(int argc, char* argv[])
     QGuiApplication app(argc, argv);
     app.setOrganizationName("Commmuni");
     app.setApplicationName("QtQuick Example");
+
+    // quick -benchmark [users]: measures delegate creation for a large channel
+    const QStringList args = app.arguments();
+    const int idx = args.indexOf("-benchmark");
+    if (idx != -1) {
+        int users = args.value(idx + 1).toInt();
+        if (users <= 0)
+            users = 20000;
+        BenchmarkServer server(users);
+        if (!server.listen(QHostAddress::LocalHost))
+            qFatal("%s", qPrintable(server.errorString()));
+        QQmlApplicationEngine engine;
+        engine.rootContext()->setContextProperty("benchmarkPort", int(server.serverPort()));
+        engine.rootContext()->setContextProperty("benchmarkUsers", users);
+        engine.load(QUrl("qrc:/Benchmark.qml"));
+        return app.exec();
+    }
+
     QQmlApplicationEngine engine(QUrl("qrc:/main.qml"));
     return app.exec();
 }
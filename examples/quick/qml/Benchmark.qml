@@ -0,0 +1,88 @@
+/*
+ * Copyright (C) 2008-2016 The Communi Project
+ *
+ * This example is free, and not covered by the BSD license. There is no
+ * restriction applied to their modification, redistribution, using and so on.
+ * You can study them, modify them, use them in your own program - either
+ * completely or partially.
+ */
+
+import QtQuick 2.1
+import QtQuick.Window 2.0
+import Communi 3.0
+
+Window {
+    id: window
+
+    visible: true
+    title: qsTr("Communi delegate benchmark")
+
+    width: 240
+    height: 800
+
+    property int created: 0
+    property double joined: 0
+
+    IrcConnection {
+        id: connection
+        host: "127.0.0.1"
+        port: benchmarkPort
+        userName: "communi"
+        nickName: "communi"
+        realName: "Communi benchmark"
+        Component.onCompleted: open()
+        onConnected: window.joined = Date.now()
+    }
+
+    IrcBufferModel {
+        id: bufferModel
+        connection: connection
+        onAdded: if (buffer.channel) userModel.channel = buffer.toChannel()
+    }
+
+    ListView {
+        id: listView
+
+        anchors.fill: parent
+        cacheBuffer: 0
+
+        // only the model interface is used, the list properties stay unbound
+        model: IrcUserModel {
+            id: userModel
+            sortMethod: Irc.SortByTitle
+            onCountChanged: if (count === benchmarkUsers) benchmark.start()
+        }
+
+        delegate: Rectangle {
+            width: listView.width
+            height: 20
+            color: index % 2 ? "#edf3fe" : "white"
+            Text {
+                text: model.title
+                anchors.left: parent.left
+                anchors.leftMargin: 6
+                anchors.verticalCenter: parent.verticalCenter
+            }
+            Component.onCompleted: ++window.created
+        }
+    }
+
+    // let the view settle before scrolling through the whole list
+    Timer {
+        id: benchmark
+        interval: 0
+        onTriggered: {
+            var populated = Date.now() - window.joined
+            window.created = 0
+            var start = Date.now()
+            var page = Math.max(1, Math.floor(listView.height / 20))
+            for (var i = 0; i < userModel.count; i += page)
+                listView.positionViewAtIndex(i, ListView.Beginning)
+            var elapsed = Date.now() - start
+            console.log(qsTr("%1 users: populated in %2 ms, %3 delegates created in %4 ms (%5 us/delegate)")
+                        .arg(userModel.count).arg(populated).arg(window.created).arg(elapsed)
+                        .arg(window.created ? Math.round(1000 * elapsed / window.created) : 0))
+            Qt.quit()
+        }
+    }
+}
@@ -13,9 +13,12 @@ lessThan(QT_MAJOR_VERSION, 5)|lessThan(QT_MINOR_VERSION, 2) {
 }
 
 # Input
+HEADERS += benchmarkserver.h
+SOURCES += benchmarkserver.cpp
 SOURCES += main.cpp
 RESOURCES += quick.qrc
 OTHER_FILES += qml/main.qml
+OTHER_FILES += qml/Benchmark.qml
 OTHER_FILES += qml/BufferListView.qml
 OTHER_FILES += qml/ChatPage.qml
 OTHER_FILES += qml/ConnectPage.qml
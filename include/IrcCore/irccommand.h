@@ -154,14 +154,54 @@ private:
     Q_DISABLE_COPY(IrcCommand)
 };
 
+class IRC_CORE_EXPORT IrcCommandValue
+{
+public:
+    IrcCommandValue();
+    explicit IrcCommandValue(IrcCommand::Type type, const QString& param1 = QString(), const QString& param2 = QString(), const QString& param3 = QString());
+
+    IrcCommand::Type type() const;
+    int count() const;
+    QString parameter(int index) const;
+    QStringList parameters() const;
+
+    QByteArray encoding() const;
+    void setEncoding(const QByteArray& encoding);
+
+    QString toString() const;
+    IrcCommand* toCommand(QObject* parent = 0) const;
+
+    static IrcCommandValue createCtcpAction(const QString& target, const QString& action);
+    static IrcCommandValue createJoin(const QString& channel, const QString& key = QString());
+    static IrcCommandValue createMessage(const QString& target, const QString& message);
+    static IrcCommandValue createMode(const QString& target, const QString& mode = QString(), const QString& arg = QString());
+    static IrcCommandValue createNick(const QString& nick);
+    static IrcCommandValue createNotice(const QString& target, const QString& notice);
+    static IrcCommandValue createPart(const QString& channel, const QString& reason = QString());
+    static IrcCommandValue createPing(const QString& argument);
+    static IrcCommandValue createPong(const QString& argument);
+    static IrcCommandValue createQuit(const QString& reason = QString());
+
+private:
+    IrcCommandValue(IrcCommand::Type type, int count, const QString& param1, const QString& param2, const QString& param3);
+
+    IrcCommand::Type m_type;
+    int m_count;
+    QString m_params[3];
+    QByteArray m_encoding;
+};
+
 #ifndef QT_NO_DEBUG_STREAM
 IRC_CORE_EXPORT QDebug operator<<(QDebug debug, IrcCommand::Type type);
 IRC_CORE_EXPORT QDebug operator<<(QDebug debug, const IrcCommand* command);
+IRC_CORE_EXPORT QDebug operator<<(QDebug debug, const IrcCommandValue& command);
 #endif // QT_NO_DEBUG_STREAM
 
 IRC_END_NAMESPACE
 
 Q_DECLARE_METATYPE(IRC_PREPEND_NAMESPACE(IrcCommand*))
 Q_DECLARE_METATYPE(IRC_PREPEND_NAMESPACE(IrcCommand::Type))
+Q_DECLARE_METATYPE(IRC_PREPEND_NAMESPACE(IrcCommandValue))
+Q_DECLARE_TYPEINFO(IRC_PREPEND_NAMESPACE(IrcCommandValue), Q_MOVABLE_TYPE);
 
 #endif // IRCCOMMAND_H
@@ -41,11 +41,14 @@ public:
     IrcCommandPrivate();
 
     QString params(int index) const;
+    bool serialize(QByteArray* out) const;
+    static bool serialize(QByteArray* out, const IrcCommandValue& command);
 
     IrcCommand::Type type;
     QStringList parameters;
     QByteArray encoding;
     QPointer<IrcConnection> connection;
+    bool builtIn;
 
     static IrcCommandPrivate* get(const IrcCommand* command)
     {
@@ -42,6 +42,7 @@
 IRC_BEGIN_NAMESPACE
 
 class IrcCommand;
+class IrcCommandValue;
 class IrcProtocol;
 class IrcConnectionPrivate;
 
@@ -68,6 +69,9 @@ class IRC_CORE_EXPORT IrcConnection : public QObject
     Q_PROPERTY(QAbstractSocket* socket READ socket WRITE setSocket)
     Q_PROPERTY(bool secure READ isSecure WRITE setSecure NOTIFY secureChanged)
     Q_PROPERTY(bool secureSupported READ isSecureSupported)
+    Q_PROPERTY(bool sessionResumption READ isSessionResumptionEnabled WRITE setSessionResumptionEnabled NOTIFY sessionResumptionChanged)
+    Q_PROPERTY(bool metricsEnabled READ isMetricsEnabled WRITE setMetricsEnabled NOTIFY metricsEnabledChanged)
+    Q_PROPERTY(int statisticsInterval READ statisticsInterval WRITE setStatisticsInterval NOTIFY statisticsIntervalChanged)
     Q_PROPERTY(QString saslMechanism READ saslMechanism WRITE setSaslMechanism NOTIFY saslMechanismChanged)
     Q_PROPERTY(QStringList supportedSaslMechanisms READ supportedSaslMechanisms CONSTANT)
     Q_PROPERTY(QVariantMap ctcpReplies READ ctcpReplies WRITE setCtcpReplies NOTIFY ctcpRepliesChanged)
@@ -141,6 +145,15 @@ public:
     void setSecure(bool secure);
     static bool isSecureSupported();
 
+    bool isSessionResumptionEnabled() const;
+    void setSessionResumptionEnabled(bool enabled);
+
+    bool isMetricsEnabled() const;
+    void setMetricsEnabled(bool enabled);
+
+    int statisticsInterval() const;
+    void setStatisticsInterval(int interval);
+
     QString saslMechanism() const;
     void setSaslMechanism(const QString& mechanism);
 
@@ -155,14 +168,20 @@ public:
     void setProtocol(IrcProtocol* protocol);
 
     void installMessageFilter(QObject* filter);
+    void installMessageFilter(QObject* filter, const QList<IrcMessage::Type>& types);
     void removeMessageFilter(QObject* filter);
 
     void installCommandFilter(QObject* filter);
     void removeCommandFilter(QObject* filter);
 
+    bool sendCommand(const IrcCommandValue& command);
+
     Q_INVOKABLE QByteArray saveState(int version = 0) const;
     Q_INVOKABLE bool restoreState(const QByteArray& state, int version = 0);
 
+    Q_INVOKABLE QVariantMap statistics() const;
+    Q_INVOKABLE void resetStatistics();
+
 public Q_SLOTS:
     void open();
     void close();
@@ -227,6 +246,10 @@ Q_SIGNALS:
     void reconnectDelayChanged(int seconds);
     void enabledChanged(bool enabled);
     void secureChanged(bool secure);
+    void sessionResumptionChanged(bool enabled);
+    void metricsEnabledChanged(bool enabled);
+    void statisticsIntervalChanged(int interval);
+    void statisticsReported(const QVariantMap& statistics);
     void saslMechanismChanged(const QString& mechanism);
     void ctcpRepliesChanged(const QVariantMap& replies);
 
@@ -247,8 +270,11 @@ private:
     Q_PRIVATE_SLOT(d_func(), void _irc_error(QAbstractSocket::SocketError))
     Q_PRIVATE_SLOT(d_func(), void _irc_state(QAbstractSocket::SocketState))
     Q_PRIVATE_SLOT(d_func(), void _irc_sslErrors())
+    Q_PRIVATE_SLOT(d_func(), void _irc_encrypted())
+    Q_PRIVATE_SLOT(d_func(), void _irc_sessionTicket())
     Q_PRIVATE_SLOT(d_func(), void _irc_reconnect())
     Q_PRIVATE_SLOT(d_func(), void _irc_readData())
+    Q_PRIVATE_SLOT(d_func(), void _irc_reportStatistics())
     Q_PRIVATE_SLOT(d_func(), void _irc_filterDestroyed(QObject*))
 };
 
@@ -30,21 +30,96 @@
 #define IRCCONNECTION_P_H
 
 #include "ircconnection.h"
+#include "irctrafficrecorder.h"
 
 #include <QSet>
 #include <QList>
 #include <QHash>
 #include <QStack>
 #include <QTimer>
+#include <QVector>
 #include <QString>
 #include <QByteArray>
 #include <QAbstractSocket>
+#include <QPointer>
+#ifndef IRC_NO_METRICS
+#include <QElapsedTimer>
+#endif // IRC_NO_METRICS
+#include <string.h>
+
+QT_FORWARD_DECLARE_CLASS(QTextCodec)
 
 IRC_BEGIN_NAMESPACE
 
 class IrcMessageFilter;
 class IrcCommandFilter;
 
+// notified of each line as IrcProtocol::write() sends it, see IrcLagTimer
+class IrcWriteObserver
+{
+public:
+    virtual ~IrcWriteObserver() { }
+    virtual void lineWritten(const QByteArray& line) = 0;
+};
+
+class IrcConnectionMetrics
+{
+public:
+    enum Stage { Parse, Filter, Dispatch, StageCount };
+
+    IrcConnectionMetrics() { reset(); }
+
+    void reset()
+    {
+        bytesIn = bytesOut = linesIn = linesOut = 0;
+        memset(messages, 0, sizeof(messages));
+        memset(passes, 0, sizeof(passes));
+        memset(samples, 0, sizeof(samples));
+        memset(nsecs, 0, sizeof(nsecs));
+    }
+
+    // only every 16th pass through a stage is timed
+    bool sample(Stage stage) { return (++passes[stage] & 15) == 0; }
+
+    qint64 bytesIn;
+    qint64 bytesOut;
+    qint64 linesIn;
+    qint64 linesOut;
+    qint64 messages[IrcMessage::Batch + 1];
+    quint32 passes[StageCount];
+    qint64 samples[StageCount];
+    qint64 nsecs[StageCount];
+};
+
+#ifndef IRC_NO_METRICS
+class IrcMetricsTimer
+{
+public:
+    IrcMetricsTimer(IrcConnectionMetrics* metrics, IrcConnectionMetrics::Stage stage)
+        : metrics(metrics && metrics->sample(stage) ? metrics : 0), stage(stage)
+    {
+        if (this->metrics)
+            timer.start();
+    }
+
+    ~IrcMetricsTimer()
+    {
+        if (metrics) {
+            metrics->nsecs[stage] += timer.nsecsElapsed();
+            ++metrics->samples[stage];
+        }
+    }
+
+private:
+    IrcConnectionMetrics* metrics;
+    IrcConnectionMetrics::Stage stage;
+    QElapsedTimer timer;
+};
+#define IRC_METRICS_TIMER(metrics, stage) IrcMetricsTimer irc_metrics_timer(metrics, IrcConnectionMetrics::stage)
+#else
+#define IRC_METRICS_TIMER(metrics, stage)
+#endif // IRC_NO_METRICS
+
 class IrcConnectionPrivate
 {
     Q_DECLARE_PUBLIC(IrcConnection)
@@ -59,10 +134,14 @@ public:
     void _irc_error(QAbstractSocket::SocketError error);
     void _irc_state(QAbstractSocket::SocketState state);
     void _irc_sslErrors();
+    void _irc_encrypted();
+    void _irc_sessionTicket();
     void _irc_reconnect();
     void _irc_readData();
+    void _irc_reportStatistics();
 
     void _irc_filterDestroyed(QObject* filter);
+    void updateMessageFilters();
 
     void open();
     void reconnect();
@@ -71,6 +150,9 @@ public:
     void setInfo(const QHash<QString, QString>& info);
 
     bool receiveMessage(IrcMessage* msg);
+    bool isSignalConnected(int type) const;
+    QTextCodec* codecForCommand(const QByteArray& encoding);
+    IrcConnectionMetrics* activeMetrics() { return metricsEnabled ? &metrics : 0; }
     IrcCommand* createCtcpReply(IrcPrivateMessage* request);
 
     static IrcConnectionPrivate* get(const IrcConnection* connection)
@@ -102,10 +184,23 @@ public:
     QList<QByteArray> pendingData;
     QList<QObject*> commandFilters;
     QList<QObject*> messageFilters;
+    QHash<QObject*, quint64> messageFilterTypes;
+    QVector<QVector<IrcMessageFilter*> > dispatchFilters;
     QStack<QObject*> activeCommandFilters;
     QSet<int> replies;
     bool pendingOpen;
     bool closed;
+    bool resumption;
+    int handshakes;
+    bool metricsEnabled;
+    IrcConnectionMetrics metrics;
+    int debugMatch;
+    QByteArray commandEncoding;
+    QTextCodec* commandCodec;
+    QByteArray sendBuffer;
+    QPointer<IrcTrafficRecorder> recorder;
+    QList<IrcWriteObserver*> writeObservers;
+    QTimer reporter;
 };
 
 IRC_END_NAMESPACE
@@ -37,6 +37,8 @@
 #include "ircfilter.h"
 #include "ircnetwork.h"
 #include "ircprotocol.h"
+#include "ircreplaysocket.h"
+#include "irctrafficrecorder.h"
 
 IRC_BEGIN_NAMESPACE
 
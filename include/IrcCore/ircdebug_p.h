@@ -34,8 +34,12 @@
 #include <QtCore/qdebug.h>
 #include <QtCore/qstring.h>
 #include <QtCore/qregexp.h>
+#include <QtCore/qmutex.h>
 #include <QtCore/qdatetime.h>
 
+#include "ircconnection_p.h"
+#include "irctrace_p.h"
+
 IRC_BEGIN_NAMESPACE
 
 #ifndef IRC_DOXYGEN
@@ -48,20 +52,23 @@ public:
 
     IrcDebug(IrcConnection* c, Level l) : enabled(irc_debug_enabled(c, l))
 #ifndef QT_NO_DEBUG_STREAM
-      , debug(&str)
+      , writer(0), debug(&str)
 #endif // QT_NO_DEBUG_STREAM
     {
 #ifndef QT_NO_DEBUG_STREAM
         if (enabled) {
-            const QString desc = c->displayName();
-            const QString stamp = QDateTime::currentDateTime().toString(Qt::ISODate);
-            debug << qPrintable("[" + stamp + " " + desc + "]");
-            switch (l) {
-                case Error: debug << "!!"; break;
-                case Status: debug << "??"; break;
-                case Write: debug << "->"; break;
-                case Read: debug << "<-"; break;
-                default: break;
+            writer = IrcTraceWriter::instance();
+            if (writer) {
+                // formatted later by the writer thread
+                record.stamp = QDateTime::currentMSecsSinceEpoch();
+                record.level = l;
+                record.name = c->displayName();
+            } else {
+                const QString desc = c->displayName();
+                const QString stamp = QDateTime::currentDateTime().toString(Qt::ISODate);
+                debug << qPrintable("[" + stamp + " " + desc + "]");
+                if (l != None)
+                    debug << IrcTraceWriter::marker(l);
             }
         }
 #endif // QT_NO_DEBUG_STREAM
@@ -69,8 +76,14 @@ public:
 
     ~IrcDebug() {
 #ifndef QT_NO_DEBUG_STREAM
-        if (enabled)
-            qDebug() << qPrintable(str);
+        if (enabled) {
+            if (writer) {
+                record.text = str.toUtf8();
+                writer->post(record);
+            } else {
+                qDebug() << qPrintable(str);
+            }
+        }
 #endif // QT_NO_DEBUG_STREAM
     }
 
@@ -91,33 +104,33 @@ private:
     bool enabled;
     QString str;
 #ifndef QT_NO_DEBUG_STREAM
+    IrcTraceWriter* writer;
+    IrcTraceRecord record;
     QDebug debug;
 #endif // QT_NO_DEBUG_STREAM
 };
 
-static bool irc_debug_enabled(IrcConnection* c, uint l)
+class IrcDebugConfig
 {
-    static QString dbg_name;
-    static uint dbg_level = IrcDebug::None;
-
-    static bool dbg_init = false;
-    if (!dbg_init) {
+public:
+    IrcDebugConfig() : level(IrcDebug::None)
+    {
         QByteArray lenv = qgetenv("IRC_DEBUG_LEVEL").toLower();
         if (!lenv.isEmpty()) {
             bool ok = false;
             int number = lenv.toInt(&ok);
             if (ok) {
-                dbg_level = number;
+                level = number;
             } else if (lenv == "none") {
-                dbg_level = IrcDebug::None;
+                level = IrcDebug::None;
             } else if (lenv == "error") {
-                dbg_level = IrcDebug::Error;
+                level = IrcDebug::Error;
             } else if (lenv == "status") {
-                dbg_level = IrcDebug::Status;
+                level = IrcDebug::Status;
             } else if (lenv == "write") {
-                dbg_level = IrcDebug::Write;
+                level = IrcDebug::Write;
             } else if (lenv == "read") {
-                dbg_level = IrcDebug::Read;
+                level = IrcDebug::Read;
             } else {
                 qWarning("Unknown IRC_DEBUG_LEVEL value '%s'", lenv.data());
                 qWarning("Available values: 0-4, none, error, status, write, read.");
@@ -130,20 +143,43 @@ static bool irc_debug_enabled(IrcConnection* c, uint l)
             int number = denv.toInt(&ok);
             if (ok) {
                 if (number == 0)
-                    dbg_level = IrcDebug::None;
+                    level = IrcDebug::None;
                 else if (lenv.isEmpty())
-                    dbg_level = IrcDebug::Read;
+                    level = IrcDebug::Read;
             }
         }
 
-        dbg_name = QString::fromUtf8(qgetenv("IRC_DEBUG_NAME"));
-        if (!dbg_name.isEmpty() && lenv.isEmpty() && denv.isEmpty())
-            dbg_level = IrcDebug::Read;
-
-        dbg_init = true;
+        const QString name = QString::fromUtf8(qgetenv("IRC_DEBUG_NAME"));
+        if (!name.isEmpty()) {
+            filter = QRegExp(name, Qt::CaseInsensitive, QRegExp::Wildcard);
+            if (lenv.isEmpty() && denv.isEmpty())
+                level = IrcDebug::Read;
+        }
     }
 
-    return l <= dbg_level && (dbg_name.isEmpty() || QRegExp(dbg_name, Qt::CaseInsensitive, QRegExp::Wildcard).exactMatch(c->displayName()));
+    uint level;
+    QRegExp filter;
+    QMutex mutex;
+};
+
+// initialized once in a thread-safe manner
+Q_GLOBAL_STATIC(IrcDebugConfig, irc_debug_config)
+
+static bool irc_debug_enabled(IrcConnection* c, uint l)
+{
+    IrcDebugConfig* config = irc_debug_config();
+    if (l > config->level)
+        return false;
+    if (config->filter.isEmpty())
+        return true;
+    // the match is cached until the display name changes
+    IrcConnectionPrivate* priv = IrcConnectionPrivate::get(c);
+    if (priv->debugMatch == -1) {
+        // QRegExp is not reentrant, the compiled filter is shared under a lock
+        QMutexLocker locker(&config->mutex);
+        priv->debugMatch = config->filter.exactMatch(c->displayName()) ? 1 : 0;
+    }
+    return priv->debugMatch == 1;
 }
 
 #define ircDebug(Connection, Flag) IrcDebug(Connection, Flag)
@@ -36,6 +36,7 @@ IRC_BEGIN_NAMESPACE
 
 class IrcMessage;
 class IrcCommand;
+class IrcCommandValue;
 
 class IRC_CORE_EXPORT IrcMessageFilter
 {
@@ -51,15 +52,24 @@ public:
     virtual bool commandFilter(IrcCommand* command) = 0;
 };
 
+class IRC_CORE_EXPORT IrcCommandValueFilter
+{
+public:
+    virtual ~IrcCommandValueFilter() { }
+    virtual bool commandValueFilter(const IrcCommandValue& command) = 0;
+};
+
 IRC_END_NAMESPACE
 
 // TODO: fixme
 #ifdef IRC_NAMESPACE
 using IRC_NAMESPACE::IrcMessageFilter;
 using IRC_NAMESPACE::IrcCommandFilter;
+using IRC_NAMESPACE::IrcCommandValueFilter;
 #endif
 
 Q_DECLARE_INTERFACE(IrcMessageFilter, "Communi.IrcMessageFilter")
 Q_DECLARE_INTERFACE(IrcCommandFilter, "Communi.IrcCommandFilter")
+Q_DECLARE_INTERFACE(IrcCommandValueFilter, "Communi.IrcCommandValueFilter")
 
 #endif // IRCFILTER_H
@@ -0,0 +1,165 @@
+/*
+  Copyright (C) 2008-2016 The Communi Project
+
+  You may use this file under the terms of BSD license as follows:
+
+  Redistribution and use in source and binary forms, with or without
+  modification, are permitted provided that the following conditions are met:
+    * Redistributions of source code must retain the above copyright
+      notice, this list of conditions and the following disclaimer.
+    * Redistributions in binary form must reproduce the above copyright
+      notice, this list of conditions and the following disclaimer in the
+      documentation and/or other materials provided with the distribution.
+    * Neither the name of the copyright holder nor the names of its
+      contributors may be used to endorse or promote products derived
+      from this software without specific prior written permission.
+
+  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+  ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+  WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+  DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDERS OR CONTRIBUTORS BE LIABLE FOR
+  ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+  (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+  ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+  (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+  SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#ifndef IRCLINEREADER_P_H
+#define IRCLINEREADER_P_H
+
+#include <IrcGlobal>
+#include <QtCore/qlist.h>
+#include <QtCore/qmutex.h>
+#include <QtCore/qatomic.h>
+#include <QtCore/qobject.h>
+#include <QtCore/qthread.h>
+#include <QtCore/qbytearray.h>
+
+#include "ircmessage_p.h"
+
+IRC_BEGIN_NAMESPACE
+
+#ifndef IRC_DOXYGEN
+// unbounded single-producer single-consumer queue
+template <typename T>
+class IrcSpscQueue
+{
+public:
+    IrcSpscQueue() : head(new Node), tail(head) { }
+    ~IrcSpscQueue()
+    {
+        while (head) {
+            Node* next = load(head->next);
+            delete head;
+            head = next;
+        }
+    }
+
+    // producer thread only
+    void enqueue(const T& value)
+    {
+        Node* node = new Node;
+        node->value = value;
+        store(tail->next, node);
+        tail = node;
+    }
+
+    // consumer thread only
+    bool dequeue(T* value)
+    {
+        Node* next = load(head->next);
+        if (!next)
+            return false;
+        *value = next->value;
+        next->value = T();
+        delete head;
+        head = next;
+        return true;
+    }
+
+private:
+    struct Node
+    {
+        T value;
+        QAtomicPointer<Node> next;
+    };
+
+    static Node* load(QAtomicPointer<Node>& ptr)
+    {
+#if QT_VERSION >= 0x050000
+        return ptr.loadAcquire();
+#else
+        return ptr;
+#endif // QT_VERSION
+    }
+
+    static void store(QAtomicPointer<Node>& ptr, Node* node)
+    {
+#if QT_VERSION >= 0x050000
+        ptr.storeRelease(node);
+#else
+        ptr.fetchAndStoreRelease(node);
+#endif // QT_VERSION
+    }
+
+    Node* head;
+    Node* tail;
+
+    Q_DISABLE_COPY(IrcSpscQueue)
+};
+
+class IrcLineReader : public QObject
+{
+    Q_OBJECT
+
+public:
+    IrcLineReader();
+    ~IrcLineReader();
+
+    static IrcLineReader* create();
+
+    void write(const QByteArray& data);
+    QList<IrcMessageData> readAll();
+    QByteArray stop();
+
+Q_SIGNALS:
+    void readyRead();
+
+private Q_SLOTS:
+    void process();
+    QByteArray flush();
+
+private:
+    bool readLines(const QByteArray& delimiter);
+
+    QByteArray buffer;
+    QAtomicInt pending;
+    QAtomicInt ready;
+    IrcSpscQueue<QByteArray> input;
+    IrcSpscQueue<IrcMessageData> output;
+};
+
+class IrcLineReaderPool
+{
+public:
+    IrcLineReaderPool();
+    ~IrcLineReaderPool();
+
+    QThread* nextThread();
+    void add(IrcLineReader* reader);
+    void remove(IrcLineReader* reader);
+    void stop();
+
+private:
+    QMutex mutex;
+    QList<QThread*> threads;
+    QList<IrcLineReader*> readers;
+    int next;
+};
+#endif // IRC_DOXYGEN
+
+IRC_END_NAMESPACE
+
+#endif // IRCLINEREADER_P_H
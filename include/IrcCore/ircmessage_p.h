@@ -104,8 +104,18 @@ public:
 
     QByteArray content() const;
 
+    enum Ctcp { CtcpUnknown = -1, CtcpNone, CtcpAction, CtcpRequest };
+
+    // classification of the PRIVMSG/NOTICE content parameter
+    int ctcp() const;
+    QString ctcpContent() const;
+
+    static int classifyCtcp(const QByteArray& content);
+    static int classifyCtcp(const QString& content);
+
     void invalidate();
 
+    static IrcMessage* fromData(const IrcMessageData& data, IrcConnection* connection);
     static QString decode(const QByteArray& data, const QByteArray& encoding);
     static bool parsePrefix(const QString& prefix, QString* nick, QString* ident, QString* host);
 
@@ -122,6 +132,8 @@ public:
     mutable IrcExplicitValue<QString> m_command;
     mutable IrcExplicitValue<QStringList> m_params;
     mutable IrcExplicitValue<QVariantMap> m_tags;
+    mutable int m_ctcp;
+    mutable IrcExplicitValue<QString> m_content;
 };
 
 IRC_END_NAMESPACE
@@ -37,6 +37,7 @@
 IRC_BEGIN_NAMESPACE
 
 class IrcMessage;
+class IrcProtocol;
 class IrcConnection;
 class IrcNumericMessage;
 
@@ -45,22 +46,24 @@ class IrcMessageComposer : public QObject
     Q_OBJECT
 
 public:
-    IrcMessageComposer(IrcConnection* connection);
+    IrcMessageComposer(IrcConnection* connection, IrcProtocol* protocol);
 
     static bool isComposed(int code);
 
     void composeMessage(IrcNumericMessage* message);
 
-Q_SIGNALS:
-    void messageComposed(IrcMessage* message);
-
 private:
+    bool isComposing(int type) const;
+    void beginCompose(IrcMessage* message, const QStringList& params);
     void finishCompose(IrcMessage* message);
     void replaceParam(int index, const QString& param);
 
     struct Data {
         IrcConnection* connection;
+        IrcProtocol* protocol;
         QStack<IrcMessage*> messages;
+        // built in place, assigned to the message once finished
+        QStack<QStringList> params;
     } d;
 };
 
@@ -49,6 +49,7 @@ class IRC_CORE_EXPORT IrcNetwork : public QObject
     Q_PROPERTY(QStringList prefixes READ prefixes NOTIFY prefixesChanged)
     Q_PROPERTY(QStringList channelTypes READ channelTypes NOTIFY channelTypesChanged)
     Q_PROPERTY(QStringList statusPrefixes READ statusPrefixes NOTIFY statusPrefixesChanged)
+    Q_PROPERTY(QString caseMapping READ caseMapping NOTIFY caseMappingChanged)
     Q_PROPERTY(QStringList availableCapabilities READ availableCapabilities NOTIFY availableCapabilitiesChanged)
     Q_PROPERTY(QStringList requestedCapabilities READ requestedCapabilities WRITE setRequestedCapabilities NOTIFY requestedCapabilitiesChanged)
     Q_PROPERTY(QStringList activeCapabilities READ activeCapabilities NOTIFY activeCapabilitiesChanged)
@@ -70,6 +71,7 @@ public:
 
     QStringList channelTypes() const;
     QStringList statusPrefixes() const;
+    QString caseMapping() const;
 
     Q_INVOKABLE bool isChannel(const QString& name) const;
 
@@ -120,6 +122,7 @@ Q_SIGNALS:
     void prefixesChanged(const QStringList& prefixes);
     void channelTypesChanged(const QStringList& types);
     void statusPrefixesChanged(const QStringList& prefixes);
+    void caseMappingChanged(const QString& caseMapping);
     void availableCapabilitiesChanged(const QStringList& capabilities);
     void requestedCapabilitiesChanged(const QStringList& capabilities);
     void activeCapabilitiesChanged(const QStringList& capabilities);
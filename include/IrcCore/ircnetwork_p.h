@@ -35,9 +35,52 @@
 #include <QHash>
 #include <QString>
 #include <QPointer>
+#include <QStringList>
+#include <QSharedPointer>
 
 IRC_BEGIN_NAMESPACE
 
+class IrcNetworkInfo
+{
+public:
+    static QSharedPointer<const IrcNetworkInfo> intern(const QHash<QString, QString>& tokens);
+
+    bool isChannelType(const QChar& c) const { return contains(channelTypeBits, channelTypes, c); }
+    bool isStatusPrefix(const QChar& c) const { return contains(statusPrefixBits, statusPrefixes, c); }
+    int statusPrefixLength(const QString& str) const;
+
+    QString modeToPrefix(const QString& mode) const;
+    QString prefixToMode(const QString& prefix) const;
+
+    QString key;
+    QHash<QString, QString> tokens;
+
+    QString name;
+    QString caseMapping;
+    QStringList modes, prefixes, channelTypes, statusPrefixes;
+    QStringList channelModes[4];
+    int numericLimits[IrcNetwork::MonitorCount + 1];
+    QHash<QString, int> modeLimits, channelLimits, targetLimits;
+
+private:
+    IrcNetworkInfo(const QString& key, const QHash<QString, QString>& tokens);
+    static void release(const IrcNetworkInfo* info);
+
+    static bool contains(const quint32* bits, const QStringList& list, const QChar& c)
+    {
+        const ushort u = c.unicode();
+        if (u < 128)
+            return (bits[u >> 5] & (1u << (u & 31))) != 0;
+        return list.contains(c);
+    }
+
+    // ASCII lookup tables, the rest is looked up from the lists
+    quint32 channelTypeBits[4];
+    quint32 statusPrefixBits[4];
+    ushort modePrefixes[128];
+    ushort prefixModes[128];
+};
+
 class IrcNetworkPrivate
 {
     Q_DECLARE_PUBLIC(IrcNetwork)
@@ -49,15 +92,6 @@ public:
     void setAvailableCapabilities(const QSet<QString>& capabilities);
     void setActiveCapabilities(const QSet<QString>& capabilities);
 
-    void setName(const QString& name);
-    void setModes(const QStringList& modes);
-    void setPrefixes(const QStringList& prefixes);
-    void setChannelTypes(const QStringList& types);
-    void setStatusPrefixes(const QStringList& prefixes);
-
-    static QString getPrefix(const QString& str, const QStringList& prefixes);
-    static QString removePrefix(const QString& str, const QStringList& prefixes);
-
     static IrcNetwork* create(IrcConnection* connection)
     {
         return new IrcNetwork(connection);
@@ -71,9 +105,7 @@ public:
     IrcNetwork* q_ptr;
     QPointer<IrcConnection> connection;
     bool initialized;
-    QString name;
-    QStringList modes, prefixes, channelTypes, channelModes, statusPrefixes;
-    QHash<QString, int> numericLimits, modeLimits, channelLimits, targetLimits;
+    QSharedPointer<const IrcNetworkInfo> info;
     QSet<QString> availableCaps, requestedCaps, activeCaps;
 };
 
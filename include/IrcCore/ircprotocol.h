@@ -47,6 +47,8 @@ class IRC_CORE_EXPORT IrcProtocol : public QObject
     Q_OBJECT
     Q_PROPERTY(IrcConnection* connection READ connection)
     Q_PROPERTY(QAbstractSocket* socket READ socket)
+    Q_PROPERTY(bool threaded READ isThreaded WRITE setThreaded)
+    Q_PROPERTY(bool pipelined READ isPipelined WRITE setPipelined)
 
 public:
     explicit IrcProtocol(IrcConnection* connection);
@@ -55,6 +57,12 @@ public:
     IrcConnection* connection() const;
     QAbstractSocket* socket() const;
 
+    bool isThreaded() const;
+    void setThreaded(bool threaded);
+
+    bool isPipelined() const;
+    void setPipelined(bool pipelined);
+
     virtual void open();
     virtual void close();
 
@@ -78,6 +86,7 @@ private:
 
     Q_PRIVATE_SLOT(d_func(), void _irc_pauseHandshake())
     Q_PRIVATE_SLOT(d_func(), void _irc_resumeHandshake())
+    Q_PRIVATE_SLOT(d_func(), void _irc_readParsed())
 };
 
 IRC_END_NAMESPACE
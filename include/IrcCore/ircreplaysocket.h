@@ -0,0 +1,89 @@
+/*
+  Copyright (C) 2008-2016 The Communi Project
+
+  You may use this file under the terms of BSD license as follows:
+
+  Redistribution and use in source and binary forms, with or without
+  modification, are permitted provided that the following conditions are met:
+    * Redistributions of source code must retain the above copyright
+      notice, this list of conditions and the following disclaimer.
+    * Redistributions in binary form must reproduce the above copyright
+      notice, this list of conditions and the following disclaimer in the
+      documentation and/or other materials provided with the distribution.
+    * Neither the name of the copyright holder nor the names of its
+      contributors may be used to endorse or promote products derived
+      from this software without specific prior written permission.
+
+  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+  ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+  WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+  DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDERS OR CONTRIBUTORS BE LIABLE FOR
+  ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+  (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+  ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+  (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+  SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#ifndef IRCREPLAYSOCKET_H
+#define IRCREPLAYSOCKET_H
+
+#include <IrcGlobal>
+#include <QtCore/qmetatype.h>
+#include <QtCore/qscopedpointer.h>
+#include <QtNetwork/qabstractsocket.h>
+
+IRC_BEGIN_NAMESPACE
+
+class IrcReplaySocketPrivate;
+
+class IRC_CORE_EXPORT IrcReplaySocket : public QAbstractSocket
+{
+    Q_OBJECT
+    Q_PROPERTY(bool realTime READ isRealTime WRITE setRealTime)
+
+public:
+    explicit IrcReplaySocket(QObject* parent = 0);
+    virtual ~IrcReplaySocket();
+
+    bool load(const QString& fileName);
+    bool load(QIODevice* device);
+
+    bool isRealTime() const;
+    void setRealTime(bool realTime);
+
+    qint64 bytesAvailable() const;
+    void close();
+
+#if QT_VERSION >= 0x050000
+    using QAbstractSocket::connectToHost;
+    void connectToHost(const QString& hostName, quint16 port, OpenMode mode = ReadWrite, NetworkLayerProtocol protocol = AnyIPProtocol);
+    void disconnectFromHost();
+#endif // QT_VERSION
+
+Q_SIGNALS:
+    void finished();
+
+protected:
+    qint64 readData(char* data, qint64 maxSize);
+    qint64 writeData(const char* data, qint64 size);
+
+protected Q_SLOTS:
+    void connectToHostImplementation(const QString& hostName, quint16 port, OpenMode mode = ReadWrite);
+    void disconnectFromHostImplementation();
+
+private:
+    QScopedPointer<IrcReplaySocketPrivate> d_ptr;
+    Q_DECLARE_PRIVATE(IrcReplaySocket)
+    Q_DISABLE_COPY(IrcReplaySocket)
+
+    Q_PRIVATE_SLOT(d_func(), void _irc_connect())
+    Q_PRIVATE_SLOT(d_func(), void _irc_replay())
+};
+
+IRC_END_NAMESPACE
+
+Q_DECLARE_METATYPE(IRC_PREPEND_NAMESPACE(IrcReplaySocket*))
+
+#endif // IRCREPLAYSOCKET_H
@@ -0,0 +1,112 @@
+/*
+  Copyright (C) 2008-2016 The Communi Project
+
+  You may use this file under the terms of BSD license as follows:
+
+  Redistribution and use in source and binary forms, with or without
+  modification, are permitted provided that the following conditions are met:
+    * Redistributions of source code must retain the above copyright
+      notice, this list of conditions and the following disclaimer.
+    * Redistributions in binary form must reproduce the above copyright
+      notice, this list of conditions and the following disclaimer in the
+      documentation and/or other materials provided with the distribution.
+    * Neither the name of the copyright holder nor the names of its
+      contributors may be used to endorse or promote products derived
+      from this software without specific prior written permission.
+
+  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+  ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+  WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+  DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDERS OR CONTRIBUTORS BE LIABLE FOR
+  ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+  (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+  ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+  (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+  SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#ifndef IRCTRACE_P_H
+#define IRCTRACE_P_H
+
+#include <IrcGlobal>
+#include <QtCore/qfile.h>
+#include <QtCore/qatomic.h>
+#include <QtCore/qthread.h>
+#include <QtCore/qstring.h>
+#include <QtCore/qbytearray.h>
+
+IRC_BEGIN_NAMESPACE
+
+#ifndef IRC_DOXYGEN
+struct IrcTraceRecord
+{
+    IrcTraceRecord() : stamp(0), level(0) { }
+
+    qint64 stamp;
+    int level;
+    QString name;
+    QByteArray text;
+};
+
+// bounded multi-producer single-consumer ring
+class IrcTraceRing
+{
+public:
+    explicit IrcTraceRing(int capacity);
+    ~IrcTraceRing();
+
+    // any thread, fails when the ring is full
+    bool enqueue(const IrcTraceRecord& record);
+
+    // consumer thread only
+    bool dequeue(IrcTraceRecord* record);
+
+private:
+    struct Cell
+    {
+        QAtomicInt sequence;
+        IrcTraceRecord record;
+    };
+
+    Cell* cells;
+    int mask;
+    QAtomicInt enqueuePos;
+    uint dequeuePos;
+
+    Q_DISABLE_COPY(IrcTraceRing)
+};
+
+// flushes trace records to IRC_DEBUG_FILE in a background thread
+class IrcTraceWriter : public QThread
+{
+public:
+    IrcTraceWriter();
+    // does not start the thread, used by tests
+    IrcTraceWriter(const QString& fileName, int capacity);
+    ~IrcTraceWriter();
+
+    // returns 0 unless IRC_DEBUG_FILE is set and open for writing
+    static IrcTraceWriter* instance();
+    static const char* marker(int level);
+
+    void post(const IrcTraceRecord& record);
+    void stop();
+
+protected:
+    void run();
+
+private:
+    bool open(const QString& fileName, int capacity);
+
+    QFile file;
+    IrcTraceRing* ring;
+    QAtomicInt active;
+    QAtomicInt quit;
+    QAtomicInt dropped;
+};
+#endif // IRC_DOXYGEN
+
+IRC_END_NAMESPACE
+
+#endif // IRCTRACE_P_H
@@ -0,0 +1,72 @@
+/*
+  Copyright (C) 2008-2016 The Communi Project
+
+  You may use this file under the terms of BSD license as follows:
+
+  Redistribution and use in source and binary forms, with or without
+  modification, are permitted provided that the following conditions are met:
+    * Redistributions of source code must retain the above copyright
+      notice, this list of conditions and the following disclaimer.
+    * Redistributions in binary form must reproduce the above copyright
+      notice, this list of conditions and the following disclaimer in the
+      documentation and/or other materials provided with the distribution.
+    * Neither the name of the copyright holder nor the names of its
+      contributors may be used to endorse or promote products derived
+      from this software without specific prior written permission.
+
+  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+  ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+  WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+  DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDERS OR CONTRIBUTORS BE LIABLE FOR
+  ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+  (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+  ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+  (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+  SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#ifndef IRCTRAFFICRECORDER_H
+#define IRCTRAFFICRECORDER_H
+
+#include <IrcGlobal>
+#include <QtCore/qobject.h>
+#include <QtCore/qmetatype.h>
+#include <QtCore/qscopedpointer.h>
+
+QT_FORWARD_DECLARE_CLASS(QIODevice)
+
+IRC_BEGIN_NAMESPACE
+
+class IrcConnection;
+class IrcTrafficRecorderPrivate;
+
+class IRC_CORE_EXPORT IrcTrafficRecorder : public QObject
+{
+    Q_OBJECT
+    Q_PROPERTY(IrcConnection* connection READ connection WRITE setConnection)
+
+public:
+    explicit IrcTrafficRecorder(QObject* parent = 0);
+    virtual ~IrcTrafficRecorder();
+
+    IrcConnection* connection() const;
+    void setConnection(IrcConnection* connection);
+
+    QIODevice* device() const;
+    void setDevice(QIODevice* device);
+
+    bool open(const QString& fileName);
+    void close();
+
+private:
+    QScopedPointer<IrcTrafficRecorderPrivate> d_ptr;
+    Q_DECLARE_PRIVATE(IrcTrafficRecorder)
+    Q_DISABLE_COPY(IrcTrafficRecorder)
+};
+
+IRC_END_NAMESPACE
+
+Q_DECLARE_METATYPE(IRC_PREPEND_NAMESPACE(IrcTrafficRecorder*))
+
+#endif // IRCTRAFFICRECORDER_H
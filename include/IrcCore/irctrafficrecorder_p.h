@@ -0,0 +1,75 @@
+/*
+  Copyright (C) 2008-2016 The Communi Project
+
+  You may use this file under the terms of BSD license as follows:
+
+  Redistribution and use in source and binary forms, with or without
+  modification, are permitted provided that the following conditions are met:
+    * Redistributions of source code must retain the above copyright
+      notice, this list of conditions and the following disclaimer.
+    * Redistributions in binary form must reproduce the above copyright
+      notice, this list of conditions and the following disclaimer in the
+      documentation and/or other materials provided with the distribution.
+    * Neither the name of the copyright holder nor the names of its
+      contributors may be used to endorse or promote products derived
+      from this software without specific prior written permission.
+
+  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+  ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+  WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+  DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDERS OR CONTRIBUTORS BE LIABLE FOR
+  ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+  (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+  ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+  (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+  SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#ifndef IRCTRAFFICRECORDER_P_H
+#define IRCTRAFFICRECORDER_P_H
+
+#include "irctrafficrecorder.h"
+#include "ircconnection.h"
+#include <QElapsedTimer>
+#include <QDataStream>
+#include <QByteArray>
+#include <QPointer>
+#include <QFile>
+
+IRC_BEGIN_NAMESPACE
+
+#ifndef IRC_DOXYGEN
+// "IRCR" header + version + start time, followed by
+// (direction, msecs since start, raw bytes) records
+static const quint32 IRC_RECORDING_MAGIC = 0x49524352;
+static const quint16 IRC_RECORDING_VERSION = 1;
+
+class IrcTrafficRecorderPrivate
+{
+    Q_DECLARE_PUBLIC(IrcTrafficRecorder)
+
+public:
+    IrcTrafficRecorderPrivate();
+
+    enum Direction { Read, Write };
+
+    void record(Direction direction, const QByteArray& data);
+
+    static IrcTrafficRecorderPrivate* get(IrcTrafficRecorder* recorder)
+    {
+        return recorder->d_func();
+    }
+
+    IrcTrafficRecorder* q_ptr;
+    QPointer<IrcConnection> connection;
+    QPointer<QIODevice> device;
+    QFile* file;
+    QDataStream stream;
+    QElapsedTimer timer;
+};
+#endif // IRC_DOXYGEN
+
+IRC_END_NAMESPACE
+
+#endif // IRCTRAFFICRECORDER_P_H
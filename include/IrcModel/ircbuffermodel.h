@@ -31,12 +31,14 @@
 
 #include <Irc>
 #include <IrcGlobal>
+#include <QtCore/qvariant.h>
 #include <QtCore/qmetatype.h>
 #include <QtCore/qstringlist.h>
 #include <QtCore/qabstractitemmodel.h>
 
 IRC_BEGIN_NAMESPACE
 
+class IrcUser;
 class IrcBuffer;
 class IrcChannel;
 class IrcMessage;
@@ -79,6 +81,7 @@ public:
     Q_INVOKABLE IrcBuffer* find(const QString& title) const;
     Q_INVOKABLE bool contains(const QString& title) const;
     Q_INVOKABLE int indexOf(IrcBuffer* buffer) const;
+    Q_INVOKABLE QList<IrcUser*> findUsers(const QString& pattern) const;
 
     Q_INVOKABLE IrcBuffer* add(const QString& title);
     Q_INVOKABLE void add(IrcBuffer* buffer);
@@ -119,6 +122,10 @@ public:
 
     Q_INVOKABLE QByteArray saveState(int version = 0) const;
     Q_INVOKABLE bool restoreState(const QByteArray& state, int version = 0);
+    Q_INVOKABLE QByteArray saveSnapshot(int version = 0, bool users = false) const;
+
+    Q_INVOKABLE QVariantMap statistics() const;
+    Q_INVOKABLE void resetStatistics();
 
 public Q_SLOTS:
     void clear();
@@ -165,6 +172,8 @@ private:
     Q_PRIVATE_SLOT(d_func(), void _irc_bufferDestroyed(IrcBuffer*))
     Q_PRIVATE_SLOT(d_func(), void _irc_restoreBuffers())
     Q_PRIVATE_SLOT(d_func(), void _irc_monitorStatus())
+    Q_PRIVATE_SLOT(d_func(), void _irc_joinTimeout())
+    Q_PRIVATE_SLOT(d_func(), void _irc_caseMappingChanged(const QString&))
 };
 
 IRC_END_NAMESPACE
@@ -32,10 +32,34 @@
 #include "ircbuffer.h"
 #include "ircfilter.h"
 #include "ircbuffermodel.h"
+#include "ircnickindex_p.h"
 #include <qpointer.h>
+#include <qtimer.h>
+#include <qelapsedtimer.h>
 
 IRC_BEGIN_NAMESPACE
 
+struct IrcBufferState
+{
+    IrcBufferState() : channel(false), sticky(false), persistent(false), enabled(true) { }
+
+    static IrcBufferState fromMap(const QVariantMap& map);
+    QVariantMap toMap() const;
+
+    QString title;
+    QString name;
+    QString prefix;
+    QString topic;
+    QStringList modes;
+    QStringList args;
+    QStringList users;
+    QVariantMap userData;
+    bool channel;
+    bool sticky;
+    bool persistent;
+    bool enabled;
+};
+
 class IrcBufferModelPrivate : public QObject, public IrcMessageFilter, public IrcCommandFilter
 {
     Q_OBJECT
@@ -61,10 +85,21 @@ public:
     void promoteBuffer(IrcBuffer* buffer);
 
     void restoreBuffer(IrcBuffer* buffer);
-    QVariantMap saveBuffer(IrcBuffer* buffer) const;
+    IrcBufferState saveBuffer(IrcBuffer* buffer, bool users = false) const;
+    QList<IrcBufferState> saveBuffers(bool users = false) const;
+
+    static QByteArray writeSnapshot(const QList<IrcBufferState>& states, int version, bool users);
+    static bool readSnapshot(const QByteArray& snapshot, int version, QList<IrcBufferState>* states);
 
     bool processMessage(const QString& title, IrcMessage* message, bool create = false);
 
+    void rejoin();
+    void rejoined(const QString& channel, bool joined);
+    void throttleJoins(const QString& channel = QString());
+    void processJoinReply(IrcMessage* message);
+    void finishRestore();
+    void flushMonitor();
+
     void _irc_connected();
     void _irc_initialized();
     void _irc_disconnected();
@@ -72,6 +107,8 @@ public:
 
     void _irc_restoreBuffers();
     void _irc_monitorStatus();
+    void _irc_joinTimeout();
+    void _irc_caseMappingChanged(const QString& caseMapping);
 
     static IrcBufferModelPrivate* get(IrcBufferModel* model)
     {
@@ -84,7 +121,7 @@ public:
     QList<IrcBuffer*> bufferList;
     QMap<QString, IrcBuffer*> bufferMap;
     QHash<QString, QString> keys;
-    QVariantMap bufferStates;
+    QMap<QString, IrcBufferState> bufferStates;
     QStringList channels;
     Irc::SortMethod sortMethod;
     Qt::SortOrder sortOrder;
@@ -94,6 +131,22 @@ public:
     int joinDelay;
     bool monitorEnabled;
     bool monitorPending;
+    bool monitorBatched;
+    QStringList monitorQueue;
+    QStringList joinQueue;
+    QList<QStringList> joinLines;
+    QTimer joinTimer;
+    int joinWindow;
+    int joinBackoff;
+    bool joinThrottled;
+    bool restoring;
+    QElapsedTimer restoreTimer;
+    int restoreTime;
+    int joinCommands;
+    int joinedChannels;
+    int failedChannels;
+    int joinThrottles;
+    IrcNickIndex nickIndex;
 };
 
 IRC_END_NAMESPACE
@@ -32,9 +32,11 @@
 #include <IrcGlobal>
 #include <IrcBuffer>
 #include <QtCore/qmetatype.h>
+#include <QtCore/qstringlist.h>
 
 IRC_BEGIN_NAMESPACE
 
+class IrcUser;
 class IrcChannelPrivate;
 
 class IRC_MODEL_EXPORT IrcChannel : public IrcBuffer
@@ -54,6 +56,11 @@ public:
 
     virtual bool isActive() const;
 
+    Q_INVOKABLE QStringList masks(const QString& mode = QLatin1String("b")) const;
+    Q_INVOKABLE QStringList matchingMasks(const QString& prefix, const QString& mode = QLatin1String("b")) const;
+    Q_INVOKABLE QStringList matchingMasks(IrcUser* user, const QString& mode = QLatin1String("b")) const;
+    Q_INVOKABLE QList<IrcUser*> matchingUsers(const QString& mask) const;
+
 public Q_SLOTS:
     void who();
     void join(const QString& key = QString());
@@ -64,6 +71,7 @@ Q_SIGNALS:
     void keyChanged(const QString& key);
     void modeChanged(const QString& mode);
     void topicChanged(const QString& topic);
+    void masksChanged(const QString& mode, const QStringList& masks);
     void destroyed(IrcChannel* channel);
 private:
     Q_DECLARE_PRIVATE(IrcChannel)
@@ -32,12 +32,41 @@
 #include "ircchannel.h"
 #include "ircnetwork.h"
 #include "ircbuffer_p.h"
+#include "ircmaskmatcher_p.h"
+#include "irc.h"
 #include <qstringlist.h>
 #include <qlist.h>
+#include <qhash.h>
 #include <qmap.h>
 
 IRC_BEGIN_NAMESPACE
 
+class IrcUser;
+
+#ifndef IRC_DOXYGEN
+// channel users sorted by one sort key, shared by all matching user models
+class IrcUserIndex
+{
+public:
+    IrcUserIndex(Irc::SortMethod method, Qt::SortOrder order);
+
+    void reset(const QList<IrcUser*>& list);
+    void insert(IrcUser* user);
+    void remove(IrcUser* user);
+    void reinsert(IrcUser* user);
+
+    Irc::SortMethod method;
+    Qt::SortOrder order;
+    QList<IrcUser*> users;
+    // the users in between remove and insert of the last reinsert()
+    QList<IrcUser*> removed;
+    // the rows affected by the last change, or -1
+    int removedRow;
+    int insertedRow;
+    int ref;
+};
+#endif // IRC_DOXYGEN
+
 class IrcChannelPrivate : public IrcBufferPrivate
 {
     Q_DECLARE_PUBLIC(IrcChannel)
@@ -66,6 +95,14 @@ public:
     bool setUserAway(const QString &name, bool away);
     void setUserServOp(const QString &name, bool servOp);
 
+    IrcMaskMatcher* maskMatcher(const QString& mode) const;
+    bool changeMask(const QString& mode, const QString& mask, bool add);
+    void setMasks(const QString& mode, const QStringList& masks);
+    QString userPrefix(IrcUser* user) const;
+
+    IrcUserIndex* acquireUserIndex(Irc::SortMethod method, Qt::SortOrder order);
+    void releaseUserIndex(IrcUserIndex* index);
+
     virtual bool processAwayMessage(IrcAwayMessage* message);
     virtual bool processJoinMessage(IrcJoinMessage* message);
     virtual bool processKickMessage(IrcKickMessage* message);
@@ -94,6 +131,9 @@ public:
     QList<IrcUser*> activeUsers;
     QMap<QString, IrcUser*> userMap;
     QList<IrcUserModel*> userModels;
+    QList<IrcUserIndex*> userIndexes;
+    mutable QMap<QString, IrcMaskMatcher*> maskMatchers;
+    QHash<QString, QStringList> maskReplies;
 };
 
 IRC_END_NAMESPACE
@@ -0,0 +1,120 @@
+/*
+  Copyright (C) 2008-2016 The Communi Project
+
+  You may use this file under the terms of BSD license as follows:
+
+  Redistribution and use in source and binary forms, with or without
+  modification, are permitted provided that the following conditions are met:
+    * Redistributions of source code must retain the above copyright
+      notice, this list of conditions and the following disclaimer.
+    * Redistributions in binary form must reproduce the above copyright
+      notice, this list of conditions and the following disclaimer in the
+      documentation and/or other materials provided with the distribution.
+    * Neither the name of the copyright holder nor the names of its
+      contributors may be used to endorse or promote products derived
+      from this software without specific prior written permission.
+
+  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+  ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+  WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+  DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDERS OR CONTRIBUTORS BE LIABLE FOR
+  ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+  (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+  ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+  (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+  SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#ifndef IRCMASKMATCHER_P_H
+#define IRCMASKMATCHER_P_H
+
+#include <IrcGlobal>
+#include <qhash.h>
+#include <qlist.h>
+#include <qmap.h>
+#include <qstring.h>
+#include <qstringlist.h>
+
+IRC_BEGIN_NAMESPACE
+
+#ifndef IRC_DOXYGEN
+// a case folded "nick!ident@host" mask split into the literal parts
+// around its '*' wildcards, where '?' matches any single character
+class IrcCompiledMask
+{
+public:
+    IrcCompiledMask(const QString& mask, const QString& caseMapping);
+
+    bool match(const QString& folded) const;
+
+    QString mask;
+    QString pattern;
+    QStringList parts;
+    int length;
+};
+
+// list mode masks, indexed by the literal prefix of the mask or its
+// host, or by the literal suffix of the mask, so that only the masks
+// that may match a user are tested
+class IrcMaskMatcher
+{
+public:
+    explicit IrcMaskMatcher(const QString& caseMapping = QString());
+    ~IrcMaskMatcher();
+
+    QString caseMapping() const;
+    void setCaseMapping(const QString& caseMapping);
+
+    QStringList masks() const;
+    void setMasks(const QStringList& masks);
+
+    bool insert(const QString& mask);
+    bool remove(const QString& mask);
+
+    QStringList match(const QString& prefix) const;
+
+    static QString fold(const QString& str, const QString& caseMapping);
+    static QString normalize(const QString& mask);
+
+private:
+    enum Key { MaskPrefix, HostPrefix, MaskSuffix, KeyCount };
+
+    void clear();
+    void index(IrcCompiledMask* mask, bool add);
+    void lookup(Key key, const QString& str, QList<IrcCompiledMask*>* candidates) const;
+
+    QString mapping;
+    QList<IrcCompiledMask*> list;
+    QHash<QString, IrcCompiledMask*> patterns;
+    QHash<QString, QList<IrcCompiledMask*> > keys[KeyCount];
+    QMap<int, int> lengths[KeyCount];
+    QList<IrcCompiledMask*> wild;
+
+    Q_DISABLE_COPY(IrcMaskMatcher)
+};
+
+// inline, so that other modules can fold names without linking to the matcher
+inline QString IrcMaskMatcher::fold(const QString& str, const QString& caseMapping)
+{
+    const bool ascii = caseMapping == QLatin1String("ascii");
+    const ushort upper = caseMapping == QLatin1String("strict-rfc1459") ? ']' : '^';
+
+    QString folded = str;
+    QChar* data = folded.data();
+    for (int i = 0; i < folded.length(); ++i) {
+        const ushort c = data[i].unicode();
+        if (c >= 'A' && c <= 'Z')
+            data[i] = QChar(ushort(c + 32));
+        else if (!ascii && c >= '[' && c <= upper)
+            data[i] = QChar(ushort(c + 32)); // []\^ -> {}|~
+        else if (!ascii && c > 127)
+            data[i] = data[i].toLower();
+    }
+    return folded;
+}
+#endif // IRC_DOXYGEN
+
+IRC_END_NAMESPACE
+
+#endif // IRCMASKMATCHER_P_H
@@ -0,0 +1,85 @@
+/*
+  Copyright (C) 2008-2016 The Communi Project
+
+  You may use this file under the terms of BSD license as follows:
+
+  Redistribution and use in source and binary forms, with or without
+  modification, are permitted provided that the following conditions are met:
+    * Redistributions of source code must retain the above copyright
+      notice, this list of conditions and the following disclaimer.
+    * Redistributions in binary form must reproduce the above copyright
+      notice, this list of conditions and the following disclaimer in the
+      documentation and/or other materials provided with the distribution.
+    * Neither the name of the copyright holder nor the names of its
+      contributors may be used to endorse or promote products derived
+      from this software without specific prior written permission.
+
+  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+  ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+  WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+  DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDERS OR CONTRIBUTORS BE LIABLE FOR
+  ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+  (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+  ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+  (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+  SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#ifndef IRCNICKINDEX_P_H
+#define IRCNICKINDEX_P_H
+
+#include <IrcGlobal>
+#include <qhash.h>
+#include <qlist.h>
+#include <qset.h>
+#include <qstring.h>
+
+IRC_BEGIN_NAMESPACE
+
+class IrcUser;
+
+#ifndef IRC_DOXYGEN
+struct IrcNickEntry
+{
+    QString nick; // folded
+    QString host; // folded "ident@host", or empty if unknown
+    QString mask; // folded "nick!ident@host", or empty if unknown
+    QList<IrcUser*> users;
+};
+
+// the users of all channels, interned by nick and indexed by trigrams
+class IrcNickIndex
+{
+public:
+    IrcNickIndex();
+    ~IrcNickIndex();
+
+    void insert(IrcUser* user);
+    void remove(IrcUser* user);
+    void rename(IrcUser* user, const QString& from);
+    void setHost(const QString& nick, const QString& ident, const QString& host);
+    void setCaseMapping(const QString& caseMapping);
+
+    int count() const;
+    QList<IrcUser*> find(const QString& pattern) const;
+
+private:
+    typedef QHash<quint64, QSet<IrcNickEntry*> > Trigrams;
+
+    QString fold(const QString& str) const;
+    QString takeUser(IrcUser* user, const QString& name);
+    void insertUser(IrcUser* user, const QString& name, const QString& host);
+    static void index(Trigrams* trigrams, const QString& text, IrcNickEntry* entry);
+    static void unindex(Trigrams* trigrams, const QString& text, IrcNickEntry* entry);
+
+    QHash<QString, IrcNickEntry*> entries;
+    Trigrams nicks;
+    Trigrams masks;
+    QString caseMapping;
+};
+#endif // IRC_DOXYGEN
+
+IRC_END_NAMESPACE
+
+#endif // IRCNICKINDEX_P_H
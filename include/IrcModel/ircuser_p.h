@@ -54,6 +54,8 @@ public:
     QString name;
     QString prefix;
     QString mode;
+    QString title;
+    QString host; // "ident@host", if known
     bool servOp;
     bool away;
 };
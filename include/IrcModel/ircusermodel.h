@@ -54,8 +54,21 @@ class IRC_MODEL_EXPORT IrcUserModel : public QAbstractListModel
     Q_PROPERTY(IrcChannel* channel READ channel WRITE setChannel NOTIFY channelChanged)
     Q_PROPERTY(Irc::SortMethod sortMethod READ sortMethod WRITE setSortMethod)
     Q_PROPERTY(Qt::SortOrder sortOrder READ sortOrder WRITE setSortOrder)
+    Q_PROPERTY(FilterFlags filterFlags READ filterFlags WRITE setFilterFlags NOTIFY filterChanged)
+    Q_PROPERTY(QString prefixFilter READ prefixFilter WRITE setPrefixFilter NOTIFY filterChanged)
+    Q_PROPERTY(QString nameFilter READ nameFilter WRITE setNameFilter NOTIFY filterChanged)
+    Q_ENUMS(FilterFlag)
+    Q_FLAGS(FilterFlags)
 
 public:
+    enum FilterFlag {
+        NoFilter = 0x0,
+        AwayFilter = 0x1,
+        PresentFilter = 0x2,
+        ServOpFilter = 0x4
+    };
+    Q_DECLARE_FLAGS(FilterFlags, FilterFlag)
+
     explicit IrcUserModel(QObject* parent = 0);
     virtual ~IrcUserModel();
 
@@ -81,6 +94,15 @@ public:
     Qt::SortOrder sortOrder() const;
     void setSortOrder(Qt::SortOrder order);
 
+    FilterFlags filterFlags() const;
+    void setFilterFlags(FilterFlags flags);
+
+    QString prefixFilter() const;
+    void setPrefixFilter(const QString& prefixes);
+
+    QString nameFilter() const;
+    void setNameFilter(const QString& filter);
+
     QModelIndex index(IrcUser* user) const;
     IrcUser* user(const QModelIndex& index) const;
 
@@ -105,6 +127,7 @@ Q_SIGNALS:
     void titlesChanged(const QStringList& titles);
     void usersChanged(const QList<IrcUser*>& users);
     void channelChanged(IrcChannel* channel);
+    void filterChanged();
 
 protected:
     virtual bool lessThan(IrcUser* one, IrcUser* another, Irc::SortMethod method) const;
@@ -118,6 +141,8 @@ private:
     Q_DISABLE_COPY(IrcUserModel)
 };
 
+Q_DECLARE_OPERATORS_FOR_FLAGS(IrcUserModel::FilterFlags)
+
 IRC_END_NAMESPACE
 
 Q_DECLARE_METATYPE(IRC_PREPEND_NAMESPACE(IrcUserModel*))
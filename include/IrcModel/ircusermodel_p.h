@@ -51,7 +51,25 @@ public:
     void setUserMode(IrcUser* user);
     void promoteUser(IrcUser* user);
     bool updateUser(IrcUser* user);
+    void updateUserStatus(IrcUser* user);
     bool updateTitles();
+    void buildTitles() const;
+    bool hasReceivers(const char* signal) const;
+
+    bool isFiltered() const;
+    bool acceptsUser(IrcUser* user) const;
+    QList<IrcUser*> filterUsers(const QList<IrcUser*>& users) const;
+    bool refilterUser(IrcUser* user);
+    void refilter();
+    QStringList userNames() const;
+    void emitNamesChanged();
+
+    bool hasDefaultSort() const;
+    void sortUsers(QList<IrcUser*>& users, Irc::SortMethod method, Qt::SortOrder order);
+    void updateIndex();
+    void releaseIndex();
+
+    static bool lessThan(IrcUser* one, IrcUser* another, Irc::SortMethod method);
 
     static IrcUserModelPrivate* get(IrcUserModel* model)
     {
@@ -60,11 +78,16 @@ public:
 
     IrcUserModel* q_ptr;
     Irc::DataRole role;
-    QStringList titles;
+    mutable QStringList titles;
+    mutable bool titlesDirty;
     QList<IrcUser*> userList;
     QPointer<IrcChannel> channel;
     Irc::SortMethod sortMethod;
     Qt::SortOrder sortOrder;
+    IrcUserModel::FilterFlags filterFlags;
+    QString prefixFilter;
+    QString nameFilter;
+    IrcUserIndex* shared;
 };
 
 IRC_END_NAMESPACE
@@ -32,6 +32,7 @@
 #include <IrcGlobal>
 #include <IrcCommand>
 #include <QtCore/qobject.h>
+#include <QtCore/qvariant.h>
 #include <QtCore/qmetatype.h>
 #include <QtCore/qstringlist.h>
 
@@ -82,6 +83,9 @@ public:
 
     Q_INVOKABLE IrcCommand* parse(const QString& input) const;
 
+    Q_INVOKABLE QVariantMap statistics() const;
+    Q_INVOKABLE void resetStatistics();
+
 public Q_SLOTS:
     void clear();
     void reset();
@@ -32,7 +32,9 @@
 #include "irccommandparser.h"
 #include "irccommand.h"
 
+#include <QHash>
 #include <QList>
+#include <QBitArray>
 #include <QString>
 #include <QMultiMap>
 #include <QStringList>
@@ -62,6 +64,7 @@ struct IrcCommandInfo
     IrcCommand::Type type;
     QString command;
     QString syntax;
+    QString visual;
     int min, max;
     QList<IrcParameterInfo> params;
 };
@@ -72,13 +75,20 @@ public:
     IrcCommandParserPrivate();
 
     QList<IrcCommandInfo> find(const QString& command) const;
+    QStringList findPrefixed(const QString& prefix) const;
+    void updateIndex(const QString& command);
     static IrcCommandInfo parseSyntax(IrcCommand::Type type, const QString& syntax);
+    static QString formatSyntax(const IrcCommandInfo& command, IrcCommandParser::Details details);
     IrcCommand* parseCommand(const IrcCommandInfo& command, const QString& input) const;
     bool processParameters(const IrcCommandInfo& command, const QString& input, QStringList* params) const;
     bool processCommand(QString* input, int* removed = 0) const;
     bool processMessage(QString* input, int* removed = 0) const;
     bool onChannel() const;
 
+    void updateFilter();
+    bool filterInput(const QString& input) const;
+    bool filterCommand(const QString& input, int pos) const;
+
     static IrcCommandParserPrivate* get(IrcCommandParser* parser)
     {
         return parser->d_func();
@@ -89,6 +99,13 @@ public:
     QStringList triggers;
     QStringList channels;
     QMultiMap<QString, IrcCommandInfo> commands;
+    QHash<QString, QList<IrcCommandInfo> > index;
+    QBitArray commandChars;
+    QBitArray triggerChars;
+    bool wideTriggers;
+    mutable qint64 hits;
+    mutable qint64 misses;
+    mutable qint64 parsed;
 };
 
 IRC_END_NAMESPACE
@@ -31,6 +31,8 @@
 
 #include <IrcGlobal>
 #include <QtCore/qobject.h>
+#include <QtCore/qvariant.h>
+#include <QtCore/qstringlist.h>
 #include <QtCore/qmetatype.h>
 #include <QtCore/qscopedpointer.h>
 
@@ -44,6 +46,10 @@ class IRC_UTIL_EXPORT IrcCommandQueue : public QObject
     Q_OBJECT
     Q_PROPERTY(int batch READ batch WRITE setBatch)
     Q_PROPERTY(int interval READ interval WRITE setInterval)
+    Q_PROPERTY(int byteRate READ byteRate WRITE setByteRate)
+    Q_PROPERTY(bool splitting READ isSplitting WRITE setSplitting)
+    Q_PROPERTY(bool packing READ isPacking WRITE setPacking)
+    Q_PROPERTY(QStringList services READ services WRITE setServices)
     Q_PROPERTY(int size READ size NOTIFY sizeChanged)
     Q_PROPERTY(IrcConnection* connection READ connection WRITE setConnection)
 
@@ -57,11 +63,26 @@ public:
     int interval() const;
     void setInterval(int seconds);
 
+    int byteRate() const;
+    void setByteRate(int bytes);
+
+    bool isSplitting() const;
+    void setSplitting(bool splitting);
+
+    bool isPacking() const;
+    void setPacking(bool packing);
+
+    QStringList services() const;
+    void setServices(const QStringList& services);
+
     int size() const;
 
     IrcConnection* connection() const;
     void setConnection(IrcConnection* connection);
 
+    Q_INVOKABLE QVariantMap statistics() const;
+    Q_INVOKABLE void resetStatistics();
+
 public Q_SLOTS:
     void clear();
     void flush();
@@ -31,32 +31,94 @@
 
 #include "irccommandqueue.h"
 #include "ircfilter.h"
+#include <QElapsedTimer>
 #include <QPointer>
 #include <QQueue>
 #include <QTimer>
+#include <QHash>
 
 IRC_BEGIN_NAMESPACE
 
-class IrcCommandQueuePrivate : public QObject,  public IrcCommandFilter
+struct IrcQueuedCommand
+{
+    IrcQueuedCommand() : bytes(-1), queued(0) { }
+    QPointer<IrcCommand> command;
+    int bytes;
+    qint64 queued;
+};
+
+class IrcCommandLane
+{
+public:
+    bool isEmpty() const { return order.isEmpty(); }
+    void enqueue(const QString& target, const IrcQueuedCommand& cmd);
+    IrcQueuedCommand& head();
+    IrcQueuedCommand& head(const QString& target);
+    IrcQueuedCommand dequeue();
+    IrcQueuedCommand dequeue(const QString& target);
+    QList<IrcQueuedCommand> takeAll();
+    QList<QString> targets() const { return order; }
+
+private:
+    QQueue<QString> order;
+    QHash<QString, QQueue<IrcQueuedCommand> > commands;
+};
+
+class IrcCommandQueuePrivate : public QObject, public IrcCommandFilter, public IrcCommandValueFilter, public IrcMessageFilter
 {
     Q_OBJECT
-    Q_INTERFACES(IrcCommandFilter)
+    Q_INTERFACES(IrcCommandFilter IrcCommandValueFilter IrcMessageFilter)
     Q_DECLARE_PUBLIC(IrcCommandQueue)
 
 public:
+    enum Lane { High, Normal, LaneCount };
+
     IrcCommandQueuePrivate();
 
     bool commandFilter(IrcCommand* cmd);
+    bool commandValueFilter(const IrcCommandValue& cmd);
+    bool messageFilter(IrcMessage* msg);
 
     void _irc_updateTimer();
     void _irc_sendBatch(bool force = false);
 
+    IrcCommandLane* nextLane();
+    void refill();
+    void resetCredit();
+    int capacity() const;
+    int cost(IrcQueuedCommand* cmd) const;
+    void clear();
+
+    void enqueue(IrcCommand* cmd);
+    void updateStatistics(const IrcQueuedCommand& queued);
+    QList<IrcCommand*> split(IrcCommand* cmd) const;
+    void pack(IrcCommand* cmd, IrcCommandLane* lane);
+    int prefixLength() const;
+    int lineLength(IrcCommand* cmd) const;
+
+    Lane lane(IrcCommand* cmd) const;
+    QString target(IrcCommand* cmd) const;
+
     IrcCommandQueue* q_ptr;
     IrcConnection* connection;
     QTimer timer;
+    QElapsedTimer clock;
     int batch;
     int interval;
-    QQueue<QPointer<IrcCommand> > commands;
+    int byteRate;
+    int size;
+    bool splitting;
+    bool packing;
+    QString prefix;
+    QStringList services;
+    qint64 credit;
+    qint64 refilled;
+    IrcCommandLane lanes[LaneCount];
+
+    qint64 sent;
+    qint64 totalWait;
+    qint64 maxWait;
+    int maxSize;
 };
 
 IRC_END_NAMESPACE
@@ -0,0 +1,106 @@
+/*
+  Copyright (C) 2008-2016 The Communi Project
+
+  You may use this file under the terms of BSD license as follows:
+
+  Redistribution and use in source and binary forms, with or without
+  modification, are permitted provided that the following conditions are met:
+    * Redistributions of source code must retain the above copyright
+      notice, this list of conditions and the following disclaimer.
+    * Redistributions in binary form must reproduce the above copyright
+      notice, this list of conditions and the following disclaimer in the
+      documentation and/or other materials provided with the distribution.
+    * Neither the name of the copyright holder nor the names of its
+      contributors may be used to endorse or promote products derived
+      from this software without specific prior written permission.
+
+  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+  ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+  WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+  DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDERS OR CONTRIBUTORS BE LIABLE FOR
+  ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+  (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+  ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+  (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+  SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#ifndef IRCCONNECTIONPOOL_H
+#define IRCCONNECTIONPOOL_H
+
+#include <IrcGlobal>
+#include <QtCore/qlist.h>
+#include <QtCore/qobject.h>
+#include <QtCore/qvariant.h>
+#include <QtCore/qmetatype.h>
+#include <QtCore/qscopedpointer.h>
+#include <QtNetwork/qhostinfo.h>
+
+IRC_BEGIN_NAMESPACE
+
+class IrcConnection;
+class IrcConnectionPoolPrivate;
+
+class IRC_UTIL_EXPORT IrcConnectionPool : public QObject
+{
+    Q_OBJECT
+    Q_PROPERTY(int count READ count NOTIFY countChanged)
+    Q_PROPERTY(int concurrency READ concurrency WRITE setConcurrency)
+    Q_PROPERTY(int interval READ interval WRITE setInterval)
+    Q_PROPERTY(int minimumDelay READ minimumDelay WRITE setMinimumDelay)
+    Q_PROPERTY(int maximumDelay READ maximumDelay WRITE setMaximumDelay)
+    Q_PROPERTY(QVariantMap statistics READ statistics NOTIFY statisticsChanged)
+
+public:
+    explicit IrcConnectionPool(QObject* parent = 0);
+    virtual ~IrcConnectionPool();
+
+    int count() const;
+    QList<IrcConnection*> connections() const;
+    bool contains(IrcConnection* connection) const;
+
+    Q_INVOKABLE void addConnection(IrcConnection* connection);
+    Q_INVOKABLE void removeConnection(IrcConnection* connection);
+
+    int concurrency() const;
+    void setConcurrency(int connections);
+
+    int interval() const;
+    void setInterval(int msecs);
+
+    int minimumDelay() const;
+    void setMinimumDelay(int seconds);
+
+    int maximumDelay() const;
+    void setMaximumDelay(int seconds);
+
+    QVariantMap statistics() const;
+    Q_INVOKABLE void resetStatistics();
+
+public Q_SLOTS:
+    void open();
+    void close();
+
+Q_SIGNALS:
+    void countChanged(int count);
+    void connectionAdded(IrcConnection* connection);
+    void connectionRemoved(IrcConnection* connection);
+    void statisticsChanged(const QVariantMap& statistics);
+
+private:
+    QScopedPointer<IrcConnectionPoolPrivate> d_ptr;
+    Q_DECLARE_PRIVATE(IrcConnectionPool)
+    Q_DISABLE_COPY(IrcConnectionPool)
+
+    Q_PRIVATE_SLOT(d_func(), void _irc_dispatch())
+    Q_PRIVATE_SLOT(d_func(), void _irc_statusChanged())
+    Q_PRIVATE_SLOT(d_func(), void _irc_destroyed(QObject* connection))
+    Q_PRIVATE_SLOT(d_func(), void _irc_lookedUp(const QHostInfo& info))
+};
+
+IRC_END_NAMESPACE
+
+Q_DECLARE_METATYPE(IRC_PREPEND_NAMESPACE(IrcConnectionPool*))
+
+#endif // IRCCONNECTIONPOOL_H
@@ -0,0 +1,100 @@
+/*
+  Copyright (C) 2008-2016 The Communi Project
+
+  You may use this file under the terms of BSD license as follows:
+
+  Redistribution and use in source and binary forms, with or without
+  modification, are permitted provided that the following conditions are met:
+    * Redistributions of source code must retain the above copyright
+      notice, this list of conditions and the following disclaimer.
+    * Redistributions in binary form must reproduce the above copyright
+      notice, this list of conditions and the following disclaimer in the
+      documentation and/or other materials provided with the distribution.
+    * Neither the name of the copyright holder nor the names of its
+      contributors may be used to endorse or promote products derived
+      from this software without specific prior written permission.
+
+  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+  ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+  WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+  DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDERS OR CONTRIBUTORS BE LIABLE FOR
+  ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+  (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+  ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+  (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+  SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#ifndef IRCCONNECTIONPOOL_P_H
+#define IRCCONNECTIONPOOL_P_H
+
+#include "ircconnectionpool.h"
+#include <QElapsedTimer>
+#include <QMultiMap>
+#include <QTimer>
+#include <QHash>
+#include <QSet>
+
+IRC_BEGIN_NAMESPACE
+
+struct IrcPooledConnection
+{
+    IrcPooledConnection() : reconnectDelay(0), attempts(0), due(-1), started(-1), connected(false) { }
+
+    int reconnectDelay;
+    int attempts;
+    qint64 due;
+    qint64 started;
+    bool connected;
+};
+
+class IrcConnectionPoolPrivate
+{
+    Q_DECLARE_PUBLIC(IrcConnectionPool)
+
+public:
+    IrcConnectionPoolPrivate();
+
+    void _irc_dispatch();
+    void _irc_statusChanged();
+    void _irc_destroyed(QObject* connection);
+    void _irc_lookedUp(const QHostInfo& info);
+
+    void schedule(IrcConnection* connection, qint64 delay);
+    void unschedule(IrcConnection* connection);
+    void start(IrcConnection* connection);
+    void release(IrcConnection* connection);
+    void forget(IrcConnection* connection);
+    bool resolve(IrcConnection* connection);
+    qint64 backoff(int attempts);
+    void updateStatistics();
+
+    IrcConnectionPool* q_ptr;
+    QList<IrcConnection*> connections;
+    QHash<IrcConnection*, IrcPooledConnection> pooled;
+    QMultiMap<qint64, IrcConnection*> queue;
+    QSet<IrcConnection*> pending;
+    QHash<QString, qint64> hosts;
+    QHash<int, QString> lookups;
+    QTimer timer;
+    QElapsedTimer clock;
+    bool opened;
+    int concurrency;
+    int interval;
+    int minimumDelay;
+    int maximumDelay;
+    qint64 last;
+    quint32 seed;
+    // counters for the statistics
+    int attempts;
+    int failures;
+    int disconnects;
+    int resolved;
+    qint64 connectTime;
+    int connectCount;
+};
+
+IRC_END_NAMESPACE
+
+#endif // IRCCONNECTIONPOOL_P_H
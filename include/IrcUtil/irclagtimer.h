@@ -31,6 +31,7 @@
 
 #include <IrcGlobal>
 #include <QtCore/qobject.h>
+#include <QtCore/qvariant.h>
 #include <QtCore/qmetatype.h>
 #include <QtCore/qscopedpointer.h>
 
@@ -44,6 +45,9 @@ class IRC_UTIL_EXPORT IrcLagTimer : public QObject
     Q_OBJECT
     Q_PROPERTY(qint64 lag READ lag NOTIFY lagChanged)
     Q_PROPERTY(int interval READ interval WRITE setInterval)
+    Q_PROPERTY(int window READ window WRITE setWindow)
+    Q_PROPERTY(bool passive READ isPassive WRITE setPassive)
+    Q_PROPERTY(QVariantMap statistics READ statistics NOTIFY statisticsChanged)
     Q_PROPERTY(IrcConnection* connection READ connection WRITE setConnection)
 
 public:
@@ -58,8 +62,18 @@ public:
     int interval() const;
     void setInterval(int seconds);
 
+    int window() const;
+    void setWindow(int samples);
+
+    bool isPassive() const;
+    void setPassive(bool passive);
+
+    QVariantMap statistics() const;
+    Q_INVOKABLE void resetStatistics();
+
 Q_SIGNALS:
     void lagChanged(qint64 lag);
+    void statisticsChanged(const QVariantMap& statistics);
 
 private:
     QScopedPointer<IrcLagTimerPrivate> d_ptr;
@@ -30,14 +30,52 @@
 #define IRCLAGTIMER_P_H
 
 #include "irclagtimer.h"
+#include "ircconnection_p.h"
 #include "ircfilter.h"
+#include <QElapsedTimer>
+#include <QVector>
+#include <QQueue>
 #include <QTimer>
+#include <QHash>
 
 IRC_BEGIN_NAMESPACE
 
 class IrcPongMessage;
 
-class IrcLagTimerPrivate : public QObject,  public IrcMessageFilter
+class IrcLatencyHistogram
+{
+public:
+    IrcLatencyHistogram();
+
+    int window() const { return samples.size(); }
+    void setWindow(int window);
+
+    int count() const { return size; }
+    void add(qint64 usecs);
+    void clear();
+
+    qint64 minimum() const;
+    qint64 maximum() const;
+    qint64 percentile(double percent) const;
+
+    static int bucket(qint64 usecs);
+    static qint64 highestEquivalent(int bucket);
+
+private:
+    QVector<qint64> samples;
+    QVector<int> buckets;
+    int next;
+    int size;
+};
+
+struct IrcEchoedCommand
+{
+    QString target;
+    QString content;
+    qint64 sent;
+};
+
+class IrcLagTimerPrivate : public QObject, public IrcMessageFilter, public IrcWriteObserver
 {
     Q_OBJECT
     Q_INTERFACES(IrcMessageFilter)
@@ -47,7 +85,9 @@ public:
     IrcLagTimerPrivate();
 
     bool messageFilter(IrcMessage* msg);
+    void lineWritten(const QByteArray& line);
     bool processPongReply(IrcPongMessage* msg);
+    void processEcho(const QString& target, const QString& content);
 
     void _irc_connected();
     void _irc_pingServer();
@@ -55,12 +95,21 @@ public:
 
     void updateTimer();
     void updateLag(qint64 value);
+    void addSample(qint64 usecs);
+    qint64 now() const;
 
     IrcLagTimer* q_ptr;
-    IrcConnection* connection;
+    QPointer<IrcConnection> connection;
     QTimer timer;
     int interval;
     qint64 lag;
+    bool passive;
+    QElapsedTimer clock;
+    QHash<QString, qint64> pings;
+    QQueue<IrcEchoedCommand> echoes;
+    IrcLatencyHistogram histogram;
+    qint64 last;
+    qint64 measured;
 };
 
 IRC_END_NAMESPACE
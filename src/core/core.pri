@@ -12,6 +12,8 @@ INCLUDEPATH += $$PWD $$INCDIR
 CONV_HEADERS  = $$INCDIR/Irc
 CONV_HEADERS += $$INCDIR/IrcCommand
 CONV_HEADERS += $$INCDIR/IrcCommandFilter
+CONV_HEADERS += $$INCDIR/IrcCommandValue
+CONV_HEADERS += $$INCDIR/IrcCommandValueFilter
 CONV_HEADERS += $$INCDIR/IrcConnection
 CONV_HEADERS += $$INCDIR/IrcCore
 CONV_HEADERS += $$INCDIR/IrcGlobal
@@ -19,6 +21,8 @@ CONV_HEADERS += $$INCDIR/IrcMessage
 CONV_HEADERS += $$INCDIR/IrcMessageFilter
 CONV_HEADERS += $$INCDIR/IrcNetwork
 CONV_HEADERS += $$INCDIR/IrcProtocol
+CONV_HEADERS += $$INCDIR/IrcReplaySocket
+CONV_HEADERS += $$INCDIR/IrcTrafficRecorder
 
 PUB_HEADERS  = $$INCDIR/irc.h
 PUB_HEADERS += $$INCDIR/irccommand.h
@@ -29,14 +33,19 @@ PUB_HEADERS += $$INCDIR/ircglobal.h
 PUB_HEADERS += $$INCDIR/ircmessage.h
 PUB_HEADERS += $$INCDIR/ircnetwork.h
 PUB_HEADERS += $$INCDIR/ircprotocol.h
+PUB_HEADERS += $$INCDIR/ircreplaysocket.h
+PUB_HEADERS += $$INCDIR/irctrafficrecorder.h
 
 PRIV_HEADERS  = $$INCDIR/irccommand_p.h
 PRIV_HEADERS += $$INCDIR/ircconnection_p.h
 PRIV_HEADERS += $$INCDIR/ircdebug_p.h
+PRIV_HEADERS += $$INCDIR/irclinereader_p.h
 PRIV_HEADERS += $$INCDIR/ircmessage_p.h
 PRIV_HEADERS += $$INCDIR/ircmessagecomposer_p.h
 PRIV_HEADERS += $$INCDIR/ircmessagedecoder_p.h
 PRIV_HEADERS += $$INCDIR/ircnetwork_p.h
+PRIV_HEADERS += $$INCDIR/irctrace_p.h
+PRIV_HEADERS += $$INCDIR/irctrafficrecorder_p.h
 
 HEADERS += $$PUB_HEADERS
 HEADERS += $$PRIV_HEADERS
@@ -46,12 +55,16 @@ SOURCES += $$PWD/irccommand.cpp
 SOURCES += $$PWD/ircconnection.cpp
 SOURCES += $$PWD/irccore.cpp
 SOURCES += $$PWD/ircfilter.cpp
+SOURCES += $$PWD/irclinereader.cpp
 SOURCES += $$PWD/ircmessage.cpp
 SOURCES += $$PWD/ircmessage_p.cpp
 SOURCES += $$PWD/ircmessagecomposer.cpp
 SOURCES += $$PWD/ircmessagedecoder.cpp
 SOURCES += $$PWD/ircnetwork.cpp
 SOURCES += $$PWD/ircprotocol.cpp
+SOURCES += $$PWD/ircreplaysocket.cpp
+SOURCES += $$PWD/irctrace.cpp
+SOURCES += $$PWD/irctrafficrecorder.cpp
 
 include(pkg.pri)
 
@@ -74,3 +87,5 @@ CONFIG(icu, icu|no_icu|uchardet) {
 } else {
     SOURCES += $$PWD/ircmessagedecoder_none.cpp
 }
+
+no_metrics:DEFINES += IRC_NO_METRICS
@@ -261,7 +261,7 @@ IRC_BEGIN_NAMESPACE
  */
 
 #ifndef IRC_DOXYGEN
-IrcCommandPrivate::IrcCommandPrivate() : type(IrcCommand::Custom), encoding("UTF-8")
+IrcCommandPrivate::IrcCommandPrivate() : type(IrcCommand::Custom), encoding("UTF-8"), builtIn(false)
 {
 }
 
@@ -270,11 +270,129 @@ QString IrcCommandPrivate::params(int index) const
     return QStringList(parameters.mid(index)).join(QLatin1String(" "));
 }
 
+// appends UTF-8 without an intermediate QByteArray
+static void irc_append_utf8(QByteArray* out, const QString& str)
+{
+    const int len = str.length();
+    const int pos = out->size();
+    out->resize(pos + 3 * len);
+    char* dst = out->data() + pos;
+    const ushort* src = str.utf16();
+    for (int i = 0; i < len; ++i) {
+        uint u = src[i];
+        if (u < 0x80) {
+            *dst++ = static_cast<char>(u);
+        } else if (u < 0x800) {
+            *dst++ = static_cast<char>(0xc0 | (u >> 6));
+            *dst++ = static_cast<char>(0x80 | (u & 0x3f));
+        } else if ((u & 0xf800) != 0xd800) {
+            *dst++ = static_cast<char>(0xe0 | (u >> 12));
+            *dst++ = static_cast<char>(0x80 | ((u >> 6) & 0x3f));
+            *dst++ = static_cast<char>(0x80 | (u & 0x3f));
+        } else if ((u & 0xfc00) == 0xd800 && i + 1 < len && (src[i + 1] & 0xfc00) == 0xdc00) {
+            u = QChar::surrogateToUcs4(u, src[++i]);
+            *dst++ = static_cast<char>(0xf0 | (u >> 18));
+            *dst++ = static_cast<char>(0x80 | ((u >> 12) & 0x3f));
+            *dst++ = static_cast<char>(0x80 | ((u >> 6) & 0x3f));
+            *dst++ = static_cast<char>(0x80 | (u & 0x3f));
+        } else {
+            *dst++ = '?'; // lone surrogate
+        }
+    }
+    out->resize(dst - out->constData());
+}
+
+// uniform parameter access for IrcCommand and IrcCommandValue parameters
+static inline int irc_param_count(const QStringList& params) { return params.count(); }
+static inline int irc_param_count(const IrcCommandValue& params) { return params.count(); }
+static inline QString irc_param(const QStringList& params, int index) { return params.value(index); }
+static inline QString irc_param(const IrcCommandValue& params, int index) { return params.parameter(index); }
+
+template <typename Params>
+static void irc_append_params(QByteArray* out, const Params& params, int from)
+{
+    const int count = irc_param_count(params);
+    for (int i = from; i < count; ++i) {
+        if (i > from)
+            out->append(' ');
+        irc_append_utf8(out, irc_param(params, i));
+    }
+}
+
+// literal command prefix followed by the first parameter
+static void irc_append_command(QByteArray* out, const char* prefix, const QString& param)
+{
+    out->append(prefix);
+    irc_append_utf8(out, param);
+}
+
+// the UTF-8 equivalent of IrcCommand::toString(), written into a reusable buffer
+template <typename Params>
+static bool irc_serialize(QByteArray* out, IrcCommand::Type type, const Params& parameters)
+{
+    out->resize(0);
+    const QString p0 = irc_param(parameters, 0);
+    const QString p1 = irc_param(parameters, 1);
+    const QString p2 = irc_param(parameters, 2);
+
+    switch (type) {
+        case IrcCommand::Admin:         irc_append_command(out, "ADMIN ", p0); break;
+        case IrcCommand::Away:          out->append("AWAY :"); irc_append_params(out, parameters, 0); break;
+        case IrcCommand::Capability:    irc_append_command(out, "CAP ", p0); out->append(" :"); irc_append_params(out, parameters, 1); break;
+        case IrcCommand::CtcpAction:    irc_append_command(out, "PRIVMSG ", p0); out->append(" :\1ACTION "); irc_append_params(out, parameters, 1); out->append('\1'); break;
+        case IrcCommand::CtcpRequest:   irc_append_command(out, "PRIVMSG ", p0); out->append(" :\1"); irc_append_params(out, parameters, 1); out->append('\1'); break;
+        case IrcCommand::CtcpReply:     irc_append_command(out, "NOTICE ", p0); out->append(" :\1"); irc_append_params(out, parameters, 1); out->append('\1'); break;
+        case IrcCommand::Info:          irc_append_command(out, "INFO ", p0); break;
+        case IrcCommand::Invite:        irc_append_command(out, "INVITE ", p0); irc_append_command(out, " ", p1); break;
+        case IrcCommand::Join:          irc_append_command(out, "JOIN ", p0); if (!p1.isNull()) irc_append_command(out, " ", p1); break;
+        case IrcCommand::Kick:          irc_append_command(out, "KICK ", p0); irc_append_command(out, " ", p1); if (!p2.isNull()) { out->append(" :"); irc_append_params(out, parameters, 2); } break;
+        case IrcCommand::Knock:         irc_append_command(out, "KNOCK ", p0); irc_append_command(out, " ", p1); break;
+        case IrcCommand::List:          irc_append_command(out, "LIST ", p0); if (!p1.isNull()) irc_append_command(out, " ", p1); break;
+        case IrcCommand::Message:       irc_append_command(out, "PRIVMSG ", p0); out->append(" :"); irc_append_params(out, parameters, 1); break;
+        case IrcCommand::Mode:          out->append("MODE "); irc_append_params(out, parameters, 0); break;
+        case IrcCommand::Monitor:       irc_append_command(out, "MONITOR ", p0); irc_append_command(out, " ", p1); break;
+        case IrcCommand::Motd:          irc_append_command(out, "MOTD ", p0); break;
+        case IrcCommand::Names:         irc_append_command(out, "NAMES ", p0); break;
+        case IrcCommand::Nick:          irc_append_command(out, "NICK ", p0); break;
+        case IrcCommand::Notice:        irc_append_command(out, "NOTICE ", p0); out->append(" :"); irc_append_params(out, parameters, 1); break;
+        case IrcCommand::Part:          irc_append_command(out, "PART ", p0); if (!p1.isNull()) { out->append(" :"); irc_append_params(out, parameters, 1); } break;
+        case IrcCommand::Ping:          irc_append_command(out, "PING ", p0); break;
+        case IrcCommand::Pong:          irc_append_command(out, "PONG ", p0); break;
+        case IrcCommand::Quit:          out->append("QUIT :"); irc_append_params(out, parameters, 0); break;
+        case IrcCommand::Quote:         irc_append_params(out, parameters, 0); break;
+        case IrcCommand::Stats:         irc_append_command(out, "STATS ", p0); irc_append_command(out, " ", p1); break;
+        case IrcCommand::Time:          irc_append_command(out, "TIME ", p0); break;
+        case IrcCommand::Topic:         irc_append_command(out, "TOPIC ", p0); if (!p1.isNull()) { out->append(" :"); irc_append_params(out, parameters, 1); } break;
+        case IrcCommand::Trace:         irc_append_command(out, "TRACE ", p0); break;
+        case IrcCommand::Users:         irc_append_command(out, "USERS ", p0); break;
+        case IrcCommand::Version:       if (p0.isNull()) out->append("VERSION"); else { irc_append_command(out, "PRIVMSG ", p0); out->append(" :\1VERSION\1"); } break;
+        case IrcCommand::Who:           irc_append_command(out, "WHO ", p0); break;
+        case IrcCommand::Whois:         irc_append_command(out, "WHOIS ", p0); irc_append_command(out, " ", p0); break;
+        case IrcCommand::Whowas:        irc_append_command(out, "WHOWAS ", p0); irc_append_command(out, " ", p0); break;
+
+        case IrcCommand::Custom:
+        default:                        return false;
+    }
+    return true;
+}
+
+bool IrcCommandPrivate::serialize(QByteArray* out) const
+{
+    return irc_serialize(out, type, parameters);
+}
+
+bool IrcCommandPrivate::serialize(QByteArray* out, const IrcCommandValue& command)
+{
+    return irc_serialize(out, command.type(), command);
+}
+
 IrcCommand* IrcCommandPrivate::createCommand(IrcCommand::Type type, const QStringList& parameters)
 {
     IrcCommand* command = new IrcCommand;
     command->setType(type);
     command->setParameters(parameters);
+    // created by the library, so toString() cannot be reimplemented
+    IrcCommandPrivate::get(command)->builtIn = true;
     return command;
 }
 #endif // IRC_DOXYGEN
@@ -896,6 +1014,223 @@ IrcCommand* IrcCommand::createWhowas(const QString& user, int count)
     return IrcCommandPrivate::createCommand(Whowas, QStringList() << user << QString::number(count));
 }
 
+/*!
+    \class IrcCommandValue irccommand.h <IrcCommandValue>
+    \ingroup core
+    \brief Provides a lightweight value type for the most common commands.
+    \since 3.6
+
+    IrcCommandValue is an alternative to IrcCommand for applications that send
+    large amounts of commands, such as bots. Unlike IrcCommand, it is not a QObject,
+    it holds up to three parameters inline, and it is cheap to copy. Sending it via
+    IrcConnection::sendCommand(const IrcCommandValue&) does not allocate any command
+    objects, unless command filters are installed on the connection.
+
+    \code
+    connection->sendCommand(IrcCommandValue::createMessage("#communi", "Hello"));
+    \endcode
+
+    \sa IrcCommand, IrcConnection::sendCommand()
+ */
+
+#ifndef IRC_DOXYGEN
+Q_GLOBAL_STATIC_WITH_ARGS(QByteArray, irc_default_encoding, ("UTF-8"))
+#endif // IRC_DOXYGEN
+
+/*!
+    Constructs an invalid command value of type IrcCommand::Custom without parameters.
+ */
+IrcCommandValue::IrcCommandValue() : m_type(IrcCommand::Custom), m_count(0), m_encoding(*irc_default_encoding())
+{
+}
+
+/*!
+    Constructs a command value of \a type with up to three parameters.
+
+    Trailing null parameters are not counted.
+ */
+IrcCommandValue::IrcCommandValue(IrcCommand::Type type, const QString& param1, const QString& param2, const QString& param3)
+    : m_type(type), m_count(!param3.isNull() ? 3 : !param2.isNull() ? 2 : !param1.isNull() ? 1 : 0), m_encoding(*irc_default_encoding())
+{
+    m_params[0] = param1;
+    m_params[1] = param2;
+    m_params[2] = param3;
+}
+
+#ifndef IRC_DOXYGEN
+IrcCommandValue::IrcCommandValue(IrcCommand::Type type, int count, const QString& param1, const QString& param2, const QString& param3)
+    : m_type(type), m_count(count), m_encoding(*irc_default_encoding())
+{
+    m_params[0] = param1;
+    m_params[1] = param2;
+    m_params[2] = param3;
+}
+#endif // IRC_DOXYGEN
+
+/*!
+    Returns the command type.
+ */
+IrcCommand::Type IrcCommandValue::type() const
+{
+    return m_type;
+}
+
+/*!
+    Returns the number of parameters.
+ */
+int IrcCommandValue::count() const
+{
+    return m_count;
+}
+
+/*!
+    Returns the parameter at \a index, or a null string if \a index is out of range.
+ */
+QString IrcCommandValue::parameter(int index) const
+{
+    if (index < 0 || index >= m_count)
+        return QString();
+    return m_params[index];
+}
+
+/*!
+    Returns the parameters as a list.
+ */
+QStringList IrcCommandValue::parameters() const
+{
+    QStringList params;
+    for (int i = 0; i < m_count; ++i)
+        params += m_params[i];
+    return params;
+}
+
+/*!
+    Returns the encoding.
+
+    The default value is \c "UTF-8".
+
+    \sa IrcCommand::encoding
+ */
+QByteArray IrcCommandValue::encoding() const
+{
+    return m_encoding;
+}
+
+/*!
+    Sets the \a encoding.
+ */
+void IrcCommandValue::setEncoding(const QByteArray& encoding)
+{
+    m_encoding = encoding;
+}
+
+/*!
+    Returns the command as a string, equal to IrcCommand::toString().
+ */
+QString IrcCommandValue::toString() const
+{
+    QByteArray data;
+    if (IrcCommandPrivate::serialize(&data, *this))
+        return QString::fromUtf8(data.constData(), data.length());
+    return QString();
+}
+
+/*!
+    Creates an equivalent IrcCommand with \a parent.
+
+    The caller takes ownership of the command, unless it is sent via
+    IrcConnection::sendCommand().
+ */
+IrcCommand* IrcCommandValue::toCommand(QObject* parent) const
+{
+    IrcCommand* command = new IrcCommand(parent);
+    command->setType(m_type);
+    command->setParameters(parameters());
+    command->setEncoding(m_encoding);
+    IrcCommandPrivate::get(command)->builtIn = true;
+    return command;
+}
+
+/*!
+    Creates a command value equivalent to IrcCommand::createCtcpAction().
+ */
+IrcCommandValue IrcCommandValue::createCtcpAction(const QString& target, const QString& action)
+{
+    return IrcCommandValue(IrcCommand::CtcpAction, 2, target, action, QString());
+}
+
+/*!
+    Creates a command value equivalent to IrcCommand::createJoin().
+ */
+IrcCommandValue IrcCommandValue::createJoin(const QString& channel, const QString& key)
+{
+    return IrcCommandValue(IrcCommand::Join, 2, channel, key, QString());
+}
+
+/*!
+    Creates a command value equivalent to IrcCommand::createMessage().
+ */
+IrcCommandValue IrcCommandValue::createMessage(const QString& target, const QString& message)
+{
+    return IrcCommandValue(IrcCommand::Message, 2, target, message, QString());
+}
+
+/*!
+    Creates a command value equivalent to IrcCommand::createMode().
+ */
+IrcCommandValue IrcCommandValue::createMode(const QString& target, const QString& mode, const QString& arg)
+{
+    return IrcCommandValue(IrcCommand::Mode, 3, target, mode, arg);
+}
+
+/*!
+    Creates a command value equivalent to IrcCommand::createNick().
+ */
+IrcCommandValue IrcCommandValue::createNick(const QString& nick)
+{
+    return IrcCommandValue(IrcCommand::Nick, 1, nick, QString(), QString());
+}
+
+/*!
+    Creates a command value equivalent to IrcCommand::createNotice().
+ */
+IrcCommandValue IrcCommandValue::createNotice(const QString& target, const QString& notice)
+{
+    return IrcCommandValue(IrcCommand::Notice, 2, target, notice, QString());
+}
+
+/*!
+    Creates a command value equivalent to IrcCommand::createPart().
+ */
+IrcCommandValue IrcCommandValue::createPart(const QString& channel, const QString& reason)
+{
+    return IrcCommandValue(IrcCommand::Part, 2, channel, reason, QString());
+}
+
+/*!
+    Creates a command value equivalent to IrcCommand::createPing().
+ */
+IrcCommandValue IrcCommandValue::createPing(const QString& argument)
+{
+    return IrcCommandValue(IrcCommand::Ping, 1, argument, QString(), QString());
+}
+
+/*!
+    Creates a command value equivalent to IrcCommand::createPong().
+ */
+IrcCommandValue IrcCommandValue::createPong(const QString& argument)
+{
+    return IrcCommandValue(IrcCommand::Pong, 1, argument, QString(), QString());
+}
+
+/*!
+    Creates a command value equivalent to IrcCommand::createQuit().
+ */
+IrcCommandValue IrcCommandValue::createQuit(const QString& reason)
+{
+    return IrcCommandValue(IrcCommand::Quit, 1, reason, QString(), QString());
+}
+
 #ifndef QT_NO_DEBUG_STREAM
 QDebug operator<<(QDebug debug, IrcCommand::Type type)
 {
@@ -920,6 +1255,16 @@ QDebug operator<<(QDebug debug, const IrcCommand* command)
     debug.nospace() << ')';
     return debug.space();
 }
+
+QDebug operator<<(QDebug debug, const IrcCommandValue& command)
+{
+    debug.nospace() << "IrcCommandValue(type=" << command.type();
+    QString str = command.toString();
+    if (!str.isEmpty())
+        debug.nospace() << ", " << str.left(20);
+    debug.nospace() << ')';
+    return debug.space();
+}
 #endif // QT_NO_DEBUG_STREAM
 
 #include "moc_irccommand.cpp"
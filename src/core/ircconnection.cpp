@@ -48,12 +48,103 @@
 #ifndef QT_NO_SSL
 #include <QSslSocket>
 #include <QSslError>
+#include <QSslConfiguration>
+#include <QSslCertificate>
+#include <QCryptographicHash>
 #endif // QT_NO_SSL
+#include <QCache>
+#include <QMutex>
 #include <QDataStream>
 #include <QVariantMap>
 
 IRC_BEGIN_NAMESPACE
 
+// IrcMessage::Batch is the last message type
+static const int MESSAGE_TYPE_COUNT = IrcMessage::Batch + 1;
+static const quint64 ALL_MESSAGE_TYPES = ~Q_UINT64_C(0);
+
+#if QT_VERSION >= 0x050000
+class IrcSignalTable
+{
+public:
+    IrcSignalTable()
+    {
+        received = QMetaMethod::fromSignal(&IrcConnection::messageReceived);
+        types[IrcMessage::Account] = QMetaMethod::fromSignal(&IrcConnection::accountMessageReceived);
+        types[IrcMessage::Away] = QMetaMethod::fromSignal(&IrcConnection::awayMessageReceived);
+        types[IrcMessage::Batch] = QMetaMethod::fromSignal(&IrcConnection::batchMessageReceived);
+        types[IrcMessage::Capability] = QMetaMethod::fromSignal(&IrcConnection::capabilityMessageReceived);
+        types[IrcMessage::Error] = QMetaMethod::fromSignal(&IrcConnection::errorMessageReceived);
+        types[IrcMessage::HostChange] = QMetaMethod::fromSignal(&IrcConnection::hostChangeMessageReceived);
+        types[IrcMessage::Invite] = QMetaMethod::fromSignal(&IrcConnection::inviteMessageReceived);
+        types[IrcMessage::Join] = QMetaMethod::fromSignal(&IrcConnection::joinMessageReceived);
+        types[IrcMessage::Kick] = QMetaMethod::fromSignal(&IrcConnection::kickMessageReceived);
+        types[IrcMessage::Mode] = QMetaMethod::fromSignal(&IrcConnection::modeMessageReceived);
+        types[IrcMessage::Motd] = QMetaMethod::fromSignal(&IrcConnection::motdMessageReceived);
+        types[IrcMessage::Names] = QMetaMethod::fromSignal(&IrcConnection::namesMessageReceived);
+        types[IrcMessage::Nick] = QMetaMethod::fromSignal(&IrcConnection::nickMessageReceived);
+        types[IrcMessage::Notice] = QMetaMethod::fromSignal(&IrcConnection::noticeMessageReceived);
+        types[IrcMessage::Numeric] = QMetaMethod::fromSignal(&IrcConnection::numericMessageReceived);
+        types[IrcMessage::Part] = QMetaMethod::fromSignal(&IrcConnection::partMessageReceived);
+        types[IrcMessage::Ping] = QMetaMethod::fromSignal(&IrcConnection::pingMessageReceived);
+        types[IrcMessage::Pong] = QMetaMethod::fromSignal(&IrcConnection::pongMessageReceived);
+        types[IrcMessage::Private] = QMetaMethod::fromSignal(&IrcConnection::privateMessageReceived);
+        types[IrcMessage::Quit] = QMetaMethod::fromSignal(&IrcConnection::quitMessageReceived);
+        types[IrcMessage::Topic] = QMetaMethod::fromSignal(&IrcConnection::topicMessageReceived);
+        types[IrcMessage::Whois] = QMetaMethod::fromSignal(&IrcConnection::whoisMessageReceived);
+        types[IrcMessage::Whowas] = QMetaMethod::fromSignal(&IrcConnection::whowasMessageReceived);
+        types[IrcMessage::WhoReply] = QMetaMethod::fromSignal(&IrcConnection::whoReplyMessageReceived);
+    }
+
+    QMetaMethod received;
+    QMetaMethod types[MESSAGE_TYPE_COUNT];
+};
+
+Q_GLOBAL_STATIC(IrcSignalTable, irc_signal_table)
+#endif // QT_VERSION
+
+#if !defined(QT_NO_SSL) && QT_VERSION >= 0x050200
+// the least recently used sessions are evicted
+static const int SESSION_CACHE_SIZE = 100;
+
+class IrcSessionCache
+{
+public:
+    IrcSessionCache() : sessions(SESSION_CACHE_SIZE) { }
+
+    QByteArray session(const QSslSocket* socket, const QString& host, int port)
+    {
+        QMutexLocker locker(&mutex);
+        const QByteArray* session = sessions.object(key(socket, host, port));
+        return session ? *session : QByteArray();
+    }
+
+    void setSession(const QSslSocket* socket, const QString& host, int port, const QByteArray& session)
+    {
+        QMutexLocker locker(&mutex);
+        sessions.insert(key(socket, host, port), new QByteArray(session));
+    }
+
+private:
+    // a session is only resumed with the same server name and client
+    // certificate, so that one identity cannot resume the session of another
+    static QString key(const QSslSocket* socket, const QString& host, int port)
+    {
+        QString name = socket->peerVerifyName();
+        if (name.isEmpty())
+            name = host;
+        const QByteArray cert = socket->localCertificate().digest(QCryptographicHash::Sha256).toHex();
+        return host.toLower() + QLatin1Char(':') + QString::number(port) + QLatin1Char('/')
+             + name.toLower() + QLatin1Char('/') + QString::fromLatin1(cert);
+    }
+
+    QMutex mutex;
+    QCache<QString, QByteArray> sessions;
+};
+
+Q_GLOBAL_STATIC(IrcSessionCache, irc_session_cache)
+#endif // !QT_NO_SSL && QT_VERSION
+
 /*!
     \file ircconnection.h
     \brief \#include &lt;IrcConnection&gt;
@@ -88,6 +179,14 @@ IRC_BEGIN_NAMESPACE
     for convenience. See messageReceived() and IrcMessage and its
     subclasses for more details.
 
+    \section headless-clients Headless clients
+
+    Bots, bouncers and other headless clients that only care about a few
+    message types may avoid the signal machinery altogether by installing
+    an IrcMessageFilter for the message types they are interested in. See
+    installMessageFilter(). The messageReceived() and message type specific
+    signals are not emitted at all when nothing is connected to them.
+
     \section sending-commands Sending commands
 
     Sending commands to a server is most conveniently done by creating
@@ -261,8 +360,14 @@ IrcConnectionPrivate::IrcConnectionPrivate() :
     realName(),
     enabled(true),
     status(IrcConnection::Inactive),
+    dispatchFilters(MESSAGE_TYPE_COUNT),
     pendingOpen(false),
-    closed(false)
+    closed(false),
+    resumption(false),
+    handshakes(0),
+    metricsEnabled(false),
+    debugMatch(-1),
+    commandCodec(0)
 {
 }
 
@@ -273,6 +378,8 @@ void IrcConnectionPrivate::init(IrcConnection* connection)
     connection->setSocket(new QTcpSocket(connection));
     connection->setProtocol(new IrcProtocol(connection));
     QObject::connect(&reconnecter, SIGNAL(timeout()), connection, SLOT(_irc_reconnect()));
+    QObject::connect(&reporter, SIGNAL(timeout()), connection, SLOT(_irc_reportStatistics()));
+    sendBuffer.reserve(512);
 }
 
 void IrcConnectionPrivate::_irc_connected()
@@ -324,6 +431,27 @@ void IrcConnectionPrivate::_irc_sslErrors()
     emit q->secureError();
 }
 
+void IrcConnectionPrivate::_irc_encrypted()
+{
+#ifndef QT_NO_SSL
+    ++handshakes;
+    _irc_sessionTicket();
+#endif // !QT_NO_SSL
+}
+
+void IrcConnectionPrivate::_irc_sessionTicket()
+{
+#if !defined(QT_NO_SSL) && QT_VERSION >= 0x050200
+    QSslSocket* ssl = qobject_cast<QSslSocket*>(socket);
+    IrcSessionCache* cache = irc_session_cache();
+    if (ssl && cache && resumption) {
+        const QByteArray session = ssl->sslConfiguration().sessionTicket();
+        if (!session.isEmpty())
+            cache->setSession(ssl, host, port, session);
+    }
+#endif // !QT_NO_SSL && QT_VERSION
+}
+
 void IrcConnectionPrivate::_irc_state(QAbstractSocket::SocketState state)
 {
     Q_Q(IrcConnection);
@@ -357,15 +485,41 @@ void IrcConnectionPrivate::_irc_reconnect()
 
 void IrcConnectionPrivate::_irc_readData()
 {
+    if (metricsEnabled)
+        metrics.bytesIn += socket->bytesAvailable();
     protocol->read();
 }
 
+void IrcConnectionPrivate::_irc_reportStatistics()
+{
+    Q_Q(IrcConnection);
+    emit q->statisticsReported(q->statistics());
+}
+
 void IrcConnectionPrivate::_irc_filterDestroyed(QObject* filter)
 {
-    messageFilters.removeAll(filter);
+    if (messageFilters.removeAll(filter)) {
+        messageFilterTypes.remove(filter);
+        updateMessageFilters();
+    }
     commandFilters.removeAll(filter);
 }
 
+void IrcConnectionPrivate::updateMessageFilters()
+{
+    // resolve the interfaces once and index the filters by message type
+    for (int i = 0; i < MESSAGE_TYPE_COUNT; ++i)
+        dispatchFilters[i].clear();
+    foreach (QObject* object, messageFilters) {
+        IrcMessageFilter* filter = qobject_cast<IrcMessageFilter*>(object);
+        const quint64 types = messageFilterTypes.value(object, ALL_MESSAGE_TYPES);
+        for (int i = 0; filter && i < MESSAGE_TYPE_COUNT; ++i) {
+            if (types & (Q_UINT64_C(1) << i))
+                dispatchFilters[i] += filter;
+        }
+    }
+}
+
 static bool parseServer(const QString& server, QString* host, int* port, bool* ssl)
 {
     QStringList p = server.split(QRegExp("[: ]"), QString::SkipEmptyParts);
@@ -394,6 +548,17 @@ void IrcConnectionPrivate::open()
             q->setPort(p);
             q->setSecure(s);
         }
+#if !defined(QT_NO_SSL) && QT_VERSION >= 0x050200
+        // offer the session of the previous connection to the same host
+        QSslSocket* ssl = qobject_cast<QSslSocket*>(socket);
+        IrcSessionCache* cache = irc_session_cache();
+        if (ssl && cache && resumption) {
+            QSslConfiguration config = ssl->sslConfiguration();
+            config.setSslOption(QSsl::SslOptionDisableSessionPersistence, false);
+            config.setSessionTicket(cache->session(ssl, host, port));
+            ssl->setSslConfiguration(config);
+        }
+#endif // !QT_NO_SSL && QT_VERSION
         socket->connectToHost(host, port);
     }
 }
@@ -441,8 +606,10 @@ void IrcConnectionPrivate::setInfo(const QHash<QString, QString>& info)
     IrcNetworkPrivate* priv = IrcNetworkPrivate::get(network);
     priv->setInfo(info);
     const QString newName = q->displayName();
-    if (oldName != newName)
+    if (oldName != newName) {
+        debugMatch = -1;
         emit q->displayNameChanged(newName);
+    }
 }
 
 bool IrcConnectionPrivate::receiveMessage(IrcMessage* msg)
@@ -463,16 +630,36 @@ bool IrcConnectionPrivate::receiveMessage(IrcMessage* msg)
     }
 
     bool filtered = false;
-    for (int i = messageFilters.count() - 1; !filtered && i >= 0; --i) {
-        IrcMessageFilter* filter = qobject_cast<IrcMessageFilter*>(messageFilters.at(i));
-        if (filter)
-            filtered |= filter->messageFilter(msg);
+    const int type = msg->type();
+    if (metricsEnabled && type >= 0 && type < MESSAGE_TYPE_COUNT)
+        ++metrics.messages[type];
+
+    {
+        IRC_METRICS_TIMER(activeMetrics(), Filter);
+        if (type >= 0 && type < MESSAGE_TYPE_COUNT) {
+            // a filter may remove filters, or delete itself
+            const QVector<IrcMessageFilter*>& filters = dispatchFilters.at(type);
+            for (int i = filters.count() - 1; !filtered && i >= 0; --i) {
+                if (i < filters.count())
+                    filtered |= filters.at(i)->messageFilter(msg);
+            }
+        } else {
+            for (int i = messageFilters.count() - 1; !filtered && i >= 0; --i) {
+                IrcMessageFilter* filter = qobject_cast<IrcMessageFilter*>(messageFilters.at(i));
+                if (filter)
+                    filtered |= filter->messageFilter(msg);
+            }
+        }
     }
 
-    if (!filtered) {
+    IRC_METRICS_TIMER(filtered ? 0 : activeMetrics(), Dispatch);
+
+    // skip the signal emission altogether when nobody is listening
+    if (!filtered && isSignalConnected(-1))
         emit q->messageReceived(msg);
 
-        switch (msg->type()) {
+    if (!filtered && isSignalConnected(type)) {
+        switch (type) {
         case IrcMessage::Account:
             emit q->accountMessageReceived(static_cast<IrcAccountMessage*>(msg));
             break;
@@ -557,6 +744,33 @@ bool IrcConnectionPrivate::receiveMessage(IrcMessage* msg)
     return !filtered;
 }
 
+bool IrcConnectionPrivate::isSignalConnected(int type) const
+{
+#if QT_VERSION >= 0x050000
+    Q_Q(const IrcConnection);
+    const IrcSignalTable* table = irc_signal_table();
+    if (type == -1)
+        return q->isSignalConnected(table->received);
+    if (type >= 0 && type < MESSAGE_TYPE_COUNT)
+        return q->isSignalConnected(table->types[type]);
+    return false;
+#else
+    // Qt 4 has no cheap way of telling whether a signal is connected
+    Q_UNUSED(type);
+    return true;
+#endif // QT_VERSION
+}
+
+QTextCodec* IrcConnectionPrivate::codecForCommand(const QByteArray& encoding)
+{
+    // commands rarely change encoding, resolve it once
+    if (!commandCodec || encoding != commandEncoding) {
+        commandCodec = QTextCodec::codecForName(encoding);
+        commandEncoding = encoding;
+    }
+    return commandCodec;
+}
+
 IrcCommand* IrcConnectionPrivate::createCtcpReply(IrcPrivateMessage* request)
 {
     Q_Q(IrcConnection);
@@ -629,6 +843,7 @@ IrcConnection* IrcConnection::clone(QObject *parent) const
     connection->setEnabled(isEnabled());
     connection->setReconnectDelay(reconnectDelay());
     connection->setSecure(isSecure());
+    connection->setSessionResumptionEnabled(isSessionResumptionEnabled());
     connection->setSaslMechanism(saslMechanism());
     return connection;
 }
@@ -692,8 +907,10 @@ void IrcConnection::setHost(const QString& host)
         d->host = host;
         emit hostChanged(host);
         const QString newName = displayName();
-        if (oldName != newName)
+        if (oldName != newName) {
+            d->debugMatch = -1;
             emit displayNameChanged(newName);
+        }
     }
 }
 
@@ -954,6 +1171,7 @@ void IrcConnection::setDisplayName(const QString& name)
     Q_D(IrcConnection);
     if (d->displayName != name) {
         d->displayName = name;
+        d->debugMatch = -1;
         emit displayNameChanged(name);
     }
 }
@@ -1143,8 +1361,13 @@ void IrcConnection::setSocket(QAbstractSocket* socket)
             connect(socket, SIGNAL(readyRead()), this, SLOT(_irc_readData()));
             connect(socket, SIGNAL(error(QAbstractSocket::SocketError)), this, SLOT(_irc_error(QAbstractSocket::SocketError)));
             connect(socket, SIGNAL(stateChanged(QAbstractSocket::SocketState)), this, SLOT(_irc_state(QAbstractSocket::SocketState)));
-            if (isSecure())
+            if (isSecure()) {
                 connect(socket, SIGNAL(sslErrors(QList<QSslError>)), this, SLOT(_irc_sslErrors()));
+                connect(socket, SIGNAL(encrypted()), this, SLOT(_irc_encrypted()));
+#if QT_VERSION >= 0x050F00
+                connect(socket, SIGNAL(newSessionTicketReceived()), this, SLOT(_irc_sessionTicket()));
+#endif // QT_VERSION
+            }
         }
     }
 }
@@ -1213,6 +1436,124 @@ void IrcConnection::setSecure(bool secure)
 #endif // !QT_NO_SSL
 }
 
+/*!
+    \since 3.6
+    \property bool IrcConnection::sessionResumption
+    This property holds whether secure sessions are resumed when reconnecting.
+
+    When enabled, the TLS session negotiated with a host is cached and
+    offered to the server the next time a connection to the same host and
+    port is opened with the same peer verify name and client certificate.
+    A server that accepts the session skips the expensive part of the
+    handshake. The cache is shared by all connections within
+    the application, and holds the sessions of up to 100 recently
+    used hosts.
+
+    The default value is \c false.
+
+    \note Session resumption relies on functionality introduced in Qt 5.2.0,
+          and is therefore not functional when built against earlier versions of Qt.
+
+    \par Access functions:
+    \li bool <b>isSessionResumptionEnabled</b>() const
+    \li void <b>setSessionResumptionEnabled</b>(bool enabled)
+
+    \par Notifier signal:
+    \li void <b>sessionResumptionChanged</b>(bool enabled)
+
+    \sa secure, statistics()
+ */
+bool IrcConnection::isSessionResumptionEnabled() const
+{
+    Q_D(const IrcConnection);
+    return d->resumption;
+}
+
+void IrcConnection::setSessionResumptionEnabled(bool enabled)
+{
+    Q_D(IrcConnection);
+    if (d->resumption != enabled) {
+        d->resumption = enabled;
+        emit sessionResumptionChanged(enabled);
+    }
+}
+
+/*!
+    \since 3.6
+    \property bool IrcConnection::metricsEnabled
+    This property holds whether traffic and timing metrics are collected.
+
+    When enabled, the connection counts the bytes and lines it reads and
+    writes, and the received messages per type. Every 16th message is
+    additionally timed while being parsed, filtered and dispatched. The
+    collected metrics are included in statistics().
+
+    The default value is \c false.
+
+    \note The timing metrics are not available when the library is built
+          with \c IRC_NO_METRICS defined (configure \c -no-metrics).
+
+    \par Access functions:
+    \li bool <b>isMetricsEnabled</b>() const
+    \li void <b>setMetricsEnabled</b>(bool enabled)
+
+    \par Notifier signal:
+    \li void <b>metricsEnabledChanged</b>(bool enabled)
+
+    \sa statistics(), statisticsInterval
+ */
+bool IrcConnection::isMetricsEnabled() const
+{
+    Q_D(const IrcConnection);
+    return d->metricsEnabled;
+}
+
+void IrcConnection::setMetricsEnabled(bool enabled)
+{
+    Q_D(IrcConnection);
+    if (d->metricsEnabled != enabled) {
+        d->metricsEnabled = enabled;
+        emit metricsEnabledChanged(enabled);
+    }
+}
+
+/*!
+    \since 3.6
+    \property int IrcConnection::statisticsInterval
+    This property holds the statistics report interval in milliseconds.
+
+    When positive, statisticsReported() is emitted periodically with the
+    current statistics(). The default value is \c 0, which means that
+    statistics are not reported.
+
+    \par Access functions:
+    \li int <b>statisticsInterval</b>() const
+    \li void <b>setStatisticsInterval</b>(int interval)
+
+    \par Notifier signal:
+    \li void <b>statisticsIntervalChanged</b>(int interval)
+
+    \sa statisticsReported(), metricsEnabled
+ */
+int IrcConnection::statisticsInterval() const
+{
+    Q_D(const IrcConnection);
+    return d->reporter.isActive() ? d->reporter.interval() : 0;
+}
+
+void IrcConnection::setStatisticsInterval(int interval)
+{
+    Q_D(IrcConnection);
+    interval = qMax(0, interval);
+    if (statisticsInterval() != interval) {
+        if (interval > 0)
+            d->reporter.start(interval);
+        else
+            d->reporter.stop();
+        emit statisticsIntervalChanged(interval);
+    }
+}
+
 /*!
     \deprecated Use Irc::isSecureSupported() instead.
  */
@@ -1434,9 +1775,15 @@ bool IrcConnection::sendCommand(IrcCommand* command)
         if (filtered) {
             res = false;
         } else {
-            QTextCodec* codec = QTextCodec::codecForName(command->encoding());
+            QTextCodec* codec = d->codecForCommand(command->encoding());
             Q_ASSERT(codec);
-            res = sendData(codec->fromUnicode(command->toString()));
+            // commands created by IrcCommand's factories are written straight to UTF-8,
+            // others may be subclasses that reimplement toString()
+            if (codec->mibEnum() == 106 && IrcCommandPrivate::get(command)->builtIn
+                    && IrcCommandPrivate::get(command)->serialize(&d->sendBuffer))
+                res = sendData(d->sendBuffer);
+            else
+                res = sendData(codec->fromUnicode(command->toString()));
         }
         if (!command->parent())
             command->deleteLater();
@@ -1444,6 +1791,51 @@ bool IrcConnection::sendCommand(IrcCommand* command)
     return res;
 }
 
+/*!
+    \since 3.6
+
+    Sends a lightweight \a command to the server.
+
+    Unlike sendCommand(IrcCommand*), this does not allocate an IrcCommand.
+    Installed command filters that implement IrcCommandValueFilter are
+    given the \a command as is. If any installed filter implements only
+    IrcCommandFilter, an equivalent IrcCommand is created and sent instead.
+
+    \note IrcCommandQueue implements IrcCommandValueFilter, but it still
+    creates an IrcCommand for each command it queues.
+
+    \sa IrcCommandValue, IrcCommandValueFilter, installCommandFilter()
+ */
+bool IrcConnection::sendCommand(const IrcCommandValue& command)
+{
+    Q_D(IrcConnection);
+    // filters that only know IrcCommand need an equivalent object
+    foreach (QObject* filter, d->commandFilters) {
+        if (!d->activeCommandFilters.contains(filter) && !qobject_cast<IrcCommandValueFilter*>(filter))
+            return sendCommand(command.toCommand());
+    }
+
+    bool filtered = false;
+    for (int i = d->commandFilters.count() - 1; !filtered && i >= 0; --i) {
+        QObject* filter = d->commandFilters.at(i);
+        IrcCommandValueFilter* valueFilter = qobject_cast<IrcCommandValueFilter*>(filter);
+        if (valueFilter && !d->activeCommandFilters.contains(filter)) {
+            d->activeCommandFilters.push(filter);
+            filtered |= valueFilter->commandValueFilter(command);
+            d->activeCommandFilters.pop();
+        }
+    }
+    if (filtered)
+        return false;
+
+    QTextCodec* codec = d->codecForCommand(command.encoding());
+    if (!codec) // unsupported, ignored like in IrcCommand::setEncoding()
+        codec = d->codecForCommand("UTF-8");
+    if (codec->mibEnum() == 106 && IrcCommandPrivate::serialize(&d->sendBuffer, command))
+        return sendData(d->sendBuffer);
+    return sendData(codec->fromUnicode(command.toString()));
+}
+
 /*!
     Sends raw \a data to the server.
 
@@ -1463,7 +1855,13 @@ bool IrcConnection::sendData(const QByteArray& data)
                 if (cmd.startsWith("QUIT") && (data.length() == 4 || QChar(data.at(4)).isSpace()))
                     d->closed = true;
             }
-            return d->protocol->write(data);
+            if (!d->protocol->write(data))
+                return false;
+            if (d->metricsEnabled) {
+                d->metrics.bytesOut += data.length() + 2;
+                ++d->metrics.linesOut;
+            }
+            return true;
         } else {
             d->pendingData += data;
         }
@@ -1500,6 +1898,34 @@ void IrcConnection::installMessageFilter(QObject* filter)
     IrcMessageFilter* msgFilter = qobject_cast<IrcMessageFilter*>(filter);
     if (msgFilter) {
         d->messageFilters += filter;
+        d->messageFilterTypes.remove(filter);
+        d->updateMessageFilters();
+        connect(filter, SIGNAL(destroyed(QObject*)), this, SLOT(_irc_filterDestroyed(QObject*)), Qt::UniqueConnection);
+    }
+}
+
+/*!
+    \since 3.6
+    \overload
+
+    Installs a message \a filter that is only interested in messages of the specified \a types.
+
+    The filter is not invoked for messages of any other type, which makes
+    dispatching messages cheaper when many filters are installed.
+
+    \sa removeMessageFilter()
+ */
+void IrcConnection::installMessageFilter(QObject* filter, const QList<IrcMessage::Type>& types)
+{
+    Q_D(IrcConnection);
+    IrcMessageFilter* msgFilter = qobject_cast<IrcMessageFilter*>(filter);
+    if (msgFilter) {
+        quint64 mask = 0;
+        foreach (IrcMessage::Type type, types)
+            mask |= (type < MESSAGE_TYPE_COUNT) ? (Q_UINT64_C(1) << type) : 0;
+        d->messageFilters += filter;
+        d->messageFilterTypes.insert(filter, mask);
+        d->updateMessageFilters();
         connect(filter, SIGNAL(destroyed(QObject*)), this, SLOT(_irc_filterDestroyed(QObject*)), Qt::UniqueConnection);
     }
 }
@@ -1519,6 +1945,8 @@ void IrcConnection::removeMessageFilter(QObject* filter)
     IrcMessageFilter* msgFilter = qobject_cast<IrcMessageFilter*>(filter);
     if (msgFilter) {
         d->messageFilters.removeAll(filter);
+        d->messageFilterTypes.remove(filter);
+        d->updateMessageFilters();
         disconnect(filter, SIGNAL(destroyed(QObject*)), this, SLOT(_irc_filterDestroyed(QObject*)));
     }
 }
@@ -1591,6 +2019,7 @@ QByteArray IrcConnection::saveState(int version) const
     args.insert("enabled", d->enabled);
     args.insert("reconnectDelay", reconnectDelay());
     args.insert("secure", isSecure());
+    args.insert("sessionResumption", d->resumption);
     args.insert("saslMechanism", d->saslMechanism);
 
     QByteArray state;
@@ -1636,10 +2065,74 @@ bool IrcConnection::restoreState(const QByteArray& state, int version)
     setEnabled(args.value("enabled", d->enabled).toBool());
     setReconnectDelay(args.value("reconnectDelay", reconnectDelay()).toInt());
     setSecure(args.value("secure", isSecure()).toBool());
+    setSessionResumptionEnabled(args.value("sessionResumption", d->resumption).toBool());
     setSaslMechanism(args.value("saslMechanism", d->saslMechanism).toString());
     return true;
 }
 
+/*!
+    \since 3.6
+
+    Returns the statistics of the connection.
+
+    The map contains the following keys:
+    \li \c "handshakes" - the amount of completed secure handshakes
+
+    When \ref metricsEnabled "metrics are enabled", the map also contains:
+    \li \c "bytesIn" and \c "bytesOut" - the amount of bytes read and written
+    \li \c "linesIn" and \c "linesOut" - the amount of lines read and written
+    \li \c "messages" - a map of received message counts keyed by IrcMessage::Type name
+    \li \c "parseTime", \c "filterTime" and \c "dispatchTime" - the average
+        time in nanoseconds spent per sampled message in each stage
+
+    \sa resetStatistics(), sessionResumption, metricsEnabled, statisticsReported()
+ */
+QVariantMap IrcConnection::statistics() const
+{
+    Q_D(const IrcConnection);
+    QVariantMap stats;
+    stats.insert(QLatin1String("handshakes"), d->handshakes);
+    if (d->metricsEnabled) {
+        const IrcConnectionMetrics& metrics = d->metrics;
+        stats.insert(QLatin1String("bytesIn"), metrics.bytesIn);
+        stats.insert(QLatin1String("bytesOut"), metrics.bytesOut);
+        stats.insert(QLatin1String("linesIn"), metrics.linesIn);
+        stats.insert(QLatin1String("linesOut"), metrics.linesOut);
+
+        QVariantMap messages;
+        const QMetaObject* mo = &IrcMessage::staticMetaObject;
+        const QMetaEnum types = mo->enumerator(mo->indexOfEnumerator("Type"));
+        for (int i = 0; i < MESSAGE_TYPE_COUNT; ++i) {
+            if (metrics.messages[i] > 0)
+                messages.insert(QLatin1String(types.valueToKey(i)), metrics.messages[i]);
+        }
+        stats.insert(QLatin1String("messages"), messages);
+
+#ifndef IRC_NO_METRICS
+        static const char* const stages[] = { "parseTime", "filterTime", "dispatchTime" };
+        for (int i = 0; i < IrcConnectionMetrics::StageCount; ++i) {
+            const qint64 samples = metrics.samples[i];
+            stats.insert(QLatin1String(stages[i]), samples > 0 ? metrics.nsecs[i] / samples : Q_INT64_C(0));
+        }
+#endif // IRC_NO_METRICS
+    }
+    return stats;
+}
+
+/*!
+    \since 3.6
+
+    Resets the statistics of the connection.
+
+    \sa statistics()
+ */
+void IrcConnection::resetStatistics()
+{
+    Q_D(IrcConnection);
+    d->handshakes = 0;
+    d->metrics.reset();
+}
+
 /*!
     Creates a reply command for the CTCP \a request.
 
@@ -62,6 +62,7 @@ namespace IrcCore {
 
         qRegisterMetaType<IrcCommand*>("IrcCommand*");
         qRegisterMetaType<IrcCommand::Type>("IrcCommand::Type");
+        qRegisterMetaType<IrcCommandValue>("IrcCommandValue");
 
         qRegisterMetaType<IrcMessage*>("IrcMessage*");
         qRegisterMetaType<IrcMessage::Type>("IrcMessage::Type");
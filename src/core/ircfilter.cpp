@@ -245,4 +245,69 @@ IRC_BEGIN_NAMESPACE
     \sa IrcConnection::installCommandFilter()
  */
 
+/*!
+    \since 3.6
+    \class IrcCommandValueFilter ircfilter.h <IrcCommandValueFilter>
+    \ingroup core
+    \brief Provides an interface for filtering command values
+
+    IrcConnection::sendCommand(const IrcCommandValue&) creates an
+    equivalent IrcCommand for the installed command filters, unless
+    every one of them also implements IrcCommandValueFilter. Such
+    filters are given the lightweight IrcCommandValue instead, and
+    no IrcCommand is allocated unless a filter creates one itself.
+
+    A command value filter must also implement IrcCommandFilter,
+    and it is installed via IrcConnection::installCommandFilter().
+
+    \code
+    class CommandCounter : public QObject,
+                           public IrcCommandFilter,
+                           public IrcCommandValueFilter
+    {
+        Q_OBJECT
+        Q_INTERFACES(IrcCommandFilter IrcCommandValueFilter)
+
+    public:
+        CommandCounter(IrcConnection* parent) : QObject(parent), count(0)
+        {
+            parent->installCommandFilter(this);
+        }
+
+        virtual bool commandFilter(IrcCommand* cmd)
+        {
+            ++count;
+            return false;
+        }
+
+        virtual bool commandValueFilter(const IrcCommandValue& cmd)
+        {
+            ++count;
+            return false;
+        }
+
+        int count;
+    };
+    \endcode
+
+    \sa IrcCommandFilter, IrcConnection::installCommandFilter()
+ */
+
+/*!
+    \fn IrcCommandValueFilter::~IrcCommandValueFilter()
+    Destructs the command value filter.
+ */
+
+/*!
+    \fn virtual bool IrcCommandValueFilter::commandValueFilter(const IrcCommandValue& command) = 0
+
+    Reimplement this function to filter command values to installed connections.
+
+    Return \c true to filter the command out, i.e. stop it being handled further;
+    otherwise return \c false. A filter that keeps the command for later, for
+    example to send it delayed, can use IrcCommandValue::toCommand().
+
+    \sa IrcConnection::sendCommand()
+ */
+
 IRC_END_NAMESPACE
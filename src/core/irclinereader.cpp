@@ -0,0 +1,193 @@
+/*
+  Copyright (C) 2008-2016 The Communi Project
+
+  You may use this file under the terms of BSD license as follows:
+
+  Redistribution and use in source and binary forms, with or without
+  modification, are permitted provided that the following conditions are met:
+    * Redistributions of source code must retain the above copyright
+      notice, this list of conditions and the following disclaimer.
+    * Redistributions in binary form must reproduce the above copyright
+      notice, this list of conditions and the following disclaimer in the
+      documentation and/or other materials provided with the distribution.
+    * Neither the name of the copyright holder nor the names of its
+      contributors may be used to endorse or promote products derived
+      from this software without specific prior written permission.
+
+  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+  ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+  WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+  DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDERS OR CONTRIBUTORS BE LIABLE FOR
+  ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+  (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+  ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+  (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+  SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#include "irclinereader_p.h"
+#include <QThread>
+#include <QCoreApplication>
+
+IRC_BEGIN_NAMESPACE
+
+#ifndef IRC_DOXYGEN
+Q_GLOBAL_STATIC(IrcLineReaderPool, irc_line_reader_pool)
+
+// the threads must be joined while the application still exists,
+// not during the destruction of static objects
+static void irc_stop_line_reader_pool()
+{
+    irc_line_reader_pool()->stop();
+}
+
+IrcLineReader::IrcLineReader() : pending(0), ready(0)
+{
+}
+
+IrcLineReader::~IrcLineReader()
+{
+    if (IrcLineReaderPool* pool = irc_line_reader_pool())
+        pool->remove(this);
+}
+
+IrcLineReader* IrcLineReader::create()
+{
+    IrcLineReader* reader = new IrcLineReader;
+    reader->moveToThread(irc_line_reader_pool()->nextThread());
+    irc_line_reader_pool()->add(reader);
+    return reader;
+}
+
+// called in the owner thread
+void IrcLineReader::write(const QByteArray& data)
+{
+    if (!data.isEmpty()) {
+        input.enqueue(data);
+        if (pending.testAndSetOrdered(0, 1))
+            QMetaObject::invokeMethod(this, "process", Qt::QueuedConnection);
+    }
+}
+
+// called in the owner thread
+QList<IrcMessageData> IrcLineReader::readAll()
+{
+    ready.fetchAndStoreOrdered(0);
+    QList<IrcMessageData> messages;
+    IrcMessageData data;
+    while (output.dequeue(&data))
+        messages += data;
+    return messages;
+}
+
+// called in the owner thread, returns the incomplete line that
+// remains after the reader thread has parsed all pending input
+QByteArray IrcLineReader::stop()
+{
+    QByteArray rest;
+    QThread* reader = thread();
+    if (reader->isRunning() && reader != QThread::currentThread())
+        QMetaObject::invokeMethod(this, "flush", Qt::BlockingQueuedConnection, Q_RETURN_ARG(QByteArray, rest));
+    else
+        rest = flush();
+    return rest;
+}
+
+// called in the reader thread
+QByteArray IrcLineReader::flush()
+{
+    process();
+    QByteArray rest = buffer;
+    buffer.clear();
+    return rest;
+}
+
+// called in the reader thread
+void IrcLineReader::process()
+{
+    pending.fetchAndStoreOrdered(0);
+    QByteArray data;
+    while (input.dequeue(&data))
+        buffer += data;
+    // try reading RFC compliant message lines first
+    bool read = readLines("\r\n");
+    // fall back to RFC incompliant lines...
+    read |= readLines("\n");
+    if (read && ready.testAndSetOrdered(0, 1))
+        emit readyRead();
+}
+
+bool IrcLineReader::readLines(const QByteArray& delimiter)
+{
+    bool read = false;
+    int i = -1;
+    while ((i = buffer.indexOf(delimiter)) != -1) {
+        QByteArray line = buffer.left(i).trimmed();
+        buffer = buffer.mid(i + delimiter.length());
+        if (!line.isEmpty()) {
+            output.enqueue(IrcMessageData::fromData(line));
+            read = true;
+        }
+    }
+    return read;
+}
+
+IrcLineReaderPool::IrcLineReaderPool() : next(0)
+{
+}
+
+IrcLineReaderPool::~IrcLineReaderPool()
+{
+    stop();
+}
+
+QThread* IrcLineReaderPool::nextThread()
+{
+    QMutexLocker locker(&mutex);
+    if (threads.isEmpty()) {
+        const int count = qMax(1, QThread::idealThreadCount());
+        for (int i = 0; i < count; ++i) {
+            QThread* thread = new QThread;
+            thread->start();
+            threads += thread;
+        }
+        qAddPostRoutine(irc_stop_line_reader_pool);
+    }
+    // shard the readers across the threads
+    return threads.at(next++ % threads.count());
+}
+
+void IrcLineReaderPool::add(IrcLineReader* reader)
+{
+    QMutexLocker locker(&mutex);
+    readers += reader;
+}
+
+void IrcLineReaderPool::remove(IrcLineReader* reader)
+{
+    QMutexLocker locker(&mutex);
+    readers.removeOne(reader);
+}
+
+void IrcLineReaderPool::stop()
+{
+    QMutexLocker locker(&mutex);
+    foreach (QThread* thread, threads) {
+        thread->quit();
+        thread->wait();
+        delete thread;
+    }
+    threads.clear();
+    // the readers that are still alive, or whose deferred deletion
+    // never ran, are deleted once their threads have finished
+    const QList<IrcLineReader*> orphans = readers;
+    readers.clear();
+    locker.unlock();
+    qDeleteAll(orphans);
+}
+#endif // IRC_DOXYGEN
+
+#include "moc_irclinereader_p.cpp"
+
+IRC_END_NAMESPACE
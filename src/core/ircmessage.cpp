@@ -241,31 +241,38 @@ IRC_BEGIN_NAMESPACE
     \brief The message is an implicit "reply" after joining a channel.
  */
 
-static const QMetaObject* irc_command_meta_object(const QString& command)
-{
-    static QHash<QString, const QMetaObject*> metaObjects;
-    if (metaObjects.isEmpty()) {
-        metaObjects.insert("ACCOUNT", &IrcAccountMessage::staticMetaObject);
-        metaObjects.insert("AWAY", &IrcAwayMessage::staticMetaObject);
-        metaObjects.insert("BATCH", &IrcBatchMessage::staticMetaObject);
-        metaObjects.insert("CAP", &IrcCapabilityMessage::staticMetaObject);
-        metaObjects.insert("ERROR", &IrcErrorMessage::staticMetaObject);
-        metaObjects.insert("CHGHOST", &IrcHostChangeMessage::staticMetaObject);
-        metaObjects.insert("INVITE", &IrcInviteMessage::staticMetaObject);
-        metaObjects.insert("JOIN", &IrcJoinMessage::staticMetaObject);
-        metaObjects.insert("KICK", &IrcKickMessage::staticMetaObject);
-        metaObjects.insert("MODE", &IrcModeMessage::staticMetaObject);
-        metaObjects.insert("NICK", &IrcNickMessage::staticMetaObject);
-        metaObjects.insert("NOTICE", &IrcNoticeMessage::staticMetaObject);
-        metaObjects.insert("PART", &IrcPartMessage::staticMetaObject);
-        metaObjects.insert("PING", &IrcPingMessage::staticMetaObject);
-        metaObjects.insert("PONG", &IrcPongMessage::staticMetaObject);
-        metaObjects.insert("PRIVMSG", &IrcPrivateMessage::staticMetaObject);
-        metaObjects.insert("QUIT", &IrcQuitMessage::staticMetaObject);
-        metaObjects.insert("TOPIC", &IrcTopicMessage::staticMetaObject);
+class IrcMetaObjectHash : public QHash<QString, const QMetaObject*>
+{
+public:
+    IrcMetaObjectHash()
+    {
+        insert("ACCOUNT", &IrcAccountMessage::staticMetaObject);
+        insert("AWAY", &IrcAwayMessage::staticMetaObject);
+        insert("BATCH", &IrcBatchMessage::staticMetaObject);
+        insert("CAP", &IrcCapabilityMessage::staticMetaObject);
+        insert("ERROR", &IrcErrorMessage::staticMetaObject);
+        insert("CHGHOST", &IrcHostChangeMessage::staticMetaObject);
+        insert("INVITE", &IrcInviteMessage::staticMetaObject);
+        insert("JOIN", &IrcJoinMessage::staticMetaObject);
+        insert("KICK", &IrcKickMessage::staticMetaObject);
+        insert("MODE", &IrcModeMessage::staticMetaObject);
+        insert("NICK", &IrcNickMessage::staticMetaObject);
+        insert("NOTICE", &IrcNoticeMessage::staticMetaObject);
+        insert("PART", &IrcPartMessage::staticMetaObject);
+        insert("PING", &IrcPingMessage::staticMetaObject);
+        insert("PONG", &IrcPongMessage::staticMetaObject);
+        insert("PRIVMSG", &IrcPrivateMessage::staticMetaObject);
+        insert("QUIT", &IrcQuitMessage::staticMetaObject);
+        insert("TOPIC", &IrcTopicMessage::staticMetaObject);
     }
+};
+
+// initialized once in a thread-safe manner
+Q_GLOBAL_STATIC(IrcMetaObjectHash, irc_meta_objects)
 
-    const QMetaObject* metaObject = metaObjects.value(command.toUpper());
+static const QMetaObject* irc_command_meta_object(const QString& command)
+{
+    const QMetaObject* metaObject = irc_meta_objects()->value(command.toUpper());
     if (!metaObject) {
         bool ok = false;
         command.toInt(&ok);
@@ -688,14 +695,21 @@ void IrcMessage::setTag(const QString& name, const QVariant& value)
     Creates a new message from \a data and \a connection.
  */
 IrcMessage* IrcMessage::fromData(const QByteArray& data, IrcConnection* connection)
+{
+    return IrcMessagePrivate::fromData(IrcMessageData::fromData(data), connection);
+}
+
+#ifndef IRC_DOXYGEN
+IrcMessage* IrcMessagePrivate::fromData(const IrcMessageData& md, IrcConnection* connection)
 {
     IrcMessage* message = 0;
-    IrcMessageData md = IrcMessageData::fromData(data);
     const QMetaObject* metaObject = irc_command_meta_object(md.command);
     if (metaObject) {
         message = qobject_cast<IrcMessage*>(metaObject->newInstance(Q_ARG(IrcConnection*, connection)));
         Q_ASSERT(message);
         message->d_ptr->data = md;
+        if (message->d_ptr->type == IrcMessage::Private || message->d_ptr->type == IrcMessage::Notice)
+            message->d_ptr->m_ctcp = classifyCtcp(md.params.value(1));
         QByteArray tag = md.tags.value("time");
         if (!tag.isEmpty()) {
             QDateTime ts = QDateTime::fromString(QString::fromUtf8(tag), Qt::ISODate);
@@ -705,6 +719,7 @@ IrcMessage* IrcMessage::fromData(const QByteArray& data, IrcConnection* connecti
     }
     return message;
 }
+#endif // IRC_DOXYGEN
 
 /*!
     Creates a new message from \a prefix, \a command and \a parameters with \a connection.
@@ -748,6 +763,8 @@ IrcMessage* IrcMessage::clone(QObject* parent) const
         p->m_command = d->m_command;
         p->m_params = d->m_params;
         p->m_tags = d->m_tags;
+        p->m_ctcp = d->m_ctcp;
+        p->m_content = d->m_content;
     }
     return msg;
 }
@@ -1551,8 +1568,9 @@ QString IrcNoticeMessage::target() const
 {
     Q_D(const IrcMessage);
     if (d->connection) {
-        const IrcNetwork* network = d->connection->network();
-        return IrcNetworkPrivate::removePrefix(d->param(0), network->statusPrefixes());
+        const IrcNetworkInfo* info = IrcNetworkPrivate::get(d->connection->network())->info.data();
+        const QString target = d->param(0);
+        return target.mid(info->statusPrefixLength(target));
     }
     return d->param(0);
 }
@@ -1566,12 +1584,7 @@ QString IrcNoticeMessage::target() const
 QString IrcNoticeMessage::content() const
 {
     Q_D(const IrcMessage);
-    QString msg = d->param(1);
-    if (isReply()) {
-        msg.remove(0, 1);
-        msg.chop(1);
-    }
-    return msg;
+    return d->ctcpContent();
 }
 
 /*!
@@ -1586,8 +1599,9 @@ QString IrcNoticeMessage::statusPrefix() const
 {
     Q_D(const IrcMessage);
     if (d->connection) {
-        const IrcNetwork* network = d->connection->network();
-        return IrcNetworkPrivate::getPrefix(d->param(0), network->statusPrefixes());
+        const IrcNetworkInfo* info = IrcNetworkPrivate::get(d->connection->network())->info.data();
+        const QString target = d->param(0);
+        return target.left(info->statusPrefixLength(target));
     }
     return QString();
 }
@@ -1618,8 +1632,7 @@ bool IrcNoticeMessage::isPrivate() const
 bool IrcNoticeMessage::isReply() const
 {
     Q_D(const IrcMessage);
-    QString msg = d->param(1);
-    return msg.startsWith('\1') && msg.endsWith('\1');
+    return d->ctcp() != IrcMessagePrivate::CtcpNone;
 }
 
 bool IrcNoticeMessage::isValid() const
@@ -1817,8 +1830,9 @@ QString IrcPrivateMessage::target() const
 {
     Q_D(const IrcMessage);
     if (d->connection) {
-        const IrcNetwork* network = d->connection->network();
-        return IrcNetworkPrivate::removePrefix(d->param(0), network->statusPrefixes());
+        const IrcNetworkInfo* info = IrcNetworkPrivate::get(d->connection->network())->info.data();
+        const QString target = d->param(0);
+        return target.mid(info->statusPrefixLength(target));
     }
     return d->param(0);
 }
@@ -1832,13 +1846,7 @@ QString IrcPrivateMessage::target() const
 QString IrcPrivateMessage::content() const
 {
     Q_D(const IrcMessage);
-    QString msg = d->param(1);
-    const bool act = isAction();
-    const bool req = isRequest();
-    if (act) msg.remove(0, 8);
-    if (req) msg.remove(0, 1);
-    if (act || req) msg.chop(1);
-    return msg;
+    return d->ctcpContent();
 }
 
 /*!
@@ -1853,8 +1861,9 @@ QString IrcPrivateMessage::statusPrefix() const
 {
     Q_D(const IrcMessage);
     if (d->connection) {
-        const IrcNetwork* network = d->connection->network();
-        return IrcNetworkPrivate::getPrefix(d->param(0), network->statusPrefixes());
+        const IrcNetworkInfo* info = IrcNetworkPrivate::get(d->connection->network())->info.data();
+        const QString target = d->param(0);
+        return target.left(info->statusPrefixLength(target));
     }
     return QString();
 }
@@ -1885,8 +1894,7 @@ bool IrcPrivateMessage::isPrivate() const
 bool IrcPrivateMessage::isAction() const
 {
     Q_D(const IrcMessage);
-    QString msg = d->param(1);
-    return msg.startsWith("\1ACTION ") && msg.endsWith('\1');
+    return d->ctcp() == IrcMessagePrivate::CtcpAction;
 }
 
 /*!
@@ -1899,8 +1907,7 @@ bool IrcPrivateMessage::isAction() const
 bool IrcPrivateMessage::isRequest() const
 {
     Q_D(const IrcMessage);
-    QString msg = d->param(1);
-    return msg.startsWith('\1') && msg.endsWith('\1') && !isAction();
+    return d->ctcp() == IrcMessagePrivate::CtcpRequest;
 }
 
 bool IrcPrivateMessage::isValid() const
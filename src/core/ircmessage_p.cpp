@@ -28,12 +28,14 @@
 
 #include "ircmessage_p.h"
 #include "ircmessagedecoder_p.h"
+#include <QThreadStorage>
 
 IRC_BEGIN_NAMESPACE
 
 #ifndef IRC_DOXYGEN
 IrcMessagePrivate::IrcMessagePrivate() :
-    connection(0), type(IrcMessage::Unknown), timeStamp(QDateTime::currentDateTime()), encoding("ISO-8859-15"), flags(-1)
+    connection(0), type(IrcMessage::Unknown), timeStamp(QDateTime::currentDateTime()), encoding("ISO-8859-15"), flags(-1),
+    m_ctcp(CtcpUnknown)
 {
 }
 
@@ -111,6 +113,8 @@ QString IrcMessagePrivate::param(int index) const
 void IrcMessagePrivate::setParams(const QStringList& params)
 {
     m_params.setValue(params);
+    m_ctcp = CtcpUnknown;
+    m_content.clear();
 }
 
 QVariantMap IrcMessagePrivate::tags() const
@@ -164,6 +168,45 @@ QByteArray IrcMessagePrivate::content() const
     return data.content;
 }
 
+int IrcMessagePrivate::ctcp() const
+{
+    if (m_ctcp == CtcpUnknown) {
+        if (m_params.isExplicit())
+            m_ctcp = classifyCtcp(param(1));
+        else
+            m_ctcp = classifyCtcp(data.params.value(1));
+    }
+    return m_ctcp;
+}
+
+QString IrcMessagePrivate::ctcpContent() const
+{
+    if (m_content.isNull()) {
+        QString msg = param(1);
+        const int kind = ctcp();
+        if (kind == CtcpAction && type != IrcMessage::Notice)
+            msg = msg.mid(8, msg.length() - 9);
+        else if (kind != CtcpNone)
+            msg = msg.mid(1, msg.length() - 2);
+        m_content = msg;
+    }
+    return m_content.value();
+}
+
+int IrcMessagePrivate::classifyCtcp(const QByteArray& content)
+{
+    if (!content.startsWith('\1') || !content.endsWith('\1'))
+        return CtcpNone;
+    return content.startsWith("\1ACTION ") ? CtcpAction : CtcpRequest;
+}
+
+int IrcMessagePrivate::classifyCtcp(const QString& content)
+{
+    if (!content.startsWith(QLatin1Char('\1')) || !content.endsWith(QLatin1Char('\1')))
+        return CtcpNone;
+    return content.startsWith(QLatin1String("\1ACTION ")) ? CtcpAction : CtcpRequest;
+}
+
 void IrcMessagePrivate::invalidate()
 {
     m_nick.clear();
@@ -172,8 +215,12 @@ void IrcMessagePrivate::invalidate()
 
     m_prefix.clear();
     m_command.clear();
+    // the raw content is classified regardless of the encoding
+    if (m_params.isExplicit())
+        m_ctcp = CtcpUnknown;
     m_params.clear();
     m_tags.clear();
+    m_content.clear();
 }
 
 IrcMessageData IrcMessageData::fromData(const QByteArray& data)
@@ -245,11 +292,15 @@ IrcMessageData IrcMessageData::fromData(const QByteArray& data)
     return message;
 }
 
+// the charset detectors are not reentrant
+Q_GLOBAL_STATIC(QThreadStorage<IrcMessageDecoder*>, irc_message_decoders)
+
 QString IrcMessagePrivate::decode(const QByteArray& data, const QByteArray& encoding)
 {
-    // TODO: not thread safe
-    static IrcMessageDecoder decoder;
-    return decoder.decode(data, encoding);
+    QThreadStorage<IrcMessageDecoder*>* decoders = irc_message_decoders();
+    if (!decoders->hasLocalData())
+        decoders->setLocalData(new IrcMessageDecoder);
+    return decoders->localData()->decode(data, encoding);
 }
 
 bool IrcMessagePrivate::parsePrefix(const QString& prefix, QString* nick, QString* ident, QString* host)
@@ -27,15 +27,17 @@
 */
 
 #include "ircmessagecomposer_p.h"
+#include "ircprotocol.h"
 #include "ircmessage.h"
 #include "irc.h"
 
 IRC_BEGIN_NAMESPACE
 
 #ifndef IRC_DOXYGEN
-IrcMessageComposer::IrcMessageComposer(IrcConnection* connection)
+IrcMessageComposer::IrcMessageComposer(IrcConnection* connection, IrcProtocol* protocol)
 {
     d.connection = connection;
+    d.protocol = protocol;
 }
 
 bool IrcMessageComposer::isComposed(int code)
@@ -76,126 +78,122 @@ void IrcMessageComposer::composeMessage(IrcNumericMessage* message)
 {
     switch (message->code()) {
     case Irc::RPL_MOTDSTART:
-        d.messages.push(new IrcMotdMessage(d.connection));
+        beginCompose(new IrcMotdMessage(d.connection), QStringList(message->parameters().value(0)));
         d.messages.top()->setPrefix(message->prefix());
-        d.messages.top()->setParameters(QStringList(message->parameters().value(0)));
         break;
     case Irc::RPL_MOTD:
-        d.messages.top()->setParameters(d.messages.top()->parameters() << message->parameters().value(1));
+        if (isComposing(IrcMessage::Motd))
+            d.params.top() += message->parameters().value(1);
         break;
     case Irc::RPL_ENDOFMOTD:
-        finishCompose(message);
+        if (isComposing(IrcMessage::Motd))
+            finishCompose(message);
         break;
 
     case Irc::RPL_NAMREPLY: {
-        if (d.messages.empty() || d.messages.top()->type() != IrcMessage::Names)
-            d.messages.push(new IrcNamesMessage(d.connection));
+        if (!isComposing(IrcMessage::Names))
+            beginCompose(new IrcNamesMessage(d.connection), QStringList(QString()));
         d.messages.top()->setPrefix(message->prefix());
         int count = message->parameters().count();
-        QString channel = message->parameters().value(count - 2);
-        QStringList names = d.messages.top()->parameters().mid(1);
-        names += message->parameters().value(count - 1).split(QLatin1Char(' '), QString::SkipEmptyParts);
-        d.messages.top()->setParameters(QStringList() << channel << names);
+        QStringList& params = d.params.top();
+        params[0] = message->parameters().value(count - 2); // channel
+        params += message->parameters().value(count - 1).split(QLatin1Char(' '), QString::SkipEmptyParts);
         break;
     }
     case Irc::RPL_ENDOFNAMES:
-        finishCompose(message);
+        if (isComposing(IrcMessage::Names))
+            finishCompose(message);
         break;
 
     case Irc::RPL_TOPIC:
     case Irc::RPL_NOTOPIC:
-        d.messages.push(new IrcTopicMessage(d.connection));
+        beginCompose(new IrcTopicMessage(d.connection), QStringList() << message->parameters().value(1) << message->parameters().value(2));
         d.messages.top()->setPrefix(message->prefix());
         d.messages.top()->setCommand(QString::number(message->code()));
-        d.messages.top()->setParameters(QStringList() << message->parameters().value(1) << message->parameters().value(2));
         finishCompose(message);
         break;
 
     case Irc::RPL_INVITING:
     case Irc::RPL_INVITED:
-        d.messages.push(new IrcInviteMessage(d.connection));
+        beginCompose(new IrcInviteMessage(d.connection), QStringList() << message->parameters().value(1) << message->parameters().value(2));
         d.messages.top()->setPrefix(message->prefix());
         d.messages.top()->setCommand(QString::number(message->code()));
-        d.messages.top()->setParameters(QStringList() << message->parameters().value(1) << message->parameters().value(2));
         finishCompose(message);
         break;
 
     case Irc::RPL_WHOREPLY: {
-        d.messages.push(new IrcWhoReplyMessage(d.connection));
+        QStringList params;
+        params << message->parameters().value(1) // mask
+               << message->parameters().value(4) // server
+               << message->parameters().value(6); // status
+        QString last = message->parameters().value(7);
+        int index = last.indexOf(QLatin1Char(' ')); // ignore hopcount
+        if (index != -1)
+            params << last.mid(index + 1); // real name
+        beginCompose(new IrcWhoReplyMessage(d.connection), params);
         d.messages.top()->setPrefix(message->parameters().value(5) // nick
                                     + QLatin1Char('!') + message->parameters().value(2) // ident
                                     + QLatin1Char('@') + message->parameters().value(3)); // host
         d.messages.top()->setCommand(QString::number(message->code()));
-        d.messages.top()->setParameters(QStringList() << message->parameters().value(1) // mask
-                                                      << message->parameters().value(4) // server
-                                                      << message->parameters().value(6)); // status
-        QString last = message->parameters().value(7);
-        int index = last.indexOf(QLatin1Char(' ')); // ignore hopcount
-        if (index != -1)
-            d.messages.top()->setParameters(d.messages.top()->parameters() << last.mid(index + 1)); // real name
         finishCompose(message);
         break;
     }
 
     case Irc::RPL_CHANNELMODEIS:
-        d.messages.push(new IrcModeMessage(d.connection));
+        beginCompose(new IrcModeMessage(d.connection), message->parameters().mid(1));
         d.messages.top()->setPrefix(message->prefix());
         d.messages.top()->setCommand(QString::number(message->code()));
-        d.messages.top()->setParameters(message->parameters().mid(1));
         finishCompose(message);
         break;
 
     case Irc::RPL_AWAY:
-        if (!d.messages.isEmpty() && d.messages.top()->type() == IrcMessage::Whois) {
+        if (isComposing(IrcMessage::Whois)) {
             replaceParam(9, message->parameters().value(2)); // away reason
             break;
         }
         // flow through
     case Irc::RPL_UNAWAY:
     case Irc::RPL_NOWAWAY:
-        d.messages.push(new IrcAwayMessage(d.connection));
-        d.messages.top()->setCommand(QString::number(message->code()));
         if (message->code() == Irc::RPL_AWAY) {
+            beginCompose(new IrcAwayMessage(d.connection), message->parameters().mid(2));
             d.messages.top()->setPrefix(message->parameters().value(1));
-            d.messages.top()->setParameters(message->parameters().mid(2));
         } else {
+            beginCompose(new IrcAwayMessage(d.connection), message->parameters().mid(1));
             d.messages.top()->setPrefix(message->parameters().value(0));
-            d.messages.top()->setParameters(message->parameters().mid(1));
         }
+        d.messages.top()->setCommand(QString::number(message->code()));
         finishCompose(message);
         break;
 
     case Irc::RPL_WHOISUSER:
-        d.messages.push(new IrcWhoisMessage(d.connection));
+        beginCompose(new IrcWhoisMessage(d.connection), QStringList() << message->parameters().value(5)
+                                                                      << QString()   // server
+                                                                      << QString()   // info
+                                                                      << QString()   // account
+                                                                      << QString()   // address
+                                                                      << QString()   // since
+                                                                      << QString()   // idle
+                                                                      << QString()   // secure
+                                                                      << QString()   // channels
+                                                                      << QString()); // away reason
         d.messages.top()->setPrefix(message->parameters().value(1)
                                     + "!" + message->parameters().value(2)
                                     + "@" + message->parameters().value(3));
-        d.messages.top()->setParameters(QStringList() << message->parameters().value(5)
-                                                      << QString()   // server
-                                                      << QString()   // info
-                                                      << QString()   // account
-                                                      << QString()   // address
-                                                      << QString()   // since
-                                                      << QString()   // idle
-                                                      << QString()   // secure
-                                                      << QString()   // channels
-                                                      << QString()); // away reason
         break;
 
     case Irc::RPL_WHOWASUSER:
-        d.messages.push(new IrcWhowasMessage(d.connection));
+        beginCompose(new IrcWhowasMessage(d.connection), QStringList() << message->parameters().value(5)
+                                                                       << QString()   // server
+                                                                       << QString()   // info
+                                                                       << QString()   // account
+                                                                       << QString()   // address
+                                                                       << QString()   // since
+                                                                       << QString()   // idle
+                                                                       << QString()   // secure
+                                                                       << QString()); // channels
         d.messages.top()->setPrefix(message->parameters().value(1)
                                     + "!" + message->parameters().value(2)
                                     + "@" + message->parameters().value(3));
-        d.messages.top()->setParameters(QStringList() << message->parameters().value(5)
-                                                      << QString()   // server
-                                                      << QString()   // info
-                                                      << QString()   // account
-                                                      << QString()   // address
-                                                      << QString()   // since
-                                                      << QString()   // idle
-                                                      << QString()   // secure
-                                                      << QString()); // channels
         break;
 
     case Irc::RPL_WHOISSERVER:
@@ -225,30 +223,46 @@ void IrcMessageComposer::composeMessage(IrcNumericMessage* message)
         break;
 
     case Irc::RPL_ENDOFWHOIS:
+        if (isComposing(IrcMessage::Whois))
+            finishCompose(message);
+        break;
     case Irc::RPL_ENDOFWHOWAS:
-        finishCompose(message);
+        if (isComposing(IrcMessage::Whowas))
+            finishCompose(message);
         break;
     }
 }
 
+// an end of list reply only finishes a list of the same kind
+bool IrcMessageComposer::isComposing(int type) const
+{
+    return !d.messages.isEmpty() && d.messages.top()->type() == type;
+}
+
+void IrcMessageComposer::beginCompose(IrcMessage* message, const QStringList& params)
+{
+    d.messages.push(message);
+    d.params.push(params);
+}
+
 void IrcMessageComposer::finishCompose(IrcMessage* message)
 {
     if (!d.messages.isEmpty()) {
         IrcMessage* composed = d.messages.pop();
+        composed->setParameters(d.params.pop());
         composed->setTimeStamp(message->timeStamp());
         if (message->testFlag(IrcMessage::Implicit))
             composed->setFlag(IrcMessage::Implicit);
-        emit messageComposed(composed);
+        d.protocol->receiveMessage(composed);
     }
 }
 
 void IrcMessageComposer::replaceParam(int index, const QString& param)
 {
-    if (!d.messages.isEmpty()) {
-        QStringList params = d.messages.top()->parameters();
+    if (!d.params.isEmpty()) {
+        QStringList& params = d.params.top();
         if (index < params.count())
-            params.replace(index, param);
-        d.messages.top()->setParameters(params);
+            params[index] = param;
     }
 }
 #endif // IRC_DOXYGEN
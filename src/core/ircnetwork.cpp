@@ -34,6 +34,8 @@
 #include "irccommand.h"
 #include <QMetaEnum>
 #include <QPointer>
+#include <QMutex>
+#include <string.h>
 
 IRC_BEGIN_NAMESPACE
 
@@ -182,10 +184,14 @@ IRC_BEGIN_NAMESPACE
  */
 
 #ifndef IRC_DOXYGEN
-IrcNetworkPrivate::IrcNetworkPrivate() : q_ptr(0), initialized(false),
-    modes(QStringList() << "o" << "v"), prefixes(QStringList() << "@" << "+"), channelTypes("#")
+class IrcNetworkInfoRegistry
 {
-}
+public:
+    QMutex mutex;
+    QHash<QString, QWeakPointer<const IrcNetworkInfo> > infos;
+};
+
+Q_GLOBAL_STATIC(IrcNetworkInfoRegistry, irc_network_infos)
 
 static QHash<QString, int> numericValues(const QString& parameter)
 {
@@ -196,128 +202,175 @@ static QHash<QString, int> numericValues(const QString& parameter)
     return values;
 }
 
-void IrcNetworkPrivate::setInfo(const QHash<QString, QString>& info)
+static void fillBits(quint32* bits, const QStringList& chars)
 {
-    Q_Q(IrcNetwork);
-    if (info.contains("NETWORK"))
-        setName(info.value("NETWORK"));
-    if (info.contains("PREFIX")) {
-        const QString pfx = info.value("PREFIX");
-        setModes(pfx.mid(1, pfx.indexOf(')') - 1).split("", QString::SkipEmptyParts));
-        setPrefixes(pfx.mid(pfx.indexOf(')') + 1).split("", QString::SkipEmptyParts));
+    memset(bits, 0, 4 * sizeof(quint32));
+    foreach (const QString& c, chars) {
+        const ushort u = c.at(0).unicode();
+        if (u < 128)
+            bits[u >> 5] |= 1u << (u & 31);
     }
-    if (info.contains("CHANTYPES"))
-        setChannelTypes(info.value("CHANTYPES").split("", QString::SkipEmptyParts));
-    if (info.contains("STATUSMSG"))
-        setStatusPrefixes(info.value("STATUSMSG").split("", QString::SkipEmptyParts));
-
-    // TODO:
-    if (info.contains("NICKLEN"))
-        numericLimits.insert("NICKLEN", info.value("NICKLEN").toInt());
-    if (info.contains("CHANNELLEN"))
-        numericLimits.insert("CHANNELLEN", info.value("CHANNELLEN").toInt());
-    if (info.contains("TOPICLEN"))
-        numericLimits.insert("TOPICLEN", info.value("TOPICLEN").toInt());
-    if (info.contains("KICKLEN"))
-        numericLimits.insert("KICKLEN", info.value("KICKLEN").toInt());
-    if (info.contains("AWAYLEN"))
-        numericLimits.insert("AWAYLEN", info.value("AWAYLEN").toInt());
-    if (info.contains("MODES"))
-        numericLimits.insert("MODES", info.value("MODES").toInt());
-    if (info.contains("MONITOR"))
-        numericLimits.insert("MONITOR", info.value("MONITOR").toInt());
-    if (info.contains("CHANMODES"))
-        channelModes = info.value("CHANMODES").split(",", QString::SkipEmptyParts);
-    if (info.contains("MAXLIST"))
-        modeLimits = numericValues(info.value("MAXLIST"));
-    if (info.contains("CHANLIMIT"))
-        channelLimits = numericValues(info.value("CHANLIMIT"));
-    if (info.contains("TARGMAX"))
-        targetLimits = numericValues(info.value("TARGMAX"));
+}
 
-    if (!initialized) {
-        initialized = true;
-        emit q->initialized();
+static void fillTable(ushort* table, const QStringList& from, const QStringList& to)
+{
+    memset(table, 0, 128 * sizeof(ushort));
+    for (int i = 0; i < from.count(); ++i) {
+        const ushort u = from.at(i).at(0).unicode();
+        if (u < 128 && !table[u] && i < to.count())
+            table[u] = to.at(i).at(0).unicode();
     }
 }
 
-void IrcNetworkPrivate::setAvailableCapabilities(const QSet<QString>& capabilities)
+IrcNetworkInfo::IrcNetworkInfo(const QString& key, const QHash<QString, QString>& tokens) : key(key), tokens(tokens),
+    modes(QStringList() << "o" << "v"), prefixes(QStringList() << "@" << "+"), channelTypes("#")
 {
-    Q_Q(IrcNetwork);
-    if (availableCaps != capabilities) {
-        availableCaps = capabilities;
-        emit q->availableCapabilitiesChanged(availableCaps.toList());
+    name = tokens.value("NETWORK");
+    caseMapping = tokens.value("CASEMAPPING", "rfc1459").toLower();
+    if (tokens.contains("PREFIX")) {
+        const QString pfx = tokens.value("PREFIX");
+        modes = pfx.mid(1, pfx.indexOf(')') - 1).split("", QString::SkipEmptyParts);
+        prefixes = pfx.mid(pfx.indexOf(')') + 1).split("", QString::SkipEmptyParts);
     }
+    if (tokens.contains("CHANTYPES"))
+        channelTypes = tokens.value("CHANTYPES").split("", QString::SkipEmptyParts);
+    if (tokens.contains("STATUSMSG"))
+        statusPrefixes = tokens.value("STATUSMSG").split("", QString::SkipEmptyParts);
+
+    const QStringList types = tokens.value("CHANMODES").split(",", QString::SkipEmptyParts);
+    for (int i = 0; i < 4; ++i)
+        channelModes[i] = types.value(i).split("", QString::SkipEmptyParts);
+
+    static const char* const limits[] = { "NICKLEN", "CHANNELLEN", "TOPICLEN", 0, "KICKLEN", "AWAYLEN", "MODES", "MONITOR" };
+    for (int i = 0; i <= IrcNetwork::MonitorCount; ++i) {
+        const QString limit = limits[i] ? QString::fromLatin1(limits[i]) : QString();
+        numericLimits[i] = tokens.contains(limit) ? tokens.value(limit).toInt() : -1;
+    }
+    numericLimits[IrcNetwork::MessageLength] = 512; // RFC 1459
+
+    modeLimits = numericValues(tokens.value("MAXLIST"));
+    channelLimits = numericValues(tokens.value("CHANLIMIT"));
+    targetLimits = numericValues(tokens.value("TARGMAX"));
+
+    fillBits(channelTypeBits, channelTypes);
+    fillBits(statusPrefixBits, statusPrefixes);
+    fillTable(modePrefixes, modes, prefixes);
+    fillTable(prefixModes, prefixes, modes);
 }
 
-void IrcNetworkPrivate::setActiveCapabilities(const QSet<QString>& capabilities)
+QSharedPointer<const IrcNetworkInfo> IrcNetworkInfo::intern(const QHash<QString, QString>& tokens)
 {
-    Q_Q(IrcNetwork);
-    if (activeCaps != capabilities) {
-        activeCaps = capabilities;
-        emit q->activeCapabilitiesChanged(activeCaps.toList());
+    // connections to the same network end up with identical tokens
+    QStringList keyValues;
+    QHash<QString, QString>::const_iterator it;
+    for (it = tokens.constBegin(); it != tokens.constEnd(); ++it)
+        keyValues += it.key() + QLatin1Char('=') + it.value();
+    keyValues.sort();
+    const QString key = keyValues.join(QLatin1String(" "));
+
+    IrcNetworkInfoRegistry* registry = irc_network_infos();
+    if (!registry)
+        return QSharedPointer<const IrcNetworkInfo>(new IrcNetworkInfo(key, tokens));
+
+    QMutexLocker locker(&registry->mutex);
+    QSharedPointer<const IrcNetworkInfo> info = registry->infos.value(key).toStrongRef();
+    if (!info) {
+        info = QSharedPointer<const IrcNetworkInfo>(new IrcNetworkInfo(key, tokens), &IrcNetworkInfo::release);
+        registry->infos.insert(key, info);
     }
+    return info;
 }
 
-void IrcNetworkPrivate::setName(const QString& value)
+void IrcNetworkInfo::release(const IrcNetworkInfo* info)
 {
-    Q_Q(IrcNetwork);
-    if (name != value) {
-        name = value;
-        emit q->nameChanged(value);
+    IrcNetworkInfoRegistry* registry = irc_network_infos();
+    if (registry) {
+        QMutexLocker locker(&registry->mutex);
+        // the key may have been re-interned meanwhile
+        QHash<QString, QWeakPointer<const IrcNetworkInfo> >::iterator it = registry->infos.find(info->key);
+        if (it != registry->infos.end() && it.value().isNull())
+            registry->infos.erase(it);
     }
+    delete info;
 }
 
-void IrcNetworkPrivate::setModes(const QStringList& value)
+int IrcNetworkInfo::statusPrefixLength(const QString& str) const
 {
-    Q_Q(IrcNetwork);
-    if (modes != value) {
-        modes = value;
-        emit q->modesChanged(value);
-    }
+    int i = 0;
+    while (i < str.length() && isStatusPrefix(str.at(i)))
+        ++i;
+    return i;
 }
 
-void IrcNetworkPrivate::setPrefixes(const QStringList& value)
+QString IrcNetworkInfo::modeToPrefix(const QString& mode) const
 {
-    Q_Q(IrcNetwork);
-    if (prefixes != value) {
-        prefixes = value;
-        emit q->prefixesChanged(value);
+    if (mode.length() == 1 && mode.at(0).unicode() < 128) {
+        const ushort prefix = modePrefixes[mode.at(0).unicode()];
+        return prefix ? QString(QChar(prefix)) : QString();
     }
+    return prefixes.value(modes.indexOf(mode));
 }
 
-void IrcNetworkPrivate::setChannelTypes(const QStringList& value)
+QString IrcNetworkInfo::prefixToMode(const QString& prefix) const
 {
-    Q_Q(IrcNetwork);
-    if (channelTypes != value) {
-        channelTypes = value;
-        emit q->channelTypesChanged(value);
+    if (prefix.length() == 1 && prefix.at(0).unicode() < 128) {
+        const ushort mode = prefixModes[prefix.at(0).unicode()];
+        return mode ? QString(QChar(mode)) : QString();
     }
+    return modes.value(prefixes.indexOf(prefix));
+}
+
+IrcNetworkPrivate::IrcNetworkPrivate() : q_ptr(0), initialized(false),
+    info(IrcNetworkInfo::intern(QHash<QString, QString>()))
+{
 }
 
-void IrcNetworkPrivate::setStatusPrefixes(const QStringList& value)
+void IrcNetworkPrivate::setInfo(const QHash<QString, QString>& tokens)
 {
     Q_Q(IrcNetwork);
-    if (statusPrefixes != value) {
-        statusPrefixes = value;
-        emit q->statusPrefixesChanged(value);
+    QHash<QString, QString> merged = info->tokens;
+    QHash<QString, QString>::const_iterator it;
+    for (it = tokens.constBegin(); it != tokens.constEnd(); ++it)
+        merged.insert(it.key(), it.value());
+
+    const QSharedPointer<const IrcNetworkInfo> old = info;
+    info = IrcNetworkInfo::intern(merged);
+
+    if (old->name != info->name)
+        emit q->nameChanged(info->name);
+    if (old->modes != info->modes)
+        emit q->modesChanged(info->modes);
+    if (old->prefixes != info->prefixes)
+        emit q->prefixesChanged(info->prefixes);
+    if (old->channelTypes != info->channelTypes)
+        emit q->channelTypesChanged(info->channelTypes);
+    if (old->statusPrefixes != info->statusPrefixes)
+        emit q->statusPrefixesChanged(info->statusPrefixes);
+    if (old->caseMapping != info->caseMapping)
+        emit q->caseMappingChanged(info->caseMapping);
+
+    if (!initialized) {
+        initialized = true;
+        emit q->initialized();
     }
 }
 
-QString IrcNetworkPrivate::getPrefix(const QString& str, const QStringList& prefixes)
+void IrcNetworkPrivate::setAvailableCapabilities(const QSet<QString>& capabilities)
 {
-    int i = 0;
-    while (i < str.length() && prefixes.contains(str.at(i)))
-        ++i;
-    return str.left(i);
+    Q_Q(IrcNetwork);
+    if (availableCaps != capabilities) {
+        availableCaps = capabilities;
+        emit q->availableCapabilitiesChanged(availableCaps.toList());
+    }
 }
 
-QString IrcNetworkPrivate::removePrefix(const QString& str, const QStringList& prefixes)
+void IrcNetworkPrivate::setActiveCapabilities(const QSet<QString>& capabilities)
 {
-    int i = 0;
-    while (i < str.length() && prefixes.contains(str.at(i)))
-        ++i;
-    return str.mid(i);
+    Q_Q(IrcNetwork);
+    if (activeCaps != capabilities) {
+        activeCaps = capabilities;
+        emit q->activeCapabilitiesChanged(activeCaps.toList());
+    }
 }
 #endif // IRC_DOXYGEN
 
@@ -371,7 +424,7 @@ bool IrcNetwork::isInitialized()
 QString IrcNetwork::name() const
 {
     Q_D(const IrcNetwork);
-    return d->name;
+    return d->info->name;
 }
 
 /*!
@@ -394,7 +447,7 @@ QString IrcNetwork::name() const
 QStringList IrcNetwork::modes() const
 {
     Q_D(const IrcNetwork);
-    return d->modes;
+    return d->info->modes;
 }
 
 /*!
@@ -417,7 +470,7 @@ QStringList IrcNetwork::modes() const
 QStringList IrcNetwork::prefixes() const
 {
     Q_D(const IrcNetwork);
-    return d->prefixes;
+    return d->info->prefixes;
 }
 
 /*!
@@ -428,7 +481,7 @@ QStringList IrcNetwork::prefixes() const
 QString IrcNetwork::modeToPrefix(const QString& mode) const
 {
     Q_D(const IrcNetwork);
-    return d->prefixes.value(d->modes.indexOf(mode));
+    return d->info->modeToPrefix(mode);
 }
 
 /*!
@@ -439,7 +492,7 @@ QString IrcNetwork::modeToPrefix(const QString& mode) const
 QString IrcNetwork::prefixToMode(const QString& prefix) const
 {
     Q_D(const IrcNetwork);
-    return d->modes.value(d->prefixes.indexOf(prefix));
+    return d->info->prefixToMode(prefix);
 }
 
 /*!
@@ -460,7 +513,7 @@ QString IrcNetwork::prefixToMode(const QString& prefix) const
 QStringList IrcNetwork::channelTypes() const
 {
     Q_D(const IrcNetwork);
-    return d->channelTypes;
+    return d->info->channelTypes;
 }
 
 /*!
@@ -481,7 +534,28 @@ QStringList IrcNetwork::channelTypes() const
 QStringList IrcNetwork::statusPrefixes() const
 {
     Q_D(const IrcNetwork);
-    return d->statusPrefixes;
+    return d->info->statusPrefixes;
+}
+
+/*!
+    \since 3.6
+
+    This property holds the case mapping of nick and channel names.
+
+    The value is advertised by the server, for example \c "rfc1459",
+    \c "strict-rfc1459" or \c "ascii". The default value is \c "rfc1459",
+    where the characters \c []\\^ are the upper case forms of \c {}|~.
+
+    \par Access function:
+    \li QString <b>caseMapping</b>() const
+
+    \par Notifier signal:
+    \li void <b>caseMappingChanged</b>(const QString& caseMapping)
+ */
+QString IrcNetwork::caseMapping() const
+{
+    Q_D(const IrcNetwork);
+    return d->info->caseMapping;
 }
 
 /*!
@@ -498,8 +572,8 @@ QStringList IrcNetwork::statusPrefixes() const
 bool IrcNetwork::isChannel(const QString& name) const
 {
     Q_D(const IrcNetwork);
-    QString unprefixed = d->removePrefix(name, d->statusPrefixes);
-    return !unprefixed.isEmpty() && d->channelTypes.contains(unprefixed.at(0));
+    const int index = d->info->statusPrefixLength(name);
+    return index < name.length() && d->info->isChannelType(name.at(index));
 }
 
 /*!
@@ -512,13 +586,13 @@ QStringList IrcNetwork::channelModes(IrcNetwork::ModeTypes types) const
     Q_D(const IrcNetwork);
     QStringList modes;
     if (types & TypeA)
-        modes += d->channelModes.value(0).split("", QString::SkipEmptyParts);
+        modes += d->info->channelModes[0];
     if (types & TypeB)
-        modes += d->channelModes.value(1).split("", QString::SkipEmptyParts);
+        modes += d->info->channelModes[1];
     if (types & TypeC)
-        modes += d->channelModes.value(2).split("", QString::SkipEmptyParts);
+        modes += d->info->channelModes[2];
     if (types & TypeD)
-        modes += d->channelModes.value(3).split("", QString::SkipEmptyParts);
+        modes += d->info->channelModes[3];
     return modes;
 }
 
@@ -530,18 +604,9 @@ QStringList IrcNetwork::channelModes(IrcNetwork::ModeTypes types) const
 int IrcNetwork::numericLimit(Limit limit) const
 {
     Q_D(const IrcNetwork);
-    QString key;
-    switch (limit) {
-        case NickLength:        key = QLatin1String("NICKLEN"); break;
-        case ChannelLength:     key = QLatin1String("CHANNELLEN"); break;
-        case TopicLength:       key = QLatin1String("TOPICLEN"); break;
-        case MessageLength:     return 512; // RFC 1459
-        case KickReasonLength:  key = QLatin1String("KICKLEN"); break;
-        case AwayReasonLength:  key = QLatin1String("AWAYLEN"); break;
-        case ModeCount:         key = QLatin1String("MODES"); break;
-        case MonitorCount:      key = QLatin1String("MONITOR"); break;
-    }
-    return d->numericLimits.value(key, -1);
+    if (limit < NickLength || limit > MonitorCount)
+        return -1;
+    return d->info->numericLimits[limit];
 }
 
 /*!
@@ -552,7 +617,7 @@ int IrcNetwork::numericLimit(Limit limit) const
 int IrcNetwork::modeLimit(const QString& mode) const
 {
     Q_D(const IrcNetwork);
-    return d->modeLimits.value(mode);
+    return d->info->modeLimits.value(mode);
 }
 
 /*!
@@ -563,7 +628,7 @@ int IrcNetwork::modeLimit(const QString& mode) const
 int IrcNetwork::channelLimit(const QString& type) const
 {
     Q_D(const IrcNetwork);
-    return d->channelLimits.value(type);
+    return d->info->channelLimits.value(type);
 }
 
 /*!
@@ -572,7 +637,7 @@ int IrcNetwork::channelLimit(const QString& type) const
 int IrcNetwork::targetLimit(const QString& command) const
 {
     Q_D(const IrcNetwork);
-    return d->targetLimits.value(command);
+    return d->info->targetLimits.value(command);
 }
 
 /*!
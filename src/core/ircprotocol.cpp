@@ -28,8 +28,10 @@
 
 #include "ircprotocol.h"
 #include "ircconnection_p.h"
+#include "irclinereader_p.h"
 #include "ircmessagecomposer_p.h"
 #include "ircnetwork_p.h"
+#include "irctrafficrecorder_p.h"
 #include "ircconnection.h"
 #include "ircmessage_p.h"
 #include "irccommand.h"
@@ -54,6 +56,8 @@ IRC_BEGIN_NAMESPACE
  */
 
 #ifndef IRC_DOXYGEN
+static const int ERR_SASLFAIL = 904;
+
 class IrcProtocolPrivate
 {
     Q_DECLARE_PUBLIC(IrcProtocol)
@@ -62,9 +66,14 @@ public:
     IrcProtocolPrivate();
 
     void authenticate(bool secure);
+    bool speculate();
+    void requestCapabilities(const QSet<QString>& availableCaps, bool sasl, const QSet<QString>& refusedCaps = QSet<QString>());
+    bool discardSaslFailure(IrcMessage* msg);
+    void resumeHandshake();
 
     void readLines(const QByteArray& delimiter);
     void processLine(const QByteArray& line);
+    void processData(const IrcMessageData& data);
 
     bool batchMessage(IrcMessage* msg);
     bool handleBatchMessage(IrcBatchMessage* msg);
@@ -75,10 +84,12 @@ public:
 
     void _irc_pauseHandshake();
     void _irc_resumeHandshake();
+    void _irc_readParsed();
 
     IrcProtocol* q_ptr;
     IrcConnection* connection;
     IrcMessageComposer* composer;
+    QPointer<IrcLineReader> reader;
     QHash<QString, IrcBatchMessage*> batches;
     QHash<QString, QString> info;
     QByteArray buffer;
@@ -86,10 +97,15 @@ public:
     bool resumed;
     bool authed;
     bool motd;
+    bool pipelined;
+    bool speculating;
+    bool speculatingSasl;
+    bool saslRefused;
 };
 
-IrcProtocolPrivate::IrcProtocolPrivate() : q_ptr(0), connection(0), composer(0),
-    currentNick(-1), resumed(false), authed(false), motd(false)
+IrcProtocolPrivate::IrcProtocolPrivate() : q_ptr(0), connection(0), composer(0), reader(0),
+    currentNick(-1), resumed(false), authed(false), motd(false), pipelined(false), speculating(false),
+    speculatingSasl(false), saslRefused(false)
 {
 }
 
@@ -107,6 +123,64 @@ void IrcProtocolPrivate::authenticate(bool secure)
     }
 }
 
+bool IrcProtocolPrivate::speculate()
+{
+    // Request the capabilities without waiting for CAP LS to tell whether
+    // they are available. A CAP REQ is atomic, so a NAK leaves everything
+    // untouched and the request is retried with the available subset.
+    QMetaObject::invokeMethod(connection->network(), "requestingCapabilities");
+    QSet<QString> requestedCaps = connection->network()->requestedCapabilities().toSet();
+    const bool sasl = !connection->saslMechanism().isEmpty() && !connection->password().isEmpty();
+    if (sasl)
+        requestedCaps += QLatin1String("sasl");
+    speculating = !requestedCaps.isEmpty() && connection->sendRaw("CAP REQ :" + QStringList(requestedCaps.toList()).join(" "));
+    // the server processes the lines in order, so the mechanism
+    // can be sent right away and it is answered after the ACK
+    speculatingSasl = sasl && speculating && connection->sendRaw("AUTHENTICATE " + connection->saslMechanism());
+    return speculatingSasl;
+}
+
+void IrcProtocolPrivate::requestCapabilities(const QSet<QString>& availableCaps, bool sasl, const QSet<QString>& refusedCaps)
+{
+    QSet<QString> requestedCaps;
+    QSet<QString> activeCaps = connection->network()->activeCapabilities().toSet();
+    foreach (const QString& cap, connection->network()->requestedCapabilities()) {
+        if (availableCaps.contains(cap) && !activeCaps.contains(cap))
+            requestedCaps += cap;
+    }
+    if (sasl && !connection->saslMechanism().isEmpty() && availableCaps.contains(QLatin1String("sasl")))
+        requestedCaps += QLatin1String("sasl");
+    // the server would refuse the very same request again
+    if (!requestedCaps.isEmpty() && requestedCaps != refusedCaps)
+        connection->sendRaw("CAP REQ :" + QStringList(requestedCaps.toList()).join(" "));
+    else
+        resumeHandshake();
+}
+
+// The server answers the speculative AUTHENTICATE of a refused CAP REQ with
+// ERR_SASLFAIL, or ERR_UNKNOWNCOMMAND if it does not know SASL at all. The
+// reply belongs to an exchange that never started, so it is not delivered.
+bool IrcProtocolPrivate::discardSaslFailure(IrcMessage* msg)
+{
+    if (!saslRefused || msg->type() != IrcMessage::Numeric)
+        return false;
+    const int code = static_cast<IrcNumericMessage*>(msg)->code();
+    if (code != ERR_SASLFAIL && (code != Irc::ERR_UNKNOWNCOMMAND || msg->parameters().value(1) != QLatin1String("AUTHENTICATE")))
+        return false;
+    saslRefused = false;
+    msg->deleteLater();
+    return true;
+}
+
+void IrcProtocolPrivate::resumeHandshake()
+{
+    Q_Q(IrcProtocol);
+    if (pipelined)
+        _irc_resumeHandshake();
+    else
+        QMetaObject::invokeMethod(q, "_irc_resumeHandshake", Qt::QueuedConnection);
+}
+
 void IrcProtocolPrivate::readLines(const QByteArray& delimiter)
 {
     int i = -1;
@@ -119,8 +193,14 @@ void IrcProtocolPrivate::readLines(const QByteArray& delimiter)
 }
 
 void IrcProtocolPrivate::processLine(const QByteArray& line)
+{
+    processData(IrcMessageData::fromData(line));
+}
+
+void IrcProtocolPrivate::processData(const IrcMessageData& data)
 {
     Q_Q(IrcProtocol);
+    const QByteArray& line = data.content;
     ircDebug(connection, IrcDebug::Read) << line;
 
     if (line.startsWith("AUTHENTICATE") && !connection->saslMechanism().isEmpty()) {
@@ -128,17 +208,29 @@ void IrcProtocolPrivate::processLine(const QByteArray& line)
         if (args.count() == 2 && args.at(1) == "+")
             authenticate(true);
         if (!connection->isConnected())
-            QMetaObject::invokeMethod(q, "_irc_resumeHandshake", Qt::QueuedConnection);
+            resumeHandshake();
         return;
     }
 
-    IrcMessage* msg = IrcMessage::fromData(line, connection);
-    if (msg) {
-        msg->setEncoding(connection->encoding());
+    IrcConnectionPrivate* priv = IrcConnectionPrivate::get(connection);
+    if (priv->metricsEnabled)
+        ++priv->metrics.linesIn;
 
+    IrcMessage* msg = 0;
+    {
+        IRC_METRICS_TIMER(priv->activeMetrics(), Parse);
+        msg = IrcMessagePrivate::fromData(data, connection);
+        if (msg)
+            msg->setEncoding(connection->encoding());
+    }
+
+    if (msg) {
         if (!msg->tag("batch").isNull() && batchMessage(msg))
             return;
 
+        if (discardSaslFailure(msg))
+            return;
+
         switch (msg->type()) {
         case IrcMessage::Batch:
             if (handleBatchMessage(static_cast<IrcBatchMessage*>(msg)))
@@ -296,38 +388,37 @@ void IrcProtocolPrivate::handleCapabilityMessage(IrcCapabilityMessage* msg)
             handleCapability(&availableCaps, cap);
         q->setAvailableCapabilities(availableCaps);
 
-        if (!connected && msg->parameter(2) != "*") {
+        // a speculative request is answered by ACK or NAK
+        if (!connected && !speculating && msg->parameter(2) != "*") {
             QMetaObject::invokeMethod(connection->network(), "requestingCapabilities");
-            QSet<QString> requestedCaps;
-            QSet<QString> activeCaps = connection->network()->activeCapabilities().toSet();
-            foreach (const QString& cap, connection->network()->requestedCapabilities()) {
-                if (availableCaps.contains(cap) && !activeCaps.contains(cap))
-                    requestedCaps += cap;
-            }
             const QStringList params = msg->parameters();
-            if (params.value(params.count() - 1) != QLatin1String("*")) {
-                if (!connection->saslMechanism().isEmpty() && availableCaps.contains(QLatin1String("sasl")))
-                    requestedCaps += QLatin1String("sasl");
-            }
-            if (!requestedCaps.isEmpty())
-                connection->sendRaw("CAP REQ :" + QStringList(requestedCaps.toList()).join(" "));
-            else
-                QMetaObject::invokeMethod(q, "_irc_resumeHandshake", Qt::QueuedConnection);
+            requestCapabilities(availableCaps, params.value(params.count() - 1) != QLatin1String("*"));
         }
     } else if (subCommand == "ACK" || subCommand == "NAK") {
         bool auth = false;
+        const bool speculated = speculating;
+        speculating = false;
+        // the failure of the speculative AUTHENTICATE precedes any later reply
+        saslRefused = false;
         if (subCommand == "ACK") {
             QSet<QString> activeCaps = connection->network()->activeCapabilities().toSet();
             foreach (const QString& cap, msg->capabilities()) {
                 handleCapability(&activeCaps, cap);
                 if (cap == "sasl" && !connection->saslMechanism().isEmpty() && !connection->password().isEmpty())
-                    auth = connection->sendRaw("AUTHENTICATE " + connection->saslMechanism());
+                    auth = speculated || connection->sendRaw("AUTHENTICATE " + connection->saslMechanism());
             }
             q->setActiveCapabilities(activeCaps);
+        } else if (speculated) {
+            saslRefused = speculatingSasl;
+            speculatingSasl = false;
+            // fall back to requesting what CAP LS advertised, unless
+            // that is exactly what the server has just refused
+            requestCapabilities(connection->network()->availableCapabilities().toSet(), true, msg->capabilities().toSet());
+            return;
         }
 
         if (!connected && !auth)
-            QMetaObject::invokeMethod(q, "_irc_resumeHandshake", Qt::QueuedConnection);
+            resumeHandshake();
     } else if (subCommand == "NEW") {
         QStringList requestedCaps;
         QSet<QString> availableCaps = connection->network()->availableCapabilities().toSet();
@@ -362,6 +453,9 @@ void IrcProtocolPrivate::_irc_pauseHandshake()
     connection->sendData("CAP LS 302");
     resumed = false;
     authed = false;
+    speculating = false;
+    speculatingSasl = false;
+    saslRefused = false;
 }
 
 void IrcProtocolPrivate::_irc_resumeHandshake()
@@ -373,6 +467,14 @@ void IrcProtocolPrivate::_irc_resumeHandshake()
     }
     resumed = true;
 }
+
+void IrcProtocolPrivate::_irc_readParsed()
+{
+    if (reader) {
+        foreach (const IrcMessageData& data, reader->readAll())
+            processData(data);
+    }
+}
 #endif // IRC_DOXYGEN
 
 /*!
@@ -383,8 +485,7 @@ IrcProtocol::IrcProtocol(IrcConnection* connection) : QObject(connection), d_ptr
     Q_D(IrcProtocol);
     d->q_ptr = this;
     d->connection = connection;
-    d->composer = new IrcMessageComposer(connection);
-    connect(d->composer, SIGNAL(messageComposed(IrcMessage*)), this, SLOT(receiveMessage(IrcMessage*)));
+    d->composer = new IrcMessageComposer(connection, this);
 }
 
 /*!
@@ -393,6 +494,8 @@ IrcProtocol::IrcProtocol(IrcConnection* connection) : QObject(connection), d_ptr
 IrcProtocol::~IrcProtocol()
 {
     Q_D(IrcProtocol);
+    if (d->reader)
+        d->reader->deleteLater();
     delete d->composer;
 }
 
@@ -420,6 +523,97 @@ QAbstractSocket* IrcProtocol::socket() const
     return d->connection->socket();
 }
 
+/*!
+    \since 3.6
+
+    This property holds whether incoming data is parsed in a separate thread.
+
+    When enabled, the default implementation of read() hands the received
+    data over to a shared pool of reader threads that split it into lines
+    and parse the lines. The parsed messages are delivered back to the
+    thread of the connection, where they are received in the original
+    order. Connections are distributed evenly between the reader threads.
+
+    This is useful for applications that run a large amount of connections.
+    The default value is \c false.
+
+    \note Disabling threaded parsing waits for the reader thread to parse
+    the data that has been received so far.
+
+    \par Access functions:
+    \li bool <b>isThreaded</b>() const
+    \li void <b>setThreaded</b>(bool threaded)
+ */
+bool IrcProtocol::isThreaded() const
+{
+    Q_D(const IrcProtocol);
+    return d->reader != 0;
+}
+
+void IrcProtocol::setThreaded(bool threaded)
+{
+    Q_D(IrcProtocol);
+    if (threaded && !d->reader) {
+        d->reader = IrcLineReader::create();
+        connect(d->reader, SIGNAL(readyRead()), this, SLOT(_irc_readParsed()));
+        d->reader->write(d->buffer);
+        d->buffer.clear();
+    } else if (!threaded && d->reader) {
+        IrcLineReader* reader = d->reader;
+        disconnect(reader, SIGNAL(readyRead()), this, SLOT(_irc_readParsed()));
+        // wait for the reader thread to parse the data it has received,
+        // deliver the messages and continue with the incomplete line
+        d->buffer = reader->stop();
+        d->_irc_readParsed();
+        d->reader = 0;
+        reader->deleteLater();
+    }
+}
+
+/*!
+    \since 3.6
+
+    This property holds whether the connection registration handshake is pipelined.
+
+    By default, the capabilities are requested after the server has listed
+    the available capabilities, and SASL authentication is started after the
+    server has acknowledged the \c sasl capability. Each step takes a round
+    trip to the server.
+
+    When enabled, the default implementation of open() sends the
+    <tt>CAP REQ</tt> for the \ref IrcNetwork::requestedCapabilities
+    "requested capabilities" and the <tt>AUTHENTICATE</tt> command together
+    with the \c NICK and \c USER commands, without waiting for the replies.
+    When SASL is not used, <tt>CAP END</tt> is sent right away as well, so
+    that registration completes in a single round trip. Commands that have
+    been sent before the connection was established, such as the initial
+    channel joins, are written as soon as the server welcomes the client.
+
+    If the server rejects the speculative request, for example because one
+    of the requested capabilities is not available, the request is retried
+    with the capabilities that the server has advertised, unless those are
+    exactly the ones it has just refused. The reply to the speculative
+    <tt>AUTHENTICATE</tt> of a rejected request is not delivered.
+
+    This is useful for applications that reconnect a large amount of
+    connections. The default value is \c false.
+
+    \par Access functions:
+    \li bool <b>isPipelined</b>() const
+    \li void <b>setPipelined</b>(bool pipelined)
+ */
+bool IrcProtocol::isPipelined() const
+{
+    Q_D(const IrcProtocol);
+    return d->pipelined;
+}
+
+void IrcProtocol::setPipelined(bool pipelined)
+{
+    Q_D(IrcProtocol);
+    d->pipelined = pipelined;
+}
+
 /*!
     This method is called when the connection has been established.
 
@@ -428,12 +622,16 @@ QAbstractSocket* IrcProtocol::socket() const
 
     Furthermore, it sends a <tt>CAP LS</tt> command as specified in
     <a href="http://tools.ietf.org/html/draft-mitchell-irc-capabilities-01">IRC Client Capabilities Extension</a>.
+
+    \sa pipelined
  */
 void IrcProtocol::open()
 {
     Q_D(IrcProtocol);
     d->_irc_pauseHandshake();
 
+    const bool auth = d->pipelined && d->speculate();
+
     if (d->connection->saslMechanism().isEmpty() && !d->connection->password().isEmpty())
         d->authenticate(false);
 
@@ -443,6 +641,9 @@ void IrcProtocol::open()
 
     d->connection->sendRaw(QString("NICK %1").arg(nick));
     d->connection->sendRaw(QString("USER %1 hostname servername :%2").arg(d->connection->userName(), d->connection->realName()));
+
+    if (d->pipelined && !auth)
+        d->_irc_resumeHandshake();
 }
 
 /*!
@@ -465,7 +666,15 @@ void IrcProtocol::close()
 void IrcProtocol::read()
 {
     Q_D(IrcProtocol);
-    d->buffer += socket()->readAll();
+    const QByteArray data = socket()->readAll();
+    IrcConnectionPrivate* priv = IrcConnectionPrivate::get(d->connection);
+    if (priv->recorder)
+        IrcTrafficRecorderPrivate::get(priv->recorder)->record(IrcTrafficRecorderPrivate::Read, data);
+    if (d->reader) {
+        d->reader->write(data);
+        return;
+    }
+    d->buffer += data;
     // try reading RFC compliant message lines first
     d->readLines("\r\n");
     // fall back to RFC incompliant lines...
@@ -482,7 +691,16 @@ void IrcProtocol::read()
  */
 bool IrcProtocol::write(const QByteArray& data)
 {
-    return socket()->write(data + QByteArray("\r\n")) != -1;
+    Q_D(IrcProtocol);
+    const QByteArray line = data + QByteArray("\r\n");
+    if (socket()->write(line) == -1)
+        return false;
+    IrcConnectionPrivate* priv = IrcConnectionPrivate::get(d->connection);
+    if (priv->recorder)
+        IrcTrafficRecorderPrivate::get(priv->recorder)->record(IrcTrafficRecorderPrivate::Write, line);
+    foreach (IrcWriteObserver* observer, priv->writeObservers)
+        observer->lineWritten(data);
+    return true;
 }
 
 /*!
@@ -0,0 +1,337 @@
+/*
+  Copyright (C) 2008-2016 The Communi Project
+
+  You may use this file under the terms of BSD license as follows:
+
+  Redistribution and use in source and binary forms, with or without
+  modification, are permitted provided that the following conditions are met:
+    * Redistributions of source code must retain the above copyright
+      notice, this list of conditions and the following disclaimer.
+    * Redistributions in binary form must reproduce the above copyright
+      notice, this list of conditions and the following disclaimer in the
+      documentation and/or other materials provided with the distribution.
+    * Neither the name of the copyright holder nor the names of its
+      contributors may be used to endorse or promote products derived
+      from this software without specific prior written permission.
+
+  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+  ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+  WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+  DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDERS OR CONTRIBUTORS BE LIABLE FOR
+  ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+  (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+  ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+  (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+  SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#include "ircreplaysocket.h"
+#include "irctrafficrecorder_p.h"
+#include <QElapsedTimer>
+#include <QDataStream>
+#include <QTimer>
+#include <QDebug>
+#include <QFile>
+#include <QList>
+#include <string.h>
+
+IRC_BEGIN_NAMESPACE
+
+/*!
+    \file ircreplaysocket.h
+    \brief \#include &lt;IrcReplaySocket&gt;
+ */
+
+/*!
+    \class IrcReplaySocket ircreplaysocket.h <IrcReplaySocket>
+    \ingroup core
+    \brief Plays back recorded traffic to a connection.
+    \since 3.6
+
+    IrcReplaySocket is a socket that plays back the data read during a
+    session recorded by IrcTrafficRecorder. It does not connect to any
+    server. Data written to the socket is discarded.
+
+    \code
+    IrcReplaySocket* socket = new IrcReplaySocket(connection);
+    socket->load("session.ircr");
+    connection->setSocket(socket);
+    connection->open();
+    \endcode
+
+    By default, the recorded data is played back as fast as possible,
+    one recorded read per event loop pass. When \ref realTime is enabled,
+    the data is played back at the recorded pace.
+
+    \sa IrcTrafficRecorder
+ */
+
+/*!
+    \fn void IrcReplaySocket::finished()
+
+    This signal is emitted when all recorded data has been played back.
+    The socket disconnects after emitting the signal.
+ */
+
+#ifndef IRC_DOXYGEN
+struct IrcReplayRecord
+{
+    quint32 offset;
+    QByteArray data;
+};
+
+class IrcReplaySocketPrivate
+{
+    Q_DECLARE_PUBLIC(IrcReplaySocket)
+
+public:
+    IrcReplaySocketPrivate() : q_ptr(0), next(0), realTime(false) { }
+
+    void scheduleNext();
+
+    void _irc_connect();
+    void _irc_replay();
+
+    IrcReplaySocket* q_ptr;
+    QList<IrcReplayRecord> records;
+    int next;
+    bool realTime;
+    QByteArray buffer;
+    QTimer timer;
+    QElapsedTimer clock;
+};
+
+void IrcReplaySocketPrivate::scheduleNext()
+{
+    Q_Q(IrcReplaySocket);
+    if (q->state() != QAbstractSocket::ConnectedState)
+        return;
+    qint64 delay = 0;
+    if (realTime && next < records.count())
+        delay = qMax(Q_INT64_C(0), records.at(next).offset - clock.elapsed());
+    timer.start(static_cast<int>(delay));
+}
+
+void IrcReplaySocketPrivate::_irc_connect()
+{
+    Q_Q(IrcReplaySocket);
+    if (q->state() != QAbstractSocket::ConnectingState)
+        return;
+    q->setSocketState(QAbstractSocket::ConnectedState);
+    emit q->stateChanged(QAbstractSocket::ConnectedState);
+    emit q->connected();
+    clock.start();
+    scheduleNext();
+}
+
+void IrcReplaySocketPrivate::_irc_replay()
+{
+    Q_Q(IrcReplaySocket);
+    if (next >= records.count()) {
+        emit q->finished();
+        q->disconnectFromHostImplementation();
+        return;
+    }
+    buffer += records.at(next++).data;
+    emit q->readyRead();
+    scheduleNext();
+}
+#endif // IRC_DOXYGEN
+
+/*!
+    Constructs a new replay socket with \a parent.
+ */
+IrcReplaySocket::IrcReplaySocket(QObject* parent) : QAbstractSocket(TcpSocket, parent), d_ptr(new IrcReplaySocketPrivate)
+{
+    Q_D(IrcReplaySocket);
+    d->q_ptr = this;
+    d->timer.setSingleShot(true);
+    connect(&d->timer, SIGNAL(timeout()), this, SLOT(_irc_replay()));
+}
+
+/*!
+    Destructs the replay socket.
+ */
+IrcReplaySocket::~IrcReplaySocket()
+{
+    // nothing for QAbstractSocket to abort
+    setSocketState(UnconnectedState);
+}
+
+/*!
+    Loads a recording from a file called \a fileName.
+
+    Returns \c true on success; otherwise \c false.
+ */
+bool IrcReplaySocket::load(const QString& fileName)
+{
+    QFile file(fileName);
+    if (!file.open(QIODevice::ReadOnly)) {
+        qWarning() << "IrcReplaySocket::load(): cannot open" << fileName << file.errorString();
+        return false;
+    }
+    return load(&file);
+}
+
+/*!
+    Loads a recording from \a device, which must be open for reading.
+
+    Returns \c true on success; otherwise \c false.
+ */
+bool IrcReplaySocket::load(QIODevice* device)
+{
+    Q_D(IrcReplaySocket);
+    if (!device)
+        return false;
+
+    QDataStream in(device);
+    in.setVersion(QDataStream::Qt_4_6);
+
+    quint32 magic = 0;
+    quint16 version = 0;
+    qint64 start = 0;
+    in >> magic >> version >> start;
+    if (in.status() != QDataStream::Ok || magic != IRC_RECORDING_MAGIC || version > IRC_RECORDING_VERSION) {
+        qWarning("IrcReplaySocket::load(): unsupported recording");
+        return false;
+    }
+
+    QList<IrcReplayRecord> records;
+    while (!in.atEnd()) {
+        quint8 direction = 0;
+        IrcReplayRecord record;
+        in >> direction >> record.offset >> record.data;
+        if (in.status() != QDataStream::Ok) {
+            qWarning("IrcReplaySocket::load(): truncated recording");
+            return false;
+        }
+        // written data is produced again by the connection itself
+        if (direction == IrcTrafficRecorderPrivate::Read)
+            records += record;
+    }
+
+    d->records = records;
+    d->next = 0;
+    return true;
+}
+
+/*!
+    This property holds whether the recording is played back at the recorded pace.
+
+    The default value is \c false, which means that the recording is
+    played back as fast as possible.
+
+    \par Access functions:
+    \li bool <b>isRealTime</b>() const
+    \li void <b>setRealTime</b>(bool realTime)
+ */
+bool IrcReplaySocket::isRealTime() const
+{
+    Q_D(const IrcReplaySocket);
+    return d->realTime;
+}
+
+void IrcReplaySocket::setRealTime(bool realTime)
+{
+    Q_D(IrcReplaySocket);
+    d->realTime = realTime;
+}
+
+/*!
+    \reimp
+ */
+qint64 IrcReplaySocket::bytesAvailable() const
+{
+    Q_D(const IrcReplaySocket);
+    return d->buffer.size() + QIODevice::bytesAvailable();
+}
+
+/*!
+    \reimp
+ */
+void IrcReplaySocket::close()
+{
+    disconnectFromHostImplementation();
+}
+
+#if QT_VERSION >= 0x050000
+/*!
+    \reimp
+ */
+void IrcReplaySocket::connectToHost(const QString& hostName, quint16 port, OpenMode mode, NetworkLayerProtocol protocol)
+{
+    Q_UNUSED(protocol);
+    connectToHostImplementation(hostName, port, mode);
+}
+
+/*!
+    \reimp
+ */
+void IrcReplaySocket::disconnectFromHost()
+{
+    disconnectFromHostImplementation();
+}
+#endif // QT_VERSION
+
+/*!
+    \reimp
+ */
+qint64 IrcReplaySocket::readData(char* data, qint64 maxSize)
+{
+    Q_D(IrcReplaySocket);
+    const int size = static_cast<int>(qMin<qint64>(maxSize, d->buffer.size()));
+    memcpy(data, d->buffer.constData(), size);
+    d->buffer.remove(0, size);
+    return size;
+}
+
+/*!
+    \reimp
+ */
+qint64 IrcReplaySocket::writeData(const char* data, qint64 size)
+{
+    Q_UNUSED(data);
+    return size;
+}
+
+/*!
+    \internal
+ */
+void IrcReplaySocket::connectToHostImplementation(const QString& hostName, quint16 port, OpenMode mode)
+{
+    Q_D(IrcReplaySocket);
+    if (state() != UnconnectedState)
+        return;
+    setPeerName(hostName);
+    setPeerPort(port);
+    d->next = 0;
+    d->buffer.clear();
+    QIODevice::open(mode | QIODevice::Unbuffered);
+    setSocketState(ConnectingState);
+    emit stateChanged(ConnectingState);
+    // connect asynchronously like a real socket does
+    QMetaObject::invokeMethod(this, "_irc_connect", Qt::QueuedConnection);
+}
+
+/*!
+    \internal
+ */
+void IrcReplaySocket::disconnectFromHostImplementation()
+{
+    Q_D(IrcReplaySocket);
+    if (state() == UnconnectedState)
+        return;
+    const bool wasConnected = state() == ConnectedState;
+    d->timer.stop();
+    d->buffer.clear();
+    setSocketState(UnconnectedState);
+    emit stateChanged(UnconnectedState);
+    if (wasConnected)
+        emit disconnected();
+    QIODevice::close();
+}
+
+#include "moc_ircreplaysocket.cpp"
+
+IRC_END_NAMESPACE
@@ -0,0 +1,226 @@
+/*
+  Copyright (C) 2008-2016 The Communi Project
+
+  You may use this file under the terms of BSD license as follows:
+
+  Redistribution and use in source and binary forms, with or without
+  modification, are permitted provided that the following conditions are met:
+    * Redistributions of source code must retain the above copyright
+      notice, this list of conditions and the following disclaimer.
+    * Redistributions in binary form must reproduce the above copyright
+      notice, this list of conditions and the following disclaimer in the
+      documentation and/or other materials provided with the distribution.
+    * Neither the name of the copyright holder nor the names of its
+      contributors may be used to endorse or promote products derived
+      from this software without specific prior written permission.
+
+  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+  ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+  WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+  DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDERS OR CONTRIBUTORS BE LIABLE FOR
+  ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+  (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+  ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+  (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+  SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#include "irctrace_p.h"
+#include <QCoreApplication>
+#include <QDateTime>
+
+IRC_BEGIN_NAMESPACE
+
+#ifndef IRC_DOXYGEN
+static const int TRACE_CAPACITY = 8192; // must be a power of two
+static const ulong TRACE_IDLE_MSECS = 10;
+
+static int irc_atomic_load(QAtomicInt& value)
+{
+#if QT_VERSION >= 0x050000
+    return value.loadAcquire();
+#else
+    return value.fetchAndAddAcquire(0);
+#endif // QT_VERSION
+}
+
+static void irc_atomic_store(QAtomicInt& value, int newValue)
+{
+#if QT_VERSION >= 0x050000
+    value.storeRelease(newValue);
+#else
+    value.fetchAndStoreRelease(newValue);
+#endif // QT_VERSION
+}
+
+IrcTraceRing::IrcTraceRing(int capacity) : cells(new Cell[capacity]), mask(capacity - 1), enqueuePos(0), dequeuePos(0)
+{
+    Q_ASSERT((capacity & mask) == 0);
+    for (int i = 0; i < capacity; ++i)
+        irc_atomic_store(cells[i].sequence, i);
+}
+
+IrcTraceRing::~IrcTraceRing()
+{
+    delete [] cells;
+}
+
+bool IrcTraceRing::enqueue(const IrcTraceRecord& record)
+{
+    Cell* cell = 0;
+    int pos = irc_atomic_load(enqueuePos);
+    forever {
+        cell = &cells[pos & mask];
+        const int diff = static_cast<int>(static_cast<uint>(irc_atomic_load(cell->sequence)) - static_cast<uint>(pos));
+        if (diff == 0) {
+            if (enqueuePos.testAndSetRelaxed(pos, static_cast<int>(static_cast<uint>(pos) + 1)))
+                break;
+            pos = irc_atomic_load(enqueuePos);
+        } else if (diff < 0) {
+            return false;
+        } else {
+            pos = irc_atomic_load(enqueuePos);
+        }
+    }
+    cell->record = record;
+    irc_atomic_store(cell->sequence, static_cast<int>(static_cast<uint>(pos) + 1));
+    return true;
+}
+
+bool IrcTraceRing::dequeue(IrcTraceRecord* record)
+{
+    Cell* cell = &cells[dequeuePos & mask];
+    if (static_cast<uint>(irc_atomic_load(cell->sequence)) != dequeuePos + 1)
+        return false;
+    *record = cell->record;
+    cell->record = IrcTraceRecord();
+    irc_atomic_store(cell->sequence, static_cast<int>(dequeuePos + mask + 1));
+    ++dequeuePos;
+    return true;
+}
+
+// initialized once in a thread-safe manner
+Q_GLOBAL_STATIC(IrcTraceWriter, irc_trace_writer)
+
+// the thread must be joined while the application still exists,
+// not during the destruction of static objects
+static void irc_stop_trace_writer()
+{
+    irc_trace_writer()->stop();
+}
+
+IrcTraceWriter::IrcTraceWriter() : ring(0), active(0), quit(0), dropped(0)
+{
+    const QString fileName = QFile::decodeName(qgetenv("IRC_DEBUG_FILE"));
+    if (!fileName.isEmpty()) {
+        if (open(fileName, TRACE_CAPACITY)) {
+            start(QThread::LowPriority);
+            qAddPostRoutine(irc_stop_trace_writer);
+        } else {
+            // IrcDebug falls back to qDebug()
+            qWarning("IrcTraceWriter: cannot open '%s' for writing", qPrintable(fileName));
+        }
+    }
+}
+
+IrcTraceWriter::IrcTraceWriter(const QString& fileName, int capacity) : ring(0), active(0), quit(0), dropped(0)
+{
+    open(fileName, capacity);
+}
+
+IrcTraceWriter::~IrcTraceWriter()
+{
+    stop();
+    delete ring;
+}
+
+// the ring is allocated only when there is a file to write to
+bool IrcTraceWriter::open(const QString& fileName, int capacity)
+{
+    file.setFileName(fileName);
+    if (!file.open(QIODevice::WriteOnly | QIODevice::Append))
+        return false;
+    ring = new IrcTraceRing(capacity);
+    irc_atomic_store(active, 1);
+    return true;
+}
+
+IrcTraceWriter* IrcTraceWriter::instance()
+{
+    IrcTraceWriter* writer = irc_trace_writer();
+    if (!writer || !irc_atomic_load(writer->active))
+        return 0;
+    return writer;
+}
+
+// flushes the remaining records, later records go to qDebug()
+void IrcTraceWriter::stop()
+{
+    if (irc_atomic_load(active)) {
+        irc_atomic_store(active, 0);
+        irc_atomic_store(quit, 1);
+        wait();
+        file.close();
+    }
+}
+
+const char* IrcTraceWriter::marker(int level)
+{
+    switch (level) {
+        case 1: return "!!";
+        case 2: return "??";
+        case 3: return "->";
+        case 4: return "<-";
+        default: return "";
+    }
+}
+
+// never blocks, records are dropped while the ring is full
+void IrcTraceWriter::post(const IrcTraceRecord& record)
+{
+    if (!ring->enqueue(record))
+        dropped.fetchAndAddRelaxed(1);
+}
+
+static QByteArray irc_trace_line(qint64 stamp, const QString& name, int level, const QByteArray& text)
+{
+    QByteArray line = "[";
+    line += QDateTime::fromMSecsSinceEpoch(stamp).toString(Qt::ISODate).toLatin1();
+    line += ' ';
+    line += name.toUtf8();
+    line += "] ";
+    line += IrcTraceWriter::marker(level);
+    line += ' ';
+    line += text;
+    line += '\n';
+    return line;
+}
+
+void IrcTraceWriter::run()
+{
+    forever {
+        const bool stop = irc_atomic_load(quit);
+        bool idle = true;
+        IrcTraceRecord record;
+        while (ring->dequeue(&record)) {
+            file.write(irc_trace_line(record.stamp, record.name, record.level, record.text));
+            idle = false;
+        }
+        const int drops = dropped.fetchAndStoreRelaxed(0);
+        if (drops > 0) {
+            const QByteArray text = QByteArray::number(drops) + " trace records dropped";
+            file.write(irc_trace_line(QDateTime::currentMSecsSinceEpoch(), QString(), 1, text));
+            idle = false;
+        }
+        if (!idle)
+            file.flush();
+        if (stop)
+            break;
+        if (idle)
+            msleep(TRACE_IDLE_MSECS);
+    }
+}
+#endif // IRC_DOXYGEN
+
+IRC_END_NAMESPACE
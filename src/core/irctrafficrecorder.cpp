@@ -0,0 +1,199 @@
+/*
+  Copyright (C) 2008-2016 The Communi Project
+
+  You may use this file under the terms of BSD license as follows:
+
+  Redistribution and use in source and binary forms, with or without
+  modification, are permitted provided that the following conditions are met:
+    * Redistributions of source code must retain the above copyright
+      notice, this list of conditions and the following disclaimer.
+    * Redistributions in binary form must reproduce the above copyright
+      notice, this list of conditions and the following disclaimer in the
+      documentation and/or other materials provided with the distribution.
+    * Neither the name of the copyright holder nor the names of its
+      contributors may be used to endorse or promote products derived
+      from this software without specific prior written permission.
+
+  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+  ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+  WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+  DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDERS OR CONTRIBUTORS BE LIABLE FOR
+  ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+  (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+  ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+  (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+  SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#include "irctrafficrecorder.h"
+#include "irctrafficrecorder_p.h"
+#include "ircconnection_p.h"
+#include "ircconnection.h"
+#include <QDateTime>
+#include <QDebug>
+
+IRC_BEGIN_NAMESPACE
+
+/*!
+    \file irctrafficrecorder.h
+    \brief \#include &lt;IrcTrafficRecorder&gt;
+ */
+
+/*!
+    \class IrcTrafficRecorder irctrafficrecorder.h <IrcTrafficRecorder>
+    \ingroup core
+    \brief Records the raw traffic of a connection.
+    \since 3.6
+
+    IrcTrafficRecorder writes the raw bytes that the \ref IrcProtocol "protocol"
+    of a connection reads from and writes to its socket into a device,
+    together with the time elapsed since the recording was started.
+    A recording can be played back with IrcReplaySocket in order to
+    reproduce a session deterministically without a server.
+
+    \code
+    IrcTrafficRecorder* recorder = new IrcTrafficRecorder(connection);
+    recorder->open("session.ircr");
+    \endcode
+
+    \note Only the traffic passing through IrcProtocol::read() and
+          IrcProtocol::write() is recorded. A custom protocol that
+          overrides these without calling the base implementation
+          is not recorded.
+
+    \sa IrcReplaySocket
+ */
+
+#ifndef IRC_DOXYGEN
+IrcTrafficRecorderPrivate::IrcTrafficRecorderPrivate() : q_ptr(0), file(0)
+{
+}
+
+void IrcTrafficRecorderPrivate::record(Direction direction, const QByteArray& data)
+{
+    if (device && !data.isEmpty())
+        stream << static_cast<quint8>(direction) << static_cast<quint32>(timer.elapsed()) << data;
+}
+#endif // IRC_DOXYGEN
+
+/*!
+    Constructs a new traffic recorder with \a parent.
+
+    \note If \a parent is an instance of IrcConnection, it will be
+    automatically assigned to \ref IrcTrafficRecorder::connection "connection".
+ */
+IrcTrafficRecorder::IrcTrafficRecorder(QObject* parent) : QObject(parent), d_ptr(new IrcTrafficRecorderPrivate)
+{
+    Q_D(IrcTrafficRecorder);
+    d->q_ptr = this;
+    setConnection(qobject_cast<IrcConnection*>(parent));
+}
+
+/*!
+    Destructs the traffic recorder.
+ */
+IrcTrafficRecorder::~IrcTrafficRecorder()
+{
+    setConnection(0);
+    close();
+}
+
+/*!
+    This property holds the recorded connection.
+
+    \par Access functions:
+    \li IrcConnection* <b>connection</b>() const
+    \li void <b>setConnection</b>(IrcConnection* connection)
+ */
+IrcConnection* IrcTrafficRecorder::connection() const
+{
+    Q_D(const IrcTrafficRecorder);
+    return d->connection;
+}
+
+void IrcTrafficRecorder::setConnection(IrcConnection* connection)
+{
+    Q_D(IrcTrafficRecorder);
+    if (d->connection != connection) {
+        if (d->connection) {
+            IrcConnectionPrivate* priv = IrcConnectionPrivate::get(d->connection);
+            if (priv->recorder == this)
+                priv->recorder = 0;
+        }
+        d->connection = connection;
+        if (connection)
+            IrcConnectionPrivate::get(connection)->recorder = this;
+    }
+}
+
+/*!
+    Returns the device the traffic is recorded to.
+
+    \sa setDevice()
+ */
+QIODevice* IrcTrafficRecorder::device() const
+{
+    Q_D(const IrcTrafficRecorder);
+    return d->device;
+}
+
+/*!
+    Starts recording to \a device, which must be open for writing.
+    Passing \c 0 stops recording.
+
+    \sa open(), close()
+ */
+void IrcTrafficRecorder::setDevice(QIODevice* device)
+{
+    Q_D(IrcTrafficRecorder);
+    if (d->device != device) {
+        if (d->file && d->file != device) {
+            delete d->file;
+            d->file = 0;
+        }
+        d->device = device;
+        d->stream.setDevice(device);
+        if (device) {
+            d->stream.setVersion(QDataStream::Qt_4_6);
+            d->stream << IRC_RECORDING_MAGIC << IRC_RECORDING_VERSION << QDateTime::currentMSecsSinceEpoch();
+            d->timer.start();
+        }
+    }
+}
+
+/*!
+    Starts recording to a file called \a fileName. Any existing
+    content of the file is overwritten.
+
+    Returns \c true on success; otherwise \c false.
+
+    \sa setDevice(), close()
+ */
+bool IrcTrafficRecorder::open(const QString& fileName)
+{
+    Q_D(IrcTrafficRecorder);
+    QFile* file = new QFile(fileName, this);
+    if (!file->open(QIODevice::WriteOnly | QIODevice::Truncate)) {
+        qWarning() << "IrcTrafficRecorder::open(): cannot open" << fileName << file->errorString();
+        delete file;
+        return false;
+    }
+    setDevice(file);
+    d->file = file;
+    return true;
+}
+
+/*!
+    Stops recording and closes the file opened by open().
+
+    \sa open(), setDevice()
+ */
+void IrcTrafficRecorder::close()
+{
+    setDevice(0);
+}
+
+#include "moc_irctrafficrecorder.cpp"
+
+IRC_END_NAMESPACE
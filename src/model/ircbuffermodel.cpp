@@ -35,12 +35,16 @@
 #include "ircmessage.h"
 #include "irccommand.h"
 #include "ircconnection.h"
+#include "ircuser.h"
 #include <qmetatype.h>
 #include <qmetaobject.h>
 #include <qdatastream.h>
 #include <qvariant.h>
 #include <qtimer.h>
+#include <qendian.h>
+#include <qvector.h>
 #include <algorithm>
+#include <string.h>
 
 IRC_BEGIN_NAMESPACE
 
@@ -117,6 +121,15 @@ private:
     Irc::SortMethod method;
 };
 
+// the amount of JOIN lines sent before waiting for replies from the server
+static const int InitialJoinWindow = 2;
+static const int MaximumJoinWindow = 8;
+// how long to wait before retrying, when the server asks to slow down (ms)
+static const int MinimumJoinBackoff = 1000;
+static const int MaximumJoinBackoff = 16000;
+// how long to wait for replies before giving up on them (ms)
+static const int JoinTimeout = 10000;
+
 class IrcBufferGreaterThan
 {
 public:
@@ -130,7 +143,9 @@ private:
 IrcBufferModelPrivate::IrcBufferModelPrivate() : q_ptr(0), role(Irc::TitleRole),
     sortMethod(Irc::SortByHand), sortOrder(Qt::AscendingOrder),
     bufferProto(0), channelProto(0), persistent(false), joinDelay(0),
-    monitorEnabled(false), monitorPending(false)
+    monitorEnabled(false), monitorPending(false), monitorBatched(false),
+    joinWindow(InitialJoinWindow), joinBackoff(MinimumJoinBackoff), joinThrottled(false),
+    restoring(false), restoreTime(-1), joinCommands(0), joinedChannels(0), failedChannels(0), joinThrottles(0)
 {
 }
 
@@ -140,6 +155,9 @@ bool IrcBufferModelPrivate::messageFilter(IrcMessage* msg)
     if (msg->type() == IrcMessage::Join && msg->isOwn())
         createBuffer(static_cast<IrcJoinMessage*>(msg)->channel());
 
+    if (!joinLines.isEmpty() || joinThrottled)
+        processJoinReply(msg);
+
     bool processed = false;
     switch (msg->type()) {
         case IrcMessage::Away:
@@ -199,6 +217,14 @@ bool IrcBufferModelPrivate::messageFilter(IrcMessage* msg)
             break;
     }
 
+    // the hosts of indexed nicks, see findUsers()
+    if (msg->type() == IrcMessage::Join || msg->type() == IrcMessage::WhoReply) {
+        nickIndex.setHost(msg->nick(), msg->ident(), msg->host());
+    } else if (msg->type() == IrcMessage::HostChange) {
+        IrcHostChangeMessage* hostMsg = static_cast<IrcHostChangeMessage*>(msg);
+        nickIndex.setHost(hostMsg->nick(), hostMsg->user(), hostMsg->host());
+    }
+
     if (!processed)
         emit q->messageIgnored(msg);
 
@@ -304,7 +330,6 @@ void IrcBufferModelPrivate::insertBuffer(int index, IrcBuffer* buffer, bool noti
 {
     Q_Q(IrcBufferModel);
     if (buffer && !bufferList.contains(buffer)) {
-        restoreBuffer(buffer);
         const QString title = buffer->title();
         const QString lower = title.toLower();
         if (bufferMap.contains(lower)) {
@@ -312,6 +337,7 @@ void IrcBufferModelPrivate::insertBuffer(int index, IrcBuffer* buffer, bool noti
             return;
         }
         IrcBufferPrivate::get(buffer)->setModel(q);
+        restoreBuffer(buffer);
         const bool isChannel = buffer->isChannel();
         if (sortMethod != Irc::SortByHand) {
             QList<IrcBuffer*>::iterator it;
@@ -346,11 +372,9 @@ void IrcBufferModelPrivate::insertBuffer(int index, IrcBuffer* buffer, bool noti
                 emit q->emptyChanged(false);
         }
         if (monitorEnabled && IrcBufferPrivate::get(buffer)->isMonitorable()) {
-            connection->sendCommand(IrcCommand::createMonitor("+", buffer->title()));
-            if (!monitorPending) {
-                monitorPending = true;
-                QTimer::singleShot(1000, q, SLOT(_irc_monitorStatus()));
-            }
+            monitorQueue += buffer->title();
+            if (!monitorBatched)
+                flushMonitor();
         }
     }
 }
@@ -427,43 +451,329 @@ void IrcBufferModelPrivate::promoteBuffer(IrcBuffer* buffer)
 
 void IrcBufferModelPrivate::restoreBuffer(IrcBuffer* buffer)
 {
-    const QVariantMap& b = bufferStates.value(buffer->title().toLower()).toMap();
-    if (!b.isEmpty()) {
-        buffer->setSticky(b.value("sticky").toBool());
-        buffer->setPersistent(b.value("persistent").toBool());
-        buffer->setUserData(b.value("userData").toMap());
+    QMap<QString, IrcBufferState>::const_iterator it = bufferStates.constFind(buffer->title().toLower());
+    if (it != bufferStates.constEnd()) {
+        const IrcBufferState& b = it.value();
+        buffer->setSticky(b.sticky);
+        buffer->setPersistent(b.persistent);
+        buffer->setUserData(b.userData);
         IrcChannel* channel = buffer->toChannel();
         if (channel && !channel->isActive()) {
             IrcChannelPrivate* p = IrcChannelPrivate::get(channel);
-            const QStringList modes = b.value("modes").toStringList();
-            const QStringList args = b.value("args").toStringList();
-            for (int i = 0; i < modes.count(); ++i)
-                p->modes.insert(modes.at(i), args.value(i));
-            p->enabled = b.value("enabled", true).toBool();
+            for (int i = 0; i < b.modes.count(); ++i)
+                p->modes.insert(b.modes.at(i), b.args.value(i));
+            if (!b.topic.isEmpty())
+                p->setTopic(b.topic);
+            if (!b.users.isEmpty() && channel->network())
+                p->setUsers(b.users);
+            p->enabled = b.enabled;
         }
     }
 }
 
-QVariantMap IrcBufferModelPrivate::saveBuffer(IrcBuffer* buffer) const
+IrcBufferState IrcBufferModelPrivate::saveBuffer(IrcBuffer* buffer, bool users) const
 {
-    QVariantMap b;
-    b.insert("title", buffer->title());
-    b.insert("name", buffer->name());
-    b.insert("prefix", buffer->prefix());
+    IrcBufferState b;
+    b.title = buffer->title();
+    b.name = buffer->name();
+    b.prefix = buffer->prefix();
     if (IrcChannel* channel = buffer->toChannel()) {
         IrcChannelPrivate* p = IrcChannelPrivate::get(channel);
-        b.insert("modes", QStringList(p->modes.keys()));
-        b.insert("args", QStringList(p->modes.values()));
-        b.insert("topic", channel->topic());
-        b.insert("enabled", p->enabled);
+        b.modes = p->modes.keys();
+        b.args = p->modes.values();
+        b.topic = channel->topic();
+        b.enabled = p->enabled;
+        if (users) {
+            foreach (IrcUser* user, p->userList)
+                b.users += user->prefix() + user->name();
+        }
     }
-    b.insert("channel", buffer->isChannel());
-    b.insert("sticky", buffer->isSticky());
-    b.insert("persistent", buffer->isPersistent());
-    b.insert("userData", buffer->userData());
+    b.channel = buffer->isChannel();
+    b.sticky = buffer->isSticky();
+    b.persistent = buffer->isPersistent();
+    b.userData = buffer->userData();
     return b;
 }
 
+QList<IrcBufferState> IrcBufferModelPrivate::saveBuffers(bool users) const
+{
+    QMap<QString, IrcBufferState> states = bufferStates;
+    foreach (IrcBuffer* buffer, bufferList)
+        states.insert(buffer->title().toLower(), saveBuffer(buffer, users));
+    return states.values();
+}
+
+IrcBufferState IrcBufferState::fromMap(const QVariantMap& b)
+{
+    IrcBufferState state;
+    state.title = b.value("title").toString();
+    state.name = b.value("name").toString();
+    state.prefix = b.value("prefix").toString();
+    state.topic = b.value("topic").toString();
+    state.modes = b.value("modes").toStringList();
+    state.args = b.value("args").toStringList();
+    state.userData = b.value("userData").toMap();
+    state.channel = b.value("channel").toBool();
+    state.sticky = b.value("sticky").toBool();
+    state.persistent = b.value("persistent").toBool();
+    state.enabled = b.value("enabled", true).toBool();
+    return state;
+}
+
+QVariantMap IrcBufferState::toMap() const
+{
+    QVariantMap b;
+    b.insert("title", title);
+    b.insert("name", name);
+    b.insert("prefix", prefix);
+    if (channel) {
+        b.insert("modes", modes);
+        b.insert("args", args);
+        b.insert("topic", topic);
+        b.insert("enabled", enabled);
+    }
+    b.insert("channel", channel);
+    b.insert("sticky", sticky);
+    b.insert("persistent", persistent);
+    b.insert("userData", userData);
+    return b;
+}
+
+// Snapshot layout, all integers are little-endian:
+//
+// header           "IRCS", quint16 format, quint16 flags, qint32 version,
+//                  quint32 string, buffer, mode and user counts, quint32 data size
+// string index     quint32 offset and length per string, relative to the string data
+// buffer records   quint32 title, name, prefix and topic strings, flags,
+//                  first mode and mode count, first user and user count,
+//                  user data offset and length, and a reserved field
+// mode records     quint32 mode and argument strings
+// user records     quint32 prefixed nick string
+// user data        QDataStream serialized QVariantMaps
+// string data      UTF-8
+//
+// The records have a fixed size, so that a memory-mapped snapshot can be
+// read in place without copying or parsing it up front.
+
+static const char IrcSnapshotMagic[] = "IRCS";
+static const quint16 IrcSnapshotFormat = 1;
+
+enum IrcSnapshotFlag { IrcSnapshotUsers = 0x1 };
+enum IrcBufferRecordFlag { IrcChannelRecord = 0x1, IrcStickyRecord = 0x2, IrcPersistentRecord = 0x4, IrcEnabledRecord = 0x8 };
+
+static const int IrcSnapshotHeaderSize = 32;
+static const int IrcStringIndexSize = 8;
+static const int IrcBufferRecordSize = 48;
+static const int IrcModeRecordSize = 8;
+static const int IrcUserRecordSize = 4;
+
+static void writeUInt16(QByteArray* data, quint16 value)
+{
+    uchar buf[2];
+    qToLittleEndian<quint16>(value, buf);
+    data->append(reinterpret_cast<const char*>(buf), 2);
+}
+
+static void writeUInt32(QByteArray* data, quint32 value)
+{
+    uchar buf[4];
+    qToLittleEndian<quint32>(value, buf);
+    data->append(reinterpret_cast<const char*>(buf), 4);
+}
+
+static inline quint32 readUInt32(const uchar* data)
+{
+    return qFromLittleEndian<quint32>(data);
+}
+
+class IrcStringTable
+{
+public:
+    quint32 insert(const QString& str)
+    {
+        QHash<QString, quint32>::const_iterator it = indexes.constFind(str);
+        if (it != indexes.constEnd())
+            return it.value();
+        const quint32 idx = indexes.count();
+        const QByteArray utf8 = str.toUtf8();
+        writeUInt32(&index, data.size());
+        writeUInt32(&index, utf8.size());
+        data += utf8;
+        indexes.insert(str, idx);
+        return idx;
+    }
+
+    QHash<QString, quint32> indexes;
+    QByteArray index;
+    QByteArray data;
+};
+
+QByteArray IrcBufferModelPrivate::writeSnapshot(const QList<IrcBufferState>& states, int version, bool users)
+{
+    IrcStringTable strings;
+    QByteArray records;
+    QByteArray modes;
+    QByteArray members;
+    QByteArray blobs;
+    quint32 modeCount = 0;
+    quint32 userCount = 0;
+
+    records.reserve(states.count() * IrcBufferRecordSize);
+    foreach (const IrcBufferState& state, states) {
+        writeUInt32(&records, strings.insert(state.title));
+        writeUInt32(&records, strings.insert(state.name));
+        writeUInt32(&records, strings.insert(state.prefix));
+        writeUInt32(&records, strings.insert(state.topic));
+
+        quint32 flags = 0;
+        if (state.channel)
+            flags |= IrcChannelRecord;
+        if (state.sticky)
+            flags |= IrcStickyRecord;
+        if (state.persistent)
+            flags |= IrcPersistentRecord;
+        if (state.enabled)
+            flags |= IrcEnabledRecord;
+        writeUInt32(&records, flags);
+
+        writeUInt32(&records, modeCount);
+        writeUInt32(&records, state.modes.count());
+        for (int i = 0; i < state.modes.count(); ++i) {
+            writeUInt32(&modes, strings.insert(state.modes.at(i)));
+            writeUInt32(&modes, strings.insert(state.args.value(i)));
+        }
+        modeCount += state.modes.count();
+
+        const QStringList nicks = users ? state.users : QStringList();
+        writeUInt32(&records, userCount);
+        writeUInt32(&records, nicks.count());
+        foreach (const QString& nick, nicks)
+            writeUInt32(&members, strings.insert(nick));
+        userCount += nicks.count();
+
+        QByteArray blob;
+        if (!state.userData.isEmpty()) {
+            QDataStream out(&blob, QIODevice::WriteOnly);
+            out << state.userData;
+        }
+        writeUInt32(&records, blobs.size());
+        writeUInt32(&records, blob.size());
+        blobs += blob;
+
+        writeUInt32(&records, 0); // reserved
+    }
+
+    QByteArray snapshot;
+    snapshot.reserve(IrcSnapshotHeaderSize + strings.index.size() + records.size() +
+                     modes.size() + members.size() + blobs.size() + strings.data.size());
+    snapshot.append(IrcSnapshotMagic, 4);
+    writeUInt16(&snapshot, IrcSnapshotFormat);
+    writeUInt16(&snapshot, users ? IrcSnapshotUsers : 0);
+    writeUInt32(&snapshot, version);
+    writeUInt32(&snapshot, strings.indexes.count());
+    writeUInt32(&snapshot, states.count());
+    writeUInt32(&snapshot, modeCount);
+    writeUInt32(&snapshot, userCount);
+    writeUInt32(&snapshot, blobs.size());
+    snapshot += strings.index;
+    snapshot += records;
+    snapshot += modes;
+    snapshot += members;
+    snapshot += blobs;
+    snapshot += strings.data;
+    return snapshot;
+}
+
+bool IrcBufferModelPrivate::readSnapshot(const QByteArray& snapshot, int version, QList<IrcBufferState>* states)
+{
+    const uchar* data = reinterpret_cast<const uchar*>(snapshot.constData());
+    const quint64 size = snapshot.size();
+    if (size < quint64(IrcSnapshotHeaderSize) || memcmp(data, IrcSnapshotMagic, 4) != 0)
+        return false;
+    if (qFromLittleEndian<quint16>(data + 4) != IrcSnapshotFormat || qint32(readUInt32(data + 8)) != version)
+        return false;
+
+    const quint32 stringCount = readUInt32(data + 12);
+    const quint32 bufferCount = readUInt32(data + 16);
+    const quint32 modeCount = readUInt32(data + 20);
+    const quint32 userCount = readUInt32(data + 24);
+    const quint32 dataSize = readUInt32(data + 28);
+
+    const quint64 indexOffset = IrcSnapshotHeaderSize;
+    const quint64 recordOffset = indexOffset + quint64(stringCount) * IrcStringIndexSize;
+    const quint64 modeOffset = recordOffset + quint64(bufferCount) * IrcBufferRecordSize;
+    const quint64 userOffset = modeOffset + quint64(modeCount) * IrcModeRecordSize;
+    const quint64 dataOffset = userOffset + quint64(userCount) * IrcUserRecordSize;
+    const quint64 stringOffset = dataOffset + dataSize;
+    if (stringOffset > size)
+        return false;
+
+    // decode each distinct string once, and share it between the records
+    QVector<QString> strings(stringCount);
+    for (quint32 i = 0; i < stringCount; ++i) {
+        const uchar* entry = data + indexOffset + i * IrcStringIndexSize;
+        const quint64 offset = readUInt32(entry);
+        const quint64 length = readUInt32(entry + 4);
+        if (stringOffset + offset + length > size)
+            return false;
+        strings[i] = QString::fromUtf8(reinterpret_cast<const char*>(data + stringOffset + offset), length);
+    }
+
+    QList<IrcBufferState> result;
+    result.reserve(bufferCount);
+    for (quint32 i = 0; i < bufferCount; ++i) {
+        const uchar* record = data + recordOffset + i * IrcBufferRecordSize;
+        quint32 fields[11];
+        for (int f = 0; f < 11; ++f)
+            fields[f] = readUInt32(record + f * 4);
+        if (fields[0] >= stringCount || fields[1] >= stringCount || fields[2] >= stringCount || fields[3] >= stringCount)
+            return false;
+        if (quint64(fields[5]) + fields[6] > modeCount || quint64(fields[7]) + fields[8] > userCount)
+            return false;
+        if (quint64(fields[9]) + fields[10] > dataSize)
+            return false;
+
+        IrcBufferState state;
+        state.title = strings.at(fields[0]);
+        state.name = strings.at(fields[1]);
+        state.prefix = strings.at(fields[2]);
+        state.topic = strings.at(fields[3]);
+        state.channel = fields[4] & IrcChannelRecord;
+        state.sticky = fields[4] & IrcStickyRecord;
+        state.persistent = fields[4] & IrcPersistentRecord;
+        state.enabled = fields[4] & IrcEnabledRecord;
+
+        for (quint32 m = fields[5]; m < fields[5] + fields[6]; ++m) {
+            const uchar* mode = data + modeOffset + m * IrcModeRecordSize;
+            const quint32 name = readUInt32(mode);
+            const quint32 arg = readUInt32(mode + 4);
+            if (name >= stringCount || arg >= stringCount)
+                return false;
+            state.modes += strings.at(name);
+            state.args += strings.at(arg);
+        }
+
+        for (quint32 u = fields[7]; u < fields[7] + fields[8]; ++u) {
+            const quint32 nick = readUInt32(data + userOffset + u * IrcUserRecordSize);
+            if (nick >= stringCount)
+                return false;
+            state.users += strings.at(nick);
+        }
+
+        if (fields[10] > 0) {
+            const QByteArray blob = QByteArray::fromRawData(reinterpret_cast<const char*>(data + dataOffset + fields[9]), fields[10]);
+            QDataStream in(blob);
+            in >> state.userData;
+            if (in.status() != QDataStream::Ok)
+                return false;
+        }
+        result += state;
+    }
+
+    *states = result;
+    return true;
+}
+
 bool IrcBufferModelPrivate::processMessage(const QString& title, IrcMessage* message, bool create)
 {
     IrcBuffer* buffer = bufferMap.value(title.toLower());
@@ -474,8 +784,209 @@ bool IrcBufferModelPrivate::processMessage(const QString& title, IrcMessage* mes
     return false;
 }
 
+void IrcBufferModelPrivate::rejoin()
+{
+    // Join multiple channels:
+    //
+    // * A single IRC command may be 512 bytes long, including the <CR><LF> at the end.
+    //   Therefore, we must collect as many channels as possible into a single command,
+    //   but without exceeding the 512 bytes nor the TARGMAX limit of the server.
+    //
+    // * We should also group channels with keys separately from channels without keys,
+    //   because the JOIN command doesn't work when channels without keys preceed the
+    //   channels with keys.
+    //   Works:
+    //       JOIN #ch1,#ch2             --- neither #ch1 nor #ch2 have keys
+    //       JOIN #ch1,#ch2 key1,key2   --- both #ch1 and #ch2 have keys
+    //       JOIN #ch1,#ch2 key1        --- #ch1 has key, #ch2 doesn't
+    //   Doesn't work:
+    //       JOIN #ch1,#ch2 ,key2       --- #ch1 doesn't have a key, #ch2 does
+    //
+    // * Only a window of commands is sent at once. The window grows as the server
+    //   replies, and shrinks when the server asks to slow down.
+    if (!connection || !connection->isConnected())
+        return;
+
+    const int maxLength = connection->network()->numericLimit(IrcNetwork::MessageLength);
+    const int maxTargets = connection->network()->targetLimit(QLatin1String("JOIN"));
+
+    while (!joinThrottled && joinLines.count() < joinWindow && !joinQueue.isEmpty()) {
+        // length of "JOIN " and "\r\n"
+        int length = 7;
+        QStringList chans, keys, line;
+        while (!joinQueue.isEmpty() && (maxTargets <= 0 || chans.count() < maxTargets)) {
+            IrcBuffer* buffer = bufferMap.value(joinQueue.first());
+            IrcChannel* channel = buffer ? buffer->toChannel() : 0;
+            if (!channel || channel->isActive()) {
+                joinQueue.removeFirst();
+                continue;
+            }
+            const QString key = channel->key();
+            if (!key.isEmpty() && keys.count() < chans.count())
+                break;
+            // a comma between the channels, and a space or a comma before a key
+            int additionalLength = channel->title().toUtf8().length();
+            if (!chans.isEmpty())
+                ++additionalLength;
+            if (!key.isEmpty())
+                additionalLength += key.toUtf8().length() + 1;
+            if (!chans.isEmpty() && length + additionalLength > maxLength)
+                break;
+            length += additionalLength;
+            chans += channel->title();
+            if (!key.isEmpty())
+                keys += key;
+            line += joinQueue.takeFirst();
+        }
+        if (line.isEmpty())
+            break;
+        joinLines += line;
+        ++joinCommands;
+        connection->sendCommand(IrcCommand::createJoin(chans, keys));
+    }
+
+    if (joinQueue.isEmpty() && joinLines.isEmpty())
+        finishRestore();
+    else if (!joinThrottled)
+        joinTimer.start(JoinTimeout);
+}
+
+void IrcBufferModelPrivate::rejoined(const QString& channel, bool joined)
+{
+    const QString lower = channel.toLower();
+    for (int i = 0; i < joinLines.count(); ++i) {
+        if (joinLines[i].removeOne(lower)) {
+            if (joined)
+                ++joinedChannels;
+            else
+                ++failedChannels;
+            if (joinLines.at(i).isEmpty()) {
+                // the server keeps up, widen the window
+                joinLines.removeAt(i);
+                joinWindow = qMin(joinWindow + 1, MaximumJoinWindow);
+                joinBackoff = MinimumJoinBackoff;
+                rejoin();
+            }
+            return;
+        }
+    }
+}
+
+void IrcBufferModelPrivate::throttleJoins(const QString& channel)
+{
+    // The server processes the commands in order. Without a channel,
+    // the reply refers to the oldest command still waiting for replies.
+    QStringList retry;
+    if (channel.isEmpty()) {
+        if (!joinLines.isEmpty())
+            retry = joinLines.takeFirst();
+    } else {
+        const QString lower = channel.toLower();
+        for (int i = 0; i < joinLines.count(); ++i) {
+            if (joinLines[i].removeOne(lower)) {
+                if (joinLines.at(i).isEmpty())
+                    joinLines.removeAt(i);
+                retry += lower;
+                break;
+            }
+        }
+    }
+    for (int i = retry.count() - 1; i >= 0; --i)
+        joinQueue.prepend(retry.at(i));
+
+    ++joinThrottles;
+    joinWindow = qMax(1, joinWindow / 2);
+    joinThrottled = true;
+    joinTimer.start(joinBackoff);
+    joinBackoff = qMin(joinBackoff * 2, MaximumJoinBackoff);
+}
+
+void IrcBufferModelPrivate::processJoinReply(IrcMessage* msg)
+{
+    if (msg->type() == IrcMessage::Join && msg->isOwn()) {
+        rejoined(static_cast<IrcJoinMessage*>(msg)->channel(), true);
+    } else if (msg->type() == IrcMessage::Numeric) {
+        const QString target = msg->parameters().value(1);
+        switch (static_cast<IrcNumericMessage*>(msg)->code()) {
+        case Irc::ERR_TOOMANYCHANNELS:
+            // the server does not accept any more channels
+            joinQueue.clear();
+            rejoined(target, false);
+            break;
+        case Irc::ERR_NOSUCHCHANNEL:
+        case Irc::ERR_UNAVAILRESOURCE:
+        case Irc::ERR_LINKCHANNEL:
+        case Irc::ERR_CHANNELISFULL:
+        case Irc::ERR_INVITEONLYCHAN:
+        case Irc::ERR_BANNEDFROMCHAN:
+        case Irc::ERR_BADCHANNELKEY:
+        case Irc::ERR_BADCHANMASK:
+        case Irc::ERR_NEEDREGGEDNICK:
+        case Irc::ERR_SECUREONLYCHAN:
+            rejoined(target, false);
+            break;
+        case Irc::RPL_TRYAGAIN:
+            if (!target.compare(QLatin1String("JOIN"), Qt::CaseInsensitive))
+                throttleJoins();
+            break;
+        case Irc::ERR_TARGETTOOFAST:
+            throttleJoins(target);
+            break;
+        default:
+            break;
+        }
+    }
+    if (joinQueue.isEmpty() && joinLines.isEmpty())
+        finishRestore();
+}
+
+void IrcBufferModelPrivate::finishRestore()
+{
+    joinTimer.stop();
+    joinThrottled = false;
+    if (restoring) {
+        restoring = false;
+        restoreTime = restoreTimer.elapsed();
+    }
+}
+
+void IrcBufferModelPrivate::flushMonitor()
+{
+    Q_Q(IrcBufferModel);
+    if (!connection || monitorQueue.isEmpty())
+        return;
+
+    // length of "MONITOR + " and "\r\n"
+    const int minLength = 12;
+    const int maxLength = connection->network()->numericLimit(IrcNetwork::MessageLength);
+    int length = minLength;
+    QStringList targets;
+    foreach (const QString& target, monitorQueue) {
+        const int additionalLength = target.toUtf8().length() + 1;
+        if (!targets.isEmpty() && length + additionalLength > maxLength) {
+            connection->sendCommand(IrcCommand::createMonitor("+", targets));
+            targets.clear();
+            length = minLength;
+        }
+        length += additionalLength;
+        targets += target;
+    }
+    connection->sendCommand(IrcCommand::createMonitor("+", targets));
+    monitorQueue.clear();
+
+    if (!monitorPending) {
+        monitorPending = true;
+        QTimer::singleShot(1000, q, SLOT(_irc_monitorStatus()));
+    }
+}
+
 void IrcBufferModelPrivate::_irc_connected()
 {
+    restoring = true;
+    restoreTime = -1;
+    restoreTimer.start();
+    joinWindow = InitialJoinWindow;
+    joinBackoff = MinimumJoinBackoff;
     foreach (IrcBuffer* buffer, bufferList)
         IrcBufferPrivate::get(buffer)->connected();
 }
@@ -486,33 +997,46 @@ void IrcBufferModelPrivate::_irc_initialized()
     if (joinDelay >= 0)
         QTimer::singleShot(joinDelay * 1000, q, SLOT(_irc_restoreBuffers()));
 
-    bool monitored = false;
     foreach (IrcBuffer* buffer, bufferList) {
-        if (monitorEnabled && IrcBufferPrivate::get(buffer)->isMonitorable()) {
-            connection->sendCommand(IrcCommand::createMonitor("+", buffer->title()));
-            monitored = true;
-        }
-    }
-
-    if (monitored && !monitorPending) {
-        monitorPending = true;
-        QTimer::singleShot(1000, q, SLOT(_irc_monitorStatus()));
+        if (monitorEnabled && IrcBufferPrivate::get(buffer)->isMonitorable())
+            monitorQueue += buffer->title();
     }
+    flushMonitor();
 }
 
 void IrcBufferModelPrivate::_irc_disconnected()
 {
+    joinQueue.clear();
+    joinLines.clear();
+    joinTimer.stop();
+    joinThrottled = false;
+    restoring = false;
+    monitorQueue.clear();
     foreach (IrcBuffer* buffer, bufferList)
         IrcBufferPrivate::get(buffer)->disconnected();
 }
 
+void IrcBufferModelPrivate::_irc_caseMappingChanged(const QString& caseMapping)
+{
+    nickIndex.setCaseMapping(caseMapping);
+}
+
 void IrcBufferModelPrivate::_irc_bufferDestroyed(IrcBuffer* buffer)
 {
     removeBuffer(buffer);
 }
 
 static bool sortIrcChannels_withKeysFirst(IrcChannel *ch1, IrcChannel *ch2) {
-    return ch1->key().length() > ch2->key().length();
+    return !ch1->key().isEmpty() && ch2->key().isEmpty();
+}
+
+static int channelLimit(IrcNetwork* network, const QString& type)
+{
+    // CHANLIMIT may share a limit between types, for example "#&:50"
+    int limit = network->channelLimit(type);
+    if (limit <= 0)
+        limit = network->channelLimit(network->channelTypes().join(QString()));
+    return limit;
 }
 
 void IrcBufferModelPrivate::_irc_restoreBuffers()
@@ -532,41 +1056,21 @@ void IrcBufferModelPrivate::_irc_restoreBuffers()
     }
 
     if (!hasActiveChannels) {
-        foreach (const QVariant& v, bufferStates) {
-            QVariantMap b = v.toMap();
-            IrcBuffer* buffer = q->find(b.value("title").toString());
+        monitorBatched = true;
+        foreach (const IrcBufferState& b, bufferStates) {
+            IrcBuffer* buffer = q->find(b.title);
             if (!buffer) {
-                if (b.value("channel").toBool())
-                    buffer = createChannelHelper(b.value("title").toString());
+                if (b.channel)
+                    buffer = createChannelHelper(b.title);
                 else
-                    buffer = createBufferHelper(b.value("title").toString());
-                buffer->setName(b.value("name").toString());
-                buffer->setPrefix(b.value("prefix").toString());
+                    buffer = createBufferHelper(b.title);
+                buffer->setName(b.name);
+                buffer->setPrefix(b.prefix);
                 q->add(buffer);
             }
         }
-
-        // Join multiple channels:
-        //
-        // * A single IRC command may be 512 bytes long, including the <CR><LF> at the end.
-        //   Therefore, we must collect as many channels as many channels as possible into
-        //   a single command, but without exceeding the 512 bytes.
-        //   NOTES:
-        //       - Previously, communi tried to join all channels in a single command,
-        //         which didn't work because it exceeded the 512 bytes
-        //       - Then, it joined 3 channels at a time
-        //
-        // * We should also group channels with keys separately from channels without keys,
-        //   because the JOIN command doesn't work when channels without keys preceed the
-        //   channels with keys.
-        //   Works:
-        //       JOIN #ch1,#ch2             --- neither #ch1 nor #ch2 have keys
-        //       JOIN #ch1,#ch2 key1,key2   --- both #ch1 and #ch2 have keys
-        //       JOIN #ch1,#ch2 key1        --- #ch1 has key, #ch2 doesn't
-        //   Doesn't work:
-        //       JOIN #ch1,#ch2 ,key2       --- #ch1 doesn't have a key, #ch2 does
-        //                                      (NOTE: this is what communi used to do)
-        //
+        monitorBatched = false;
+        flushMonitor();
 
         // Get channels from buffers
         QList<IrcChannel*> filteredChannels;
@@ -574,56 +1078,35 @@ void IrcBufferModelPrivate::_irc_restoreBuffers()
         foreach (IrcBuffer* buf, bufferList) {
             IrcChannel *channel = buf->toChannel();
             if (channel && !channel->isActive() && IrcChannelPrivate::get(channel)->enabled) {
-                filteredChannels.append(channel);
+                const QString lower = channel->title().toLower();
+                bool pending = joinQueue.contains(lower);
+                for (int i = 0; !pending && i < joinLines.count(); ++i)
+                    pending = joinLines.at(i).contains(lower);
+                if (!pending)
+                    filteredChannels.append(channel);
             }
         }
 
         // Sort channels with keys first
-        std::sort(filteredChannels.begin(), filteredChannels.end(), sortIrcChannels_withKeysFirst);
-
-        if (filteredChannels.size()) {
-
-            // Length of "JOIN  \r\n"
-            const int joinCommandMinLength = 8;
-            const int maxIrcCommandBytes = 512;
-            int joinCommandLength = joinCommandMinLength;
-
-            QStringList chans, keys;
-            foreach (IrcChannel *channel, filteredChannels) {
-                int additonalLength = channel->title().length() + channel->key().length();
-                // Command needs a comma between channels
-                if (chans.length())
-                    additonalLength++;
-                // Command needs a comma between keys
-                if (keys.length() && channel->key().length())
-                    additonalLength++;
-
-                if ((joinCommandLength + additonalLength) > maxIrcCommandBytes) {
-                    // If the command size would exceed the maximum, send a command with the channels collected so far
-                    connection->sendCommand(IrcCommand::createJoin(chans, keys));
-
-                    chans.clear();
-                    keys.clear();
-                    joinCommandLength = joinCommandMinLength;
-                }
-
-                // Add channel to list
-                chans += channel->title();
-
-                // Only add key to list if there is a key,
-                // otherwise not needed, because channels with keys are sorted before channels without keys
-                if (channel->key().length())
-                    keys += channel->key();
+        std::stable_sort(filteredChannels.begin(), filteredChannels.end(), sortIrcChannels_withKeysFirst);
 
-                joinCommandLength = additonalLength;
-            }
-
-            if (!chans.isEmpty()) {
-                connection->sendCommand(IrcCommand::createJoin(chans, keys));
+        // Don't exceed the CHANLIMIT of the server
+        QHash<QString, int> counts;
+        foreach (IrcBuffer* buf, bufferList) {
+            if (buf->isChannel() && buf->isActive())
+                ++counts[buf->title().left(1)];
+        }
+        foreach (IrcChannel *channel, filteredChannels) {
+            const QString type = channel->title().left(1);
+            const int limit = channelLimit(connection->network(), type);
+            if (limit <= 0 || counts.value(type) < limit) {
+                ++counts[type];
+                joinQueue += channel->title().toLower();
             }
-
         }
     }
+
+    rejoin();
 }
 
 void IrcBufferModelPrivate::_irc_monitorStatus()
@@ -632,6 +1115,17 @@ void IrcBufferModelPrivate::_irc_monitorStatus()
         connection->sendCommand(IrcCommand::createMonitor("S"));
     monitorPending = false;
 }
+
+void IrcBufferModelPrivate::_irc_joinTimeout()
+{
+    if (joinThrottled) {
+        joinThrottled = false;
+    } else {
+        // the server did not reply; don't wait for it any longer
+        joinLines.clear();
+    }
+    rejoin();
+}
 #endif // IRC_DOXYGEN
 
 /*!
@@ -645,6 +1139,8 @@ IrcBufferModel::IrcBufferModel(QObject* parent)
 {
     Q_D(IrcBufferModel);
     d->q_ptr = this;
+    d->joinTimer.setSingleShot(true);
+    connect(&d->joinTimer, SIGNAL(timeout()), this, SLOT(_irc_joinTimeout()));
     setBufferPrototype(new IrcBuffer(this));
     setChannelPrototype(new IrcChannel(this));
     setConnection(qobject_cast<IrcConnection*>(parent));
@@ -695,6 +1191,8 @@ void IrcBufferModel::setConnection(IrcConnection* connection)
         connect(d->connection, SIGNAL(connected()), this, SLOT(_irc_connected()));
         connect(d->connection, SIGNAL(disconnected()), this, SLOT(_irc_disconnected()));
         connect(d->connection->network(), SIGNAL(initialized()), this, SLOT(_irc_initialized()));
+        connect(d->connection->network(), SIGNAL(caseMappingChanged(QString)), this, SLOT(_irc_caseMappingChanged(QString)));
+        d->nickIndex.setCaseMapping(d->connection->network()->caseMapping());
         emit connectionChanged(connection);
         emit networkChanged(network());
     }
@@ -811,6 +1309,36 @@ int IrcBufferModel::indexOf(IrcBuffer* buffer) const
     return d->bufferList.indexOf(buffer);
 }
 
+/*!
+    \since 3.6
+
+    Returns the users of all channels in the model that match \a pattern.
+
+    The pattern is matched case-insensitively against nicks, following the
+    \ref IrcNetwork::caseMapping "case mapping" of the network. It is either a
+    substring or a wildcard pattern, where \c * matches any sequence of characters
+    and \c ? matches any single character. A pattern that contains \c ! or \c @ is
+    matched against "nick!ident@host" instead. Hosts are known for users
+    that have joined or have been listed by WHO.
+
+    Each channel has its own IrcUser object, so a nick that is present
+    on several channels results in one user per channel:
+    \code
+    foreach (IrcUser* user, model->findUsers("*bot*"))
+        qDebug() << user->name() << "is present on" << user->channel()->title();
+    \endcode
+
+    The nicks of all channels are kept in an index that is
+    updated as users join, part, quit or change their nick.
+ */
+QList<IrcUser*> IrcBufferModel::findUsers(const QString& pattern) const
+{
+    Q_D(const IrcBufferModel);
+    if (pattern.isEmpty())
+        return QList<IrcUser*>();
+    return d->nickIndex.find(pattern);
+}
+
 /*!
     Adds a buffer with \a title to the model and returns it.
  */
@@ -1303,6 +1831,13 @@ void IrcBufferModel::setChannelPrototype(IrcChannel* prototype)
     after getting connected. A negative value disables automatic
     joining of channels.
 
+    Channels are re-joined with as few \c JOIN commands as the
+    \c TARGMAX and \c CHANLIMIT limits of the server allow. Only a few
+    commands are sent at once; more are sent as the server replies,
+    and less when the server asks to slow down.
+
+    \sa statistics()
+
     \par Access function:
     \li int <b>joinDelay</b>() const
     \li void <b>setJoinDelay</b>(int delay)
@@ -1363,6 +1898,8 @@ void IrcBufferModel::setMonitorEnabled(bool enabled)
     Saves the state of the model. The \a version number is stored as part of the state data.
 
     To restore the saved state, pass the return value and \a version number to restoreState().
+
+    \sa saveSnapshot()
  */
 QByteArray IrcBufferModel::saveState(int version) const
 {
@@ -1370,13 +1907,9 @@ QByteArray IrcBufferModel::saveState(int version) const
     QVariantMap args;
     args.insert("version", version);
 
-    QVariantMap states = d->bufferStates;
-    foreach (IrcBuffer* buffer, d->bufferList)
-        states.insert(buffer->title(), d->saveBuffer(buffer));
-
     QVariantList buffers;
-    foreach (const QVariant& b, states)
-        buffers += b;
+    foreach (const IrcBufferState& b, d->saveBuffers())
+        buffers += b.toMap();
     args.insert("buffers", buffers);
 
     QByteArray state;
@@ -1385,6 +1918,39 @@ QByteArray IrcBufferModel::saveState(int version) const
     return state;
 }
 
+/*!
+    \since 3.6
+
+    Saves a binary snapshot of the model state. The \a version number is stored as part of the snapshot.
+
+    The snapshot contains the same information as saveState(), but in a compact format of
+    fixed size records that refer to a table of shared strings. It is considerably smaller
+    and faster to save and restore when there are lots of buffers. If \a users is \c true,
+    the snapshot also contains the users of the channels. They are restored to the channels
+    until the server sends an up-to-date list when the channels are re-joined.
+
+    The snapshot does not need to be copied before it is restored, so it can be restored
+    straight from a memory-mapped file:
+
+    \code
+    QFile file("buffers.snapshot");
+    if (file.open(QFile::ReadOnly)) {
+        uchar* data = file.map(0, file.size());
+        model->restoreState(QByteArray::fromRawData(reinterpret_cast<const char*>(data), file.size()));
+        file.unmap(data);
+    }
+    \endcode
+
+    To restore the snapshot, pass the return value and \a version number to restoreState().
+
+    \sa saveState()
+ */
+QByteArray IrcBufferModel::saveSnapshot(int version, bool users) const
+{
+    Q_D(const IrcBufferModel);
+    return IrcBufferModelPrivate::writeSnapshot(d->saveBuffers(users), version, users);
+}
+
 /*!
     \since 3.1
 
@@ -1392,29 +1958,81 @@ QByteArray IrcBufferModel::saveState(int version) const
     If they do not match, the model state is left unchanged, and this function returns \c false; otherwise,
     the state is restored, and \c true is returned.
 
-    \sa saveState()
+    Both the states returned by saveState() and the snapshots returned by saveSnapshot() are accepted.
+
+    \sa saveState(), saveSnapshot()
  */
 bool IrcBufferModel::restoreState(const QByteArray& state, int version)
 {
     Q_D(IrcBufferModel);
-    QVariantMap args;
-    QDataStream in(state);
-    in >> args;
-    if (in.status() != QDataStream::Ok || args.value("version", -1).toInt() != version)
-        return false;
+    QList<IrcBufferState> states;
+    if (state.startsWith(IrcSnapshotMagic)) {
+        if (!IrcBufferModelPrivate::readSnapshot(state, version, &states))
+            return false;
+    } else {
+        QVariantMap args;
+        QDataStream in(state);
+        in >> args;
+        if (in.status() != QDataStream::Ok || args.value("version", -1).toInt() != version)
+            return false;
 
-    const QVariantList buffers = args.value("buffers").toList();
-    foreach (const QVariant& v, buffers) {
-        const QVariantMap b = v.toMap();
-        d->bufferStates.insert(b.value("title").toString(), b);
+        const QVariantList buffers = args.value("buffers").toList();
+        foreach (const QVariant& v, buffers)
+            states += IrcBufferState::fromMap(v.toMap());
     }
 
+    foreach (const IrcBufferState& b, states)
+        d->bufferStates.insert(b.title.toLower(), b);
+
     if (d->joinDelay >= 0 && d->connection && d->connection->isConnected())
         QTimer::singleShot(d->joinDelay * 1000, this, SLOT(_irc_restoreBuffers()));
 
     return true;
 }
 
+/*!
+    \since 3.6
+
+    Returns the statistics of the model.
+
+    The map contains the following keys:
+    \li \c "restoreTime" - the time in milliseconds it took to re-join the channels after getting connected, or \c -1 if unknown
+    \li \c "joinCommands" - the amount of \c JOIN commands sent to re-join channels
+    \li \c "joinedChannels" - the amount of channels that have been re-joined
+    \li \c "failedChannels" - the amount of channels that could not be re-joined
+    \li \c "throttles" - the amount of times the server asked to slow down
+
+    \sa resetStatistics(), joinDelay
+ */
+QVariantMap IrcBufferModel::statistics() const
+{
+    Q_D(const IrcBufferModel);
+    QVariantMap stats;
+    stats.insert(QLatin1String("restoreTime"), d->restoreTime);
+    stats.insert(QLatin1String("joinCommands"), d->joinCommands);
+    stats.insert(QLatin1String("joinedChannels"), d->joinedChannels);
+    stats.insert(QLatin1String("failedChannels"), d->failedChannels);
+    stats.insert(QLatin1String("throttles"), d->joinThrottles);
+    return stats;
+}
+
+/*!
+    \since 3.6
+
+    Resets the statistics of the model.
+
+    \sa statistics()
+ */
+void IrcBufferModel::resetStatistics()
+{
+    Q_D(IrcBufferModel);
+    d->restoreTime = -1;
+    d->joinCommands = 0;
+    d->joinedChannels = 0;
+    d->failedChannels = 0;
+    d->joinThrottles = 0;
+}
+
 #include "moc_ircbuffermodel.cpp"
 #include "moc_ircbuffermodel_p.cpp"
 
@@ -37,6 +37,7 @@
 #include "irccommand.h"
 #include "ircuser_p.h"
 #include "irc.h"
+#include <algorithm>
 
 IRC_BEGIN_NAMESPACE
 
@@ -53,6 +54,15 @@ IRC_BEGIN_NAMESPACE
     \sa IrcBufferModel
 */
 
+/*!
+    \fn void IrcChannel::masksChanged(const QString& mode, const QStringList& masks)
+    \since 3.6
+
+    This signal is emitted when the \a masks of the list \a mode change.
+
+    \sa masks()
+ */
+
 #ifndef IRC_DOXYGEN
 static QString getPrefix(const QString& name, const QStringList& prefixes)
 {
@@ -86,6 +96,66 @@ static QString userName(const QString& name, const QStringList& prefixes)
     return Irc::nickFromPrefix(copy);
 }
 
+class IrcUserIndexLessThan
+{
+public:
+    IrcUserIndexLessThan(Irc::SortMethod method, Qt::SortOrder order) : method(method), order(order) { }
+    bool operator()(IrcUser* u1, IrcUser* u2) const
+    {
+        if (order == Qt::AscendingOrder)
+            return IrcUserModelPrivate::lessThan(u1, u2, method);
+        return IrcUserModelPrivate::lessThan(u2, u1, method);
+    }
+private:
+    Irc::SortMethod method;
+    Qt::SortOrder order;
+};
+
+IrcUserIndex::IrcUserIndex(Irc::SortMethod method, Qt::SortOrder order)
+    : method(method), order(order), removedRow(-1), insertedRow(-1), ref(1)
+{
+}
+
+void IrcUserIndex::reset(const QList<IrcUser*>& list)
+{
+    users = list;
+    std::sort(users.begin(), users.end(), IrcUserIndexLessThan(method, order));
+    removed.clear();
+    removedRow = -1;
+    insertedRow = -1;
+}
+
+void IrcUserIndex::insert(IrcUser* user)
+{
+    QList<IrcUser*>::iterator it = std::upper_bound(users.begin(), users.end(), user, IrcUserIndexLessThan(method, order));
+    insertedRow = it - users.begin();
+    users.insert(it, user);
+    removed.clear();
+    removedRow = -1;
+}
+
+void IrcUserIndex::remove(IrcUser* user)
+{
+    removedRow = users.indexOf(user);
+    if (removedRow != -1)
+        users.removeAt(removedRow);
+    removed.clear();
+    insertedRow = -1;
+}
+
+void IrcUserIndex::reinsert(IrcUser* user)
+{
+    remove(user);
+    if (removedRow != -1) {
+        const int row = removedRow;
+        removed = users;
+        QList<IrcUser*>::iterator it = std::upper_bound(users.begin(), users.end(), user, IrcUserIndexLessThan(method, order));
+        insertedRow = it - users.begin();
+        users.insert(it, user);
+        removedRow = row;
+    }
+}
+
 IrcChannelPrivate::IrcChannelPrivate() : active(false), enabled(true)
 {
     qRegisterMetaType<IrcChannel*>();
@@ -94,6 +164,7 @@ IrcChannelPrivate::IrcChannelPrivate() : active(false), enabled(true)
 
 IrcChannelPrivate::~IrcChannelPrivate()
 {
+    qDeleteAll(maskMatchers);
 }
 
 void IrcChannelPrivate::init(const QString& title, IrcBufferModel* m)
@@ -132,6 +203,7 @@ void IrcChannelPrivate::changeModes(const QString& value, const QStringList& arg
 
     QMap<QString, QString> ms = modes;
     QStringList args = arguments;
+    QStringList lists;
 
     bool add = true;
     for (int i = 0; i < value.size(); ++i) {
@@ -140,6 +212,10 @@ void IrcChannelPrivate::changeModes(const QString& value, const QStringList& arg
             add = true;
         } else if (m == QLatin1String("-")) {
             add = false;
+        } else if (network && network->channelModes(IrcNetwork::TypeA).contains(m)) {
+            // list modes, such as bans, always have an argument
+            if (!args.isEmpty() && changeMask(m, args.takeFirst(), add) && !lists.contains(m))
+                lists += m;
         } else {
             if (add) {
                 QString a;
@@ -147,6 +223,8 @@ void IrcChannelPrivate::changeModes(const QString& value, const QStringList& arg
                     a = args.takeFirst();
                 ms.insert(m, a);
             } else {
+                if (!args.isEmpty() && network && network->channelModes(IrcNetwork::TypeB).contains(m))
+                    args.removeFirst();
                 ms.remove(m);
             }
         }
@@ -157,6 +235,9 @@ void IrcChannelPrivate::changeModes(const QString& value, const QStringList& arg
         modes = ms;
         emit q->modeChanged(q->mode());
     }
+
+    foreach (const QString& m, lists)
+        emit q->masksChanged(m, maskMatchers.value(m)->masks());
 }
 
 void IrcChannelPrivate::setModes(const QString& value, const QStringList& arguments)
@@ -218,6 +299,10 @@ void IrcChannelPrivate::addUser(const QString& name)
     userMap.insert(user->name(), user);
     names = userMap.keys();
 
+    if (model)
+        IrcBufferModelPrivate::get(model)->nickIndex.insert(user);
+    foreach (IrcUserIndex* index, userIndexes)
+        index->insert(user);
     foreach (IrcUserModel* model, userModels)
         IrcUserModelPrivate::get(model)->addUser(user);
 }
@@ -229,6 +314,10 @@ bool IrcChannelPrivate::removeUser(const QString& name)
         names = userMap.keys();
         userList.removeOne(user);
         activeUsers.removeOne(user);
+        if (model)
+            IrcBufferModelPrivate::get(model)->nickIndex.remove(user);
+        foreach (IrcUserIndex* index, userIndexes)
+            index->remove(user);
         foreach (IrcUserModel* model, userModels)
             IrcUserModelPrivate::get(model)->removeUser(user);
         user->deleteLater();
@@ -242,6 +331,16 @@ void IrcChannelPrivate::setUsers(const QStringList& users)
     Q_Q(IrcChannel);
     const QStringList prefixes = q->network()->prefixes();
 
+    // the hosts learned from JOIN and WHO survive a NAMES refresh
+    QHash<QString, QString> hosts;
+    IrcNickIndex* nickIndex = model ? &IrcBufferModelPrivate::get(model)->nickIndex : 0;
+    foreach (IrcUser* user, userList) {
+        const QString& host = IrcUserPrivate::get(user)->host;
+        if (!host.isEmpty())
+            hosts.insert(user->name(), host);
+        if (nickIndex)
+            nickIndex->remove(user);
+    }
     qDeleteAll(userList);
     userMap.clear();
     userList.clear();
@@ -254,12 +353,17 @@ void IrcChannelPrivate::setUsers(const QStringList& users)
         priv->setName(userName(name, prefixes));
         priv->setPrefix(getPrefix(name, prefixes));
         priv->setMode(getMode(q->network(), user->prefix()));
+        priv->host = hosts.value(priv->name);
         activeUsers.append(user);
         userList.append(user);
         userMap.insert(user->name(), user);
+        if (nickIndex)
+            nickIndex->insert(user);
     }
     names = userMap.keys();
 
+    foreach (IrcUserIndex* index, userIndexes)
+        index->reset(userList);
     foreach (IrcUserModel* model, userModels)
         IrcUserModelPrivate::get(model)->setUsers(userList);
 }
@@ -271,10 +375,12 @@ bool IrcChannelPrivate::renameUser(const QString& from, const QString& to)
         userMap.insert(to, user);
         names = userMap.keys();
 
-        foreach (IrcUserModel* model, userModels) {
+        if (model)
+            IrcBufferModelPrivate::get(model)->nickIndex.rename(user, from);
+        foreach (IrcUserIndex* index, userIndexes)
+            index->reinsert(user);
+        foreach (IrcUserModel* model, userModels)
             IrcUserModelPrivate::get(model)->renameUser(user);
-            emit model->namesChanged(names);
-        }
         return true;
     }
     return false;
@@ -321,6 +427,10 @@ void IrcChannelPrivate::setUserMode(const QString& name, const QString& command)
         priv->setPrefix(sortedPrefix);
         priv->setMode(sortedMode);
 
+        foreach (IrcUserIndex* index, userIndexes) {
+            if (index->method == Irc::SortByTitle)
+                index->reinsert(user);
+        }
         foreach (IrcUserModel* model, userModels)
             IrcUserModelPrivate::get(model)->setUserMode(user);
     }
@@ -343,7 +453,7 @@ bool IrcChannelPrivate::setUserAway(const QString& name, bool away)
         IrcUserPrivate* priv = IrcUserPrivate::get(user);
         priv->setAway(away);
         foreach (IrcUserModel* model, userModels)
-            IrcUserModelPrivate::get(model)->updateUser(user);
+            IrcUserModelPrivate::get(model)->updateUserStatus(user);
         return true;
     }
     return false;
@@ -355,7 +465,65 @@ void IrcChannelPrivate::setUserServOp(const QString& name, bool servOp)
         IrcUserPrivate* priv = IrcUserPrivate::get(user);
         priv->setServOp(servOp);
         foreach (IrcUserModel* model, userModels)
-            IrcUserModelPrivate::get(model)->updateUser(user);
+            IrcUserModelPrivate::get(model)->updateUserStatus(user);
+    }
+}
+
+IrcMaskMatcher* IrcChannelPrivate::maskMatcher(const QString& mode) const
+{
+    Q_Q(const IrcChannel);
+    const IrcNetwork* network = q->network();
+    const QString caseMapping = network ? network->caseMapping() : QString();
+    IrcMaskMatcher*& matcher = maskMatchers[mode];
+    if (!matcher)
+        matcher = new IrcMaskMatcher(caseMapping);
+    else
+        matcher->setCaseMapping(caseMapping);
+    return matcher;
+}
+
+bool IrcChannelPrivate::changeMask(const QString& mode, const QString& mask, bool add)
+{
+    IrcMaskMatcher* matcher = maskMatcher(mode);
+    return add ? matcher->insert(mask) : matcher->remove(mask);
+}
+
+void IrcChannelPrivate::setMasks(const QString& mode, const QStringList& masks)
+{
+    Q_Q(IrcChannel);
+    IrcMaskMatcher* matcher = maskMatcher(mode);
+    if (matcher->masks() != masks) {
+        matcher->setMasks(masks);
+        emit q->masksChanged(mode, matcher->masks());
+    }
+}
+
+QString IrcChannelPrivate::userPrefix(IrcUser* user) const
+{
+    const QString host = IrcUserPrivate::get(user)->host;
+    return user->name() + QLatin1Char('!') + (host.isEmpty() ? QString(QLatin1Char('@')) : host);
+}
+
+// user models with the same sort key share a sorted list of users
+IrcUserIndex* IrcChannelPrivate::acquireUserIndex(Irc::SortMethod method, Qt::SortOrder order)
+{
+    foreach (IrcUserIndex* index, userIndexes) {
+        if (index->method == method && index->order == order) {
+            ++index->ref;
+            return index;
+        }
+    }
+    IrcUserIndex* index = new IrcUserIndex(method, order);
+    index->reset(userList);
+    userIndexes.append(index);
+    return index;
+}
+
+void IrcChannelPrivate::releaseUserIndex(IrcUserIndex* index)
+{
+    if (index && !--index->ref) {
+        userIndexes.removeOne(index);
+        delete index;
     }
 }
 
@@ -430,6 +598,28 @@ bool IrcChannelPrivate::processNoticeMessage(IrcNoticeMessage* message)
 
 bool IrcChannelPrivate::processNumericMessage(IrcNumericMessage* message)
 {
+    switch (message->code()) {
+    case Irc::RPL_BANLIST:
+        maskReplies[QLatin1String("b")] += message->parameters().value(2);
+        break;
+    case Irc::RPL_EXCEPTLIST:
+        maskReplies[QLatin1String("e")] += message->parameters().value(2);
+        break;
+    case Irc::RPL_INVITELIST:
+        maskReplies[QLatin1String("I")] += message->parameters().value(2);
+        break;
+    case Irc::RPL_ENDOFBANLIST:
+        setMasks(QLatin1String("b"), maskReplies.take(QLatin1String("b")));
+        break;
+    case Irc::RPL_ENDOFEXCEPTLIST:
+        setMasks(QLatin1String("e"), maskReplies.take(QLatin1String("e")));
+        break;
+    case Irc::RPL_ENDOFINVITELIST:
+        setMasks(QLatin1String("I"), maskReplies.take(QLatin1String("I")));
+        break;
+    default:
+        break;
+    }
     promoteUser(message->nick());
     return message->isImplicit();
 }
@@ -505,11 +695,19 @@ IrcChannel::IrcChannel(QObject* parent)
 IrcChannel::~IrcChannel()
 {
     Q_D(IrcChannel);
+    if (d->model) {
+        foreach (IrcUser* user, d->userList)
+            IrcBufferModelPrivate::get(d->model)->nickIndex.remove(user);
+    }
     qDeleteAll(d->userList);
     d->userList.clear();
     d->userMap.clear();
     d->names.clear();
+    foreach (IrcUserModel* model, d->userModels)
+        IrcUserModelPrivate::get(model)->shared = 0;
     d->userModels.clear();
+    qDeleteAll(d->userIndexes);
+    d->userIndexes.clear();
     emit destroyed(this);
 }
 
@@ -573,6 +771,93 @@ bool IrcChannel::isActive() const
     return IrcBuffer::isActive() && d->active;
 }
 
+/*!
+    \since 3.6
+
+    Returns the masks of the list \a mode, for example \c "b" for bans,
+    \c "e" for ban exceptions or \c "I" for invite exceptions.
+
+    The lists are kept up to date as list modes are set and unset, and are
+    replaced when the server lists them in reply to a mode query:
+    \code
+    channel->sendCommand(IrcCommand::createMode(channel->title(), "b"));
+    \endcode
+
+    \sa masksChanged(), matchingMasks(), matchingUsers()
+ */
+QStringList IrcChannel::masks(const QString& mode) const
+{
+    Q_D(const IrcChannel);
+    if (!d->maskMatchers.contains(mode))
+        return QStringList();
+    return d->maskMatcher(mode)->masks();
+}
+
+/*!
+    \since 3.6
+
+    Returns the masks of the list \a mode that match the \a prefix.
+
+    The prefix is a "nick!ident@host" user prefix, for example the prefix
+    of a join message. The masks are matched according to the case mapping
+    of the network, and indexed so that only the masks that share a literal
+    prefix or suffix with the user are tested.
+
+    \sa masks(), matchingUsers(), IrcNetwork::caseMapping
+ */
+QStringList IrcChannel::matchingMasks(const QString& prefix, const QString& mode) const
+{
+    Q_D(const IrcChannel);
+    if (!d->maskMatchers.contains(mode))
+        return QStringList();
+    return d->maskMatcher(mode)->match(prefix);
+}
+
+/*!
+    \since 3.6
+    \overload
+
+    Returns the masks of the list \a mode that match the channel \a user.
+
+    \note The ident and host of a user are known once the user has joined
+    while the channel was active, or has been listed by who(). Until then,
+    only masks that accept any ident and host can match the user.
+ */
+QStringList IrcChannel::matchingMasks(IrcUser* user, const QString& mode) const
+{
+    Q_D(const IrcChannel);
+    if (!user)
+        return QStringList();
+    return matchingMasks(d->userPrefix(user), mode);
+}
+
+/*!
+    \since 3.6
+
+    Returns the channel users that match the \a mask.
+
+    Incomplete masks, such as \c "nick" or \c "*@host", are completed
+    to \c "nick!*@*" and \c "*!*@host", respectively. This can be used
+    to find out which users a ban would affect before setting it.
+
+    \sa matchingMasks()
+ */
+QList<IrcUser*> IrcChannel::matchingUsers(const QString& mask) const
+{
+    Q_D(const IrcChannel);
+    QList<IrcUser*> users;
+    if (mask.isEmpty())
+        return users;
+    const IrcNetwork* network = this->network();
+    const QString caseMapping = network ? network->caseMapping() : QString();
+    const IrcCompiledMask compiled(mask, caseMapping);
+    foreach (IrcUser* user, d->userList) {
+        if (compiled.match(IrcMaskMatcher::fold(d->userPrefix(user), caseMapping)))
+            users += user;
+    }
+    return users;
+}
+
 /*!
     \since 3.3
 
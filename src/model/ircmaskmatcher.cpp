@@ -0,0 +1,262 @@
+/*
+  Copyright (C) 2008-2016 The Communi Project
+
+  You may use this file under the terms of BSD license as follows:
+
+  Redistribution and use in source and binary forms, with or without
+  modification, are permitted provided that the following conditions are met:
+    * Redistributions of source code must retain the above copyright
+      notice, this list of conditions and the following disclaimer.
+    * Redistributions in binary form must reproduce the above copyright
+      notice, this list of conditions and the following disclaimer in the
+      documentation and/or other materials provided with the distribution.
+    * Neither the name of the copyright holder nor the names of its
+      contributors may be used to endorse or promote products derived
+      from this software without specific prior written permission.
+
+  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+  ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+  WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+  DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDERS OR CONTRIBUTORS BE LIABLE FOR
+  ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+  (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+  ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+  (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+  SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#include "ircmaskmatcher_p.h"
+
+IRC_BEGIN_NAMESPACE
+
+#ifndef IRC_DOXYGEN
+static inline bool irc_is_wildcard(const QChar& c)
+{
+    return c == QLatin1Char('*') || c == QLatin1Char('?');
+}
+
+static QString irc_literal_prefix(const QString& str)
+{
+    int i = 0;
+    while (i < str.length() && !irc_is_wildcard(str.at(i)))
+        ++i;
+    return str.left(i);
+}
+
+static QString irc_literal_suffix(const QString& str)
+{
+    int i = str.length();
+    while (i > 0 && !irc_is_wildcard(str.at(i - 1)))
+        --i;
+    return str.mid(i);
+}
+
+static inline bool irc_match_part(const QString& part, const QString& text, int pos)
+{
+    const QChar* p = part.constData();
+    const QChar* t = text.constData() + pos;
+    for (int i = 0; i < part.length(); ++i) {
+        if (p[i] != t[i] && p[i] != QLatin1Char('?'))
+            return false;
+    }
+    return true;
+}
+
+IrcCompiledMask::IrcCompiledMask(const QString& mask, const QString& caseMapping)
+    : mask(mask), pattern(IrcMaskMatcher::fold(IrcMaskMatcher::normalize(mask), caseMapping)), length(0)
+{
+    parts = pattern.split(QLatin1Char('*'));
+    foreach (const QString& part, parts)
+        length += part.length();
+}
+
+bool IrcCompiledMask::match(const QString& folded) const
+{
+    const int n = parts.count();
+    if (folded.length() < length)
+        return false;
+    if (n == 1)
+        return folded.length() == length && irc_match_part(parts.at(0), folded, 0);
+
+    const QString& first = parts.at(0);
+    const QString& last = parts.at(n - 1);
+    const int end = folded.length() - last.length();
+    if (!irc_match_part(first, folded, 0) || !irc_match_part(last, folded, end))
+        return false;
+
+    // the leftmost match of each part in between leaves the most room for the rest
+    int pos = first.length();
+    for (int i = 1; i < n - 1; ++i) {
+        const QString& part = parts.at(i);
+        while (pos + part.length() <= end && !irc_match_part(part, folded, pos))
+            ++pos;
+        if (pos + part.length() > end)
+            return false;
+        pos += part.length();
+    }
+    return true;
+}
+
+IrcMaskMatcher::IrcMaskMatcher(const QString& caseMapping) : mapping(caseMapping)
+{
+}
+
+IrcMaskMatcher::~IrcMaskMatcher()
+{
+    qDeleteAll(list);
+}
+
+QString IrcMaskMatcher::caseMapping() const
+{
+    return mapping;
+}
+
+void IrcMaskMatcher::setCaseMapping(const QString& caseMapping)
+{
+    if (mapping != caseMapping) {
+        const QStringList current = masks();
+        mapping = caseMapping;
+        setMasks(current);
+    }
+}
+
+QStringList IrcMaskMatcher::masks() const
+{
+    QStringList result;
+    result.reserve(list.count());
+    foreach (IrcCompiledMask* mask, list)
+        result += mask->mask;
+    return result;
+}
+
+void IrcMaskMatcher::setMasks(const QStringList& masks)
+{
+    clear();
+    foreach (const QString& mask, masks)
+        insert(mask);
+}
+
+bool IrcMaskMatcher::insert(const QString& mask)
+{
+    IrcCompiledMask* compiled = new IrcCompiledMask(mask, mapping);
+    if (mask.isEmpty() || patterns.contains(compiled->pattern)) {
+        delete compiled;
+        return false;
+    }
+    list += compiled;
+    patterns.insert(compiled->pattern, compiled);
+    index(compiled, true);
+    return true;
+}
+
+bool IrcMaskMatcher::remove(const QString& mask)
+{
+    IrcCompiledMask* compiled = patterns.take(fold(normalize(mask), mapping));
+    if (!compiled)
+        return false;
+    list.removeOne(compiled);
+    index(compiled, false);
+    delete compiled;
+    return true;
+}
+
+// returns the masks that match the "nick!ident@host" prefix
+QStringList IrcMaskMatcher::match(const QString& prefix) const
+{
+    const QString text = fold(prefix, mapping);
+    const int at = text.indexOf(QLatin1Char('@'));
+    const QString host = at != -1 ? text.mid(at + 1) : QString();
+
+    QList<IrcCompiledMask*> candidates = wild;
+    lookup(MaskPrefix, text, &candidates);
+    lookup(HostPrefix, host, &candidates);
+    lookup(MaskSuffix, text, &candidates);
+
+    QStringList result;
+    foreach (IrcCompiledMask* mask, candidates) {
+        if (mask->match(text))
+            result += mask->mask;
+    }
+    return result;
+}
+
+// completes "nick", "nick!ident" and "ident@host" to "nick!ident@host"
+QString IrcMaskMatcher::normalize(const QString& mask)
+{
+    const bool ex = mask.contains(QLatin1Char('!'));
+    const bool at = mask.contains(QLatin1Char('@'));
+    if (!ex && !at)
+        return mask + QLatin1String("!*@*");
+    if (!ex)
+        return QLatin1String("*!") + mask;
+    if (!at)
+        return mask + QLatin1String("@*");
+    return mask;
+}
+
+void IrcMaskMatcher::clear()
+{
+    qDeleteAll(list);
+    list.clear();
+    patterns.clear();
+    for (int i = 0; i < KeyCount; ++i) {
+        keys[i].clear();
+        lengths[i].clear();
+    }
+    wild.clear();
+}
+
+// each mask is indexed once, by the longest of its literal keys
+void IrcMaskMatcher::index(IrcCompiledMask* mask, bool add)
+{
+    QString str[KeyCount];
+    str[MaskPrefix] = irc_literal_prefix(mask->pattern);
+    const int at = mask->pattern.indexOf(QLatin1Char('@'));
+    if (at != -1)
+        str[HostPrefix] = irc_literal_prefix(mask->pattern.mid(at + 1));
+    str[MaskSuffix] = irc_literal_suffix(mask->pattern);
+
+    int key = MaskPrefix;
+    for (int i = HostPrefix; i < KeyCount; ++i) {
+        if (str[i].length() > str[key].length())
+            key = i;
+    }
+
+    const QString& literal = str[key];
+    if (literal.isEmpty()) {
+        if (add)
+            wild += mask;
+        else
+            wild.removeOne(mask);
+    } else if (add) {
+        QList<IrcCompiledMask*>& bucket = keys[key][literal];
+        if (bucket.isEmpty())
+            ++lengths[key][literal.length()];
+        bucket += mask;
+    } else {
+        QHash<QString, QList<IrcCompiledMask*> >::iterator it = keys[key].find(literal);
+        if (it != keys[key].end()) {
+            it.value().removeOne(mask);
+            if (it.value().isEmpty()) {
+                keys[key].erase(it);
+                if (!--lengths[key][literal.length()])
+                    lengths[key].remove(literal.length());
+            }
+        }
+    }
+}
+
+void IrcMaskMatcher::lookup(Key key, const QString& str, QList<IrcCompiledMask*>* candidates) const
+{
+    QMap<int, int>::const_iterator it;
+    for (it = lengths[key].constBegin(); it != lengths[key].constEnd() && it.key() <= str.length(); ++it) {
+        const QString literal = key == MaskSuffix ? str.right(it.key()) : str.left(it.key());
+        QHash<QString, QList<IrcCompiledMask*> >::const_iterator bucket = keys[key].constFind(literal);
+        if (bucket != keys[key].constEnd())
+            *candidates += bucket.value();
+    }
+}
+#endif // IRC_DOXYGEN
+
+IRC_END_NAMESPACE
@@ -0,0 +1,246 @@
+/*
+  Copyright (C) 2008-2016 The Communi Project
+
+  You may use this file under the terms of BSD license as follows:
+
+  Redistribution and use in source and binary forms, with or without
+  modification, are permitted provided that the following conditions are met:
+    * Redistributions of source code must retain the above copyright
+      notice, this list of conditions and the following disclaimer.
+    * Redistributions in binary form must reproduce the above copyright
+      notice, this list of conditions and the following disclaimer in the
+      documentation and/or other materials provided with the distribution.
+    * Neither the name of the copyright holder nor the names of its
+      contributors may be used to endorse or promote products derived
+      from this software without specific prior written permission.
+
+  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+  ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+  WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+  DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDERS OR CONTRIBUTORS BE LIABLE FOR
+  ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+  (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+  ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+  (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+  SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#include "ircnickindex_p.h"
+#include "ircmaskmatcher_p.h"
+#include "ircuser.h"
+#include "ircuser_p.h"
+
+IRC_BEGIN_NAMESPACE
+
+#ifndef IRC_DOXYGEN
+static inline quint64 irc_trigram(const QString& text, int i)
+{
+    return (quint64(text.at(i).unicode()) << 32) | (quint64(text.at(i + 1).unicode()) << 16) | text.at(i + 2).unicode();
+}
+
+static inline bool irc_is_wildcard(const QChar& c)
+{
+    return c == QLatin1Char('*') || c == QLatin1Char('?');
+}
+
+static bool irc_wildcard_match(const QString& pattern, const QString& text)
+{
+    int p = 0;
+    int t = 0;
+    int star = -1;
+    int mark = 0;
+    while (t < text.length()) {
+        if (p < pattern.length() && (pattern.at(p) == QLatin1Char('?') || pattern.at(p) == text.at(t))) {
+            ++p;
+            ++t;
+        } else if (p < pattern.length() && pattern.at(p) == QLatin1Char('*')) {
+            star = p++;
+            mark = t;
+        } else if (star != -1) {
+            p = star + 1;
+            t = ++mark;
+        } else {
+            return false;
+        }
+    }
+    while (p < pattern.length() && pattern.at(p) == QLatin1Char('*'))
+        ++p;
+    return p == pattern.length();
+}
+
+IrcNickIndex::IrcNickIndex()
+{
+}
+
+IrcNickIndex::~IrcNickIndex()
+{
+    qDeleteAll(entries);
+}
+
+// a user that was re-created, for example by a NAMES refresh, keeps its host
+void IrcNickIndex::insert(IrcUser* user)
+{
+    insertUser(user, user->name(), fold(IrcUserPrivate::get(user)->host));
+}
+
+void IrcNickIndex::remove(IrcUser* user)
+{
+    takeUser(user, user->name());
+}
+
+void IrcNickIndex::rename(IrcUser* user, const QString& from)
+{
+    const QString host = takeUser(user, from);
+    insertUser(user, user->name(), host);
+}
+
+void IrcNickIndex::setHost(const QString& nick, const QString& ident, const QString& host)
+{
+    IrcNickEntry* entry = entries.value(fold(nick));
+    if (entry && !host.isEmpty()) {
+        const QString userHost = ident + QLatin1Char('@') + host;
+        foreach (IrcUser* user, entry->users)
+            IrcUserPrivate::get(user)->host = userHost;
+        const QString value = fold(userHost);
+        if (entry->host != value) {
+            unindex(&masks, entry->mask, entry);
+            entry->host = value;
+            entry->mask = entry->nick + QLatin1Char('!') + value;
+            index(&masks, entry->mask, entry);
+        }
+    }
+}
+
+// the nicks are refolded, for example "[foo]" and "{foo}" are the same nick in rfc1459
+void IrcNickIndex::setCaseMapping(const QString& mapping)
+{
+    if (caseMapping != mapping) {
+        caseMapping = mapping;
+        const QList<IrcNickEntry*> old = entries.values();
+        entries.clear();
+        nicks.clear();
+        masks.clear();
+        foreach (IrcNickEntry* entry, old) {
+            foreach (IrcUser* user, entry->users)
+                insert(user);
+            delete entry;
+        }
+    }
+}
+
+int IrcNickIndex::count() const
+{
+    return entries.count();
+}
+
+// the trigrams of the literal parts of the pattern narrow down
+// the candidates before they are matched against the pattern
+QList<IrcUser*> IrcNickIndex::find(const QString& pattern) const
+{
+    const QString folded = fold(pattern);
+    const bool mask = folded.contains(QLatin1Char('!')) || folded.contains(QLatin1Char('@'));
+    const Trigrams& trigrams = mask ? masks : nicks;
+
+    bool wildcard = false;
+    const QSet<IrcNickEntry*>* smallest = 0;
+    QList<const QSet<IrcNickEntry*>*> postings;
+    for (int i = 0; i < folded.length(); ++i) {
+        if (irc_is_wildcard(folded.at(i))) {
+            wildcard = true;
+        } else if (i + 2 < folded.length() && !irc_is_wildcard(folded.at(i + 1)) && !irc_is_wildcard(folded.at(i + 2))) {
+            Trigrams::const_iterator it = trigrams.constFind(irc_trigram(folded, i));
+            if (it == trigrams.constEnd())
+                return QList<IrcUser*>();
+            if (!smallest || it.value().count() < smallest->count())
+                smallest = &it.value();
+            postings += &it.value();
+        }
+    }
+
+    QList<IrcUser*> users;
+    if (smallest) {
+        foreach (IrcNickEntry* entry, *smallest) {
+            bool candidate = true;
+            for (int i = 0; candidate && i < postings.count(); ++i)
+                candidate = postings.at(i) == smallest || postings.at(i)->contains(entry);
+            const QString& text = mask ? entry->mask : entry->nick;
+            if (candidate && (wildcard ? irc_wildcard_match(folded, text) : text.contains(folded)))
+                users += entry->users;
+        }
+    } else {
+        // too short for trigrams
+        foreach (IrcNickEntry* entry, entries) {
+            const QString& text = mask ? entry->mask : entry->nick;
+            if (!text.isEmpty() && (wildcard ? irc_wildcard_match(folded, text) : text.contains(folded)))
+                users += entry->users;
+        }
+    }
+    return users;
+}
+
+QString IrcNickIndex::fold(const QString& str) const
+{
+    return IrcMaskMatcher::fold(str, caseMapping);
+}
+
+QString IrcNickIndex::takeUser(IrcUser* user, const QString& name)
+{
+    QString host;
+    const QString nick = fold(name);
+    QHash<QString, IrcNickEntry*>::iterator it = entries.find(nick);
+    if (it != entries.end()) {
+        IrcNickEntry* entry = it.value();
+        host = entry->host;
+        entry->users.removeOne(user);
+        if (entry->users.isEmpty()) {
+            unindex(&nicks, entry->nick, entry);
+            unindex(&masks, entry->mask, entry);
+            entries.erase(it);
+            delete entry;
+        }
+    }
+    return host;
+}
+
+void IrcNickIndex::insertUser(IrcUser* user, const QString& name, const QString& host)
+{
+    const QString nick = fold(name);
+    IrcNickEntry*& entry = entries[nick];
+    if (!entry) {
+        entry = new IrcNickEntry;
+        entry->nick = nick;
+        index(&nicks, entry->nick, entry);
+    }
+    if (entry->host.isEmpty() && !host.isEmpty()) {
+        entry->host = host;
+        entry->mask = entry->nick + QLatin1Char('!') + host;
+        index(&masks, entry->mask, entry);
+    }
+    // the same nick on another channel is the same user
+    IrcUserPrivate* priv = IrcUserPrivate::get(user);
+    if (priv->host.isEmpty() && !entry->users.isEmpty())
+        priv->host = IrcUserPrivate::get(entry->users.first())->host;
+    entry->users += user;
+}
+
+void IrcNickIndex::index(Trigrams* trigrams, const QString& text, IrcNickEntry* entry)
+{
+    for (int i = 0; i + 2 < text.length(); ++i)
+        (*trigrams)[irc_trigram(text, i)].insert(entry);
+}
+
+void IrcNickIndex::unindex(Trigrams* trigrams, const QString& text, IrcNickEntry* entry)
+{
+    for (int i = 0; i + 2 < text.length(); ++i) {
+        Trigrams::iterator it = trigrams->find(irc_trigram(text, i));
+        if (it != trigrams->end()) {
+            it.value().remove(entry);
+            if (it.value().isEmpty())
+                trigrams->erase(it);
+        }
+    }
+}
+#endif // IRC_DOXYGEN
+
+IRC_END_NAMESPACE
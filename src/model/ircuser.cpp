@@ -51,8 +51,9 @@ void IrcUserPrivate::setName(const QString& n)
     Q_Q(IrcUser);
     if (name != n) {
         name = n;
+        title = prefix.left(1) + name;
         emit q->nameChanged(name);
-        emit q->titleChanged(q->title());
+        emit q->titleChanged(title);
     }
 }
 
@@ -61,8 +62,9 @@ void IrcUserPrivate::setPrefix(const QString& p)
     Q_Q(IrcUser);
     if (prefix != p) {
         prefix = p;
+        title = prefix.left(1) + name;
         emit q->prefixChanged(prefix);
-        emit q->titleChanged(q->title());
+        emit q->titleChanged(title);
     }
 }
 
@@ -128,7 +130,7 @@ IrcUser::~IrcUser()
 QString IrcUser::title() const
 {
     Q_D(const IrcUser);
-    return d->prefix.left(1) + d->name;
+    return d->title;
 }
 
 /*!
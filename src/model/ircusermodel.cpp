@@ -33,6 +33,7 @@
 #include "ircchannel_p.h"
 #include "ircuser.h"
 #include <qpointer.h>
+#include <qset.h>
 #include <algorithm>
 
 IRC_BEGIN_NAMESPACE
@@ -61,6 +62,13 @@ IRC_BEGIN_NAMESPACE
         userListView->setModel(model);
     }
     \endcode
+
+    \section qml-performance QML performance
+
+    For large channels, use the model interface in QML views and avoid
+    binding to the \ref names, \ref titles and \ref users properties.
+    Every change to such a property converts the whole list to JavaScript.
+    Nothing is converted as long as the properties are not bound.
 */
 
 /*!
@@ -109,13 +117,15 @@ private:
 };
 
 IrcUserModelPrivate::IrcUserModelPrivate() : q_ptr(0), role(Irc::TitleRole),
-    sortMethod(Irc::SortByHand), sortOrder(Qt::AscendingOrder)
+    titlesDirty(false), sortMethod(Irc::SortByHand), sortOrder(Qt::AscendingOrder),
+    filterFlags(IrcUserModel::NoFilter), shared(0)
 {
 }
 
 void IrcUserModelPrivate::addUser(IrcUser* user, bool notify)
 {
-    insertUser(-1, user, notify);
+    if (acceptsUser(user))
+        insertUser(-1, user, notify);
 }
 
 void IrcUserModelPrivate::insertUser(int index, IrcUser* user, bool notify)
@@ -123,7 +133,9 @@ void IrcUserModelPrivate::insertUser(int index, IrcUser* user, bool notify)
     Q_Q(IrcUserModel);
     if (index == -1)
         index = userList.count();
-    if (sortMethod != Irc::SortByHand) {
+    if (shared) {
+        index = shared->insertedRow;
+    } else if (sortMethod != Irc::SortByHand) {
         QList<IrcUser*>::iterator it;
         if (sortOrder == Qt::AscendingOrder)
             it = std::upper_bound(userList.begin(), userList.end(), user, IrcUserLessThan(q, sortMethod));
@@ -134,13 +146,18 @@ void IrcUserModelPrivate::insertUser(int index, IrcUser* user, bool notify)
     if (notify)
         emit q->aboutToBeAdded(user);
     q->beginInsertRows(QModelIndex(), index, index);
-    userList.insert(index, user);
-    updateTitles();
+    if (shared)
+        userList = shared->users;
+    else
+        userList.insert(index, user);
+    if (notify)
+        updateTitles();
     q->endInsertRows();
     if (notify) {
         emit q->added(user);
-        emit q->namesChanged(IrcChannelPrivate::get(channel)->names);
-        emit q->titlesChanged(titles);
+        emitNamesChanged();
+        if (!titlesDirty)
+            emit q->titlesChanged(titles);
         emit q->usersChanged(userList);
         emit q->countChanged(userList.count());
         if (userList.count() == 1)
@@ -151,18 +168,23 @@ void IrcUserModelPrivate::insertUser(int index, IrcUser* user, bool notify)
 void IrcUserModelPrivate::removeUser(IrcUser* user, bool notify)
 {
     Q_Q(IrcUserModel);
-    int idx = userList.indexOf(user);
+    int idx = shared ? shared->removedRow : userList.indexOf(user);
     if (idx != -1) {
         if (notify)
             emit q->aboutToBeRemoved(user);
         q->beginRemoveRows(QModelIndex(), idx, idx);
-        userList.removeAt(idx);
-        updateTitles();
+        if (shared)
+            userList = shared->insertedRow == -1 ? shared->users : shared->removed;
+        else
+            userList.removeAt(idx);
+        if (notify)
+            updateTitles();
         q->endRemoveRows();
         if (notify) {
             emit q->removed(user);
-            emit q->namesChanged(IrcChannelPrivate::get(channel)->names);
-            emit q->titlesChanged(titles);
+            emitNamesChanged();
+            if (!titlesDirty)
+                emit q->titlesChanged(titles);
             emit q->usersChanged(userList);
             emit q->countChanged(userList.count());
             if (userList.isEmpty())
@@ -177,21 +199,19 @@ void IrcUserModelPrivate::setUsers(const QList<IrcUser*>& users, bool reset)
     bool wasEmpty = userList.isEmpty();
     if (reset)
         q->beginResetModel();
-    userList = users;
-    if (sortMethod != Irc::SortByHand) {
-        if (sortOrder == Qt::AscendingOrder)
-            std::sort(userList.begin(), userList.end(), IrcUserLessThan(q, sortMethod));
-        else
-            std::sort(userList.begin(), userList.end(), IrcUserGreaterThan(q, sortMethod));
+    if (shared) {
+        userList = shared->users;
+    } else {
+        userList = filterUsers(users);
+        if (sortMethod != Irc::SortByHand)
+            sortUsers(userList, sortMethod, sortOrder);
     }
     updateTitles();
     if (reset)
         q->endResetModel();
-    QStringList names;
-    if (channel)
-        names = IrcChannelPrivate::get(channel)->names;
-    emit q->namesChanged(names);
-    emit q->titlesChanged(titles);
+    emitNamesChanged();
+    if (!titlesDirty)
+        emit q->titlesChanged(titles);
     emit q->usersChanged(userList);
     emit q->countChanged(userList.count());
     if (wasEmpty != userList.isEmpty())
@@ -201,28 +221,39 @@ void IrcUserModelPrivate::setUsers(const QList<IrcUser*>& users, bool reset)
 void IrcUserModelPrivate::renameUser(IrcUser* user)
 {
     Q_Q(IrcUserModel);
-    if (updateUser(user) && sortMethod != Irc::SortByHand) {
+    if (refilterUser(user))
+        return;
+    if (updateUser(user)) {
         QList<IrcUser*> users = userList;
-        const bool notify = false;
-        removeUser(user, notify);
-        insertUser(-1, user, notify);
+        if (sortMethod != Irc::SortByHand) {
+            const bool notify = false;
+            removeUser(user, notify);
+            insertUser(-1, user, notify);
+        }
         if (updateTitles())
             emit q->titlesChanged(titles);
         if (users != userList)
             emit q->usersChanged(userList);
     }
+    emitNamesChanged();
 }
 
 void IrcUserModelPrivate::setUserMode(IrcUser* user)
 {
     Q_Q(IrcUserModel);
-    if (updateUser(user) && sortMethod == Irc::SortByTitle) {
-        const bool notify = false;
-        removeUser(user, notify);
-        insertUser(0, user, notify);
+    if (refilterUser(user))
+        return;
+    if (updateUser(user)) {
+        const bool resort = sortMethod == Irc::SortByTitle;
+        if (resort) {
+            const bool notify = false;
+            removeUser(user, notify);
+            insertUser(0, user, notify);
+        }
         if (updateTitles())
             emit q->titlesChanged(titles);
-        emit q->usersChanged(userList);
+        if (resort)
+            emit q->usersChanged(userList);
     }
 }
 
@@ -251,13 +282,204 @@ bool IrcUserModelPrivate::updateUser(IrcUser* user)
     return false;
 }
 
+void IrcUserModelPrivate::updateUserStatus(IrcUser* user)
+{
+    if (!refilterUser(user))
+        updateUser(user);
+}
+
+// titles are only kept up to date while titlesChanged() has receivers,
+// otherwise they are built on demand when the property is read
 bool IrcUserModelPrivate::updateTitles()
 {
-    QStringList prev = titles;
+    if (!hasReceivers(SIGNAL(titlesChanged(QStringList)))) {
+        titlesDirty = true;
+        return false;
+    }
+    const bool wasDirty = titlesDirty;
+    const QStringList prev = titles;
+    buildTitles();
+    return wasDirty || titles != prev;
+}
+
+void IrcUserModelPrivate::buildTitles() const
+{
     titles.clear();
+    titles.reserve(userList.count());
     foreach (IrcUser* user, userList)
         titles += user->title();
-    return titles != prev;
+    titlesDirty = false;
+}
+
+bool IrcUserModelPrivate::hasReceivers(const char* signal) const
+{
+    Q_Q(const IrcUserModel);
+    return q->receivers(signal) > 0;
+}
+
+bool IrcUserModelPrivate::isFiltered() const
+{
+    return filterFlags != IrcUserModel::NoFilter || !prefixFilter.isEmpty() || !nameFilter.isEmpty();
+}
+
+bool IrcUserModelPrivate::acceptsUser(IrcUser* user) const
+{
+    if (filterFlags & IrcUserModel::AwayFilter && !user->isAway())
+        return false;
+    if (filterFlags & IrcUserModel::PresentFilter && user->isAway())
+        return false;
+    if (filterFlags & IrcUserModel::ServOpFilter && !user->isServOp())
+        return false;
+    if (!prefixFilter.isEmpty()) {
+        bool match = false;
+        const QString prefix = user->prefix();
+        for (int i = 0; !match && i < prefix.length(); ++i)
+            match = prefixFilter.contains(prefix.at(i));
+        if (!match)
+            return false;
+    }
+    if (!nameFilter.isEmpty() && !user->name().contains(nameFilter, Qt::CaseInsensitive))
+        return false;
+    return true;
+}
+
+QList<IrcUser*> IrcUserModelPrivate::filterUsers(const QList<IrcUser*>& users) const
+{
+    if (!isFiltered())
+        return users;
+    QList<IrcUser*> filtered;
+    foreach (IrcUser* user, users) {
+        if (acceptsUser(user))
+            filtered += user;
+    }
+    return filtered;
+}
+
+// adds or removes a user whose changes affect the filter
+bool IrcUserModelPrivate::refilterUser(IrcUser* user)
+{
+    if (!isFiltered())
+        return false;
+    const bool contains = userList.contains(user);
+    if (contains == acceptsUser(user))
+        return false;
+    if (contains)
+        removeUser(user);
+    else
+        insertUser(-1, user);
+    return true;
+}
+
+void IrcUserModelPrivate::refilter()
+{
+    updateIndex();
+    if (channel)
+        setUsers(IrcChannelPrivate::get(channel)->userList);
+}
+
+QStringList IrcUserModelPrivate::userNames() const
+{
+    if (!channel || userList.isEmpty())
+        return QStringList();
+    if (!isFiltered())
+        return IrcChannelPrivate::get(channel)->names;
+    QStringList names;
+    names.reserve(userList.count());
+    foreach (IrcUser* user, userList)
+        names += user->name();
+    names.sort();
+    return names;
+}
+
+void IrcUserModelPrivate::emitNamesChanged()
+{
+    Q_Q(IrcUserModel);
+    // the names of a filtered model are collected on demand
+    if (!isFiltered() || hasReceivers(SIGNAL(namesChanged(QStringList))))
+        emit q->namesChanged(userNames());
+}
+
+// lessThan() may be reimplemented in subclasses, which declare Q_OBJECT.
+// QML wraps the model without a meta-object of its own.
+bool IrcUserModelPrivate::hasDefaultSort() const
+{
+    Q_Q(const IrcUserModel);
+    return q->metaObject() == &IrcUserModel::staticMetaObject;
+}
+
+void IrcUserModelPrivate::sortUsers(QList<IrcUser*>& users, Irc::SortMethod method, Qt::SortOrder order)
+{
+    Q_Q(IrcUserModel);
+    if (method == Irc::SortByActivity && channel && hasDefaultSort()) {
+        // the channel keeps its users in the order of activity
+        QSet<IrcUser*> members;
+        members.reserve(users.count());
+        foreach (IrcUser* user, users)
+            members.insert(user);
+        users.clear();
+        foreach (IrcUser* user, IrcChannelPrivate::get(channel)->activeUsers) {
+            if (members.contains(user)) {
+                if (order == Qt::AscendingOrder)
+                    users.append(user);
+                else
+                    users.prepend(user);
+            }
+        }
+    } else if (order == Qt::AscendingOrder) {
+        std::sort(users.begin(), users.end(), IrcUserLessThan(q, method));
+    } else {
+        std::sort(users.begin(), users.end(), IrcUserGreaterThan(q, method));
+    }
+}
+
+// unfiltered models of a channel sorted by name or title share
+// a single sorted list of users that is maintained by the channel
+void IrcUserModelPrivate::updateIndex()
+{
+    const bool share = channel && !isFiltered() && hasDefaultSort()
+                       && (sortMethod == Irc::SortByName || sortMethod == Irc::SortByTitle);
+    if (shared && (!share || shared->method != sortMethod || shared->order != sortOrder))
+        releaseIndex();
+    if (share && !shared)
+        shared = IrcChannelPrivate::get(channel)->acquireUserIndex(sortMethod, sortOrder);
+}
+
+void IrcUserModelPrivate::releaseIndex()
+{
+    if (shared && channel)
+        IrcChannelPrivate::get(channel)->releaseUserIndex(shared);
+    shared = 0;
+}
+
+bool IrcUserModelPrivate::lessThan(IrcUser* one, IrcUser* another, Irc::SortMethod method)
+{
+    if (method == Irc::SortByActivity) {
+        QList<IrcUser*> activeUsers = IrcChannelPrivate::get(one->channel())->activeUsers;
+        const int i1 = activeUsers.indexOf(one);
+        const int i2 = activeUsers.indexOf(another);
+        return i1 < i2;
+    } else if (method == Irc::SortByTitle) {
+        const IrcNetwork* network = one->channel()->network();
+        const QStringList prefixes = network->prefixes();
+
+        const QString p1 = one->prefix();
+        const QString p2 = another->prefix();
+
+        const int i1 = !p1.isEmpty() ? prefixes.indexOf(p1.at(0)) : -1;
+        const int i2 = !p2.isEmpty() ? prefixes.indexOf(p2.at(0)) : -1;
+
+        if (i1 >= 0 && i2 < 0)
+            return true;
+        if (i1 < 0 && i2 >= 0)
+            return false;
+        if (i1 >= 0 && i2 >= 0 && i1 != i2)
+            return i1 < i2;
+    }
+
+    // Irc::SortByName
+    const QString n1 = one->name();
+    const QString n2 = another->name();
+    return n1.compare(n2, Qt::CaseInsensitive) < 0;
 }
 
 #endif // IRC_DOXYGEN
@@ -284,6 +506,7 @@ IrcUserModel::IrcUserModel(QObject* parent) : QAbstractListModel(parent), d_ptr(
 IrcUserModel::~IrcUserModel()
 {
     Q_D(IrcUserModel);
+    d->releaseIndex();
     if (d->channel)
         IrcChannelPrivate::get(d->channel)->userModels.removeOne(this);
 }
@@ -309,18 +532,18 @@ void IrcUserModel::setChannel(IrcChannel* channel)
     Q_D(IrcUserModel);
     if (d->channel != channel) {
         beginResetModel();
-        if (d->channel)
+        if (d->channel) {
+            d->releaseIndex();
             IrcChannelPrivate::get(d->channel)->userModels.removeOne(this);
+        }
 
         d->channel = channel;
 
         QList<IrcUser*> users;
         if (d->channel) {
             IrcChannelPrivate::get(d->channel)->userModels.append(this);
-            if (d->sortMethod == Irc::SortByActivity)
-                users = IrcChannelPrivate::get(d->channel)->activeUsers;
-            else
-                users = IrcChannelPrivate::get(d->channel)->userList;
+            d->updateIndex();
+            users = IrcChannelPrivate::get(d->channel)->userList;
         }
         const bool reset = false;
         d->setUsers(users, reset);
@@ -374,9 +597,7 @@ bool IrcUserModel::isEmpty() const
 QStringList IrcUserModel::names() const
 {
     Q_D(const IrcUserModel);
-    if (d->channel && !d->userList.isEmpty())
-        return IrcChannelPrivate::get(d->channel)->names;
-    return QStringList();
+    return d->userNames();
 }
 
 /*!
@@ -384,6 +605,9 @@ QStringList IrcUserModel::names() const
 
     This property holds the list of titles.
 
+    The list is only maintained while titlesChanged() is connected.
+    Otherwise it is built on demand when the property is read.
+
     \par Access function:
     \li QStringList <b>titles</b>() const
 
@@ -393,6 +617,8 @@ QStringList IrcUserModel::names() const
 QStringList IrcUserModel::titles() const
 {
     Q_D(const IrcUserModel);
+    if (d->titlesDirty)
+        d->buildTitles();
     return d->titles;
 }
 
@@ -428,8 +654,11 @@ IrcUser* IrcUserModel::get(int index) const
 IrcUser* IrcUserModel::find(const QString& name) const
 {
     Q_D(const IrcUserModel);
-    if (d->channel && !d->userList.isEmpty())
-        return IrcChannelPrivate::get(d->channel)->userMap.value(name);
+    if (d->channel && !d->userList.isEmpty()) {
+        IrcUser* user = IrcChannelPrivate::get(d->channel)->userMap.value(name);
+        if (user && d->acceptsUser(user))
+            return user;
+    }
     return 0;
 }
 
@@ -438,10 +667,7 @@ IrcUser* IrcUserModel::find(const QString& name) const
  */
 bool IrcUserModel::contains(const QString& name) const
 {
-    Q_D(const IrcUserModel);
-    if (d->channel && !d->userList.isEmpty())
-        return IrcChannelPrivate::get(d->channel)->userMap.contains(name);
-    return false;
+    return find(name) != 0;
 }
 
 /*!
@@ -487,8 +713,9 @@ void IrcUserModel::setSortMethod(Irc::SortMethod method)
     Q_D(IrcUserModel);
     if (d->sortMethod != method) {
         d->sortMethod = method;
+        d->updateIndex();
         if (method == Irc::SortByActivity && d->channel) {
-            d->userList = IrcChannelPrivate::get(d->channel)->activeUsers;
+            d->userList = d->filterUsers(IrcChannelPrivate::get(d->channel)->activeUsers);
             if (d->updateTitles())
                 emit titlesChanged(d->titles);
         }
@@ -519,11 +746,122 @@ void IrcUserModel::setSortOrder(Qt::SortOrder order)
     Q_D(IrcUserModel);
     if (d->sortOrder != order) {
         d->sortOrder = order;
+        d->updateIndex();
         if (d->sortMethod != Irc::SortByHand && !d->userList.isEmpty())
             sort(d->sortMethod, d->sortOrder);
     }
 }
 
+/*!
+    \since 3.6
+
+    This property holds the filter flags.
+
+    Flag                         | Description
+    -----------------------------|------------------------------------------------
+    IrcUserModel::NoFilter       | Users are not filtered by their status.
+    IrcUserModel::AwayFilter     | Only users that are marked as away are included.
+    IrcUserModel::PresentFilter  | Only users that are not marked as away are included.
+    IrcUserModel::ServOpFilter   | Only server operators are included.
+
+    The default value is \c IrcUserModel::NoFilter.
+
+    \note Unfiltered models of the same channel that are sorted by
+    name or title share a single sorted list of users. A filtered
+    model holds only the users that match the filter.
+
+    \par Access functions:
+    \li IrcUserModel::FilterFlags <b>filterFlags</b>() const
+    \li void <b>setFilterFlags</b>(IrcUserModel::FilterFlags flags)
+
+    \par Notifier signal:
+    \li void <b>filterChanged</b>()
+
+    \sa prefixFilter, nameFilter
+ */
+IrcUserModel::FilterFlags IrcUserModel::filterFlags() const
+{
+    Q_D(const IrcUserModel);
+    return d->filterFlags;
+}
+
+void IrcUserModel::setFilterFlags(FilterFlags flags)
+{
+    Q_D(IrcUserModel);
+    if (d->filterFlags != flags) {
+        d->filterFlags = flags;
+        d->refilter();
+        emit filterChanged();
+    }
+}
+
+/*!
+    \since 3.6
+
+    This property holds the prefix filter.
+
+    When set, only users that have any of the specified
+    prefixes are included. For example, \c "@" includes
+    channel operators and \c "@+" also voiced users.
+
+    \par Access functions:
+    \li QString <b>prefixFilter</b>() const
+    \li void <b>setPrefixFilter</b>(const QString& prefixes)
+
+    \par Notifier signal:
+    \li void <b>filterChanged</b>()
+
+    \sa filterFlags, nameFilter
+ */
+QString IrcUserModel::prefixFilter() const
+{
+    Q_D(const IrcUserModel);
+    return d->prefixFilter;
+}
+
+void IrcUserModel::setPrefixFilter(const QString& prefixes)
+{
+    Q_D(IrcUserModel);
+    if (d->prefixFilter != prefixes) {
+        d->prefixFilter = prefixes;
+        d->refilter();
+        emit filterChanged();
+    }
+}
+
+/*!
+    \since 3.6
+
+    This property holds the name filter.
+
+    When set, only users whose name contains the
+    specified string, ignoring case, are included.
+
+    \par Access functions:
+    \li QString <b>nameFilter</b>() const
+    \li void <b>setNameFilter</b>(const QString& filter)
+
+    \par Notifier signal:
+    \li void <b>filterChanged</b>()
+
+    \sa filterFlags, prefixFilter
+ */
+QString IrcUserModel::nameFilter() const
+{
+    Q_D(const IrcUserModel);
+    return d->nameFilter;
+}
+
+void IrcUserModel::setNameFilter(const QString& filter)
+{
+    Q_D(IrcUserModel);
+    if (d->nameFilter != filter) {
+        d->nameFilter = filter;
+        d->refilter();
+        emit filterChanged();
+    }
+}
+
 /*!
     This property holds the display role.
 
@@ -657,7 +995,10 @@ void IrcUserModel::clear()
     Q_D(IrcUserModel);
     if (!d->userList.isEmpty()) {
         beginResetModel();
+        d->releaseIndex();
         d->userList.clear();
+        d->titles.clear();
+        d->titlesDirty = false;
         endResetModel();
         emit namesChanged(QStringList());
         emit titlesChanged(QStringList());
@@ -695,10 +1036,12 @@ void IrcUserModel::sort(Irc::SortMethod method, Qt::SortOrder order)
     foreach (const QModelIndex& index, oldPersistentIndexes)
         persistentUsers += static_cast<IrcUser*>(index.internalPointer());
 
-    if (order == Qt::AscendingOrder)
-        std::sort(d->userList.begin(), d->userList.end(), IrcUserLessThan(this, method));
-    else
-        std::sort(d->userList.begin(), d->userList.end(), IrcUserGreaterThan(this, method));
+    if (d->shared && d->shared->method == method && d->shared->order == order) {
+        d->userList = d->shared->users;
+    } else {
+        d->releaseIndex();
+        d->sortUsers(d->userList, method, order);
+    }
 
     if (d->updateTitles())
         emit titlesChanged(d->titles);
@@ -718,37 +1061,16 @@ void IrcUserModel::sort(Irc::SortMethod method, Qt::SortOrder order)
     The default implementation sorts according to the specified sort method.
     Reimplement this function in order to customize the sort order.
 
+    \note A subclass that reimplements this function must declare the
+    Q_OBJECT macro. Models without a meta-object of their own share a
+    sorted list of users with the other models of the channel, and are
+    sorted without calling this function.
+
     \sa sort(), sortMethod
  */
 bool IrcUserModel::lessThan(IrcUser* one, IrcUser* another, Irc::SortMethod method) const
 {
-    if (method == Irc::SortByActivity) {
-        QList<IrcUser*> activeUsers = IrcChannelPrivate::get(one->channel())->activeUsers;
-        const int i1 = activeUsers.indexOf(one);
-        const int i2 = activeUsers.indexOf(another);
-        return i1 < i2;
-    } else if (method == Irc::SortByTitle) {
-        const IrcNetwork* network = one->channel()->network();
-        const QStringList prefixes = network->prefixes();
-
-        const QString p1 = one->prefix();
-        const QString p2 = another->prefix();
-
-        const int i1 = !p1.isEmpty() ? prefixes.indexOf(p1.at(0)) : -1;
-        const int i2 = !p2.isEmpty() ? prefixes.indexOf(p2.at(0)) : -1;
-
-        if (i1 >= 0 && i2 < 0)
-            return true;
-        if (i1 < 0 && i2 >= 0)
-            return false;
-        if (i1 >= 0 && i2 >= 0 && i1 != i2)
-            return i1 < i2;
-    }
-
-    // Irc::SortByName
-    const QString n1 = one->name();
-    const QString n2 = another->name();
-    return n1.compare(n2, Qt::CaseInsensitive) < 0;
+    return IrcUserModelPrivate::lessThan(one, another, method);
 }
 
 #include "moc_ircusermodel.cpp"
@@ -26,6 +26,8 @@ PUB_HEADERS += $$INCDIR/ircusermodel.h
 PRIV_HEADERS  = $$INCDIR/ircbuffer_p.h
 PRIV_HEADERS += $$INCDIR/ircbuffermodel_p.h
 PRIV_HEADERS += $$INCDIR/ircchannel_p.h
+PRIV_HEADERS += $$INCDIR/ircmaskmatcher_p.h
+PRIV_HEADERS += $$INCDIR/ircnickindex_p.h
 PRIV_HEADERS += $$INCDIR/ircuser_p.h
 PRIV_HEADERS += $$INCDIR/ircusermodel_p.h
 
@@ -35,6 +37,8 @@ HEADERS += $$PRIV_HEADERS
 SOURCES += $$PWD/ircbuffer.cpp
 SOURCES += $$PWD/ircbuffermodel.cpp
 SOURCES += $$PWD/ircchannel.cpp
+SOURCES += $$PWD/ircmaskmatcher.cpp
 SOURCES += $$PWD/ircmodel.cpp
+SOURCES += $$PWD/ircnickindex.cpp
 SOURCES += $$PWD/ircuser.cpp
 SOURCES += $$PWD/ircusermodel.cpp
@@ -178,20 +178,38 @@ IRC_BEGIN_NAMESPACE
  */
 
 #ifndef IRC_DOXYGEN
-IrcCommandParserPrivate::IrcCommandParserPrivate() : tolerant(false)
+IrcCommandParserPrivate::IrcCommandParserPrivate() : tolerant(false),
+    commandChars(128), triggerChars(128), wideTriggers(false), hits(0), misses(0), parsed(0)
 {
 }
 
 QList<IrcCommandInfo> IrcCommandParserPrivate::find(const QString& command) const
 {
-    QList<IrcCommandInfo> result;
-    foreach (const IrcCommandInfo& cmd, commands) {
-        if (cmd.command == command)
-            result += cmd;
+    return index.value(command);
+}
+
+QStringList IrcCommandParserPrivate::findPrefixed(const QString& prefix) const
+{
+    QStringList result;
+    QMultiMap<QString, IrcCommandInfo>::const_iterator it = commands.lowerBound(prefix);
+    while (it != commands.constEnd() && it.key().startsWith(prefix)) {
+        if (result.isEmpty() || result.last() != it.key())
+            result += it.key();
+        ++it;
     }
     return result;
 }
 
+void IrcCommandParserPrivate::updateIndex(const QString& command)
+{
+    // most recently added overloads first, as iterated in the multi map
+    const QList<IrcCommandInfo> overloads = commands.values(command);
+    if (overloads.isEmpty())
+        index.remove(command);
+    else
+        index.insert(command, overloads);
+}
+
 static inline bool isOptional(const QString& token)
 {
     return token.startsWith(QLatin1Char('(')) && token.endsWith(QLatin1Char(')'));
@@ -242,6 +260,41 @@ IrcCommandInfo IrcCommandParserPrivate::parseSyntax(IrcCommand::Type type, const
     return cmd;
 }
 
+static void removeBracketed(QString* str)
+{
+    // equivalent to str->remove(QRegExp("\\[[^\\]]+\\]"))
+    int from = 0;
+    while ((from = str->indexOf(QLatin1Char('['), from)) != -1) {
+        const int to = str->indexOf(QLatin1Char(']'), from + 1);
+        if (to == -1)
+            break;
+        if (to > from + 1)
+            str->remove(from, to - from + 1);
+        else
+            ++from;
+    }
+}
+
+QString IrcCommandParserPrivate::formatSyntax(const IrcCommandInfo& command, IrcCommandParser::Details details)
+{
+    QString str = command.command + QLatin1Char(' ') + command.syntax;
+    if (details != IrcCommandParser::Full) {
+        if (details & IrcCommandParser::NoTarget)
+            removeBracketed(&str);
+        if (details & IrcCommandParser::NoPrefix)
+            str.remove(QLatin1Char('#'));
+        if (details & IrcCommandParser::NoEllipsis)
+            str.remove(QLatin1String("..."));
+        if (details & IrcCommandParser::NoParentheses)
+            str.remove(QLatin1Char('(')).remove(QLatin1Char(')'));
+        if (details & IrcCommandParser::NoBrackets)
+            str.remove(QLatin1Char('[')).remove(QLatin1Char(']'));
+        if (details & IrcCommandParser::NoAngles)
+            str.remove(QLatin1Char('<')).remove(QLatin1Char('>'));
+    }
+    return str.simplified();
+}
+
 IrcCommand* IrcCommandParserPrivate::parseCommand(const IrcCommandInfo& command, const QString& input) const
 {
     IrcCommand* cmd = 0;
@@ -296,7 +349,8 @@ bool IrcCommandParserPrivate::processParameters(const IrcCommandInfo& command, c
 bool IrcCommandParserPrivate::processCommand(QString* input, int* removed) const
 {
     foreach (const QString& trigger, triggers) {
-        if (tolerant && trigger.length() == 1 && (input->startsWith(trigger.repeated(2)) || input->startsWith(trigger + QLatin1Char(' ')))) {
+        if (tolerant && trigger.length() == 1 && input->length() > 1 && input->at(0) == trigger.at(0)
+                && (input->at(1) == trigger.at(0) || input->at(1) == QLatin1Char(' '))) {
             // treat "//cmd" and "/ /cmd" as message (-> "/cmd")
             input->remove(0, 1);
             if (removed)
@@ -327,6 +381,62 @@ bool IrcCommandParserPrivate::onChannel() const
 {
     return channels.contains(target, Qt::CaseInsensitive);
 }
+
+void IrcCommandParserPrivate::updateFilter()
+{
+    // first character tables for the commands and triggers: a line
+    // can only parse to a command if it starts with a known command,
+    // optionally preceded by a trigger and spaces
+    commandChars.fill(false);
+    foreach (const QString& command, index.keys()) {
+        const ushort c = command.at(0).unicode();
+        if (c < 128)
+            commandChars.setBit(c);
+    }
+
+    wideTriggers = false;
+    triggerChars.fill(false);
+    foreach (const QString& trigger, triggers) {
+        if (!trigger.isEmpty()) {
+            const ushort c = trigger.at(0).unicode();
+            if (c < 128)
+                triggerChars.setBit(c);
+            else
+                wideTriggers = true;
+        }
+    }
+}
+
+bool IrcCommandParserPrivate::filterInput(const QString& input) const
+{
+    if (tolerant)
+        return true;
+    if (input.isEmpty())
+        return false;
+    if (filterCommand(input, 0))
+        return true;
+    const ushort c = input.at(0).unicode();
+    if (c < 128 ? triggerChars.testBit(c) : wideTriggers) {
+        foreach (const QString& trigger, triggers) {
+            if (!trigger.isEmpty() && input.startsWith(trigger) && filterCommand(input, trigger.length()))
+                return true;
+        }
+    }
+    return false;
+}
+
+bool IrcCommandParserPrivate::filterCommand(const QString& input, int pos) const
+{
+    const int len = input.length();
+    while (pos < len && input.at(pos) == QLatin1Char(' '))
+        ++pos;
+    if (pos >= len)
+        return false;
+    const QChar c = input.at(pos);
+    if (c.unicode() >= 128)
+        return true; // leave case folding of non-ASCII to the parser
+    return commandChars.testBit(c.toUpper().unicode());
+}
 #endif // IRC_DOXYGEN
 
 /*!
@@ -368,26 +478,13 @@ QStringList IrcCommandParser::commands() const
 QString IrcCommandParser::syntax(const QString& command, Details details) const
 {
     Q_D(const IrcCommandParser);
-    IrcCommandInfo info = d->find(command.toUpper()).value(0);
-    if (!info.command.isEmpty()) {
-        QString str = info.fullSyntax();
-        if (details != Full) {
-            if (details & NoTarget)
-                str.remove(QRegExp("\\[[^\\]]+\\]"));
-            if (details & NoPrefix)
-                str.remove("#");
-            if (details & NoEllipsis)
-                str.remove("...");
-            if (details & NoParentheses)
-                str.remove("(").remove(")");
-            if (details & NoBrackets)
-                str.remove("[").remove("]");
-            if (details & NoAngles)
-                str.remove("<").remove(">");
-        }
-        return str.simplified();
-    }
-    return QString();
+    const QHash<QString, QList<IrcCommandInfo> >::const_iterator it = d->index.constFind(command.toUpper());
+    if (it == d->index.constEnd() || it->isEmpty())
+        return QString();
+    const IrcCommandInfo& info = it->first();
+    if (details == Visual)
+        return info.visual;
+    return d->formatSyntax(info, details);
 }
 
 /*!
@@ -398,8 +495,11 @@ void IrcCommandParser::addCommand(IrcCommand::Type type, const QString& syntax)
     Q_D(IrcCommandParser);
     IrcCommandInfo cmd = d->parseSyntax(type, syntax);
     if (!cmd.command.isEmpty()) {
-        const bool contains = d->commands.contains(cmd.command);
+        cmd.visual = d->formatSyntax(cmd, Visual);
+        const bool contains = d->index.contains(cmd.command);
         d->commands.insert(cmd.command, cmd);
+        d->updateIndex(cmd.command);
+        d->updateFilter();
         if (!contains)
             emit commandsChanged(commands());
     }
@@ -412,15 +512,21 @@ void IrcCommandParser::removeCommand(IrcCommand::Type type, const QString& synta
 {
     Q_D(IrcCommandParser);
     bool changed = false;
+    QStringList removed;
     QMutableMapIterator<QString, IrcCommandInfo> it(d->commands);
     while (it.hasNext()) {
         IrcCommandInfo cmd = it.next().value();
         if (cmd.type == type && (syntax.isEmpty() || !syntax.compare(cmd.fullSyntax(), Qt::CaseInsensitive))) {
             it.remove();
+            if (!removed.contains(cmd.command))
+                removed += cmd.command;
             if (!d->commands.contains(cmd.command))
                 changed = true;
         }
     }
+    foreach (const QString& command, removed)
+        d->updateIndex(command);
+    d->updateFilter();
     if (changed)
         emit commandsChanged(commands());
 }
@@ -498,6 +604,7 @@ void IrcCommandParser::setTriggers(const QStringList& triggers)
     Q_D(IrcCommandParser);
     if (d->triggers != triggers) {
         d->triggers = triggers;
+        d->updateFilter();
         emit triggersChanged(triggers);
     }
 }
@@ -544,8 +651,15 @@ void IrcCommandParser::setTolerant(bool tolerant)
 IrcCommand* IrcCommandParser::parse(const QString& input) const
 {
     Q_D(const IrcCommandParser);
+    if (!d->filterInput(input)) {
+        ++d->misses;
+        return 0;
+    }
+    ++d->hits;
+
     QString message = input;
     if (d->processMessage(&message)) {
+        ++d->parsed;
         return IrcCommand::createMessage(d->target, message.trimmed());
     } else if (!message.isEmpty()) {
         IrcTokenizer tokenizer(message);
@@ -555,18 +669,62 @@ IrcCommand* IrcCommandParser::parse(const QString& input) const
         if (!commands.isEmpty()) {
             foreach (const IrcCommandInfo& c, commands) {
                 IrcCommand* cmd = d->parseCommand(c, params);
-                if (cmd)
+                if (cmd) {
+                    ++d->parsed;
                     return cmd;
+                }
             }
         } else if (d->tolerant) {
             IrcCommandInfo custom = d->parseSyntax(IrcCommand::Quote, QString(QLatin1String("%1 (<parameters...>)")).arg(command));
             params.prepend(custom.command + QLatin1Char(' '));
-            return d->parseCommand(custom, params);
+            IrcCommand* cmd = d->parseCommand(custom, params);
+            if (cmd)
+                ++d->parsed;
+            return cmd;
         }
     }
     return 0;
 }
 
+/*!
+    \since 3.6
+
+    Returns statistics about the parsed input.
+
+    Input that cannot possibly contain a known command is rejected by a
+    cheap pre-filter before it is tokenized. The returned map contains
+    the following keys:
+    \li \c "hits" - the number of input lines that passed the pre-filter
+    \li \c "misses" - the number of input lines rejected by the pre-filter
+    \li \c "parsed" - the number of input lines that resulted in a command
+
+    \sa resetStatistics()
+ */
+QVariantMap IrcCommandParser::statistics() const
+{
+    Q_D(const IrcCommandParser);
+    QVariantMap stats;
+    stats.insert(QLatin1String("hits"), d->hits);
+    stats.insert(QLatin1String("misses"), d->misses);
+    stats.insert(QLatin1String("parsed"), d->parsed);
+    return stats;
+}
+
+/*!
+    \since 3.6
+
+    Resets the statistics.
+
+    \sa statistics()
+ */
+void IrcCommandParser::resetStatistics()
+{
+    Q_D(IrcCommandParser);
+    d->hits = 0;
+    d->misses = 0;
+    d->parsed = 0;
+}
+
 /*!
     Clears the list of commands.
 
@@ -577,6 +735,8 @@ void IrcCommandParser::clear()
     Q_D(IrcCommandParser);
     if (!d->commands.isEmpty()) {
         d->commands.clear();
+        d->index.clear();
+        d->updateFilter();
         emit commandsChanged(QStringList());
     }
 }
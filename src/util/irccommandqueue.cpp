@@ -30,11 +30,17 @@
 #include "irccommandqueue_p.h"
 #include "ircconnection.h"
 #include "irccommand.h"
+#include "ircmessage.h"
+#include "ircnetwork.h"
+#include "ircmaskmatcher_p.h"
+#include <QTextCodec>
 
 IRC_BEGIN_NAMESPACE
 
 static const int DEFAULT_BATCH = 3;
 static const int DEFAULT_INTERVAL = 2;
+static const int DEFAULT_HOST_LENGTH = 63;
+static const int MIN_SPLIT_LENGTH = 32;
 
 /*!
     \file irccommandqueue.h
@@ -46,6 +52,34 @@ static const int DEFAULT_INTERVAL = 2;
     \class IrcCommandQueue irccommandqueue.h <IrcCommandQueue>
     \ingroup util
     \brief Provides a flood protection queue for commands.
+
+    IrcCommandQueue implements a token bucket that matches the penalty
+    model of common IRC servers. The bucket holds \ref interval seconds
+    worth of credit, and each sent line costs \ref interval / \ref batch
+    seconds. Thus, up to \ref batch lines can be sent in a burst, after
+    which the queue drains at a steady pace of \ref batch lines per
+    \ref interval. Optionally, long lines may be charged for their length
+    by specifying a \ref byteRate.
+
+    Commands that keep the connection alive or identify the user (\c PING,
+    \c PONG, \c QUIT, \c CAP and messages to \ref services such as
+    \c NickServ) are sent before
+    any other queued commands. Other commands are sent in round-robin order
+    between their targets, so that a flood of messages to one channel does
+    not starve the others. The order of commands to the same target is
+    preserved.
+
+    Messages that would exceed the maximum line length can be split into
+    several lines by enabling \ref splitting, and identical messages to
+    different targets can be combined into one line by enabling \ref packing.
+
+    \code
+    // ircu: 2 seconds + 1 second per 120 bytes, 10 seconds of credit
+    IrcCommandQueue* queue = new IrcCommandQueue(connection);
+    queue->setBatch(5);
+    queue->setInterval(10);
+    queue->setByteRate(120);
+    \endcode
  */
 
 /*!
@@ -55,32 +89,294 @@ static const int DEFAULT_INTERVAL = 2;
  */
 
 #ifndef IRC_DOXYGEN
+static bool isDigit(const QString& text, int index)
+{
+    if (index >= text.length())
+        return false;
+    const ushort c = text.at(index).unicode();
+    return c >= '0' && c <= '9';
+}
+
+static bool isFormatToggle(QChar c)
+{
+    switch (c.unicode()) {
+    case '\x02': // bold
+    case '\x11': // monospace
+    case '\x16': // reverse
+    case '\x1d': // italic
+    case '\x1e': // strikethrough
+    case '\x1f': // underline
+        return true;
+    default:
+        return false;
+    }
+}
+
+static int encodedLength(const QString& text, QTextCodec* codec)
+{
+    if (codec->mibEnum() != 106) // UTF-8
+        return codec->fromUnicode(text).length();
+    int bytes = 0;
+    for (int i = 0; i < text.length(); ++i) {
+        const ushort c = text.at(i).unicode();
+        if (c < 0x80)
+            bytes += 1;
+        else if (c < 0x800 || (c >= 0xd800 && c <= 0xdfff))
+            bytes += 2; // a surrogate pair is 4 bytes
+        else
+            bytes += 3;
+    }
+    return bytes;
+}
+
+// splits text to units that must not be broken: color codes and surrogate pairs
+static QStringList textUnits(const QString& text)
+{
+    QStringList units;
+    const int len = text.length();
+    int i = 0;
+    while (i < len) {
+        int n = 1;
+        const QChar c = text.at(i);
+        if (c == QLatin1Char('\x03')) {
+            while (n < 3 && isDigit(text, i + n))
+                ++n;
+            if (n > 1 && text.mid(i + n, 1) == QLatin1String(",") && isDigit(text, i + n + 1)) {
+                n += 2;
+                if (isDigit(text, i + n))
+                    ++n;
+            }
+        } else if (c.isHighSurrogate() && i + 1 < len && text.at(i + 1).isLowSurrogate()) {
+            n = 2;
+        }
+        units += text.mid(i, n);
+        i += n;
+    }
+    return units;
+}
+
+class IrcFormatState
+{
+public:
+    void apply(const QString& unit)
+    {
+        const QChar c = unit.at(0);
+        if (c == QLatin1Char('\x0f')) {
+            toggles.clear();
+            fg.clear();
+            bg.clear();
+        } else if (c == QLatin1Char('\x03')) {
+            if (unit.length() == 1) {
+                fg.clear();
+                bg.clear();
+            } else {
+                const int comma = unit.indexOf(QLatin1Char(','));
+                fg = unit.mid(1, comma == -1 ? -1 : comma - 1).rightJustified(2, QLatin1Char('0'));
+                if (comma != -1)
+                    bg = unit.mid(comma + 1).rightJustified(2, QLatin1Char('0'));
+            }
+        } else if (isFormatToggle(c)) {
+            const int index = toggles.indexOf(c);
+            if (index == -1)
+                toggles += c;
+            else
+                toggles.remove(index, 1);
+        }
+    }
+
+    QString toString() const
+    {
+        // two digit colors so that the restored code cannot swallow digits of the text
+        QString codes = toggles;
+        if (!fg.isEmpty()) {
+            codes += QLatin1Char('\x03') + fg;
+            if (!bg.isEmpty())
+                codes += QLatin1Char(',') + bg;
+        }
+        return codes;
+    }
+
+private:
+    QString toggles;
+    QString fg;
+    QString bg;
+};
+
+static QStringList splitText(const QString& text, int bytes, QTextCodec* codec)
+{
+    QStringList chunks;
+    IrcFormatState state;
+    const QStringList units = textUnits(text);
+    const int count = units.count();
+    int i = 0;
+    while (i < count) {
+        // restore the formatting of the previous chunk
+        QString chunk = state.toString();
+        int length = encodedLength(chunk, codec);
+        int space = -1;
+        int end = i;
+        while (end < count) {
+            const int len = encodedLength(units.at(end), codec);
+            if (length + len > bytes)
+                break;
+            if (units.at(end) == QLatin1String(" "))
+                space = end;
+            length += len;
+            ++end;
+        }
+        int next = end;
+        if (end < count) {
+            if (units.at(end) == QLatin1String(" ")) {
+                next = end + 1;
+            } else if (space > i) {
+                end = space; // break at the last word boundary
+                next = space + 1;
+            } else if (end == i) {
+                end = next = i + 1;
+            }
+        }
+        for (int j = i; j < end; ++j) {
+            chunk += units.at(j);
+            state.apply(units.at(j));
+        }
+        chunks += chunk;
+        i = next;
+    }
+    return chunks;
+}
+
+void IrcCommandLane::enqueue(const QString& target, const IrcQueuedCommand& cmd)
+{
+    QQueue<IrcQueuedCommand>& queue = commands[target];
+    if (queue.isEmpty())
+        order.enqueue(target);
+    queue.enqueue(cmd);
+}
+
+IrcQueuedCommand& IrcCommandLane::head()
+{
+    Q_ASSERT(!order.isEmpty());
+    return commands[order.head()].head();
+}
+
+IrcQueuedCommand& IrcCommandLane::head(const QString& target)
+{
+    Q_ASSERT(commands.contains(target));
+    return commands[target].head();
+}
+
+IrcQueuedCommand IrcCommandLane::dequeue()
+{
+    Q_ASSERT(!order.isEmpty());
+    const QString target = order.dequeue();
+    QQueue<IrcQueuedCommand>& queue = commands[target];
+    IrcQueuedCommand cmd = queue.dequeue();
+    if (queue.isEmpty())
+        commands.remove(target);
+    else
+        order.enqueue(target); // round-robin between targets
+    return cmd;
+}
+
+IrcQueuedCommand IrcCommandLane::dequeue(const QString& target)
+{
+    Q_ASSERT(commands.contains(target));
+    QQueue<IrcQueuedCommand>& queue = commands[target];
+    IrcQueuedCommand cmd = queue.dequeue();
+    if (queue.isEmpty()) {
+        commands.remove(target);
+        order.removeOne(target);
+    }
+    return cmd;
+}
+
+QList<IrcQueuedCommand> IrcCommandLane::takeAll()
+{
+    QList<IrcQueuedCommand> all;
+    while (!isEmpty())
+        all += dequeue();
+    return all;
+}
+
 IrcCommandQueuePrivate::IrcCommandQueuePrivate() : q_ptr(0),
-    connection(0), batch(DEFAULT_BATCH), interval(DEFAULT_INTERVAL)
+    connection(0), batch(DEFAULT_BATCH), interval(DEFAULT_INTERVAL), byteRate(0), size(0),
+    splitting(false), packing(false),
+    credit(0), refilled(0), sent(0), totalWait(0), maxWait(0), maxSize(0)
 {
+    services += QLatin1String("NickServ");
+    timer.setSingleShot(true);
+    clock.start();
+    resetCredit();
 }
 
 bool IrcCommandQueuePrivate::commandFilter(IrcCommand* cmd)
 {
-    Q_Q(IrcCommandQueue);
     if (cmd->type() == IrcCommand::Quit) {
         _irc_sendBatch(true);
-    } else if (interval > 0 && !cmd->parent() && connection->isConnected()) {
-        cmd->setParent(q);
-        commands.enqueue(cmd);
-        emit q->sizeChanged(commands.size());
-        _irc_updateTimer();
-        return true;
+        return false;
+    }
+    if (cmd->parent() || !connection->isConnected())
+        return false;
+
+    QList<IrcCommand*> pieces;
+    if (splitting)
+        pieces = split(cmd);
+    if (pieces.isEmpty()) {
+        if (interval <= 0)
+            return false;
+        enqueue(cmd);
+    } else {
+        // the original command gets deleted by IrcConnection::sendCommand()
+        foreach (IrcCommand* piece, pieces) {
+            if (interval > 0) {
+                enqueue(piece);
+            } else {
+                // the original command has already been through the filters
+                QTextCodec* codec = QTextCodec::codecForName(piece->encoding());
+                Q_ASSERT(codec);
+                connection->sendData(codec->fromUnicode(piece->toString()));
+                delete piece;
+            }
+        }
+    }
+    return true;
+}
+
+bool IrcCommandQueuePrivate::commandValueFilter(const IrcCommandValue& cmd)
+{
+    const IrcCommand::Type type = cmd.type();
+    if (type == IrcCommand::Quit) {
+        _irc_sendBatch(true);
+        return false;
     }
+    const bool splittable = splitting && (type == IrcCommand::Message || type == IrcCommand::Notice || type == IrcCommand::CtcpAction);
+    if (!connection->isConnected() || (interval <= 0 && !splittable))
+        return false;
+
+    // queued and split commands are kept as IrcCommand
+    IrcCommand* command = cmd.toCommand();
+    const bool filtered = commandFilter(command);
+    if (!command->parent())
+        delete command; // not queued
+    return filtered;
+}
+
+bool IrcCommandQueuePrivate::messageFilter(IrcMessage* msg)
+{
+    // the server prepends our prefix to relayed messages
+    if (msg->type() == IrcMessage::Join && msg->isOwn())
+        prefix = msg->prefix();
     return false;
 }
 
 void IrcCommandQueuePrivate::_irc_updateTimer()
 {
-    if (connection && interval > 0 && !commands.isEmpty() && connection->isConnected()) {
-        timer.setInterval(interval * 1000);
-        if (!timer.isActive())
-            timer.start();
+    IrcCommandLane* next = nextLane();
+    if (connection && interval > 0 && next && connection->isConnected()) {
+        refill();
+        // wake up exactly when there is enough credit for the next command
+        const qint64 wait = qMax(Q_INT64_C(0), cost(&next->head()) - credit);
+        timer.start(static_cast<int>(wait));
     } else {
         if (timer.isActive())
             timer.stop();
@@ -90,19 +386,269 @@ void IrcCommandQueuePrivate::_irc_updateTimer()
 void IrcCommandQueuePrivate::_irc_sendBatch(bool force)
 {
     Q_Q(IrcCommandQueue);
-    if (!commands.isEmpty()) {
-        int i = batch;
-        while ((force || --i >= 0) && !commands.isEmpty()) {
-            IrcCommand* cmd = commands.dequeue();
+    if (size > 0) {
+        refill();
+        const int previous = size;
+        IrcCommandLane* next = 0;
+        while ((next = nextLane())) {
+            if (!force) {
+                const int c = cost(&next->head());
+                if (credit < c)
+                    break;
+                credit -= c;
+            }
+            const IrcQueuedCommand queued = next->dequeue();
+            --size;
+            IrcCommand* cmd = queued.command;
             if (cmd) {
+                updateStatistics(queued);
+                if (packing)
+                    pack(cmd, next);
                 connection->sendCommand(cmd);
                 cmd->deleteLater();
             }
         }
-        emit q->sizeChanged(commands.size());
+        if (size != previous)
+            emit q->sizeChanged(size);
+    }
+    _irc_updateTimer();
+}
+
+IrcCommandLane* IrcCommandQueuePrivate::nextLane()
+{
+    for (int i = 0; i < LaneCount; ++i) {
+        if (!lanes[i].isEmpty())
+            return &lanes[i];
+    }
+    return 0;
+}
+
+void IrcCommandQueuePrivate::refill()
+{
+    const qint64 now = clock.elapsed();
+    credit = qMin<qint64>(capacity(), credit + now - refilled);
+    refilled = now;
+}
+
+// an idle queue starts over with a full bucket, so that the first
+// burst after changing the interval or batch is a full batch
+void IrcCommandQueuePrivate::resetCredit()
+{
+    refill();
+    if (size == 0)
+        credit = capacity();
+}
+
+int IrcCommandQueuePrivate::capacity() const
+{
+    return qMax(0, interval) * 1000;
+}
+
+int IrcCommandQueuePrivate::cost(IrcQueuedCommand* cmd) const
+{
+    int ms = capacity() / qMax(1, batch);
+    if (byteRate > 0 && cmd->command) {
+        if (cmd->bytes == -1) {
+            QTextCodec* codec = QTextCodec::codecForName(cmd->command->encoding());
+            Q_ASSERT(codec);
+            cmd->bytes = codec->fromUnicode(cmd->command->toString()).length() + 2;
+        }
+        ms += static_cast<int>(cmd->bytes * Q_INT64_C(1000) / byteRate);
+    }
+    // a single command must never exceed the bucket
+    return qMin(ms, capacity());
+}
+
+void IrcCommandQueuePrivate::clear()
+{
+    Q_Q(IrcCommandQueue);
+    for (int i = 0; i < LaneCount; ++i) {
+        foreach (const IrcQueuedCommand& queued, lanes[i].takeAll())
+            delete queued.command;
     }
+    if (size != 0) {
+        size = 0;
+        emit q->sizeChanged(0);
+    }
+}
+
+void IrcCommandQueuePrivate::enqueue(IrcCommand* cmd)
+{
+    Q_Q(IrcCommandQueue);
+    cmd->setParent(q);
+    IrcQueuedCommand queued;
+    queued.command = cmd;
+    queued.queued = clock.elapsed();
+    lanes[lane(cmd)].enqueue(target(cmd), queued);
+    maxSize = qMax(maxSize, ++size);
+    emit q->sizeChanged(size);
     _irc_updateTimer();
 }
+
+void IrcCommandQueuePrivate::updateStatistics(const IrcQueuedCommand& queued)
+{
+    const qint64 wait = clock.elapsed() - queued.queued;
+    totalWait += wait;
+    maxWait = qMax(maxWait, wait);
+    ++sent;
+}
+
+QList<IrcCommand*> IrcCommandQueuePrivate::split(IrcCommand* cmd) const
+{
+    QList<IrcCommand*> commands;
+    const IrcCommand::Type type = cmd->type();
+    if (type != IrcCommand::Message && type != IrcCommand::Notice && type != IrcCommand::CtcpAction)
+        return commands;
+
+    const QStringList params = cmd->parameters();
+    const QString target = params.value(0);
+    const QString text = QStringList(params.mid(1)).join(QLatin1String(" "));
+
+    // no encoding produces more than 4 bytes per UTF-16 code unit
+    const int limit = connection->network()->numericLimit(IrcNetwork::MessageLength);
+    if (prefixLength() + 4 * (target.length() + text.length()) + MIN_SPLIT_LENGTH <= limit)
+        return commands;
+
+    const int length = lineLength(cmd);
+    if (length <= limit)
+        return commands;
+
+    QTextCodec* codec = QTextCodec::codecForName(cmd->encoding());
+    Q_ASSERT(codec);
+    const int bytes = limit - length + encodedLength(text, codec);
+    if (bytes < MIN_SPLIT_LENGTH)
+        return commands;
+
+    foreach (const QString& chunk, splitText(text, bytes, codec)) {
+        IrcCommand* piece = 0;
+        if (type == IrcCommand::Notice)
+            piece = IrcCommand::createNotice(target, chunk);
+        else if (type == IrcCommand::CtcpAction)
+            piece = IrcCommand::createCtcpAction(target, chunk);
+        else
+            piece = IrcCommand::createMessage(target, chunk);
+        piece->setEncoding(cmd->encoding());
+        commands += piece;
+    }
+    return commands;
+}
+
+void IrcCommandQueuePrivate::pack(IrcCommand* cmd, IrcCommandLane* lane)
+{
+    const IrcCommand::Type type = cmd->type();
+    if (type != IrcCommand::Message && type != IrcCommand::Notice)
+        return;
+
+    IrcNetwork* network = connection->network();
+    const int limit = network->targetLimit(type == IrcCommand::Notice ? QLatin1String("NOTICE") : QLatin1String("PRIVMSG"));
+    if (limit <= 1)
+        return;
+
+    QStringList params = cmd->parameters();
+    const QStringList text = params.mid(1);
+    QStringList targets = params.value(0).split(QLatin1Char(','));
+    const int maxLength = network->numericLimit(IrcNetwork::MessageLength);
+    int length = lineLength(cmd);
+    QTextCodec* codec = QTextCodec::codecForName(cmd->encoding());
+    Q_ASSERT(codec);
+
+    // combine identical messages at the heads of the other targets
+    QStringList packed;
+    foreach (const QString& key, lane->targets()) {
+        if (targets.count() >= limit)
+            break;
+        IrcCommand* other = lane->head(key).command;
+        if (!other || other->type() != type || other->encoding() != cmd->encoding())
+            continue;
+        const QStringList otherParams = other->parameters();
+        const QString otherTarget = otherParams.value(0);
+        if (otherTarget.isEmpty() || otherTarget.contains(QLatin1Char(',')) || otherParams.mid(1) != text
+                || targets.contains(otherTarget, Qt::CaseInsensitive))
+            continue;
+        const int bytes = encodedLength(otherTarget, codec) + 1;
+        if (length + bytes > maxLength)
+            continue;
+        length += bytes;
+        targets += otherTarget;
+        packed += key;
+    }
+
+    if (!packed.isEmpty()) {
+        params[0] = targets.join(QLatin1String(","));
+        cmd->setParameters(params);
+        foreach (const QString& key, packed) {
+            const IrcQueuedCommand queued = lane->dequeue(key);
+            updateStatistics(queued);
+            delete queued.command;
+            --size;
+        }
+    }
+}
+
+int IrcCommandQueuePrivate::prefixLength() const
+{
+    // ":nick!user@host "
+    int length = 2 + connection->nickName().length();
+    const int index = prefix.indexOf(QLatin1Char('!'));
+    if (index != -1)
+        length += prefix.length() - index;
+    else
+        length += 3 + connection->userName().length() + DEFAULT_HOST_LENGTH; // "!~user@host"
+    return length;
+}
+
+int IrcCommandQueuePrivate::lineLength(IrcCommand* cmd) const
+{
+    QTextCodec* codec = QTextCodec::codecForName(cmd->encoding());
+    Q_ASSERT(codec);
+    return prefixLength() + encodedLength(cmd->toString(), codec) + 2;
+}
+
+IrcCommandQueuePrivate::Lane IrcCommandQueuePrivate::lane(IrcCommand* cmd) const
+{
+    switch (cmd->type()) {
+    case IrcCommand::Capability:
+    case IrcCommand::Ping:
+    case IrcCommand::Pong:
+    case IrcCommand::Quit:
+        return High;
+    case IrcCommand::Message:
+    case IrcCommand::Notice: {
+        // "NickServ" or "NickServ@services.example.org"
+        const QString name = target(cmd).section(QLatin1Char('@'), 0, 0);
+        if (services.contains(name, Qt::CaseInsensitive))
+            return High;
+        return Normal;
+    }
+    default:
+        return Normal;
+    }
+}
+
+// folded by the case mapping of the network, e.g. "#foo[" and "#foo{" are the same channel in rfc1459
+QString IrcCommandQueuePrivate::target(IrcCommand* cmd) const
+{
+    const QString caseMapping = connection ? connection->network()->caseMapping() : QString();
+    switch (cmd->type()) {
+    case IrcCommand::CtcpAction:
+    case IrcCommand::CtcpReply:
+    case IrcCommand::CtcpRequest:
+    case IrcCommand::Join:
+    case IrcCommand::Kick:
+    case IrcCommand::Knock:
+    case IrcCommand::Message:
+    case IrcCommand::Mode:
+    case IrcCommand::Names:
+    case IrcCommand::Notice:
+    case IrcCommand::Part:
+    case IrcCommand::Topic:
+        return IrcMaskMatcher::fold(cmd->parameters().value(0), caseMapping);
+    case IrcCommand::Invite:
+        return IrcMaskMatcher::fold(cmd->parameters().value(1), caseMapping);
+    default:
+        return QString();
+    }
+}
 #endif // IRC_DOXYGEN
 
 /*!
@@ -130,7 +676,7 @@ IrcCommandQueue::~IrcCommandQueue()
 /*!
     This property holds the batch size.
 
-    This is the amount of commands sent at once.
+    This is the amount of commands that can be sent at once.
     The default value is \c 3.
 
     \par Access functions:
@@ -146,12 +692,17 @@ int IrcCommandQueue::batch() const
 void IrcCommandQueue::setBatch(int batch)
 {
     Q_D(IrcCommandQueue);
-    d->batch = batch;
+    if (d->batch != batch) {
+        d->batch = batch;
+        d->resetCredit();
+        d->_irc_updateTimer();
+    }
 }
 
 /*!
     This property holds the queue processing interval in seconds.
 
+    This is the time it takes to regain credit for a full \ref batch.
     The default value is \c 2 seconds. A value equal to or
     less than \c 0 seconds disables command queueing.
 
@@ -170,10 +721,125 @@ void IrcCommandQueue::setInterval(int seconds)
     Q_D(IrcCommandQueue);
     if (d->interval != seconds) {
         d->interval = seconds;
+        d->resetCredit();
+        d->_irc_updateTimer();
+    }
+}
+
+/*!
+    \since 3.6
+
+    This property holds the byte rate in bytes per second.
+
+    When set, each command is charged for its encoded length in addition
+    to the per line cost, so that long lines are sent at a slower pace.
+    The default value is \c 0 (the length of commands is not charged).
+
+    \par Access functions:
+    \li int <b>byteRate</b>() const
+    \li void <b>setByteRate</b>(int bytes)
+ */
+int IrcCommandQueue::byteRate() const
+{
+    Q_D(const IrcCommandQueue);
+    return d->byteRate;
+}
+
+void IrcCommandQueue::setByteRate(int bytes)
+{
+    Q_D(IrcCommandQueue);
+    if (d->byteRate != bytes) {
+        d->byteRate = bytes;
         d->_irc_updateTimer();
     }
 }
 
+/*!
+    \since 3.6
+
+    This property holds whether long messages are split.
+
+    When enabled, messages, notices and actions that would exceed the
+    maximum line length are split into several lines. The length is
+    measured in encoded bytes, taking into account the prefix the server
+    prepends when relaying the message. Lines are broken at word boundaries
+    when possible, multibyte characters and color codes are never broken
+    apart, and text formatting is carried over to the following lines.
+
+    The default value is \c false.
+
+    \par Access functions:
+    \li bool <b>isSplitting</b>() const
+    \li void <b>setSplitting</b>(bool splitting)
+ */
+bool IrcCommandQueue::isSplitting() const
+{
+    Q_D(const IrcCommandQueue);
+    return d->splitting;
+}
+
+void IrcCommandQueue::setSplitting(bool splitting)
+{
+    Q_D(IrcCommandQueue);
+    d->splitting = splitting;
+}
+
+/*!
+    \since 3.6
+
+    This property holds whether queued messages are packed.
+
+    When enabled, identical queued messages or notices to different targets
+    are combined into one line with a comma separated list of targets, up
+    to the limit advertised by the server (\c TARGMAX).
+
+    The default value is \c false.
+
+    \par Access functions:
+    \li bool <b>isPacking</b>() const
+    \li void <b>setPacking</b>(bool packing)
+
+    \sa IrcNetwork::targetLimit()
+ */
+bool IrcCommandQueue::isPacking() const
+{
+    Q_D(const IrcCommandQueue);
+    return d->packing;
+}
+
+void IrcCommandQueue::setPacking(bool packing)
+{
+    Q_D(IrcCommandQueue);
+    d->packing = packing;
+}
+
+/*!
+    \since 3.6
+
+    This property holds the list of service nicks.
+
+    Messages and notices to services, for example to identify the user,
+    are sent before other queued commands. The nicks are compared case
+    insensitively, and also match targets in the \c "nick@server" form.
+
+    The default value contains \c "NickServ".
+
+    \par Access functions:
+    \li QStringList <b>services</b>() const
+    \li void <b>setServices</b>(const QStringList& services)
+ */
+QStringList IrcCommandQueue::services() const
+{
+    Q_D(const IrcCommandQueue);
+    return d->services;
+}
+
+void IrcCommandQueue::setServices(const QStringList& services)
+{
+    Q_D(IrcCommandQueue);
+    d->services = services;
+}
+
 /*!
     This property holds the current size of the queue.
 
@@ -186,7 +852,7 @@ void IrcCommandQueue::setInterval(int seconds)
 int IrcCommandQueue::size() const
 {
     Q_D(const IrcCommandQueue);
-    return d->commands.size();
+    return d->size;
 }
 
 /*!
@@ -208,12 +874,15 @@ void IrcCommandQueue::setConnection(IrcConnection* connection)
     if (d->connection != connection) {
         if (d->connection) {
             d->connection->removeCommandFilter(d);
+            d->connection->removeMessageFilter(d);
             disconnect(d->connection, SIGNAL(connected()), this, SLOT(_irc_sendBatch()));
             disconnect(d->connection, SIGNAL(disconnected()), this, SLOT(_irc_updateTimer()));
         }
         d->connection = connection;
+        d->prefix.clear();
         if (connection) {
             connection->installCommandFilter(d);
+            connection->installMessageFilter(d, QList<IrcMessage::Type>() << IrcMessage::Join);
             connect(connection, SIGNAL(connected()), this, SLOT(_irc_sendBatch()));
             connect(connection, SIGNAL(disconnected()), this, SLOT(_irc_updateTimer()));
         }
@@ -231,8 +900,7 @@ void IrcCommandQueue::setConnection(IrcConnection* connection)
 void IrcCommandQueue::clear()
 {
     Q_D(IrcCommandQueue);
-    qDeleteAll(d->commands);
-    d->commands.clear();
+    d->clear();
     d->_irc_updateTimer();
 }
 
@@ -245,6 +913,48 @@ void IrcCommandQueue::flush()
     d->_irc_sendBatch(true);
 }
 
+/*!
+    \since 3.6
+
+    Returns statistics about the queue.
+
+    The returned map contains the following keys:
+    \li \c "size" - the current amount of queued commands
+    \li \c "maxSize" - the maximum amount of queued commands
+    \li \c "sent" - the amount of sent commands
+    \li \c "averageWait" - the average time in milliseconds sent commands spent in the queue
+    \li \c "maxWait" - the maximum time in milliseconds a sent command spent in the queue
+
+    \sa resetStatistics()
+ */
+QVariantMap IrcCommandQueue::statistics() const
+{
+    Q_D(const IrcCommandQueue);
+    QVariantMap stats;
+    stats.insert(QLatin1String("size"), d->size);
+    stats.insert(QLatin1String("maxSize"), d->maxSize);
+    stats.insert(QLatin1String("sent"), d->sent);
+    stats.insert(QLatin1String("averageWait"), d->sent > 0 ? d->totalWait / d->sent : Q_INT64_C(0));
+    stats.insert(QLatin1String("maxWait"), d->maxWait);
+    return stats;
+}
+
+/*!
+    \since 3.6
+
+    Resets the statistics.
+
+    \sa statistics()
+ */
+void IrcCommandQueue::resetStatistics()
+{
+    Q_D(IrcCommandQueue);
+    d->sent = 0;
+    d->totalWait = 0;
+    d->maxWait = 0;
+    d->maxSize = d->size;
+}
+
 #include "moc_irccommandqueue.cpp"
 #include "moc_irccommandqueue_p.cpp"
 
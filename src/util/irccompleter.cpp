@@ -192,12 +192,10 @@ QList<IrcCompletion> IrcCompleterPrivate::completeCommands(const QString& text,
     if (pp->processCommand(&input, &removed)) {
         const QString command = input.split(QLatin1Char(' '), QString::SkipEmptyParts).value(0).toUpper();
         if (!command.isEmpty()) {
-            foreach (const IrcCommandInfo& cmd, pp->commands) {
-                if (cmd.command == command)
-                    return QList<IrcCompletion>() << completeCommand(text, text.left(removed) + cmd.command);
-                if (cmd.command.startsWith(command))
-                    completions += completeCommand(text, text.left(removed) + cmd.command);
-            }
+            if (pp->index.contains(command))
+                return QList<IrcCompletion>() << completeCommand(text, text.left(removed) + command);
+            foreach (const QString& cmd, pp->findPrefixed(command))
+                completions += completeCommand(text, text.left(removed) + cmd);
         }
         // TODO: context sensitive command parameter completion
         Q_UNUSED(pos);
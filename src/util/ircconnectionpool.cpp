@@ -0,0 +1,622 @@
+/*
+  Copyright (C) 2008-2016 The Communi Project
+
+  You may use this file under the terms of BSD license as follows:
+
+  Redistribution and use in source and binary forms, with or without
+  modification, are permitted provided that the following conditions are met:
+    * Redistributions of source code must retain the above copyright
+      notice, this list of conditions and the following disclaimer.
+    * Redistributions in binary form must reproduce the above copyright
+      notice, this list of conditions and the following disclaimer in the
+      documentation and/or other materials provided with the distribution.
+    * Neither the name of the copyright holder nor the names of its
+      contributors may be used to endorse or promote products derived
+      from this software without specific prior written permission.
+
+  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+  ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+  WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+  DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDERS OR CONTRIBUTORS BE LIABLE FOR
+  ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+  (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+  ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+  (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+  SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#include "ircconnectionpool.h"
+#include "ircconnectionpool_p.h"
+#include "ircconnection.h"
+#include <QHostAddress>
+#include <QDateTime>
+
+IRC_BEGIN_NAMESPACE
+
+static const int DEFAULT_CONCURRENCY = 8;
+static const int DEFAULT_INTERVAL = 250;
+static const int DEFAULT_MINIMUM_DELAY = 2;
+static const int DEFAULT_MAXIMUM_DELAY = 300;
+
+// the lifetime of the entries in the Qt host cache
+static const int HOST_CACHE_AGE = 60;
+
+/*!
+    \file ircconnectionpool.h
+    \brief \#include &lt;IrcConnectionPool&gt;
+ */
+
+/*!
+    \class IrcConnectionPool ircconnectionpool.h <IrcConnectionPool>
+    \ingroup util
+    \brief Manages the connection attempts of a large amount of connections.
+    \since 3.6
+
+    IrcConnectionPool takes over the scheduling of connection attempts from
+    the connections added to it. When many connections drop at once, for
+    example due to a network outage, reconnecting them all at the same time
+    easily gets the client throttled or banned by the server. The pool spreads
+    the connection attempts over time:
+    \li at most \ref concurrency connections are being established at once,
+    \li consecutive connection attempts are at least \ref interval apart, and
+    \li failed connections are retried with an exponentially growing delay
+        between \ref minimumDelay and \ref maximumDelay, randomized so that
+        connections that failed together do not retry together.
+
+    Connections to the same host share a single host name lookup, and
+    aggregate health metrics are available as \ref statistics. Enabling
+    \ref IrcConnection::sessionResumption "session resumption" for secure
+    connections makes reconnects to the same host cheaper.
+
+    \code
+    IrcConnectionPool* pool = new IrcConnectionPool(this);
+    foreach (const QString& nick, nicks) {
+        IrcConnection* connection = new IrcConnection("irc.server.com", pool);
+        connection->setNickName(nick);
+        // ...
+        pool->addConnection(connection);
+    }
+    pool->open();
+    \endcode
+
+    \note The automatic reconnect of the connections is disabled while they
+          are in the pool. The original \ref IrcConnection::reconnectDelay
+          "reconnect delay" is restored when a connection is removed.
+
+    \note IrcConnectionPool relies on functionality introduced in Qt 4.7.0, and is
+          therefore not functional when built against earlier versions of Qt.
+ */
+
+/*!
+    \fn void IrcConnectionPool::connectionAdded(IrcConnection* connection)
+
+    This signal is emitted when a \a connection is added to the pool.
+ */
+
+/*!
+    \fn void IrcConnectionPool::connectionRemoved(IrcConnection* connection)
+
+    This signal is emitted when a \a connection is removed from the pool.
+ */
+
+/*!
+    \fn void IrcConnectionPool::statisticsChanged(const QVariantMap& statistics)
+
+    This signal is emitted when the \a statistics have changed.
+ */
+
+#ifndef IRC_DOXYGEN
+IrcConnectionPoolPrivate::IrcConnectionPoolPrivate() : q_ptr(0), opened(false),
+    concurrency(DEFAULT_CONCURRENCY), interval(DEFAULT_INTERVAL),
+    minimumDelay(DEFAULT_MINIMUM_DELAY), maximumDelay(DEFAULT_MAXIMUM_DELAY), last(-1), seed(1),
+    attempts(0), failures(0), disconnects(0), resolved(0), connectTime(0), connectCount(0)
+{
+}
+
+void IrcConnectionPoolPrivate::_irc_dispatch()
+{
+    timer.stop();
+    const qint64 now = clock.elapsed();
+    // start() may re-enter through the status signals, so no iterator
+    // is held across it
+    forever {
+        QMultiMap<qint64, IrcConnection*>::iterator it = queue.begin();
+        while (it != queue.end() && it.key() <= now && !resolve(it.value()))
+            ++it;
+        if (it == queue.end())
+            break;
+        if (it.key() > now) {
+            timer.start(it.key() - now);
+            break;
+        }
+        if (concurrency > 0 && pending.count() >= concurrency)
+            break; // resumed when a pending connection finishes
+        if (interval > 0 && last != -1 && now - last < interval) {
+            timer.start(interval - (now - last));
+            break;
+        }
+        IrcConnection* connection = it.value();
+        queue.erase(it);
+        pooled[connection].due = -1;
+        last = now;
+        start(connection);
+    }
+}
+
+void IrcConnectionPoolPrivate::_irc_statusChanged()
+{
+    Q_Q(IrcConnectionPool);
+    IrcConnection* connection = qobject_cast<IrcConnection*>(q->sender());
+    if (!connection || !pooled.contains(connection))
+        return;
+
+    IrcPooledConnection& entry = pooled[connection];
+    switch (connection->status()) {
+    case IrcConnection::Connecting:
+        // opened outside the pool
+        unschedule(connection);
+        break;
+    case IrcConnection::Connected:
+        if (entry.started != -1) {
+            connectTime += clock.elapsed() - entry.started;
+            ++connectCount;
+        }
+        entry.attempts = 0;
+        entry.connected = true;
+        release(connection);
+        break;
+    case IrcConnection::Error:
+        if (entry.connected)
+            ++disconnects;
+        else if (pending.contains(connection))
+            ++failures;
+        entry.connected = false;
+        release(connection);
+        if (opened && connection->isEnabled())
+            schedule(connection, backoff(++entry.attempts));
+        break;
+    case IrcConnection::Closed:
+        entry.connected = false;
+        release(connection);
+        unschedule(connection);
+        break;
+    default:
+        break;
+    }
+
+    // the socket is not ready for a new connection attempt until the
+    // status change has been fully processed
+    timer.start(0);
+    updateStatistics();
+}
+
+void IrcConnectionPoolPrivate::_irc_destroyed(QObject* connection)
+{
+    Q_Q(IrcConnectionPool);
+    // the connection is being destructed so it cannot be cast anymore
+    IrcConnection* destroyed = static_cast<IrcConnection*>(connection);
+    if (pooled.contains(destroyed)) {
+        forget(destroyed);
+        emit q->connectionRemoved(destroyed);
+        emit q->countChanged(connections.count());
+        timer.start(0);
+    }
+}
+
+void IrcConnectionPoolPrivate::_irc_lookedUp(const QHostInfo& info)
+{
+    const QString host = lookups.take(info.lookupId());
+    if (!host.isEmpty())
+        hosts.insert(host, clock.elapsed());
+    _irc_dispatch();
+}
+
+void IrcConnectionPoolPrivate::schedule(IrcConnection* connection, qint64 delay)
+{
+    unschedule(connection);
+    IrcPooledConnection& entry = pooled[connection];
+    entry.due = clock.elapsed() + delay;
+    queue.insert(entry.due, connection);
+}
+
+void IrcConnectionPoolPrivate::unschedule(IrcConnection* connection)
+{
+    IrcPooledConnection& entry = pooled[connection];
+    if (entry.due != -1) {
+        queue.remove(entry.due, connection);
+        entry.due = -1;
+    }
+}
+
+void IrcConnectionPoolPrivate::start(IrcConnection* connection)
+{
+    pooled[connection].started = clock.elapsed();
+    pending.insert(connection);
+    ++attempts;
+    connection->open();
+    // open() does nothing for disabled or incomplete connections
+    if (!connection->isActive())
+        release(connection);
+}
+
+void IrcConnectionPoolPrivate::release(IrcConnection* connection)
+{
+    if (pending.remove(connection))
+        pooled[connection].started = -1;
+}
+
+void IrcConnectionPoolPrivate::forget(IrcConnection* connection)
+{
+    unschedule(connection);
+    pending.remove(connection);
+    pooled.remove(connection);
+    connections.removeOne(connection);
+}
+
+bool IrcConnectionPoolPrivate::resolve(IrcConnection* connection)
+{
+    Q_Q(IrcConnectionPool);
+    // connections that cycle through servers look up their hosts themselves
+    const QString host = connection->servers().isEmpty() ? connection->host() : QString();
+    if (host.isEmpty() || QHostAddress(host).protocol() != QAbstractSocket::UnknownNetworkLayerProtocol)
+        return true;
+
+    // a single lookup per host fills the Qt host cache that the
+    // sockets of the connections look up the host from
+    const qint64 time = hosts.value(host, -1);
+    if (time != -1 && clock.elapsed() - time < HOST_CACHE_AGE * 1000)
+        return true;
+    if (lookups.key(host, -1) == -1) {
+        lookups.insert(QHostInfo::lookupHost(host, q, SLOT(_irc_lookedUp(QHostInfo))), host);
+        ++resolved;
+    }
+    return false;
+}
+
+qint64 IrcConnectionPoolPrivate::backoff(int attempts)
+{
+    // exponential backoff with half of the delay randomized
+    const qint64 cap = qMax(minimumDelay, maximumDelay) * Q_INT64_C(1000);
+    qint64 delay = qMax(0, minimumDelay) * Q_INT64_C(1000);
+    for (int i = 1; i < attempts && delay < cap; ++i)
+        delay *= 2;
+    delay = qMin(delay, cap);
+    if (delay < 2)
+        return delay;
+
+    // xorshift is plenty for spreading out the reconnects
+    seed ^= seed << 13;
+    seed ^= seed >> 17;
+    seed ^= seed << 5;
+    return delay / 2 + seed % (delay / 2 + 1);
+}
+
+void IrcConnectionPoolPrivate::updateStatistics()
+{
+    Q_Q(IrcConnectionPool);
+    emit q->statisticsChanged(q->statistics());
+}
+#endif // IRC_DOXYGEN
+
+/*!
+    Constructs a new connection pool with \a parent.
+ */
+IrcConnectionPool::IrcConnectionPool(QObject* parent) : QObject(parent), d_ptr(new IrcConnectionPoolPrivate)
+{
+    Q_D(IrcConnectionPool);
+    d->q_ptr = this;
+    d->seed = (quint32(QDateTime::currentMSecsSinceEpoch()) ^ quint32(quintptr(this))) | 1;
+    d->clock.start();
+    d->timer.setSingleShot(true);
+    connect(&d->timer, SIGNAL(timeout()), this, SLOT(_irc_dispatch()));
+}
+
+/*!
+    Destructs the connection pool.
+
+    The connections are not destructed, unless they are children of the pool.
+ */
+IrcConnectionPool::~IrcConnectionPool()
+{
+    Q_D(IrcConnectionPool);
+    foreach (IrcConnection* connection, d->connections) {
+        disconnect(connection, 0, this, 0);
+        connection->setReconnectDelay(d->pooled.value(connection).reconnectDelay);
+    }
+}
+
+/*!
+    This property holds the number of connections in the pool.
+
+    \par Access function:
+    \li int <b>count</b>() const
+
+    \par Notifier signal:
+    \li void <b>countChanged</b>(int count)
+ */
+int IrcConnectionPool::count() const
+{
+    Q_D(const IrcConnectionPool);
+    return d->connections.count();
+}
+
+/*!
+    Returns the connections in the pool.
+ */
+QList<IrcConnection*> IrcConnectionPool::connections() const
+{
+    Q_D(const IrcConnectionPool);
+    return d->connections;
+}
+
+/*!
+    Returns \c true if the pool contains \a connection.
+ */
+bool IrcConnectionPool::contains(IrcConnection* connection) const
+{
+    Q_D(const IrcConnectionPool);
+    return d->pooled.contains(connection);
+}
+
+/*!
+    Adds a \a connection to the pool.
+
+    The connection is scheduled to be opened if the pool has been \ref open()
+    "opened" and the connection is not yet active. The pool does not take
+    ownership of the connection.
+
+    \sa removeConnection()
+ */
+void IrcConnectionPool::addConnection(IrcConnection* connection)
+{
+    Q_D(IrcConnectionPool);
+    if (!connection || d->pooled.contains(connection))
+        return;
+
+    IrcPooledConnection entry;
+    entry.reconnectDelay = connection->reconnectDelay();
+    entry.connected = connection->isConnected();
+    d->pooled.insert(connection, entry);
+    d->connections += connection;
+
+    // the pool takes care of reconnecting
+    connection->setReconnectDelay(0);
+    connect(connection, SIGNAL(statusChanged(IrcConnection::Status)), this, SLOT(_irc_statusChanged()));
+    connect(connection, SIGNAL(destroyed(QObject*)), this, SLOT(_irc_destroyed(QObject*)));
+
+    if (d->opened && !connection->isActive())
+        d->schedule(connection, 0);
+
+    emit connectionAdded(connection);
+    emit countChanged(d->connections.count());
+    d->_irc_dispatch();
+}
+
+/*!
+    Removes a \a connection from the pool.
+
+    The connection is left as is, but its automatic reconnect is restored.
+
+    \sa addConnection()
+ */
+void IrcConnectionPool::removeConnection(IrcConnection* connection)
+{
+    Q_D(IrcConnectionPool);
+    if (!connection || !d->pooled.contains(connection))
+        return;
+
+    disconnect(connection, 0, this, 0);
+    connection->setReconnectDelay(d->pooled.value(connection).reconnectDelay);
+    d->forget(connection);
+
+    emit connectionRemoved(connection);
+    emit countChanged(d->connections.count());
+    d->_irc_dispatch();
+}
+
+/*!
+    This property holds the maximum number of connections that are being
+    established at the same time.
+
+    A connection is being established from the moment it is opened until it
+    has been \ref IrcConnection::connected "connected" or has failed to connect.
+    The default value is \c 8. A value equal to or less than \c 0 means no limit.
+
+    \par Access functions:
+    \li int <b>concurrency</b>() const
+    \li void <b>setConcurrency</b>(int connections)
+ */
+int IrcConnectionPool::concurrency() const
+{
+    Q_D(const IrcConnectionPool);
+    return d->concurrency;
+}
+
+void IrcConnectionPool::setConcurrency(int connections)
+{
+    Q_D(IrcConnectionPool);
+    if (d->concurrency != connections) {
+        d->concurrency = connections;
+        d->_irc_dispatch();
+    }
+}
+
+/*!
+    This property holds the minimum interval between two connection attempts in milliseconds.
+
+    The default value is \c 250 milliseconds. A value equal to or
+    less than \c 0 means no limit.
+
+    \par Access functions:
+    \li int <b>interval</b>() const
+    \li void <b>setInterval</b>(int msecs)
+ */
+int IrcConnectionPool::interval() const
+{
+    Q_D(const IrcConnectionPool);
+    return d->interval;
+}
+
+void IrcConnectionPool::setInterval(int msecs)
+{
+    Q_D(IrcConnectionPool);
+    if (d->interval != msecs) {
+        d->interval = msecs;
+        d->_irc_dispatch();
+    }
+}
+
+/*!
+    This property holds the delay in seconds before retrying a failed connection.
+
+    The delay is doubled for each consecutive failure, up to \ref maximumDelay.
+    A random amount of up to half of the delay is subtracted from it, so that
+    connections that failed together do not retry together.
+
+    The default value is \c 2 seconds.
+
+    \par Access functions:
+    \li int <b>minimumDelay</b>() const
+    \li void <b>setMinimumDelay</b>(int seconds)
+ */
+int IrcConnectionPool::minimumDelay() const
+{
+    Q_D(const IrcConnectionPool);
+    return d->minimumDelay;
+}
+
+void IrcConnectionPool::setMinimumDelay(int seconds)
+{
+    Q_D(IrcConnectionPool);
+    d->minimumDelay = qMax(0, seconds);
+}
+
+/*!
+    This property holds the maximum delay in seconds before retrying a failed connection.
+
+    The default value is \c 300 seconds.
+
+    \par Access functions:
+    \li int <b>maximumDelay</b>() const
+    \li void <b>setMaximumDelay</b>(int seconds)
+
+    \sa minimumDelay
+ */
+int IrcConnectionPool::maximumDelay() const
+{
+    Q_D(const IrcConnectionPool);
+    return d->maximumDelay;
+}
+
+void IrcConnectionPool::setMaximumDelay(int seconds)
+{
+    Q_D(IrcConnectionPool);
+    d->maximumDelay = qMax(0, seconds);
+}
+
+/*!
+    This property holds the health metrics of the pool.
+
+    The map contains the following keys:
+    \li \c "connections" - the amount of connections in the pool
+    \li \c "connected" - the amount of connected connections
+    \li \c "connecting" - the amount of connections being established
+    \li \c "waiting" - the amount of connections waiting for a connection attempt
+    \li \c "attempts" - the total amount of connection attempts
+    \li \c "failures" - the total amount of failed connection attempts
+    \li \c "disconnects" - the total amount of established connections that were lost
+    \li \c "lookups" - the total amount of host name lookups
+    \li \c "handshakes" - the amount of secure handshakes of the connections
+    \li \c "connectTime" - the average time in milliseconds it took to connect
+
+    \par Access function:
+    \li QVariantMap <b>statistics</b>() const
+
+    \par Notifier signal:
+    \li void <b>statisticsChanged</b>(const QVariantMap& statistics)
+
+    \sa resetStatistics()
+ */
+QVariantMap IrcConnectionPool::statistics() const
+{
+    Q_D(const IrcConnectionPool);
+    int connected = 0;
+    int handshakes = 0;
+    foreach (IrcConnection* connection, d->connections) {
+        if (connection->isConnected())
+            ++connected;
+        const QVariantMap stats = connection->statistics();
+        handshakes += stats.value(QLatin1String("handshakes")).toInt();
+    }
+    QVariantMap stats;
+    stats.insert(QLatin1String("connections"), d->connections.count());
+    stats.insert(QLatin1String("connected"), connected);
+    stats.insert(QLatin1String("connecting"), d->pending.count());
+    stats.insert(QLatin1String("waiting"), d->queue.count());
+    stats.insert(QLatin1String("attempts"), d->attempts);
+    stats.insert(QLatin1String("failures"), d->failures);
+    stats.insert(QLatin1String("disconnects"), d->disconnects);
+    stats.insert(QLatin1String("lookups"), d->resolved);
+    stats.insert(QLatin1String("handshakes"), handshakes);
+    if (d->connectCount > 0)
+        stats.insert(QLatin1String("connectTime"), double(d->connectTime) / d->connectCount);
+    return stats;
+}
+
+/*!
+    Resets the cumulative counters of the \ref statistics.
+ */
+void IrcConnectionPool::resetStatistics()
+{
+    Q_D(IrcConnectionPool);
+    d->attempts = 0;
+    d->failures = 0;
+    d->disconnects = 0;
+    d->resolved = 0;
+    d->connectTime = 0;
+    d->connectCount = 0;
+    emit statisticsChanged(statistics());
+}
+
+/*!
+    Opens all connections in the pool.
+
+    The connections that are not active are scheduled to be opened
+    obeying \ref concurrency and \ref interval. Failed connections
+    are retried until the pool is closed.
+
+    \sa close()
+ */
+void IrcConnectionPool::open()
+{
+    Q_D(IrcConnectionPool);
+    d->opened = true;
+    foreach (IrcConnection* connection, d->connections) {
+        if (!connection->isActive() && d->pooled.value(connection).due == -1)
+            d->schedule(connection, 0);
+    }
+    d->_irc_dispatch();
+    d->updateStatistics();
+}
+
+/*!
+    Closes all connections in the pool and cancels the scheduled connection attempts.
+
+    \sa open(), IrcConnection::close()
+ */
+void IrcConnectionPool::close()
+{
+    Q_D(IrcConnectionPool);
+    d->opened = false;
+    d->timer.stop();
+    foreach (IrcConnection* connection, d->connections) {
+        d->unschedule(connection);
+        connection->close();
+    }
+    d->updateStatistics();
+}
+
+#include "moc_ircconnectionpool.cpp"
+
+IRC_END_NAMESPACE
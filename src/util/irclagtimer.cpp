@@ -31,11 +31,19 @@
 #include "ircconnection.h"
 #include "ircmessage.h"
 #include "irccommand.h"
+#include "ircnetwork.h"
 #include <QDateTime>
+#include <qmath.h>
 
 IRC_BEGIN_NAMESPACE
 
 static const int DEFAULT_INTERVAL = 60;
+static const int DEFAULT_WINDOW = 128;
+static const int MAX_PENDING = 16;
+
+// HDR-style buckets: 16 linear sub-buckets per power of two (~6% precision)
+static const int SUB_BUCKET_BITS = 4;
+static const int SUB_BUCKETS = 1 << SUB_BUCKET_BITS;
 
 /*!
     \file irclagtimer.h
@@ -47,6 +55,17 @@ static const int DEFAULT_INTERVAL = 60;
     \ingroup util
     \brief Provides a timer for measuring lag.
 
+    IrcLagTimer sends a \c PING to the server every \ref interval seconds
+    and measures the round-trip time of the matching \c PONG with
+    microsecond resolution from a monotonic clock. The most recent
+    measurement is available as \ref lag, and the distribution of the
+    last \ref window measurements is available as \ref statistics.
+
+    In \ref passive mode, the round-trip time is also estimated from
+    messages echoed by the server when the \c echo-message capability
+    is enabled, and a \c PING is only sent when no traffic has been
+    measured during the last interval.
+
     \note IrcLagTimer relies on functionality introduced in Qt 4.7.0, and is
           therefore not functional when built against earlier versions of Qt.
  */
@@ -57,27 +76,177 @@ static const int DEFAULT_INTERVAL = 60;
     This signal is emitted when the \a lag has changed.
  */
 
+/*!
+    \fn void IrcLagTimer::statisticsChanged(const QVariantMap& statistics)
+    \since 3.6
+
+    This signal is emitted when a round-trip time has been measured and
+    the \a statistics have changed.
+ */
+
 #ifndef IRC_DOXYGEN
-IrcLagTimerPrivate::IrcLagTimerPrivate() : q_ptr(0), connection(0), interval(DEFAULT_INTERVAL), lag(-1)
+IrcLatencyHistogram::IrcLatencyHistogram() : samples(DEFAULT_WINDOW), next(0), size(0)
 {
 }
 
+void IrcLatencyHistogram::setWindow(int window)
+{
+    window = qMax(1, window);
+    if (window != samples.size()) {
+        // keep the most recent samples that fit in the new window
+        QVector<qint64> recent;
+        const int keep = qMin(size, window);
+        for (int i = keep; i > 0; --i)
+            recent += samples.at((next - i + samples.size()) % samples.size());
+        clear();
+        samples.resize(window);
+        foreach (qint64 usecs, recent)
+            add(usecs);
+    }
+}
+
+void IrcLatencyHistogram::add(qint64 usecs)
+{
+    usecs = qMax(Q_INT64_C(0), usecs);
+    if (size == samples.size())
+        --buckets[bucket(samples.at(next))];
+    else
+        ++size;
+    samples[next] = usecs;
+    next = (next + 1) % samples.size();
+    const int index = bucket(usecs);
+    if (index >= buckets.size())
+        buckets.resize(index + 1);
+    ++buckets[index];
+}
+
+void IrcLatencyHistogram::clear()
+{
+    buckets.clear();
+    next = 0;
+    size = 0;
+}
+
+qint64 IrcLatencyHistogram::minimum() const
+{
+    qint64 min = -1;
+    for (int i = 0; i < size; ++i)
+        min = (min == -1) ? samples.at(i) : qMin(min, samples.at(i));
+    return min;
+}
+
+qint64 IrcLatencyHistogram::maximum() const
+{
+    qint64 max = -1;
+    for (int i = 0; i < size; ++i)
+        max = qMax(max, samples.at(i));
+    return max;
+}
+
+qint64 IrcLatencyHistogram::percentile(double percent) const
+{
+    if (size == 0)
+        return -1;
+    const int rank = qBound(1, qCeil(percent / 100.0 * size), size);
+    int total = 0;
+    for (int i = 0; i < buckets.size(); ++i) {
+        total += buckets.at(i);
+        if (total >= rank)
+            return qMin(highestEquivalent(i), maximum());
+    }
+    return maximum();
+}
+
+int IrcLatencyHistogram::bucket(qint64 usecs)
+{
+    if (usecs < 2 * SUB_BUCKETS)
+        return static_cast<int>(usecs);
+    int shift = 0;
+    while ((usecs >> shift) >= 2 * SUB_BUCKETS)
+        ++shift;
+    return shift * SUB_BUCKETS + static_cast<int>(usecs >> shift);
+}
+
+qint64 IrcLatencyHistogram::highestEquivalent(int bucket)
+{
+    if (bucket < 2 * SUB_BUCKETS)
+        return bucket;
+    const int shift = bucket / SUB_BUCKETS - 1;
+    const qint64 lowest = static_cast<qint64>(bucket - shift * SUB_BUCKETS) << shift;
+    return lowest + (Q_INT64_C(1) << shift) - 1;
+}
+
+IrcLagTimerPrivate::IrcLagTimerPrivate() : q_ptr(0), connection(0), interval(DEFAULT_INTERVAL), lag(-1),
+    passive(false), last(-1), measured(-1)
+{
+    clock.start();
+}
+
 bool IrcLagTimerPrivate::messageFilter(IrcMessage* msg)
 {
-    if (msg->type() == IrcMessage::Pong)
+    switch (msg->type()) {
+    case IrcMessage::Pong:
         return processPongReply(static_cast<IrcPongMessage*>(msg));
+    case IrcMessage::Private:
+        if (!echoes.isEmpty() && msg->isOwn()) {
+            IrcPrivateMessage* privMsg = static_cast<IrcPrivateMessage*>(msg);
+            processEcho(privMsg->target(), privMsg->content());
+        }
+        break;
+    case IrcMessage::Notice:
+        if (!echoes.isEmpty() && msg->isOwn()) {
+            IrcNoticeMessage* noticeMsg = static_cast<IrcNoticeMessage*>(msg);
+            processEcho(noticeMsg->target(), noticeMsg->content());
+        }
+        break;
+    default:
+        break;
+    }
     return false;
 }
 
+// remember messages that the server is going to echo back, from the time they are written
+void IrcLagTimerPrivate::lineWritten(const QByteArray& line)
+{
+    int offset = 0;
+    if (line.startsWith("PRIVMSG "))
+        offset = 8;
+    else if (line.startsWith("NOTICE "))
+        offset = 7;
+    if (!offset || !passive || !connection->network()->isCapable(QLatin1String("echo-message")))
+        return;
+
+    const int colon = line.indexOf(" :", offset);
+    if (colon == -1)
+        return;
+    IrcEchoedCommand echo;
+    echo.target = QString::fromUtf8(line.constData() + offset, colon - offset);
+    echo.content = QString::fromUtf8(line.constData() + colon + 2, line.length() - colon - 2);
+    echo.sent = now();
+    if (!echo.target.contains(QLatin1Char(',')) && !echo.content.startsWith(QLatin1Char('\1'))) {
+        if (echoes.count() >= MAX_PENDING)
+            echoes.dequeue();
+        echoes.enqueue(echo);
+    }
+}
+
 bool IrcLagTimerPrivate::processPongReply(IrcPongMessage* msg)
 {
 #if QT_VERSION >= 0x040700
     // TODO: configurable format?
-    if (msg->argument().startsWith("communi/")) {
+    const QString token = msg->argument();
+    if (token.startsWith("communi/")) {
+        const qint64 sent = pings.value(token, -1);
+        if (sent != -1) {
+            pings.remove(token);
+            addSample(now() - sent);
+            return true;
+        }
+        // not sent by us since the last reconnect, fall back to the wall clock
         bool ok = false;
-        qint64 timestamp = msg->argument().mid(8).toLongLong(&ok);
+        qint64 timestamp = token.mid(8).toLongLong(&ok);
         if (ok) {
-            updateLag(QDateTime::currentMSecsSinceEpoch() - timestamp);
+            addSample((QDateTime::currentMSecsSinceEpoch() - timestamp) * 1000);
             return true;
         }
     }
@@ -85,6 +254,18 @@ bool IrcLagTimerPrivate::processPongReply(IrcPongMessage* msg)
     return false;
 }
 
+void IrcLagTimerPrivate::processEcho(const QString& target, const QString& content)
+{
+    // skip commands that were lost or not echoed
+    while (!echoes.isEmpty()) {
+        const IrcEchoedCommand echo = echoes.dequeue();
+        if (echo.content == content && !echo.target.compare(target, Qt::CaseInsensitive)) {
+            addSample(now() - echo.sent);
+            break;
+        }
+    }
+}
+
 void IrcLagTimerPrivate::_irc_connected()
 {
 #if QT_VERSION >= 0x040700
@@ -96,9 +277,16 @@ void IrcLagTimerPrivate::_irc_connected()
 void IrcLagTimerPrivate::_irc_pingServer()
 {
 #if QT_VERSION >= 0x040700
+    // existing traffic was measured recently enough
+    if (passive && measured != -1 && now() - measured < interval * Q_INT64_C(1000000))
+        return;
+
     // TODO: configurable format?
-    QString cmd = QString("PING communi/%1").arg(QDateTime::currentMSecsSinceEpoch());
-    connection->sendData(cmd.toUtf8());
+    const QString token = QString("communi/%1").arg(QDateTime::currentMSecsSinceEpoch());
+    if (pings.count() >= MAX_PENDING)
+        pings.clear();
+    pings.insert(token, now());
+    connection->sendData("PING " + token.toUtf8());
 #endif // QT_VERSION
 }
 
@@ -106,6 +294,8 @@ void IrcLagTimerPrivate::_irc_disconnected()
 {
 #if QT_VERSION >= 0x040700
     updateLag(-1);
+    pings.clear();
+    echoes.clear();
     if (timer.isActive())
         timer.stop();
 #endif // QT_VERSION
@@ -134,6 +324,25 @@ void IrcLagTimerPrivate::updateLag(qint64 value)
         emit q->lagChanged(lag);
     }
 }
+
+void IrcLagTimerPrivate::addSample(qint64 usecs)
+{
+    Q_Q(IrcLagTimer);
+    last = qMax(Q_INT64_C(0), usecs);
+    measured = now();
+    histogram.add(last);
+    updateLag(last / 1000);
+    emit q->statisticsChanged(q->statistics());
+}
+
+qint64 IrcLagTimerPrivate::now() const
+{
+#if QT_VERSION >= 0x040800
+    return clock.nsecsElapsed() / 1000;
+#else
+    return clock.elapsed() * 1000;
+#endif // QT_VERSION
+}
 #endif // IRC_DOXYGEN
 
 /*!
@@ -155,6 +364,9 @@ IrcLagTimer::IrcLagTimer(QObject* parent) : QObject(parent), d_ptr(new IrcLagTim
  */
 IrcLagTimer::~IrcLagTimer()
 {
+    Q_D(IrcLagTimer);
+    if (d->connection)
+        IrcConnectionPrivate::get(d->connection)->writeObservers.removeAll(d);
 }
 
 /*!
@@ -176,15 +388,21 @@ void IrcLagTimer::setConnection(IrcConnection* connection)
     if (d->connection != connection) {
         if (d->connection) {
             d->connection->removeMessageFilter(d);
+            IrcConnectionPrivate::get(d->connection)->writeObservers.removeAll(d);
             disconnect(d->connection, SIGNAL(connected()), this, SLOT(_irc_connected()));
             disconnect(d->connection, SIGNAL(disconnected()), this, SLOT(_irc_disconnected()));
         }
         d->connection = connection;
         if (connection) {
-            connection->installMessageFilter(d);
+            connection->installMessageFilter(d, QList<IrcMessage::Type>() << IrcMessage::Pong
+                                                                       << IrcMessage::Private
+                                                                       << IrcMessage::Notice);
+            IrcConnectionPrivate::get(connection)->writeObservers += d;
             connect(connection, SIGNAL(connected()), this, SLOT(_irc_connected()));
             connect(connection, SIGNAL(disconnected()), this, SLOT(_irc_disconnected()));
         }
+        d->pings.clear();
+        d->echoes.clear();
         d->updateLag(-1);
         d->updateTimer();
     }
@@ -236,6 +454,120 @@ void IrcLagTimer::setInterval(int seconds)
     }
 }
 
+/*!
+    \since 3.6
+
+    This property holds the amount of measurements in the \ref statistics.
+
+    The statistics are calculated over a rolling window of the most recent
+    round-trip time measurements. The default value is \c 128.
+
+    \par Access functions:
+    \li int <b>window</b>() const
+    \li void <b>setWindow</b>(int samples)
+ */
+int IrcLagTimer::window() const
+{
+    Q_D(const IrcLagTimer);
+    return d->histogram.window();
+}
+
+void IrcLagTimer::setWindow(int samples)
+{
+    Q_D(IrcLagTimer);
+    d->histogram.setWindow(samples);
+}
+
+/*!
+    \since 3.6
+
+    This property holds whether the lag is measured passively.
+
+    When enabled, the round-trip time of messages and notices echoed back
+    by the server is measured, provided that the \c echo-message capability
+    is enabled. The time is measured from when the line is written to the
+    socket, so time spent in IrcCommandQueue is not counted. The periodic
+    \c PING is skipped when a measurement has been made during the last
+    \ref interval.
+
+    The default value is \c false.
+
+    \par Access functions:
+    \li bool <b>isPassive</b>() const
+    \li void <b>setPassive</b>(bool passive)
+ */
+bool IrcLagTimer::isPassive() const
+{
+    Q_D(const IrcLagTimer);
+    return d->passive;
+}
+
+void IrcLagTimer::setPassive(bool passive)
+{
+    Q_D(IrcLagTimer);
+    if (d->passive != passive) {
+        d->passive = passive;
+        d->echoes.clear();
+    }
+}
+
+/*!
+    \since 3.6
+
+    This property holds the round-trip time statistics.
+
+    The times are in milliseconds with microsecond resolution, calculated
+    over the last \ref window measurements. The map contains the following keys:
+    \li \c "samples" - the amount of measurements
+    \li \c "last" - the most recent round-trip time
+    \li \c "min" - the minimum round-trip time
+    \li \c "p50" - the median round-trip time
+    \li \c "p90" - the 90th percentile round-trip time
+    \li \c "p99" - the 99th percentile round-trip time
+    \li \c "max" - the maximum round-trip time
+
+    The percentiles are accurate to about 6%.
+
+    \par Access function:
+    \li QVariantMap <b>statistics</b>() const
+
+    \par Notifier signal:
+    \li void <b>statisticsChanged</b>(const QVariantMap& statistics)
+
+    \sa resetStatistics()
+ */
+QVariantMap IrcLagTimer::statistics() const
+{
+    Q_D(const IrcLagTimer);
+    const IrcLatencyHistogram& h = d->histogram;
+    QVariantMap stats;
+    stats.insert(QLatin1String("samples"), h.count());
+    if (h.count() > 0) {
+        stats.insert(QLatin1String("last"), d->last / 1000.0);
+        stats.insert(QLatin1String("min"), h.minimum() / 1000.0);
+        stats.insert(QLatin1String("p50"), h.percentile(50) / 1000.0);
+        stats.insert(QLatin1String("p90"), h.percentile(90) / 1000.0);
+        stats.insert(QLatin1String("p99"), h.percentile(99) / 1000.0);
+        stats.insert(QLatin1String("max"), h.maximum() / 1000.0);
+    }
+    return stats;
+}
+
+/*!
+    \since 3.6
+
+    Resets the round-trip time statistics.
+
+    \sa statistics
+ */
+void IrcLagTimer::resetStatistics()
+{
+    Q_D(IrcLagTimer);
+    d->histogram.clear();
+    d->last = -1;
+    emit statisticsChanged(statistics());
+}
+
 #include "moc_irclagtimer.cpp"
 #include "moc_irclagtimer_p.cpp"
 
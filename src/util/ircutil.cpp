@@ -52,6 +52,7 @@ namespace IrcUtil {
     {
         qRegisterMetaType<IrcCommandParser*>("IrcCommandParser*");
         qRegisterMetaType<IrcCompleter*>("IrcCompleter*");
+        qRegisterMetaType<IrcConnectionPool*>("IrcConnectionPool*");
         qRegisterMetaType<IrcLagTimer*>("IrcLagTimer*");
         qRegisterMetaType<IrcPalette*>("IrcPalette*");
         qRegisterMetaType<IrcTextFormat*>("IrcTextFormat*");
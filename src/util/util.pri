@@ -12,6 +12,7 @@ INCLUDEPATH += $$PWD $$INCDIR
 CONV_HEADERS  = $$INCDIR/IrcCommandParser
 CONV_HEADERS += $$INCDIR/IrcCommandQueue
 CONV_HEADERS += $$INCDIR/IrcCompleter
+CONV_HEADERS += $$INCDIR/IrcConnectionPool
 CONV_HEADERS += $$INCDIR/IrcLagTimer
 CONV_HEADERS += $$INCDIR/IrcPalette
 CONV_HEADERS += $$INCDIR/IrcTextFormat
@@ -20,6 +21,7 @@ CONV_HEADERS += $$INCDIR/IrcUtil
 PUB_HEADERS  = $$INCDIR/irccommandparser.h
 PUB_HEADERS += $$INCDIR/irccommandqueue.h
 PUB_HEADERS += $$INCDIR/irccompleter.h
+PUB_HEADERS += $$INCDIR/ircconnectionpool.h
 PUB_HEADERS += $$INCDIR/irclagtimer.h
 PUB_HEADERS += $$INCDIR/ircpalette.h
 PUB_HEADERS += $$INCDIR/irctextformat.h
@@ -27,6 +29,7 @@ PUB_HEADERS += $$INCDIR/ircutil.h
 
 PRIV_HEADERS  = $$INCDIR/irccommandparser_p.h
 PRIV_HEADERS += $$INCDIR/irccommandqueue_p.h
+PRIV_HEADERS += $$INCDIR/ircconnectionpool_p.h
 PRIV_HEADERS += $$INCDIR/irclagtimer_p.h
 PRIV_HEADERS += $$INCDIR/irctoken_p.h
 
@@ -36,6 +39,7 @@ HEADERS += $$PRIV_HEADERS
 SOURCES += $$PWD/irccommandparser.cpp
 SOURCES += $$PWD/irccommandqueue.cpp
 SOURCES += $$PWD/irccompleter.cpp
+SOURCES += $$PWD/ircconnectionpool.cpp
 SOURCES += $$PWD/irclagtimer.cpp
 SOURCES += $$PWD/ircpalette.cpp
 SOURCES += $$PWD/irctextformat.cpp
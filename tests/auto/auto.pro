@@ -7,9 +7,11 @@ TEMPLATE = subdirs
 # IrcCore
 SUBDIRS += irc
 SUBDIRS += ircconnection
+SUBDIRS += ircdebug
 SUBDIRS += irccommand
 SUBDIRS += ircmessage
 SUBDIRS += ircnetwork
+SUBDIRS += ircreplaysocket
 
 # IrcModel
 SUBDIRS += ircbuffer
@@ -22,6 +24,7 @@ SUBDIRS += ircusermodel
 SUBDIRS += irccommandparser
 SUBDIRS += irccommandqueue
 SUBDIRS += irccompleter
+SUBDIRS += ircconnectionpool
 SUBDIRS += irclagtimer
 SUBDIRS += ircpalette
 SUBDIRS += irctextformat
@@ -96,6 +96,7 @@ void tst_Irc::testMetaTypes()
     QVERIFY(qMetaTypeId<Irc*>());
     QVERIFY(qMetaTypeId<IrcConnection*>());
     QVERIFY(qMetaTypeId<IrcCommand*>());
+    QVERIFY(qMetaTypeId<IrcCommandValue>());
     QVERIFY(qMetaTypeId<IrcMessage*>());
     QVERIFY(qMetaTypeId<IrcNetwork*>());
 
@@ -13,6 +13,8 @@
 #include "irccommand.h"
 #include "ircbuffer.h"
 #include "ircfilter.h"
+#include "ircuser.h"
+#include "ircusermodel.h"
 #include <QtTest/QtTest>
 #include "tst_ircclientserver.h"
 #include "tst_ircdata.h"
@@ -39,6 +41,9 @@ private slots:
     void testQML();
     void testWarnings();
     void testMonitor();
+    void testRejoin();
+    void testSnapshot();
+    void testFindUsers();
 };
 
 Q_DECLARE_METATYPE(QModelIndex)
@@ -1512,6 +1517,242 @@ void tst_IrcBufferModel::testMonitor()
     QVERIFY(filter.commands.isEmpty());
 }
 
+static QStringList joinCommands(const QStringList& commands)
+{
+    QStringList joins;
+    foreach (const QString& command, commands) {
+        if (command.startsWith("JOIN "))
+            joins += command;
+    }
+    return joins;
+}
+
+static QByteArray joinReplies(const QString& command)
+{
+    QByteArray replies;
+    foreach (const QString& channel, command.section(" ", 1, 1).split(","))
+        replies += ":communi!communi@hidd.en JOIN :" + channel.toUtf8() + "\r\n";
+    return replies;
+}
+
+void tst_IrcBufferModel::testRejoin()
+{
+    TestCommandFilter filter(connection);
+
+    IrcBufferModel model(connection);
+    model.setMonitorEnabled(true);
+
+    connection->open();
+    QVERIFY(waitForOpened());
+    QVERIFY(waitForWritten(tst_IrcData::welcome("freenode")));
+
+    QStringList channels;
+    QByteArray joins;
+    for (int i = 0; i < 100; ++i) {
+        channels += QString("#channel-with-a-rather-long-name-%1").arg(i);
+        joins += ":communi!communi@hidd.en JOIN :" + channels.last().toUtf8() + "\r\n";
+    }
+    serverSocket->write(joins);
+    QVERIFY(serverSocket->waitForBytesWritten(1000));
+    QTRY_COMPARE(model.channels().count(), channels.count());
+
+    model.add("jpnurmi");
+    model.add("jipsu");
+    model.add("jirssi");
+
+    // reconnect
+    connection->close();
+    connection->open();
+    QVERIFY(waitForOpened());
+    filter.commands.clear();
+    QVERIFY(waitForWritten(tst_IrcData::welcome("freenode")));
+
+    // MONITOR is restored in bulk
+    QTRY_VERIFY(filter.commands.contains("MONITOR + jpnurmi,jipsu,jirssi"));
+    QCOMPARE(filter.commands.filter("MONITOR +").count(), 1);
+
+    // only a window of commands is sent before the server replies
+    QTRY_COMPARE(joinCommands(filter.commands).count(), 2);
+    QTest::qWait(100);
+    QCOMPARE(joinCommands(filter.commands).count(), 2);
+
+    // the server asks to slow down: the oldest command is retried later
+    QVERIFY(waitForWritten(":moorcock.freenode.net 263 communi JOIN :This command could not be completed because it has been used recently, and is rate-limited"));
+
+    int answered = 1;
+    QElapsedTimer timer;
+    timer.start();
+    while (model.statistics().value("restoreTime").toInt() == -1 && timer.elapsed() < 10000) {
+        QTest::qWait(20);
+        const QStringList commands = joinCommands(filter.commands);
+        while (answered < commands.count()) {
+            serverSocket->write(joinReplies(commands.at(answered++)));
+            QVERIFY(serverSocket->waitForBytesWritten(1000));
+        }
+    }
+
+    const QVariantMap stats = model.statistics();
+    QVERIFY(stats.value("restoreTime").toInt() >= 0);
+    QCOMPARE(stats.value("joinedChannels").toInt(), channels.count());
+    QCOMPARE(stats.value("failedChannels").toInt(), 0);
+    QCOMPARE(stats.value("throttles").toInt(), 1);
+
+    // channels are packed into as few commands as possible within 512 bytes
+    const QStringList commands = joinCommands(filter.commands);
+    QCOMPARE(stats.value("joinCommands").toInt(), commands.count());
+    QVERIFY(commands.count() < channels.count() / 10);
+    QSet<QString> joined;
+    foreach (const QString& command, commands) {
+        QVERIFY(command.toUtf8().length() + 2 <= 512);
+        joined += command.section(" ", 1, 1).split(",").toSet();
+    }
+    QCOMPARE(joined, channels.toSet());
+
+    model.resetStatistics();
+    QCOMPARE(model.statistics().value("restoreTime").toInt(), -1);
+    QCOMPARE(model.statistics().value("joinCommands").toInt(), 0);
+}
+
+void tst_IrcBufferModel::testSnapshot()
+{
+    IrcBufferModel model(connection);
+
+    connection->open();
+    QVERIFY(waitForOpened());
+    QVERIFY(waitForWritten(tst_IrcData::welcome("freenode")));
+
+    QVERIFY(waitForWritten(":communi!communi@hidd.en JOIN :#communi"));
+    QVERIFY(waitForWritten(":moorcock.freenode.net 332 communi #communi :Communi topic"));
+    QVERIFY(waitForWritten(":moorcock.freenode.net 353 communi = #communi :communi @jpnurmi +jipsu"));
+    QVERIFY(waitForWritten(":moorcock.freenode.net 366 communi #communi :End of /NAMES list."));
+    QVERIFY(waitForWritten(":jpnurmi!jpnurmi@hidd.en MODE #communi +k secret"));
+
+    IrcChannel* channel = model.find("#communi")->toChannel();
+    QVERIFY(channel);
+    QCOMPARE(channel->topic(), QString("Communi topic"));
+    QCOMPARE(channel->key(), QString("secret"));
+
+    IrcBuffer* query = model.add("jpnurmi");
+    query->setSticky(true);
+    QVariantMap userData;
+    userData.insert("foo", "bar");
+    query->setUserData(userData);
+
+    const QByteArray state = model.saveState(1);
+    const QByteArray snapshot = model.saveSnapshot(1, true);
+    QVERIFY(snapshot.size() < state.size());
+
+    IrcConnection another;
+    IrcBufferModel restored(&another);
+    QVERIFY(!restored.restoreState(snapshot, 2));
+    QVERIFY(!restored.restoreState(snapshot.left(snapshot.size() / 2), 1));
+    QVERIFY(restored.restoreState(snapshot, 1));
+
+    // the same state, regardless of the format
+    QCOMPARE(restored.saveState(1), state);
+    QCOMPARE(restored.saveSnapshot(1, true), snapshot);
+
+    // the old format is still accepted
+    IrcBufferModel legacy(&another);
+    QVERIFY(legacy.restoreState(state, 1));
+    QCOMPARE(legacy.saveState(1), state);
+
+    IrcChannel* restoredChannel = restored.add("#communi")->toChannel();
+    QVERIFY(restoredChannel);
+    QVERIFY(!restoredChannel->isActive());
+    QCOMPARE(restoredChannel->topic(), QString("Communi topic"));
+    QCOMPARE(restoredChannel->key(), QString("secret"));
+
+    IrcUserModel users(restoredChannel);
+    QCOMPARE(users.count(), 3);
+    QVERIFY(users.find("jpnurmi"));
+    QCOMPARE(users.find("jpnurmi")->prefix(), QString("@"));
+
+    IrcBuffer* restoredQuery = restored.add("jpnurmi");
+    QVERIFY(restoredQuery->isSticky());
+    QCOMPARE(restoredQuery->userData(), userData);
+}
+
+static QStringList channelUsers(const QList<IrcUser*>& users)
+{
+    QStringList list;
+    foreach (IrcUser* user, users)
+        list += user->channel()->title() + "/" + user->name();
+    list.sort();
+    return list;
+}
+
+void tst_IrcBufferModel::testFindUsers()
+{
+    IrcBufferModel model(connection);
+
+    connection->open();
+    QVERIFY(waitForOpened());
+    QVERIFY(waitForWritten(tst_IrcData::welcome("freenode")));
+
+    QVERIFY(waitForWritten(":communi!communi@hidd.en JOIN :#communi"));
+    QVERIFY(waitForWritten(":moorcock.freenode.net 353 communi = #communi :communi @jpnurmi +jipsu qtbot"));
+    QVERIFY(waitForWritten(":moorcock.freenode.net 366 communi #communi :End of /NAMES list."));
+    QVERIFY(waitForWritten(":communi!communi@hidd.en JOIN :#qt"));
+    QVERIFY(waitForWritten(":moorcock.freenode.net 353 communi = #qt :communi jpnurmi Guest1234"));
+    QVERIFY(waitForWritten(":moorcock.freenode.net 366 communi #qt :End of /NAMES list."));
+
+    QVERIFY(model.findUsers(QString()).isEmpty());
+    QVERIFY(model.findUsers("nobody").isEmpty());
+    QCOMPARE(channelUsers(model.findUsers("jpn")), QStringList() << "#communi/jpnurmi" << "#qt/jpnurmi");
+    QCOMPARE(channelUsers(model.findUsers("JP")), QStringList() << "#communi/jpnurmi" << "#qt/jpnurmi");
+    QCOMPARE(channelUsers(model.findUsers("*bot")), QStringList() << "#communi/qtbot");
+    QCOMPARE(channelUsers(model.findUsers("q?bot")), QStringList() << "#communi/qtbot");
+    QCOMPARE(model.findUsers("*u*").count(), 6);
+
+    // join
+    QVERIFY(waitForWritten(":ChanBot!~bot@bots.example.com JOIN :#qt"));
+    QCOMPARE(channelUsers(model.findUsers("*bot*")), QStringList() << "#communi/qtbot" << "#qt/ChanBot");
+    QCOMPARE(channelUsers(model.findUsers("*@*.EXAMPLE.com")), QStringList() << "#qt/ChanBot");
+    QCOMPARE(channelUsers(model.findUsers("!~bot@")), QStringList() << "#qt/ChanBot");
+
+    // nick
+    QVERIFY(waitForWritten(":ChanBot!~bot@bots.example.com NICK :ChanHelper"));
+    QCOMPARE(channelUsers(model.findUsers("*bot*")), QStringList() << "#communi/qtbot");
+    QCOMPARE(channelUsers(model.findUsers("chanhelper!*")), QStringList() << "#qt/ChanHelper");
+
+    // part
+    QVERIFY(waitForWritten(":jpnurmi!jpnurmi@hidd.en PART #qt"));
+    QCOMPARE(channelUsers(model.findUsers("jpnurmi")), QStringList() << "#communi/jpnurmi");
+
+    // quit
+    QVERIFY(waitForWritten(":qtbot!qtbot@hidd.en QUIT :bye"));
+    QVERIFY(model.findUsers("*bot").isEmpty());
+
+    // who
+    QVERIFY(model.findUsers("*@jipsu.example.com").isEmpty());
+    QVERIFY(waitForWritten(":moorcock.freenode.net 352 communi #communi ~jipsu jipsu.example.com moorcock.freenode.net jipsu H+ :0 J-P Nurmi"));
+    QCOMPARE(channelUsers(model.findUsers("*@jipsu.example.com")), QStringList() << "#communi/jipsu");
+
+    // names refresh
+    QVERIFY(waitForWritten(":moorcock.freenode.net 353 communi = #communi :communi @jpnurmi +jipsu"));
+    QVERIFY(waitForWritten(":moorcock.freenode.net 366 communi #communi :End of /NAMES list."));
+    QCOMPARE(channelUsers(model.findUsers("*@jipsu.example.com")), QStringList() << "#communi/jipsu");
+
+    // rfc1459 case mapping
+    QVERIFY(waitForWritten(":[foo]!foo@hidd.en JOIN :#communi"));
+    QCOMPARE(channelUsers(model.findUsers("{FOO}")), QStringList() << "#communi/[foo]");
+    QCOMPARE(channelUsers(model.findUsers("{foo}!*@hidd.en")), QStringList() << "#communi/[foo]");
+
+    // ascii case mapping
+    QVERIFY(waitForWritten(":moorcock.freenode.net 005 communi CASEMAPPING=ascii :are supported by this server"));
+    QVERIFY(model.findUsers("{foo}").isEmpty());
+    QCOMPARE(channelUsers(model.findUsers("[FOO]")), QStringList() << "#communi/[foo]");
+    QCOMPARE(channelUsers(model.findUsers("[foo]!*@hidd.en")), QStringList() << "#communi/[foo]");
+    QCOMPARE(channelUsers(model.findUsers("*@jipsu.example.com")), QStringList() << "#communi/jipsu");
+
+    // own part
+    QVERIFY(waitForWritten(":communi!communi@hidd.en PART #qt"));
+    QVERIFY(model.findUsers("Guest").isEmpty());
+    QVERIFY(model.findUsers("ChanHelper").isEmpty());
+    QCOMPARE(channelUsers(model.findUsers("communi")), QStringList() << "#communi/communi");
+}
+
 QTEST_MAIN(tst_IrcBufferModel)
 
 #include "tst_ircbuffermodel.moc"
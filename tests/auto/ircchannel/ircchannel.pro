@@ -4,4 +4,5 @@
 
 SOURCES += tst_ircchannel.cpp
 
+include(../shared/shared.pri)
 include(../auto.pri)
@@ -8,10 +8,15 @@
  */
 
 #include "ircchannel.h"
+#include "ircbuffermodel.h"
+#include "ircconnection.h"
+#include "ircuser.h"
 #include <QtTest/QtTest>
 #include <QtCore/QRegExp>
+#include "tst_ircclientserver.h"
+#include "tst_ircdata.h"
 
-class tst_IrcChannel : public QObject
+class tst_IrcChannel : public tst_IrcClientServer
 {
     Q_OBJECT
 
@@ -19,8 +24,24 @@ private slots:
     void testDefaults();
     void testSignals();
     void testDebug();
+    void testMasks();
 };
 
+static QStringList userNames(const QList<IrcUser*>& users)
+{
+    QStringList names;
+    foreach (IrcUser* user, users)
+        names += user->name();
+    names.sort();
+    return names;
+}
+
+static QStringList sorted(QStringList list)
+{
+    list.sort();
+    return list;
+}
+
 void tst_IrcChannel::testDefaults()
 {
     IrcChannel channel;
@@ -37,6 +58,9 @@ void tst_IrcChannel::testDefaults()
     QVERIFY(!channel.isPersistent());
     QVERIFY(channel.mode().isEmpty());
     QVERIFY(channel.topic().isEmpty());
+    QVERIFY(channel.masks().isEmpty());
+    QVERIFY(channel.matchingMasks("nick!ident@host").isEmpty());
+    QVERIFY(channel.matchingUsers("*!*@*").isEmpty());
 }
 
 void tst_IrcChannel::testSignals()
@@ -44,8 +68,10 @@ void tst_IrcChannel::testSignals()
     IrcChannel channel;
     QSignalSpy modeSpy(&channel, SIGNAL(modeChanged(QString)));
     QSignalSpy topicSpy(&channel, SIGNAL(topicChanged(QString)));
+    QSignalSpy masksSpy(&channel, SIGNAL(masksChanged(QString,QStringList)));
     QVERIFY(modeSpy.isValid());
     QVERIFY(topicSpy.isValid());
+    QVERIFY(masksSpy.isValid());
 }
 
 void tst_IrcChannel::testDebug()
@@ -74,6 +100,92 @@ void tst_IrcChannel::testDebug()
     str.clear();
 }
 
+void tst_IrcChannel::testMasks()
+{
+    IrcBufferModel model(connection);
+
+    connection->open();
+    QVERIFY(waitForOpened());
+    QVERIFY(waitForWritten(tst_IrcData::welcome("freenode")));
+
+    QVERIFY(waitForWritten(":communi!communi@hidd.en JOIN :#communi"));
+    QVERIFY(waitForWritten(":moorcock.freenode.net 353 communi = #communi :communi @jpnurmi +jipsu"));
+    QVERIFY(waitForWritten(":moorcock.freenode.net 366 communi #communi :End of /NAMES list."));
+
+    IrcChannel* channel = model.find("#communi")->toChannel();
+    QVERIFY(channel);
+
+    QSignalSpy modeSpy(channel, SIGNAL(modeChanged(QString)));
+    QSignalSpy masksSpy(channel, SIGNAL(masksChanged(QString,QStringList)));
+    QVERIFY(modeSpy.isValid());
+    QVERIFY(masksSpy.isValid());
+
+    // ban list reply
+    QVERIFY(waitForWritten(":moorcock.freenode.net 367 communi #communi *!*@spam.example.com jpnurmi!jpnurmi@hidd.en 1400000000"));
+    QVERIFY(waitForWritten(":moorcock.freenode.net 367 communi #communi Troll[1]*!*@* jpnurmi!jpnurmi@hidd.en 1400000000"));
+    QVERIFY(channel->masks().isEmpty());
+    QVERIFY(waitForWritten(":moorcock.freenode.net 368 communi #communi :End of Channel Ban List"));
+    QCOMPARE(channel->masks(), QStringList() << "*!*@spam.example.com" << "Troll[1]*!*@*");
+    QCOMPARE(masksSpy.count(), 1);
+    QCOMPARE(masksSpy.last().at(0).toString(), QString("b"));
+    QCOMPARE(masksSpy.last().at(1).toStringList(), channel->masks());
+    QVERIFY(channel->masks("e").isEmpty());
+
+    // the same list again
+    QVERIFY(waitForWritten(":moorcock.freenode.net 367 communi #communi *!*@spam.example.com jpnurmi!jpnurmi@hidd.en 1400000000"));
+    QVERIFY(waitForWritten(":moorcock.freenode.net 367 communi #communi Troll[1]*!*@* jpnurmi!jpnurmi@hidd.en 1400000000"));
+    QVERIFY(waitForWritten(":moorcock.freenode.net 368 communi #communi :End of Channel Ban List"));
+    QCOMPARE(masksSpy.count(), 1);
+
+    // exception list reply
+    QVERIFY(waitForWritten(":moorcock.freenode.net 348 communi #communi *!*@trusted.example.com jpnurmi!jpnurmi@hidd.en 1400000000"));
+    QVERIFY(waitForWritten(":moorcock.freenode.net 349 communi #communi :End of Channel Exception List"));
+    QCOMPARE(channel->masks("e"), QStringList() << "*!*@trusted.example.com");
+    QCOMPARE(masksSpy.count(), 2);
+    QCOMPARE(masksSpy.last().at(0).toString(), QString("e"));
+
+    // list modes
+    QVERIFY(waitForWritten(":jpnurmi!jpnurmi@hidd.en MODE #communi +bk *!~evil@* secret"));
+    QCOMPARE(channel->masks(), QStringList() << "*!*@spam.example.com" << "Troll[1]*!*@*" << "*!~evil@*");
+    QCOMPARE(channel->key(), QString("secret"));
+    QCOMPARE(channel->mode(), QString("+k secret"));
+    QCOMPARE(masksSpy.count(), 3);
+    QCOMPARE(modeSpy.count(), 1);
+
+    QVERIFY(waitForWritten(":jpnurmi!jpnurmi@hidd.en MODE #communi -bk *!*@SPAM.example.com secret"));
+    QCOMPARE(channel->masks(), QStringList() << "Troll[1]*!*@*" << "*!~evil@*");
+    QVERIFY(channel->key().isEmpty());
+    QVERIFY(channel->mode().isEmpty());
+    QCOMPARE(masksSpy.count(), 4);
+    QCOMPARE(modeSpy.count(), 2);
+
+    QVERIFY(waitForWritten(":jpnurmi!jpnurmi@hidd.en MODE #communi -b *!*@unknown.example.com"));
+    QCOMPARE(masksSpy.count(), 4);
+
+    // matching masks
+    QCOMPARE(channel->matchingMasks("evil!~evil@evil.example.com"), QStringList() << "*!~evil@*");
+    QVERIFY(channel->matchingMasks("nice!~nice@nice.example.com").isEmpty());
+    QCOMPARE(channel->matchingMasks("troll{1}abc!troll@troll.example.com"), QStringList() << "Troll[1]*!*@*");
+    QCOMPARE(channel->matchingMasks("Spam!spam@trusted.example.com", "e"), QStringList() << "*!*@trusted.example.com");
+    QVERIFY(channel->matchingMasks("Spam!spam@trusted.example.com", "I").isEmpty());
+
+    // matching users, once their hosts are known
+    QVERIFY(waitForWritten(":Troll{1}!~troll@troll.example.com JOIN :#communi"));
+    QVERIFY(waitForWritten(":Evil!~evil@evil.example.com JOIN :#communi"));
+    QCOMPARE(userNames(channel->matchingUsers("*!*@*.example.com")), QStringList() << "Evil" << "Troll{1}");
+    QCOMPARE(userNames(channel->matchingUsers("troll[1]")), QStringList() << "Troll{1}");
+    QVERIFY(channel->matchingUsers("*@jipsu.example.com").isEmpty());
+    QVERIFY(waitForWritten(":moorcock.freenode.net 352 communi #communi ~jipsu jipsu.example.com moorcock.freenode.net jipsu H+ :0 J-P Nurmi"));
+    QCOMPARE(userNames(channel->matchingUsers("*@jipsu.example.com")), QStringList() << "jipsu");
+
+    IrcUser* troll = channel->matchingUsers("Troll{1}").value(0);
+    QVERIFY(troll);
+    QCOMPARE(channel->matchingMasks(troll), QStringList() << "Troll[1]*!*@*");
+
+    QVERIFY(waitForWritten(":jpnurmi!jpnurmi@hidd.en MODE #communi +b *!*@*.example.com"));
+    QCOMPARE(sorted(channel->matchingMasks(troll)), sorted(QStringList() << "Troll[1]*!*@*" << "*!*@*.example.com"));
+}
+
 QTEST_MAIN(tst_IrcChannel)
 
 #include "tst_ircchannel.moc"
@@ -8,6 +8,7 @@
  */
 
 #include "irccommand.h"
+#include "irccommand_p.h"
 #include "ircmessage.h"
 #include "ircconnection.h"
 #include <QtTest/QtTest>
@@ -27,6 +28,12 @@ private slots:
 
     void testConversion();
 
+    void testSerialize_data();
+    void testSerialize();
+
+    void testValue_data();
+    void testValue();
+
     void testConnection();
 
     void testAdmin();
@@ -124,6 +131,117 @@ void tst_IrcCommand::testConversion()
     QCOMPARE(msg->property("content").toString(), QString("foo bar"));
 }
 
+void tst_IrcCommand::testSerialize_data()
+{
+    QTest::addColumn<IrcCommand*>("command");
+
+    const QString unicode = QString::fromUtf8("h\xc3\xa4ll\xc3\xb6 \xe2\x82\xac \xf0\x9f\x98\x80");
+
+    QTest::newRow("admin") << IrcCommand::createAdmin("server");
+    QTest::newRow("away") << IrcCommand::createAway("gone far away");
+    QTest::newRow("capability") << IrcCommand::createCapability("REQ", QStringList() << "sasl" << "multi-prefix");
+    QTest::newRow("action") << IrcCommand::createCtcpAction("#communi", unicode);
+    QTest::newRow("request") << IrcCommand::createCtcpRequest("nick", "TIME");
+    QTest::newRow("reply") << IrcCommand::createCtcpReply("nick", "TIME now");
+    QTest::newRow("info") << IrcCommand::createInfo("server");
+    QTest::newRow("invite") << IrcCommand::createInvite("nick", "#communi");
+    QTest::newRow("join") << IrcCommand::createJoin("#communi");
+    QTest::newRow("join key") << IrcCommand::createJoin("#communi", "key");
+    QTest::newRow("kick") << IrcCommand::createKick("#communi", "nick");
+    QTest::newRow("kick reason") << IrcCommand::createKick("#communi", "nick", "go away");
+    QTest::newRow("knock") << IrcCommand::createKnock("#communi", "let me in");
+    QTest::newRow("list") << IrcCommand::createList(QStringList() << "#communi", "server");
+    QTest::newRow("message") << IrcCommand::createMessage("#communi", unicode);
+    QTest::newRow("mode") << IrcCommand::createMode("#communi", "+o", "nick");
+    QTest::newRow("monitor") << IrcCommand::createMonitor("+", "nick");
+    QTest::newRow("motd") << IrcCommand::createMotd();
+    QTest::newRow("names") << IrcCommand::createNames("#communi");
+    QTest::newRow("nick") << IrcCommand::createNick("nick");
+    QTest::newRow("notice") << IrcCommand::createNotice("nick", "hello");
+    QTest::newRow("part") << IrcCommand::createPart("#communi");
+    QTest::newRow("part reason") << IrcCommand::createPart("#communi", unicode);
+    QTest::newRow("ping") << IrcCommand::createPing("1234");
+    QTest::newRow("pong") << IrcCommand::createPong("1234");
+    QTest::newRow("quit") << IrcCommand::createQuit("bye");
+    QTest::newRow("quote") << IrcCommand::createQuote(QStringList() << "FOO" << "bar" << ":baz");
+    QTest::newRow("stats") << IrcCommand::createStats("u", "server");
+    QTest::newRow("time") << IrcCommand::createTime();
+    QTest::newRow("topic") << IrcCommand::createTopic("#communi");
+    QTest::newRow("topic set") << IrcCommand::createTopic("#communi", unicode);
+    QTest::newRow("trace") << IrcCommand::createTrace("target");
+    QTest::newRow("users") << IrcCommand::createUsers("server");
+    QTest::newRow("version") << IrcCommand::createVersion();
+    QTest::newRow("version user") << IrcCommand::createVersion("nick");
+    QTest::newRow("who") << IrcCommand::createWho("nick");
+    QTest::newRow("whois") << IrcCommand::createWhois("nick");
+    QTest::newRow("whowas") << IrcCommand::createWhowas("nick");
+}
+
+void tst_IrcCommand::testSerialize()
+{
+    QFETCH(IrcCommand*, command);
+    QScopedPointer<IrcCommand> cmd(command);
+
+    QByteArray data;
+    QVERIFY(IrcCommandPrivate::get(cmd.data())->serialize(&data));
+    QCOMPARE(data, cmd->toString().toUtf8());
+
+    // the buffer is reused
+    QVERIFY(IrcCommandPrivate::get(cmd.data())->serialize(&data));
+    QCOMPARE(data, cmd->toString().toUtf8());
+
+    IrcCommand custom;
+    QVERIFY(!IrcCommandPrivate::get(&custom)->serialize(&data));
+}
+
+void tst_IrcCommand::testValue_data()
+{
+    QTest::addColumn<IrcCommandValue>("value");
+    QTest::addColumn<IrcCommand*>("command");
+
+    QTest::newRow("action") << IrcCommandValue::createCtcpAction("#communi", "waves") << IrcCommand::createCtcpAction("#communi", "waves");
+    QTest::newRow("join") << IrcCommandValue::createJoin("#communi") << IrcCommand::createJoin("#communi");
+    QTest::newRow("join key") << IrcCommandValue::createJoin("#communi", "key") << IrcCommand::createJoin("#communi", "key");
+    QTest::newRow("message") << IrcCommandValue::createMessage("#communi", "hello world") << IrcCommand::createMessage("#communi", "hello world");
+    QTest::newRow("mode") << IrcCommandValue::createMode("#communi") << IrcCommand::createMode("#communi");
+    QTest::newRow("mode arg") << IrcCommandValue::createMode("#communi", "+o", "nick") << IrcCommand::createMode("#communi", "+o", "nick");
+    QTest::newRow("nick") << IrcCommandValue::createNick("nick") << IrcCommand::createNick("nick");
+    QTest::newRow("notice") << IrcCommandValue::createNotice("nick", "hello") << IrcCommand::createNotice("nick", "hello");
+    QTest::newRow("part") << IrcCommandValue::createPart("#communi") << IrcCommand::createPart("#communi");
+    QTest::newRow("part reason") << IrcCommandValue::createPart("#communi", "bye") << IrcCommand::createPart("#communi", "bye");
+    QTest::newRow("ping") << IrcCommandValue::createPing("1234") << IrcCommand::createPing("1234");
+    QTest::newRow("pong") << IrcCommandValue::createPong("1234") << IrcCommand::createPong("1234");
+    QTest::newRow("quit") << IrcCommandValue::createQuit("bye") << IrcCommand::createQuit("bye");
+    QTest::newRow("generic") << IrcCommandValue(IrcCommand::Kick, "#communi", "nick", "reason") << IrcCommand::createKick("#communi", "nick", "reason");
+}
+
+void tst_IrcCommand::testValue()
+{
+    QFETCH(IrcCommandValue, value);
+    QFETCH(IrcCommand*, command);
+    QScopedPointer<IrcCommand> cmd(command);
+
+    QCOMPARE(value.type(), cmd->type());
+    QCOMPARE(value.parameters(), cmd->parameters());
+    QCOMPARE(value.count(), cmd->parameters().count());
+    QCOMPARE(value.encoding(), cmd->encoding());
+    QCOMPARE(value.toString(), cmd->toString());
+    QVERIFY(value.parameter(-1).isNull());
+    QVERIFY(value.parameter(value.count()).isNull());
+
+    QScopedPointer<IrcCommand> converted(value.toCommand());
+    QVERIFY(!converted->parent());
+    QCOMPARE(converted->type(), cmd->type());
+    QCOMPARE(converted->parameters(), cmd->parameters());
+    QCOMPARE(converted->toString(), cmd->toString());
+
+    IrcCommandValue copy = value;
+    copy.setEncoding("ISO-8859-15");
+    QCOMPARE(copy.encoding(), QByteArray("ISO-8859-15"));
+    QCOMPARE(copy.toString(), value.toString());
+    QCOMPARE(QScopedPointer<IrcCommand>(copy.toCommand())->encoding(), QByteArray("ISO-8859-15"));
+}
+
 void tst_IrcCommand::testConnection()
 {
     IrcConnection* connection = new IrcConnection(this);
@@ -29,6 +29,7 @@ private slots:
     void testTolerancy();
     void testCustom();
     void testWhitespace();
+    void testStatistics();
 };
 
 void tst_IrcCommandParser::testParse_data()
@@ -356,6 +357,18 @@ void tst_IrcCommandParser::testSyntax_data()
             << QString("FOO [param] <#chan> (<arg>) (<rest...>)")
             << uint(IrcCommandParser::Visual)
             << QString("FOO <chan> (<arg>) (<rest>)");
+
+    QTest::newRow("no targets")
+            << QString("foo")
+            << QString("FOO [param] <#chan> [other] (<rest...>)")
+            << uint(IrcCommandParser::NoTarget)
+            << QString("FOO <#chan> (<rest...>)");
+
+    QTest::newRow("unknown")
+            << QString("bar")
+            << QString("FOO [param] <#chan> (<arg>) (<rest...>)")
+            << uint(IrcCommandParser::Visual)
+            << QString();
 }
 
 void tst_IrcCommandParser::testSyntax()
@@ -437,6 +450,65 @@ void tst_IrcCommandParser::testWhitespace()
     delete cmd;
 }
 
+void tst_IrcCommandParser::testStatistics()
+{
+    IrcCommandParser parser;
+    parser.setTriggers(QStringList() << "!" << "bot:");
+    parser.setTarget("#communi");
+    parser.addCommand(IrcCommand::Join, "JOIN <#channel> (<key>)");
+    parser.addCommand(IrcCommand::CtcpAction, "ACT [target] <message...>");
+
+    QVariantMap stats = parser.statistics();
+    QCOMPARE(stats.value("hits").toInt(), 0);
+    QCOMPARE(stats.value("misses").toInt(), 0);
+    QCOMPARE(stats.value("parsed").toInt(), 0);
+
+    QVERIFY(!parser.parse("hello all"));
+    QVERIFY(!parser.parse("!hello all"));
+    QVERIFY(!parser.parse("bot: hello all"));
+    QVERIFY(!parser.parse(""));
+
+    stats = parser.statistics();
+    QCOMPARE(stats.value("hits").toInt(), 0);
+    QCOMPARE(stats.value("misses").toInt(), 4);
+    QCOMPARE(stats.value("parsed").toInt(), 0);
+
+    IrcCommand* cmd = parser.parse("!join #communi");
+    QVERIFY(cmd);
+    QCOMPARE(cmd->toString(), QString("JOIN #communi"));
+    delete cmd;
+
+    cmd = parser.parse("bot:  act waves");
+    QVERIFY(cmd);
+    QCOMPARE(cmd->type(), IrcCommand::CtcpAction);
+    delete cmd;
+
+    QVERIFY(!parser.parse("!just kidding"));
+
+    stats = parser.statistics();
+    QCOMPARE(stats.value("hits").toInt(), 3);
+    QCOMPARE(stats.value("misses").toInt(), 4);
+    QCOMPARE(stats.value("parsed").toInt(), 2);
+
+    parser.removeCommand(IrcCommand::Join);
+    QVERIFY(!parser.parse("!join #communi"));
+    QCOMPARE(parser.statistics().value("misses").toInt(), 5);
+
+    parser.resetStatistics();
+    stats = parser.statistics();
+    QCOMPARE(stats.value("hits").toInt(), 0);
+    QCOMPARE(stats.value("misses").toInt(), 0);
+    QCOMPARE(stats.value("parsed").toInt(), 0);
+
+    parser.setTolerant(true);
+    cmd = parser.parse("hello all");
+    QVERIFY(cmd);
+    QCOMPARE(cmd->type(), IrcCommand::Message);
+    delete cmd;
+    QCOMPARE(parser.statistics().value("hits").toInt(), 1);
+    QCOMPARE(parser.statistics().value("parsed").toInt(), 1);
+}
+
 QTEST_MAIN(tst_IrcCommandParser)
 
 #include "tst_irccommandparser.moc"
@@ -23,11 +23,21 @@ class tst_IrcCommandQueue : public tst_IrcClientServer
 private slots:
     void testBatch();
     void testInterval();
+    void testByteRate();
+    void testBurst();
+    void testServices();
     void testConnection();
     void testSize();
     void testClear();
     void testFlush();
     void testQuit();
+    void testLanes();
+    void testCaseMapping();
+    void testSplitting();
+    void testSplittingUnqueued();
+    void testCommandValues();
+    void testPacking();
+    void testStatistics();
 };
 
 void tst_IrcCommandQueue::testBatch()
@@ -46,6 +56,47 @@ void tst_IrcCommandQueue::testInterval()
     QCOMPARE(queue.interval(), 5);
 }
 
+void tst_IrcCommandQueue::testByteRate()
+{
+    IrcCommandQueue queue;
+    QCOMPARE(queue.byteRate(), 0);
+    queue.setByteRate(120);
+    QCOMPARE(queue.byteRate(), 120);
+}
+
+void tst_IrcCommandQueue::testBurst()
+{
+    TestCommandFilter filter(connection);
+    IrcCommandQueue queue(connection);
+
+    connection->open();
+    QVERIFY(waitForOpened());
+    QVERIFY(waitForWritten(tst_IrcData::welcome()));
+
+    // the whole bucket is available after reconfiguring an idle queue
+    queue.setInterval(60);
+    queue.setBatch(5);
+    filter.commands.clear();
+
+    for (int i = 0; i < 7; ++i)
+        connection->sendCommand(IrcCommand::createAway());
+    QCOMPARE(queue.size(), 7);
+
+    // the next command is due in 12 seconds
+    QTRY_COMPARE(filter.commands.count(), 5);
+    QCOMPARE(queue.size(), 2);
+    QTest::qWait(50);
+    QCOMPARE(filter.commands.count(), 5);
+}
+
+void tst_IrcCommandQueue::testServices()
+{
+    IrcCommandQueue queue;
+    QCOMPARE(queue.services(), QStringList() << "NickServ");
+    queue.setServices(QStringList() << "NickServ" << "Q@CServe.quakenet.org");
+    QCOMPARE(queue.services(), QStringList() << "NickServ" << "Q@CServe.quakenet.org");
+}
+
 void tst_IrcCommandQueue::testConnection()
 {
     IrcConnection connection1;
@@ -144,6 +195,285 @@ void tst_IrcCommandQueue::testQuit()
     QCOMPARE(queue.size(), 0);
 }
 
+void tst_IrcCommandQueue::testLanes()
+{
+    TestCommandFilter filter(connection);
+    IrcCommandQueue queue(connection);
+
+    connection->open();
+    QVERIFY(waitForOpened());
+    QVERIFY(waitForWritten(tst_IrcData::welcome()));
+
+    filter.commands.clear();
+
+    connection->sendCommand(IrcCommand::createMessage("#a", "a1"));
+    connection->sendCommand(IrcCommand::createMessage("#a", "a2"));
+    connection->sendCommand(IrcCommand::createMessage("#a", "a3"));
+    connection->sendCommand(IrcCommand::createMessage("#b", "b1"));
+    connection->sendCommand(IrcCommand::createPong("communi"));
+    connection->sendCommand(IrcCommand::createMessage("NickServ", "IDENTIFY secret"));
+    connection->sendCommand(IrcCommand::createMessage("#b", "b2"));
+    connection->sendCommand(IrcCommand::createMessage("nickserv@services.", "GHOST communi"));
+    connection->sendCommand(IrcCommand::createMessage("ChanServ", "OP #a"));
+    QCOMPARE(queue.size(), 9);
+
+    queue.flush();
+    QCOMPARE(queue.size(), 0);
+
+    QStringList sent;
+    foreach (IrcCommand* cmd, filter.commands)
+        sent += cmd->toString();
+
+    QCOMPARE(sent, QStringList() << "PONG communi"
+                                 << "PRIVMSG NickServ :IDENTIFY secret"
+                                 << "PRIVMSG nickserv@services. :GHOST communi"
+                                 << "PRIVMSG #a :a1"
+                                 << "PRIVMSG #b :b1"
+                                 << "PRIVMSG ChanServ :OP #a"
+                                 << "PRIVMSG #a :a2"
+                                 << "PRIVMSG #b :b2"
+                                 << "PRIVMSG #a :a3");
+}
+
+void tst_IrcCommandQueue::testCaseMapping()
+{
+    TestCommandFilter filter(connection);
+    IrcCommandQueue queue(connection);
+
+    connection->open();
+    QVERIFY(waitForOpened());
+    QVERIFY(waitForWritten(tst_IrcData::welcome()));
+
+    filter.commands.clear();
+
+    // freenode: CASEMAPPING=rfc1459
+    connection->sendCommand(IrcCommand::createMessage("#foo[", "m1"));
+    connection->sendCommand(IrcCommand::createMessage("#FOO{", "m2"));
+    connection->sendCommand(IrcCommand::createMessage("#bar", "b1"));
+    QCOMPARE(queue.size(), 3);
+
+    queue.flush();
+
+    QStringList sent;
+    foreach (IrcCommand* cmd, filter.commands)
+        sent += cmd->toString();
+
+    // the same channel, so round-robin with #bar
+    QCOMPARE(sent, QStringList() << "PRIVMSG #foo[ :m1"
+                                 << "PRIVMSG #bar :b1"
+                                 << "PRIVMSG #FOO{ :m2");
+}
+
+void tst_IrcCommandQueue::testSplitting()
+{
+    TestCommandFilter filter(connection);
+    IrcCommandQueue queue(connection);
+    QVERIFY(!queue.isSplitting());
+    queue.setSplitting(true);
+    QVERIFY(queue.isSplitting());
+
+    connection->open();
+    QVERIFY(waitForOpened());
+    QVERIFY(waitForWritten(tst_IrcData::welcome()));
+
+    filter.commands.clear();
+
+    // ":nick!~user@host " with the maximum host length
+    const int prefix = 2 + connection->nickName().length() + 3 + connection->userName().length() + 63;
+
+    QStringList words;
+    for (int i = 0; i < 200; ++i)
+        words += QString::fromUtf8("w\xc3\xb6rd%1").arg(i);
+    const QString text = words.join(" ");
+
+    connection->sendCommand(IrcCommand::createMessage("#communi", "short"));
+    QCOMPARE(queue.size(), 1);
+    connection->sendCommand(IrcCommand::createMessage("#communi", text));
+    QVERIFY(queue.size() > 2);
+    queue.flush();
+
+    QCOMPARE(filter.commands.takeFirst()->toString(), QString("PRIVMSG #communi :short"));
+
+    QStringList chunks;
+    foreach (IrcCommand* cmd, filter.commands) {
+        QVERIFY(prefix + cmd->toString().toUtf8().length() + 2 <= 512);
+        QCOMPARE(cmd->parameters().value(0), QString("#communi"));
+        chunks += cmd->parameters().value(1);
+    }
+    QCOMPARE(chunks.join(" "), text);
+
+    // formatting is carried over to the following lines
+    filter.commands.clear();
+    connection->sendCommand(IrcCommand::createMessage("#communi", QString("\x02\x03" "4,2") + text));
+    queue.flush();
+    QVERIFY(filter.commands.count() > 1);
+    QVERIFY(filter.commands.first()->parameters().value(1).startsWith("\x02\x03" "4,2"));
+    for (int i = 1; i < filter.commands.count(); ++i)
+        QVERIFY(filter.commands.at(i)->parameters().value(1).startsWith("\x02\x03" "04,02"));
+
+    // without spaces the text is broken at character boundaries
+    filter.commands.clear();
+    const QString word = QString::fromUtf8("\xe2\x82\xac").repeated(300);
+    connection->sendCommand(IrcCommand::createNotice("#communi", word));
+    queue.flush();
+    QVERIFY(filter.commands.count() > 1);
+    chunks.clear();
+    foreach (IrcCommand* cmd, filter.commands) {
+        QVERIFY(prefix + cmd->toString().toUtf8().length() + 2 <= 512);
+        QCOMPARE(cmd->type(), IrcCommand::Notice);
+        chunks += cmd->parameters().value(1);
+    }
+    QCOMPARE(chunks.join(""), word);
+}
+
+class CountingCommandFilter : public QObject, public IrcCommandFilter
+{
+    Q_OBJECT
+    Q_INTERFACES(IrcCommandFilter)
+
+public:
+    CountingCommandFilter(IrcConnection* connection) : count(0) { connection->installCommandFilter(this); }
+    bool commandFilter(IrcCommand*) { ++count; return false; }
+    int count;
+};
+
+void tst_IrcCommandQueue::testSplittingUnqueued()
+{
+    IrcCommandQueue queue(connection);
+    queue.setSplitting(true);
+    queue.setInterval(0);
+    // installed after the queue, so it filters commands before the queue
+    CountingCommandFilter filter(connection);
+
+    connection->open();
+    QVERIFY(waitForOpened());
+    QVERIFY(waitForWritten(tst_IrcData::welcome()));
+
+    QStringList words;
+    for (int i = 0; i < 200; ++i)
+        words += QString::fromUtf8("w\xc3\xb6rd%1").arg(i);
+    const QString text = words.join(" ");
+
+    filter.count = 0;
+    connection->sendCommand(IrcCommand::createMessage("#communi", text));
+    QCOMPARE(queue.size(), 0);
+    // the pieces are not filtered again
+    QCOMPARE(filter.count, 1);
+
+    QByteArray written;
+    while (!written.contains("w\xc3\xb6rd199") && serverSocket->waitForReadyRead(1000))
+        written += serverSocket->readAll();
+    QVERIFY(written.count("PRIVMSG #communi :") > 1);
+    QVERIFY(written.contains("w\xc3\xb6rd199"));
+}
+
+void tst_IrcCommandQueue::testCommandValues()
+{
+    IrcCommandQueue queue(connection);
+
+    connection->open();
+    QVERIFY(waitForOpened());
+    QVERIFY(waitForWritten(tst_IrcData::welcome()));
+
+    // the queue filters command values without a conversion by the connection
+    for (int i = 0; i < 3; ++i)
+        QVERIFY(!connection->sendCommand(IrcCommandValue::createMessage("#communi", QString("v%1").arg(i))));
+    QCOMPARE(queue.size(), 3);
+
+    queue.flush();
+    QCOMPARE(queue.size(), 0);
+
+    QByteArray written;
+    while (!written.contains("v2") && serverSocket->waitForReadyRead(1000))
+        written += serverSocket->readAll();
+    QVERIFY(written.contains("PRIVMSG #communi :v0\r\nPRIVMSG #communi :v1\r\nPRIVMSG #communi :v2\r\n"));
+
+    // unqueued command values are passed through
+    queue.setInterval(0);
+    QVERIFY(connection->sendCommand(IrcCommandValue::createPong("communi")));
+    QCOMPARE(queue.size(), 0);
+    written.clear();
+    while (!written.contains("PONG") && serverSocket->waitForReadyRead(1000))
+        written += serverSocket->readAll();
+    QVERIFY(written.contains("PONG communi\r\n"));
+}
+
+void tst_IrcCommandQueue::testPacking()
+{
+    TestCommandFilter filter(connection);
+    IrcCommandQueue queue(connection);
+    QVERIFY(!queue.isPacking());
+    queue.setPacking(true);
+    QVERIFY(queue.isPacking());
+
+    connection->open();
+    QVERIFY(waitForOpened());
+    QVERIFY(waitForWritten(tst_IrcData::welcome()));
+
+    filter.commands.clear();
+
+    // freenode: TARGMAX=PRIVMSG:4
+    for (int i = 1; i <= 5; ++i)
+        connection->sendCommand(IrcCommand::createMessage(QString("#chan%1").arg(i), "hello"));
+    connection->sendCommand(IrcCommand::createMessage("#chan1", "bye"));
+    connection->sendCommand(IrcCommand::createNotice("#chan2", "bye"));
+    QCOMPARE(queue.size(), 7);
+
+    queue.flush();
+    QCOMPARE(queue.size(), 0);
+
+    QStringList sent;
+    foreach (IrcCommand* cmd, filter.commands)
+        sent += cmd->toString();
+
+    QCOMPARE(sent, QStringList() << "PRIVMSG #chan1,#chan2,#chan3,#chan4 :hello"
+                                 << "NOTICE #chan2 :bye"
+                                 << "PRIVMSG #chan5 :hello"
+                                 << "PRIVMSG #chan1 :bye");
+}
+
+void tst_IrcCommandQueue::testStatistics()
+{
+    TestCommandFilter filter(connection);
+    IrcCommandQueue queue(connection);
+    // a long interval keeps the rest of the queue waiting, however slow the machine is
+    queue.setInterval(60);
+
+    connection->open();
+    QVERIFY(waitForOpened());
+    QVERIFY(waitForWritten(tst_IrcData::welcome()));
+
+    QVariantMap stats = queue.statistics();
+    QCOMPARE(stats.value("size").toInt(), 0);
+    QCOMPARE(stats.value("sent").toInt(), 0);
+
+    for (int i = 0; i < 5; ++i)
+        connection->sendCommand(IrcCommand::createAway());
+
+    stats = queue.statistics();
+    QCOMPARE(stats.value("size").toInt(), 5);
+    QCOMPARE(stats.value("maxSize").toInt(), 5);
+    QCOMPARE(stats.value("sent").toInt(), 0);
+
+    // the full bucket allows a burst of one batch, the next command is due in 20 seconds
+    QTRY_COMPARE(queue.size(), 2);
+    stats = queue.statistics();
+    QCOMPARE(stats.value("sent").toInt(), 3);
+    QVERIFY(stats.value("averageWait").toLongLong() >= 0);
+
+    queue.flush();
+    stats = queue.statistics();
+    QCOMPARE(stats.value("size").toInt(), 0);
+    QCOMPARE(stats.value("maxSize").toInt(), 5);
+    QCOMPARE(stats.value("sent").toInt(), 5);
+
+    queue.resetStatistics();
+    stats = queue.statistics();
+    QCOMPARE(stats.value("maxSize").toInt(), 0);
+    QCOMPARE(stats.value("sent").toInt(), 0);
+    QCOMPARE(stats.value("maxWait").toInt(), 0);
+}
+
 QTEST_MAIN(tst_IrcCommandQueue)
 
 #include "tst_irccommandqueue.moc"
@@ -19,6 +19,10 @@
 #include <QtCore/QScopedPointer>
 #ifndef QT_NO_SSL
 #include <QtNetwork/QSslSocket>
+#include <QtNetwork/QSslConfiguration>
+#include <QtNetwork/QTcpServer>
+#include <QtCore/QTemporaryDir>
+#include <QtCore/QProcess>
 #endif
 
 #include "tst_ircdata.h"
@@ -29,6 +33,21 @@ class FriendlyConnection : public IrcConnection
     friend class tst_IrcConnection;
 };
 
+class ReimplementedCommand : public IrcCommand
+{
+public:
+    ReimplementedCommand()
+    {
+        setType(IrcCommand::Message);
+        setParameters(QStringList() << "#communi" << "hello");
+    }
+
+    virtual QString toString() const
+    {
+        return QLatin1String("PRIVMSG #communi :reimplemented");
+    }
+};
+
 class TestProtocol : public IrcProtocol
 {
 public:
@@ -82,7 +101,13 @@ private slots:
     void testSecure();
     void testSasl();
     void testNoSasl();
+    void testPipelined_data();
+    void testPipelined();
+    void testPipelinedNak();
     void testSsl();
+    void testSessionResumption();
+    void testTlsResumption();
+    void testMetrics();
 
     void testOpen();
     void testEnabled();
@@ -94,16 +119,22 @@ private slots:
     void testStatusPrefixes();
     void testMessageComposer();
     void testMessageComposerCrash_data();
+    void testMessageComposerLists();
     void testMessageComposerCrash();
     void testBatch();
     void testServerTime();
 
     void testSendCommand();
+    void testSendCommandValue();
     void testSendData();
 
     void testMessageFilter();
+    void testMessageFilterTypes();
+    void testHeadless();
     void testCommandFilter();
 
+    void testThreaded();
+
     void testDebug();
     void testWarnings();
 
@@ -132,6 +163,9 @@ void tst_IrcConnection::testDefaults()
     QCOMPARE(connection.reconnectDelay(), 0);
     QVERIFY(connection.socket());
     QVERIFY(!connection.isSecure());
+    QVERIFY(!connection.isSessionResumptionEnabled());
+    QVERIFY(!connection.isMetricsEnabled());
+    QCOMPARE(connection.statisticsInterval(), 0);
     QVERIFY(connection.saslMechanism().isNull());
     QVERIFY(!IrcConnection::supportedSaslMechanisms().isEmpty());
     QVERIFY(connection.network());
@@ -518,6 +552,199 @@ void tst_IrcConnection::testNoSasl()
     QVERIFY(written.contains("CAP END"));
 }
 
+// answers the registration handshake like an ircd would,
+// and counts the round trips it takes to welcome the client
+class FakeIrcd
+{
+public:
+    FakeIrcd(QTcpSocket* socket, const QStringList& caps) : socket(socket), caps(caps.toSet()),
+        rounds(0), negotiating(false), nick(false), user(false), registered(false)
+    {
+    }
+
+    bool process()
+    {
+        const QList<QByteArray> lines = socket->readAll().split('\n');
+        QByteArray reply;
+        foreach (const QByteArray& data, lines) {
+            const QString line = QString::fromUtf8(data.trimmed());
+            if (line.isEmpty())
+                continue;
+            received += line;
+            if (line.startsWith("CAP LS")) {
+                negotiating = !registered;
+                reply += ":irc.ser.ver CAP * LS :" + QStringList(caps.toList()).join(" ") + "\r\n";
+            } else if (line.startsWith("CAP REQ :")) {
+                negotiating = !registered;
+                const QSet<QString> requested = line.mid(9).split(" ", QString::SkipEmptyParts).toSet();
+                if (QSet<QString>(requested).subtract(caps).isEmpty() && QSet<QString>(requested).intersect(refused).isEmpty()) {
+                    active += requested;
+                    reply += ":irc.ser.ver CAP * ACK :" + line.mid(9) + "\r\n";
+                } else {
+                    reply += ":irc.ser.ver CAP * NAK :" + line.mid(9) + "\r\n";
+                }
+            } else if (line == "CAP END") {
+                negotiating = false;
+            } else if (line.startsWith("AUTHENTICATE ")) {
+                if (!active.contains("sasl"))
+                    reply += ":irc.ser.ver 904 * :SASL authentication failed\r\n";
+                else if (line == "AUTHENTICATE PLAIN")
+                    reply += "AUTHENTICATE +\r\n";
+                else
+                    reply += ":irc.ser.ver 903 nick :SASL authentication successful\r\n";
+            } else if (line.startsWith("NICK ")) {
+                nick = true;
+            } else if (line.startsWith("USER ")) {
+                user = true;
+            }
+            if (!registered && nick && user && !negotiating) {
+                registered = true;
+                reply += ":irc.ser.ver 001 nick :Welcome to the Fake IRC Network nick\r\n";
+            }
+        }
+        if (reply.isEmpty())
+            return false;
+        ++rounds;
+        socket->write(reply);
+        return socket->waitForBytesWritten(1000);
+    }
+
+    QTcpSocket* socket;
+    QSet<QString> caps;
+    QSet<QString> refused;
+    QSet<QString> active;
+    QStringList received;
+    int rounds;
+    bool negotiating;
+    bool nick;
+    bool user;
+    bool registered;
+};
+
+void tst_IrcConnection::testPipelined_data()
+{
+    QTest::addColumn<bool>("pipelined");
+    QTest::addColumn<QString>("mechanism");
+    QTest::addColumn<QStringList>("requested");
+    QTest::addColumn<QStringList>("active");
+    QTest::addColumn<int>("rounds");
+
+    QStringList caps = QStringList() << "multi-prefix";
+    QStringList sasl = QStringList() << "multi-prefix" << "sasl";
+    QStringList unknown = QStringList() << "multi-prefix" << "unknown";
+
+    QTest::newRow("default") << false << QString() << caps << caps << 3;
+    QTest::newRow("pipelined") << true << QString() << caps << caps << 1;
+    QTest::newRow("default sasl") << false << QString("PLAIN") << caps << sasl << 4;
+    QTest::newRow("pipelined sasl") << true << QString("PLAIN") << caps << sasl << 2;
+    // NAK: the rejected request is retried with the available capabilities
+    QTest::newRow("pipelined nak") << true << QString() << unknown << caps << 1;
+    QTest::newRow("pipelined sasl nak") << true << QString("PLAIN") << unknown << sasl << 4;
+}
+
+void tst_IrcConnection::testPipelined()
+{
+    QFETCH(bool, pipelined);
+    QFETCH(QString, mechanism);
+    QFETCH(QStringList, requested);
+    QFETCH(QStringList, active);
+    QFETCH(int, rounds);
+
+    connection->protocol()->setPipelined(pipelined);
+    QCOMPARE(connection->protocol()->isPipelined(), pipelined);
+    connection->setSaslMechanism(mechanism);
+    connection->network()->setRequestedCapabilities(requested);
+    connection->sendCommand(IrcCommand::createJoin("#communi"));
+
+    connection->open();
+    QVERIFY(waitForOpened());
+
+    FakeIrcd ircd(serverSocket, QStringList() << "multi-prefix" << "sasl" << "extended-join");
+    for (int i = 0; i < 10 && !ircd.registered; ++i) {
+        // give the client a moment to write everything it has to say
+        QTest::qWait(100);
+        ircd.process();
+    }
+    QVERIFY(ircd.registered);
+    QCOMPARE(ircd.rounds, rounds);
+
+    QTRY_VERIFY(connection->isConnected());
+    // answer whatever was retried after the NAK
+    QTest::qWait(100);
+    ircd.process();
+    QTRY_COMPARE(connection->network()->activeCapabilities().toSet(), active.toSet());
+    QCOMPARE(ircd.active, active.toSet());
+    QVERIFY(ircd.received.contains("JOIN #communi"));
+}
+
+class NumericFilter : public QObject, public IrcMessageFilter
+{
+    Q_OBJECT
+    Q_INTERFACES(IrcMessageFilter)
+
+public:
+    bool messageFilter(IrcMessage* message)
+    {
+        if (message->type() == IrcMessage::Numeric)
+            codes += static_cast<IrcNumericMessage*>(message)->code();
+        return false;
+    }
+
+    QList<int> codes;
+};
+
+void tst_IrcConnection::testPipelinedNak()
+{
+    NumericFilter filter;
+    connection->installMessageFilter(&filter);
+    connection->protocol()->setPipelined(true);
+    connection->setSaslMechanism("PLAIN");
+    connection->network()->setRequestedCapabilities(QStringList() << "multi-prefix");
+
+    connection->open();
+    QVERIFY(waitForOpened());
+
+    // the server does not support SASL at all
+    FakeIrcd ircd(serverSocket, QStringList() << "multi-prefix");
+    for (int i = 0; i < 10 && !ircd.registered; ++i) {
+        QTest::qWait(100);
+        ircd.process();
+    }
+    QVERIFY(ircd.registered);
+    QTRY_VERIFY(connection->isConnected());
+
+    // the speculative request is refused, the retry leaves out sasl
+    QStringList requests = ircd.received.filter("CAP REQ");
+    QCOMPARE(requests.count(), 2);
+    QVERIFY(requests.at(0).contains("sasl"));
+    QCOMPARE(requests.at(1), QString("CAP REQ :multi-prefix"));
+    QCOMPARE(ircd.received.filter("AUTHENTICATE").count(), 1);
+    QVERIFY(ircd.received.contains("PASS secret"));
+    QCOMPARE(connection->network()->activeCapabilities(), QStringList() << "multi-prefix");
+
+    // the failure of the speculative AUTHENTICATE is not delivered
+    QVERIFY(!filter.codes.contains(904));
+    QVERIFY(filter.codes.contains(Irc::RPL_WELCOME));
+
+    // a request that would be refused again is not retried
+    connection->close();
+    connection->network()->setRequestedCapabilities(QStringList() << "multi-prefix" << "unknown");
+    connection->setSaslMechanism(QString());
+    connection->open();
+    QVERIFY(waitForOpened());
+
+    FakeIrcd other(serverSocket, QStringList() << "multi-prefix" << "unknown");
+    other.refused << "unknown"; // advertised, but refused
+    for (int i = 0; i < 10 && !other.registered; ++i) {
+        QTest::qWait(100);
+        other.process();
+    }
+    QVERIFY(other.registered);
+    QTest::qWait(100);
+    other.process();
+    QCOMPARE(other.received.filter("CAP REQ").count(), 1);
+}
+
 #ifndef QT_NO_SSL
 class SslSocket : public QSslSocket
 {
@@ -550,6 +777,221 @@ void tst_IrcConnection::testSsl()
 #endif // !QT_NO_SSL
 }
 
+#if !defined(QT_NO_SSL) && QT_VERSION >= 0x050200
+class ResumingSslSocket : public QSslSocket
+{
+    Q_OBJECT
+
+public:
+    ResumingSslSocket(QObject* parent) : QSslSocket(parent) { }
+    QByteArray offeredSession;
+
+public slots:
+    // a stand-in for a server that resumes offered sessions
+    void startClientEncryption()
+    {
+        QSslConfiguration config = sslConfiguration();
+        offeredSession = config.sessionTicket();
+        if (offeredSession.isEmpty())
+            config.setSessionTicket("session");
+        setSslConfiguration(config);
+        emit encrypted();
+    }
+};
+#endif // !QT_NO_SSL && QT_VERSION
+
+void tst_IrcConnection::testSessionResumption()
+{
+#if !defined(QT_NO_SSL) && QT_VERSION >= 0x050200
+    QSignalSpy spy(connection, SIGNAL(sessionResumptionChanged(bool)));
+    QVERIFY(spy.isValid());
+    connection->setSessionResumptionEnabled(true);
+    connection->setSessionResumptionEnabled(true);
+    QCOMPARE(spy.count(), 1);
+
+    ResumingSslSocket* socket = new ResumingSslSocket(connection);
+    connection->setSocket(socket);
+
+    connection->open();
+    QVERIFY(waitForOpened());
+    QVERIFY(socket->offeredSession.isEmpty());
+    QCOMPARE(connection->statistics().value("handshakes").toInt(), 1);
+    QVERIFY(!connection->statistics().contains("resumedHandshakes"));
+
+    connection->close();
+    connection->open();
+    QVERIFY(waitForOpened());
+    QCOMPARE(socket->offeredSession, QByteArray("session"));
+    QCOMPARE(connection->statistics().value("handshakes").toInt(), 2);
+
+    // the sessions are shared between connections
+    QScopedPointer<IrcConnection> clone(connection->clone());
+    QVERIFY(clone->isSessionResumptionEnabled());
+    ResumingSslSocket* other = new ResumingSslSocket(clone.data());
+    clone->setSocket(other);
+    clone->open();
+    QVERIFY(server->waitForNewConnection(200));
+    QVERIFY(other->waitForConnected(1000));
+    QCOMPARE(other->offeredSession, QByteArray("session"));
+
+    // but not with another server name
+    QScopedPointer<IrcConnection> named(connection->clone());
+    ResumingSslSocket* sni = new ResumingSslSocket(named.data());
+    sni->setPeerVerifyName("other.example.com");
+    named->setSocket(sni);
+    named->open();
+    QVERIFY(server->waitForNewConnection(200));
+    QVERIFY(sni->waitForConnected(1000));
+    QVERIFY(sni->offeredSession.isEmpty());
+
+    connection->resetStatistics();
+    QCOMPARE(connection->statistics().value("handshakes").toInt(), 0);
+#endif // !QT_NO_SSL && QT_VERSION
+}
+
+#if !defined(QT_NO_SSL) && QT_VERSION >= 0x050200
+// reads the output of a process without blocking the event loop
+static bool waitForOutput(QProcess* process, QByteArray* output, const QByteArray& text)
+{
+    QElapsedTimer timer;
+    timer.start();
+    while (!output->contains(text) && timer.elapsed() < 5000) {
+        QTest::qWait(20);
+        *output += process->readAllStandardOutput();
+    }
+    return output->contains(text);
+}
+#endif // !QT_NO_SSL && QT_VERSION
+
+void tst_IrcConnection::testTlsResumption()
+{
+#if !defined(QT_NO_SSL) && QT_VERSION >= 0x050200
+    QTemporaryDir dir;
+    QVERIFY(dir.isValid());
+    const QString key = dir.path() + "/key.pem";
+    const QString cert = dir.path() + "/cert.pem";
+
+    QProcess req;
+    req.start("openssl", QStringList() << "req" << "-x509" << "-newkey" << "rsa:2048" << "-nodes" << "-days" << "1"
+                                       << "-subj" << "/CN=localhost" << "-keyout" << key << "-out" << cert);
+    if (!req.waitForStarted(5000))
+        Q4SKIP("openssl is not available");
+    QVERIFY(req.waitForFinished(30000));
+    QCOMPARE(req.exitCode(), 0);
+
+    QTcpServer probe;
+    QVERIFY(probe.listen(QHostAddress::LocalHost));
+    const quint16 port = probe.serverPort();
+    probe.close();
+
+    // a real TLS server that reports whether a session was resumed
+    QProcess tls;
+    tls.setProcessChannelMode(QProcess::MergedChannels);
+    tls.start("openssl", QStringList() << "s_server" << "-accept" << QString::number(port)
+                                       << "-cert" << cert << "-key" << key << "-tls1_2");
+    QVERIFY(tls.waitForStarted(5000));
+    QByteArray output;
+    QVERIFY(waitForOutput(&tls, &output, "ACCEPT"));
+
+    connection->setPort(port);
+    connection->setSecure(true);
+    connection->setSessionResumptionEnabled(true);
+    QSslSocket* ssl = qobject_cast<QSslSocket*>(connection->socket());
+    QVERIFY(ssl);
+    ssl->setPeerVerifyMode(QSslSocket::VerifyNone);
+
+    connection->open();
+    QTRY_COMPARE(connection->statistics().value("handshakes").toInt(), 1);
+    QVERIFY(waitForOutput(&tls, &output, "CIPHER is"));
+    QVERIFY(!output.contains("Reused session-id"));
+
+    connection->close();
+    QTRY_COMPARE(connection->status(), IrcConnection::Closed);
+    QVERIFY(waitForOutput(&tls, &output, "CONNECTION CLOSED"));
+    output.clear();
+
+    // the cached session is offered and accepted by the server
+    connection->open();
+    QTRY_COMPARE(connection->statistics().value("handshakes").toInt(), 2);
+    QVERIFY(waitForOutput(&tls, &output, "Reused session-id"));
+
+    connection->close();
+    tls.kill();
+    tls.waitForFinished(5000);
+#endif // !QT_NO_SSL && QT_VERSION
+}
+
+void tst_IrcConnection::testMetrics()
+{
+    QVERIFY(!connection->statistics().contains("bytesIn"));
+
+    QSignalSpy enabledSpy(connection, SIGNAL(metricsEnabledChanged(bool)));
+    QVERIFY(enabledSpy.isValid());
+    connection->setMetricsEnabled(true);
+    connection->setMetricsEnabled(true);
+    QCOMPARE(enabledSpy.count(), 1);
+
+    connection->open();
+    QVERIFY(waitForOpened());
+    connection->resetStatistics();
+
+    const QByteArray join(":communi!~communi@hidd.en JOIN #freenode");
+    const QByteArray privmsg(":communi!~communi@hidd.en PRIVMSG #freenode :hello");
+    QVERIFY(waitForWritten(join));
+    QVERIFY(waitForWritten(privmsg));
+    QVERIFY(waitForWritten(privmsg));
+    QVERIFY(connection->sendRaw("PRIVMSG #freenode :hi"));
+
+    QVariantMap stats = connection->statistics();
+    QCOMPARE(stats.value("linesIn").toInt(), 3);
+    QCOMPARE(stats.value("bytesIn").toInt(), join.length() + 2 * privmsg.length() + 6);
+    QCOMPARE(stats.value("linesOut").toInt(), 1);
+    QCOMPARE(stats.value("bytesOut").toInt(), 23);
+
+    const QVariantMap messages = stats.value("messages").toMap();
+    QCOMPARE(messages.count(), 2);
+    QCOMPARE(messages.value("Join").toInt(), 1);
+    QCOMPARE(messages.value("Private").toInt(), 2);
+
+#ifndef IRC_NO_METRICS
+    QVERIFY(stats.contains("parseTime"));
+    QVERIFY(stats.contains("filterTime"));
+    QVERIFY(stats.contains("dispatchTime"));
+#else
+    // configure -no-metrics leaves the counters, but no timings
+    QVERIFY(!stats.contains("parseTime"));
+    QVERIFY(!stats.contains("filterTime"));
+    QVERIFY(!stats.contains("dispatchTime"));
+#endif // IRC_NO_METRICS
+
+    connection->resetStatistics();
+    stats = connection->statistics();
+    QCOMPARE(stats.value("linesIn").toInt(), 0);
+    QCOMPARE(stats.value("bytesOut").toInt(), 0);
+    QVERIFY(stats.value("messages").toMap().isEmpty());
+
+    QSignalSpy intervalSpy(connection, SIGNAL(statisticsIntervalChanged(int)));
+    QSignalSpy reportSpy(connection, SIGNAL(statisticsReported(QVariantMap)));
+    QVERIFY(intervalSpy.isValid());
+    QVERIFY(reportSpy.isValid());
+    connection->setStatisticsInterval(10);
+    connection->setStatisticsInterval(10);
+    QCOMPARE(connection->statisticsInterval(), 10);
+    QCOMPARE(intervalSpy.count(), 1);
+    QTest::qWait(50);
+    QVERIFY(reportSpy.count() > 0);
+    QVERIFY(reportSpy.last().at(0).toMap().contains("bytesIn"));
+
+    connection->setStatisticsInterval(0);
+    QCOMPARE(intervalSpy.count(), 2);
+    const int reports = reportSpy.count();
+    QTest::qWait(50);
+    QCOMPARE(reportSpy.count(), reports);
+
+    connection->setMetricsEnabled(false);
+    QVERIFY(!connection->statistics().contains("bytesIn"));
+}
+
 void tst_IrcConnection::testOpen()
 {
     IrcConnection connection;
@@ -1356,13 +1798,81 @@ void tst_IrcConnection::testMessageComposer()
     QCOMPARE(filter.type, IrcMessage::Whowas);
 }
 
+void tst_IrcConnection::testMessageComposerLists()
+{
+    Irc::registerMetaTypes();
+
+    connection->open();
+    QVERIFY(waitForOpened());
+    QVERIFY(waitForWritten(":my.irc.ser.ver 001 communi :Welcome..."));
+
+    MsgFilter filter;
+    connection->installMessageFilter(&filter);
+
+    QSignalSpy motdSpy(connection, SIGNAL(motdMessageReceived(IrcMotdMessage*)));
+    QSignalSpy namesSpy(connection, SIGNAL(namesMessageReceived(IrcNamesMessage*)));
+    QSignalSpy whowasSpy(connection, SIGNAL(whowasMessageReceived(IrcWhowasMessage*)));
+    QVERIFY(motdSpy.isValid());
+    QVERIFY(namesSpy.isValid());
+    QVERIFY(whowasSpy.isValid());
+
+    // stray MOTD lines and ends of lists that were never started are not composed
+    filter.reset();
+    QVERIFY(waitForWritten(":my.irc.ser.ver 372 communi :- stray"));
+    QVERIFY(waitForWritten(":my.irc.ser.ver 376 communi :End of /MOTD command."));
+    QVERIFY(waitForWritten(":my.irc.ser.ver 366 communi #communi :End of /NAMES list."));
+    QVERIFY(waitForWritten(":my.irc.ser.ver 318 communi jpnurmi :End of /WHOIS list."));
+    QVERIFY(waitForWritten(":my.irc.ser.ver 369 communi jpnurmi :End of WHOWAS"));
+    QCOMPARE(filter.count, 5);
+    QCOMPARE(filter.type, IrcMessage::Numeric);
+    QCOMPARE(motdSpy.count(), 0);
+    QCOMPARE(namesSpy.count(), 0);
+    QCOMPARE(whowasSpy.count(), 0);
+
+    // a MOTD consists of its own lines only
+    filter.reset("lines");
+    QVERIFY(waitForWritten(":my.irc.ser.ver 375 communi :- my.irc.ser.ver Message of the Day -"));
+    QVERIFY(waitForWritten(":my.irc.ser.ver 372 communi :- line 1"));
+    QVERIFY(waitForWritten(":my.irc.ser.ver 372 communi :- line 2"));
+    QVERIFY(waitForWritten(":my.irc.ser.ver 376 communi :End of /MOTD command."));
+    QCOMPARE(motdSpy.count(), 1);
+    QCOMPARE(filter.type, IrcMessage::Motd);
+    QCOMPARE(filter.values.value("lines").toStringList(), QStringList() << "- line 1" << "- line 2");
+
+    // names are collected over several replies, and only the end of names finishes them
+    filter.reset("channel,names");
+    QVERIFY(waitForWritten(":my.irc.ser.ver 353 communi = #communi :communi @jpnurmi"));
+    QVERIFY(waitForWritten(":my.irc.ser.ver 372 communi :- stray"));
+    QVERIFY(waitForWritten(":my.irc.ser.ver 353 communi = #communi :+jipsu qtbot"));
+    QVERIFY(waitForWritten(":my.irc.ser.ver 376 communi :End of /MOTD command."));
+    QVERIFY(waitForWritten(":my.irc.ser.ver 318 communi jpnurmi :End of /WHOIS list."));
+    QCOMPARE(namesSpy.count(), 0);
+    QCOMPARE(motdSpy.count(), 1);
+    QVERIFY(waitForWritten(":my.irc.ser.ver 366 communi #communi :End of /NAMES list."));
+    QCOMPARE(namesSpy.count(), 1);
+    QCOMPARE(filter.type, IrcMessage::Names);
+    QCOMPARE(filter.values.value("channel").toString(), QString("#communi"));
+    QCOMPARE(filter.values.value("names").toStringList(), QStringList() << "communi" << "@jpnurmi" << "+jipsu" << "qtbot");
+
+    // the end of a WHOIS does not finish a WHOWAS
+    filter.reset("realName");
+    QVERIFY(waitForWritten(":my.irc.ser.ver 314 communi jirssi ~jpnurmi 88.95.51.136 * :J-P Nurmi"));
+    QVERIFY(waitForWritten(":my.irc.ser.ver 318 communi jirssi :End of /WHOIS list."));
+    QCOMPARE(whowasSpy.count(), 0);
+    QVERIFY(waitForWritten(":my.irc.ser.ver 369 communi jirssi :End of WHOWAS"));
+    QCOMPARE(whowasSpy.count(), 1);
+    QCOMPARE(filter.type, IrcMessage::Whowas);
+    QCOMPARE(filter.values.value("realName").toString(), QString("J-P Nurmi"));
+}
+
 void tst_IrcConnection::testMessageComposerCrash_data()
 {
     QTest::addColumn<QByteArray>("data");
 
     // unexpected replies - don't crash
     QList<Irc::Code> codes;
-    codes << Irc::RPL_WHOISSERVER << Irc::RPL_WHOISACCOUNT << Irc::RPL_WHOISHOST << Irc::RPL_WHOISIDLE << Irc::RPL_WHOISSECURE << Irc::RPL_WHOISCHANNELS;
+    codes << Irc::RPL_WHOISSERVER << Irc::RPL_WHOISACCOUNT << Irc::RPL_WHOISHOST << Irc::RPL_WHOISIDLE << Irc::RPL_WHOISSECURE << Irc::RPL_WHOISCHANNELS
+          << Irc::RPL_MOTD << Irc::RPL_ENDOFMOTD << Irc::RPL_ENDOFNAMES << Irc::RPL_ENDOFWHOIS << Irc::RPL_ENDOFWHOWAS << Irc::RPL_AWAY;
     foreach (Irc::Code code, codes)
         QTest::newRow(qPrintable(Irc::codeToString(code))) << QByteArray(":server ") + QByteArray::number(code);
 }
@@ -1456,6 +1966,13 @@ void tst_IrcConnection::testSendCommand()
     connection->open();
     QVERIFY(waitForOpened());
 
+    QVERIFY(connection->sendCommand(IrcCommand::createMessage("#communi", "hello")));
+    QCOMPARE(protocol->written, QByteArray("PRIVMSG #communi :hello"));
+
+    // a subclass without Q_OBJECT must still be sent via its toString()
+    QVERIFY(connection->sendCommand(new ReimplementedCommand));
+    QCOMPARE(protocol->written, QByteArray("PRIVMSG #communi :reimplemented"));
+
     QVERIFY(connection->sendCommand(IrcCommand::createQuit()));
     QVERIFY(!connection->sendCommand(0));
     QVERIFY(protocol->written.contains("QUIT"));
@@ -1517,6 +2034,98 @@ public:
     bool commandFilterEnabled;
 };
 
+class TestValueFilter : public QObject, public IrcCommandFilter, public IrcCommandValueFilter
+{
+    Q_OBJECT
+    Q_INTERFACES(IrcCommandFilter IrcCommandValueFilter)
+
+public:
+    TestValueFilter() : commandFiltered(0), valueFiltered(0), filterEnabled(false) { }
+
+    bool commandFilter(IrcCommand*)
+    {
+        ++commandFiltered;
+        return filterEnabled;
+    }
+
+    bool commandValueFilter(const IrcCommandValue& command)
+    {
+        ++valueFiltered;
+        lastValue = command.toString();
+        return filterEnabled;
+    }
+
+    int commandFiltered;
+    int valueFiltered;
+    bool filterEnabled;
+    QString lastValue;
+};
+
+void tst_IrcConnection::testSendCommandValue()
+{
+    TestProtocol* protocol = new TestProtocol(connection);
+    FriendlyConnection* friendly = static_cast<FriendlyConnection*>(connection.data());
+    friendly->setProtocol(protocol);
+
+    connection->open();
+    QVERIFY(waitForOpened());
+
+    QVERIFY(connection->sendCommand(IrcCommandValue::createMessage("#communi", QString::fromUtf8("h\xc3\xa4ll\xc3\xb6"))));
+    QCOMPARE(protocol->written, QByteArray("PRIVMSG #communi :h\xc3\xa4ll\xc3\xb6"));
+
+    QVERIFY(connection->sendCommand(IrcCommandValue::createPong("1234")));
+    QCOMPARE(protocol->written, QByteArray("PONG 1234"));
+
+    QVERIFY(connection->sendCommand(IrcCommandValue::createMode("#communi", "+o", "communi")));
+    QCOMPARE(protocol->written, QByteArray("MODE #communi +o communi"));
+
+    // other encodings go through IrcCommand
+    IrcCommandValue latin1 = IrcCommandValue::createNotice("communi", QString::fromUtf8("h\xc3\xa4ll\xc3\xb6"));
+    latin1.setEncoding("ISO-8859-1");
+    QVERIFY(connection->sendCommand(latin1));
+    QCOMPARE(protocol->written, QByteArray("NOTICE communi :h\xe4ll\xf6"));
+
+    // command filters see an equivalent IrcCommand
+    TestFilter filter;
+    filter.clear();
+    connection->installCommandFilter(&filter);
+    QVERIFY(connection->sendCommand(IrcCommandValue::createPing("5678")));
+    QCOMPARE(filter.commandFiltered, 1);
+    QCOMPARE(protocol->written, QByteArray("PING 5678"));
+
+    filter.commandFilterEnabled = true;
+    QVERIFY(!connection->sendCommand(IrcCommandValue::createPing("9012")));
+    QCOMPARE(filter.commandFiltered, 2);
+    QCOMPARE(protocol->written, QByteArray("PING 5678"));
+    connection->removeCommandFilter(&filter);
+
+    // value filters see the value as is
+    TestValueFilter valueFilter;
+    connection->installCommandFilter(&valueFilter);
+    QVERIFY(connection->sendCommand(IrcCommandValue::createPing("3456")));
+    QCOMPARE(valueFilter.valueFiltered, 1);
+    QCOMPARE(valueFilter.commandFiltered, 0);
+    QCOMPARE(valueFilter.lastValue, QString("PING 3456"));
+    QCOMPARE(protocol->written, QByteArray("PING 3456"));
+
+    valueFilter.filterEnabled = true;
+    QVERIFY(!connection->sendCommand(IrcCommandValue::createPing("7890")));
+    QCOMPARE(valueFilter.valueFiltered, 2);
+    QCOMPARE(protocol->written, QByteArray("PING 3456"));
+    valueFilter.filterEnabled = false;
+
+    // a filter without IrcCommandValueFilter makes every filter see an IrcCommand
+    filter.clear();
+    connection->installCommandFilter(&filter);
+    QVERIFY(connection->sendCommand(IrcCommandValue::createPong("1234")));
+    QCOMPARE(filter.commandFiltered, 1);
+    QCOMPARE(valueFilter.commandFiltered, 1);
+    QCOMPARE(valueFilter.valueFiltered, 2);
+    QCOMPARE(protocol->written, QByteArray("PONG 1234"));
+    connection->removeCommandFilter(&filter);
+    connection->removeCommandFilter(&valueFilter);
+}
+
 void tst_IrcConnection::testMessageFilter()
 {
     Irc::registerMetaTypes();
@@ -1642,6 +2251,86 @@ void tst_IrcConnection::testMessageFilter()
     QVERIFY(!suicidal2);
 }
 
+void tst_IrcConnection::testMessageFilterTypes()
+{
+    TestFilter all;
+    TestFilter joins;
+    TestFilter parts;
+    all.clear(); joins.clear(); parts.clear();
+
+    connection->installMessageFilter(&all);
+    connection->installMessageFilter(&joins, QList<IrcMessage::Type>() << IrcMessage::Join);
+    connection->installMessageFilter(&parts, QList<IrcMessage::Type>() << IrcMessage::Part << IrcMessage::Kick);
+
+    connection->open();
+    QVERIFY(waitForOpened());
+
+    QVERIFY(waitForWritten(":communi!~communi@hidd.en JOIN #freenode"));
+    QCOMPARE(all.messageFiltered, 1);
+    QCOMPARE(joins.messageFiltered, 1);
+    QCOMPARE(parts.messageFiltered, 0);
+
+    QVERIFY(waitForWritten(":communi!~communi@hidd.en PART #freenode"));
+    QCOMPARE(all.messageFiltered, 2);
+    QCOMPARE(joins.messageFiltered, 1);
+    QCOMPARE(parts.messageFiltered, 1);
+
+    QVERIFY(waitForWritten(":communi!~communi@hidd.en PRIVMSG #freenode :hello"));
+    QCOMPARE(all.messageFiltered, 3);
+    QCOMPARE(joins.messageFiltered, 1);
+    QCOMPARE(parts.messageFiltered, 1);
+
+    // a filtered message does not reach the filters installed earlier
+    parts.messageFilterEnabled = true;
+    QVERIFY(waitForWritten(":communi!~communi@hidd.en KICK #freenode communi"));
+    QCOMPARE(parts.messageFiltered, 2);
+    QCOMPARE(all.messageFiltered, 3);
+
+    // reinstalled for all types
+    connection->removeMessageFilter(&joins);
+    connection->installMessageFilter(&joins);
+    QVERIFY(waitForWritten(":communi!~communi@hidd.en PRIVMSG #freenode :hello"));
+    QCOMPARE(joins.messageFiltered, 2);
+    QCOMPARE(all.messageFiltered, 4);
+
+    connection->removeMessageFilter(&all);
+    connection->removeMessageFilter(&joins);
+    connection->removeMessageFilter(&parts);
+}
+
+void tst_IrcConnection::testHeadless()
+{
+    TestFilter motd;
+    motd.clear();
+    connection->installMessageFilter(&motd, QList<IrcMessage::Type>() << IrcMessage::Motd);
+
+    QSignalSpy privateSpy(connection, SIGNAL(privateMessageReceived(IrcPrivateMessage*)));
+    QVERIFY(privateSpy.isValid());
+
+    connection->open();
+    QVERIFY(waitForOpened());
+
+    // composed messages reach the filters without going through signals
+    QVERIFY(waitForWritten(":server 375 nick :MOTD"));
+    QVERIFY(waitForWritten(":server 372 nick :- Welcome"));
+    QVERIFY(waitForWritten(":server 376 nick :End of /MOTD command."));
+    QCOMPARE(motd.messageFiltered, 1);
+    QCOMPARE(privateSpy.count(), 0);
+
+    QVERIFY(waitForWritten(":communi!~communi@hidd.en PRIVMSG #freenode :hello"));
+    QCOMPARE(motd.messageFiltered, 1);
+    QCOMPARE(privateSpy.count(), 1);
+
+    // signals connected on the fly are emitted right away
+    QSignalSpy messageSpy(connection, SIGNAL(messageReceived(IrcMessage*)));
+    QVERIFY(messageSpy.isValid());
+    QVERIFY(waitForWritten(":communi!~communi@hidd.en PRIVMSG #freenode :hello"));
+    QCOMPARE(privateSpy.count(), 2);
+    QCOMPARE(messageSpy.count(), 1);
+
+    connection->removeMessageFilter(&motd);
+}
+
 void tst_IrcConnection::testCommandFilter()
 {
     TestProtocol* protocol = new TestProtocol(connection);
@@ -1759,6 +2448,87 @@ void tst_IrcConnection::testCommandFilter()
     QVERIFY(!suicidal);
 }
 
+class ContentFilter : public QObject, public IrcMessageFilter
+{
+    Q_OBJECT
+    Q_INTERFACES(IrcMessageFilter)
+
+public:
+    bool messageFilter(IrcMessage* message)
+    {
+        if (message->type() == IrcMessage::Private)
+            contents += static_cast<IrcPrivateMessage*>(message)->content();
+        return false;
+    }
+
+    QStringList contents;
+};
+
+void tst_IrcConnection::testThreaded()
+{
+    IrcProtocol* protocol = connection->protocol();
+    QVERIFY(!protocol->isThreaded());
+    protocol->setThreaded(true);
+    QVERIFY(protocol->isThreaded());
+
+    ContentFilter filter;
+    connection->installMessageFilter(&filter);
+
+    connection->open();
+    QVERIFY(waitForOpened());
+    QVERIFY(waitForWritten(tst_IrcData::welcome()));
+
+    // parsed in a reader thread, received in this thread
+    QTRY_VERIFY(connection->isConnected());
+    QTRY_COMPARE(connection->network()->name(), QString("freenode"));
+
+    QByteArray data;
+    QStringList expected;
+    for (int i = 0; i < 100; ++i) {
+        data += QString(":nick!user@host PRIVMSG #communi :%1\r\n").arg(i).toUtf8();
+        expected += QString::number(i);
+    }
+    // split in the middle of a line
+    serverSocket->write(data.left(data.length() / 2 + 3));
+    QVERIFY(serverSocket->waitForBytesWritten(1000));
+    serverSocket->write(data.mid(data.length() / 2 + 3));
+    QVERIFY(serverSocket->waitForBytesWritten(1000));
+
+    QTRY_COMPARE(filter.contents.count(), 100);
+    QCOMPARE(filter.contents, expected);
+
+    // a complete and an incomplete line that the reader thread may not have processed yet
+    serverSocket->write(":nick!user@host PRIVMSG #communi :complete\r\n:nick!user@host PRIVMSG #communi :incom");
+    QVERIFY(serverSocket->waitForBytesWritten(1000));
+    QVERIFY(clientSocket->waitForReadyRead(1000));
+
+    protocol->setThreaded(false);
+    QVERIFY(!protocol->isThreaded());
+    QCOMPARE(filter.contents.count(), 101);
+    QCOMPARE(filter.contents.last(), QString("complete"));
+
+    QVERIFY(waitForWritten("plete"));
+    QCOMPARE(filter.contents.count(), 102);
+    QCOMPARE(filter.contents.last(), QString("incomplete"));
+
+    // an incomplete line is handed over to the reader thread
+    serverSocket->write(":nick!user@host PRIVMSG #communi :thr");
+    QVERIFY(serverSocket->waitForBytesWritten(1000));
+    QVERIFY(clientSocket->waitForReadyRead(1000));
+    protocol->setThreaded(true);
+    serverSocket->write("eaded\r\n");
+    QVERIFY(serverSocket->waitForBytesWritten(1000));
+    QTRY_COMPARE(filter.contents.count(), 103);
+    QCOMPARE(filter.contents.last(), QString("threaded"));
+
+    protocol->setThreaded(false);
+    QVERIFY(waitForWritten(":nick!user@host PRIVMSG #communi :sync"));
+    QCOMPARE(filter.contents.count(), 104);
+    QCOMPARE(filter.contents.last(), QString("sync"));
+
+    connection->removeMessageFilter(&filter);
+}
+
 void tst_IrcConnection::testDebug()
 {
     QString str;
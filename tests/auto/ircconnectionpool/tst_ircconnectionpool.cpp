@@ -0,0 +1,209 @@
+/*
+ * Copyright (C) 2008-2016 The Communi Project
+ *
+ * This test is free, and not covered by the BSD license. There is no
+ * restriction applied to their modification, redistribution, using and so on.
+ * You can study them, modify them, use them in your own program - either
+ * completely or partially.
+ */
+
+#include "ircconnectionpool.h"
+#include "ircconnection.h"
+#include <QtTest/QtTest>
+#include <QtNetwork/QTcpServer>
+#include <QtNetwork/QTcpSocket>
+
+class tst_IrcConnectionPool : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void initTestCase();
+    void cleanupTestCase();
+
+    void testDefaults();
+    void testConnections();
+    void testConcurrency();
+    void testInterval();
+    void testReconnect();
+
+private:
+    IrcConnection* createConnection(QObject* parent);
+    QTcpSocket* nextSocket();
+
+    QTcpServer server;
+};
+
+void tst_IrcConnectionPool::initTestCase()
+{
+    QVERIFY(server.listen(QHostAddress::LocalHost));
+}
+
+void tst_IrcConnectionPool::cleanupTestCase()
+{
+    server.close();
+}
+
+IrcConnection* tst_IrcConnectionPool::createConnection(QObject* parent)
+{
+    IrcConnection* connection = new IrcConnection(parent);
+    connection->setUserName("user");
+    connection->setNickName("nick");
+    connection->setRealName("real");
+    connection->setHost("127.0.0.1");
+    connection->setPort(server.serverPort());
+    return connection;
+}
+
+QTcpSocket* tst_IrcConnectionPool::nextSocket()
+{
+    QElapsedTimer timer;
+    timer.start();
+    while (!server.hasPendingConnections() && timer.elapsed() < 2000)
+        QTest::qWait(10);
+    return server.nextPendingConnection();
+}
+
+void tst_IrcConnectionPool::testDefaults()
+{
+    IrcConnectionPool pool;
+    QCOMPARE(pool.count(), 0);
+    QVERIFY(pool.connections().isEmpty());
+    QCOMPARE(pool.concurrency(), 8);
+    QCOMPARE(pool.interval(), 250);
+    QCOMPARE(pool.minimumDelay(), 2);
+    QCOMPARE(pool.maximumDelay(), 300);
+
+    QVariantMap stats = pool.statistics();
+    QCOMPARE(stats.value("connections").toInt(), 0);
+    QCOMPARE(stats.value("attempts").toInt(), 0);
+    QVERIFY(!stats.contains("connectTime"));
+}
+
+void tst_IrcConnectionPool::testConnections()
+{
+    IrcConnectionPool pool;
+    QSignalSpy countSpy(&pool, SIGNAL(countChanged(int)));
+    QVERIFY(countSpy.isValid());
+
+    IrcConnection* connection1 = createConnection(&pool);
+    connection1->setReconnectDelay(10);
+    QScopedPointer<IrcConnection> connection2(createConnection(0));
+
+    pool.addConnection(connection1);
+    pool.addConnection(connection1);
+    pool.addConnection(connection2.data());
+    QCOMPARE(pool.count(), 2);
+    QCOMPARE(countSpy.count(), 2);
+    QVERIFY(pool.contains(connection1));
+    QVERIFY(pool.contains(connection2.data()));
+    QCOMPARE(pool.connections(), QList<IrcConnection*>() << connection1 << connection2.data());
+
+    // the pool takes over reconnecting
+    QCOMPARE(connection1->reconnectDelay(), 0);
+
+    pool.removeConnection(connection1);
+    QCOMPARE(pool.count(), 1);
+    QVERIFY(!pool.contains(connection1));
+    QCOMPARE(connection1->reconnectDelay(), 10);
+
+    connection2.reset();
+    QCOMPARE(pool.count(), 0);
+    QCOMPARE(countSpy.count(), 4);
+}
+
+void tst_IrcConnectionPool::testConcurrency()
+{
+    IrcConnectionPool pool;
+    pool.setConcurrency(1);
+    pool.setInterval(0);
+    for (int i = 0; i < 3; ++i)
+        pool.addConnection(createConnection(&pool));
+
+    pool.open();
+
+    for (int i = 0; i < 3; ++i) {
+        QTcpSocket* socket = nextSocket();
+        QVERIFY(socket);
+        QCOMPARE(pool.statistics().value("connecting").toInt(), 1);
+        QCOMPARE(pool.statistics().value("waiting").toInt(), 2 - i);
+
+        // the next one waits until this one has registered
+        QTest::qWait(50);
+        QVERIFY(!server.hasPendingConnections());
+
+        socket->write(":irc.ser.ver 001 nick :Welcome\r\n");
+        QTRY_COMPARE(pool.statistics().value("connected").toInt(), i + 1);
+    }
+
+    QVariantMap stats = pool.statistics();
+    QCOMPARE(stats.value("attempts").toInt(), 3);
+    QCOMPARE(stats.value("failures").toInt(), 0);
+    QCOMPARE(stats.value("connecting").toInt(), 0);
+    QVERIFY(stats.contains("connectTime"));
+
+    pool.close();
+    QCOMPARE(pool.statistics().value("connected").toInt(), 0);
+}
+
+void tst_IrcConnectionPool::testInterval()
+{
+    IrcConnectionPool pool;
+    pool.setConcurrency(0);
+    pool.setInterval(300);
+    pool.addConnection(createConnection(&pool));
+    pool.addConnection(createConnection(&pool));
+
+    QElapsedTimer timer;
+    timer.start();
+    pool.open();
+
+    QVERIFY(nextSocket());
+    QVERIFY(nextSocket());
+    QVERIFY(timer.elapsed() >= 200);
+    QCOMPARE(pool.statistics().value("connecting").toInt(), 2);
+
+    pool.close();
+}
+
+void tst_IrcConnectionPool::testReconnect()
+{
+    IrcConnectionPool pool;
+    pool.setMinimumDelay(0);
+    IrcConnection* connection = createConnection(&pool);
+    pool.addConnection(connection);
+
+    pool.open();
+    QTcpSocket* socket = nextSocket();
+    QVERIFY(socket);
+    socket->write(":irc.ser.ver 001 nick :Welcome\r\n");
+    QTRY_VERIFY(connection->isConnected());
+
+    // a lost connection is retried
+    socket->abort();
+    QTRY_COMPARE(pool.statistics().value("disconnects").toInt(), 1);
+    socket = nextSocket();
+    QVERIFY(socket);
+    QCOMPARE(pool.statistics().value("attempts").toInt(), 2);
+
+    // a connection that fails to register is retried too
+    socket->abort();
+    socket = nextSocket();
+    QVERIFY(socket);
+    QCOMPARE(pool.statistics().value("attempts").toInt(), 3);
+    QCOMPARE(pool.statistics().value("failures").toInt(), 1);
+
+    // a closed pool does not reconnect
+    pool.close();
+    QCOMPARE(pool.statistics().value("waiting").toInt(), 0);
+    QTest::qWait(50);
+    QVERIFY(!server.hasPendingConnections());
+
+    pool.resetStatistics();
+    QCOMPARE(pool.statistics().value("attempts").toInt(), 0);
+    QCOMPARE(pool.statistics().value("disconnects").toInt(), 0);
+}
+
+QTEST_MAIN(tst_IrcConnectionPool)
+
+#include "tst_ircconnectionpool.moc"
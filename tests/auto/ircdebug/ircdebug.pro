@@ -0,0 +1,8 @@
+######################################################################
+# Communi
+######################################################################
+
+SOURCES += tst_ircdebug.cpp
+
+include(../shared/shared.pri)
+include(../auto.pri)
@@ -0,0 +1,169 @@
+/*
+ * Copyright (C) 2008-2016 The Communi Project
+ *
+ * This test is free, and not covered by the BSD license. There is no
+ * restriction applied to their modification, redistribution, using and so on.
+ * You can study them, modify them, use them in your own program - either
+ * completely or partially.
+ */
+
+#include "ircconnection.h"
+#include "ircdebug_p.h"
+#include "irctrace_p.h"
+#include <QtTest/QtTest>
+#include <QtCore/QDir>
+
+#include "tst_ircclientserver.h"
+
+static QStringList debugMessages;
+
+#if QT_VERSION >= 0x050000
+static void debugHandler(QtMsgType type, const QMessageLogContext&, const QString& msg)
+{
+    if (type == QtDebugMsg)
+        debugMessages += msg;
+}
+#else
+static void debugHandler(QtMsgType type, const char* msg)
+{
+    if (type == QtDebugMsg)
+        debugMessages += QString::fromLocal8Bit(msg);
+}
+#endif // QT_VERSION
+
+class tst_IrcDebug : public tst_IrcClientServer
+{
+    Q_OBJECT
+
+public:
+    tst_IrcDebug();
+
+private slots:
+    void testFileFallback();
+    void testMatch();
+    void testRing();
+    void testWriter();
+};
+
+tst_IrcDebug::tst_IrcDebug()
+{
+    // read once, when the first connection writes debug output
+    qputenv("IRC_DEBUG_LEVEL", "status");
+    qputenv("IRC_DEBUG_FILE", QFile::encodeName(QDir::tempPath() + "/communi-no-such-dir/debug.log"));
+    qputenv("IRC_DEBUG_NAME", "match*");
+}
+
+void tst_IrcDebug::testFileFallback()
+{
+    connection->setDisplayName("matched-fallback");
+
+    // the file cannot be opened, so the output goes to qDebug()
+#if QT_VERSION >= 0x050000
+    QtMessageHandler previous = qInstallMessageHandler(debugHandler);
+#else
+    QtMsgHandler previous = qInstallMsgHandler(debugHandler);
+#endif // QT_VERSION
+    connection->open();
+    const bool opened = waitForOpened();
+#if QT_VERSION >= 0x050000
+    qInstallMessageHandler(previous);
+#else
+    qInstallMsgHandler(previous);
+#endif // QT_VERSION
+
+    QVERIFY(opened);
+    QVERIFY(!debugMessages.filter("fallback").isEmpty());
+}
+
+void tst_IrcDebug::testMatch()
+{
+    IrcConnectionPrivate* priv = IrcConnectionPrivate::get(connection);
+
+    connection->setDisplayName("matched");
+    QCOMPARE(priv->debugMatch, -1);
+    QVERIFY(irc_debug_enabled(connection, IrcDebug::Status));
+    QCOMPARE(priv->debugMatch, 1);
+    QVERIFY(!irc_debug_enabled(connection, IrcDebug::Read));
+
+    // the cached match is invalidated when the display name changes
+    connection->setDisplayName("other");
+    QCOMPARE(priv->debugMatch, -1);
+    QVERIFY(!irc_debug_enabled(connection, IrcDebug::Status));
+    QCOMPARE(priv->debugMatch, 0);
+
+    // ...including when it falls back to the host
+    connection->setDisplayName(QString());
+    QCOMPARE(priv->debugMatch, -1);
+    QVERIFY(!irc_debug_enabled(connection, IrcDebug::Status));
+    connection->setHost("matched.host");
+    QCOMPARE(connection->displayName(), QString("matched.host"));
+    QCOMPARE(priv->debugMatch, -1);
+    QVERIFY(irc_debug_enabled(connection, IrcDebug::Status));
+    QCOMPARE(priv->debugMatch, 1);
+}
+
+static IrcTraceRecord traceRecord(int level, const QString& name, const QByteArray& text)
+{
+    IrcTraceRecord record;
+    record.stamp = QDateTime(QDate(2016, 1, 2), QTime(3, 4, 5)).toMSecsSinceEpoch();
+    record.level = level;
+    record.name = name;
+    record.text = text;
+    return record;
+}
+
+void tst_IrcDebug::testRing()
+{
+    IrcTraceRing ring(4);
+    IrcTraceRecord record;
+    QVERIFY(!ring.dequeue(&record));
+
+    // wraps around several times
+    for (int round = 0; round < 3; ++round) {
+        for (int i = 0; i < 4; ++i)
+            QVERIFY(ring.enqueue(traceRecord(i, "ring", QByteArray::number(round * 4 + i))));
+
+        // fails while full
+        QVERIFY(!ring.enqueue(traceRecord(0, "ring", "dropped")));
+
+        for (int i = 0; i < 4; ++i) {
+            QVERIFY(ring.dequeue(&record));
+            QCOMPARE(record.level, i);
+            QCOMPARE(record.name, QString("ring"));
+            QCOMPARE(record.text, QByteArray::number(round * 4 + i));
+        }
+        QVERIFY(!ring.dequeue(&record));
+    }
+}
+
+void tst_IrcDebug::testWriter()
+{
+    const QString fileName = QDir::tempPath() + "/communi-trace.log";
+    QFile::remove(fileName);
+
+    IrcTraceWriter writer(fileName, 4);
+    for (int i = 0; i < 6; ++i)
+        writer.post(traceRecord(IrcDebug::Write, "writer", "PRIVMSG #communi :" + QByteArray::number(i)));
+
+    // the thread was not running, the last two records did not fit
+    writer.start();
+    writer.stop();
+
+    QFile file(fileName);
+    QVERIFY(file.open(QIODevice::ReadOnly));
+    const QList<QByteArray> lines = file.readAll().split('\n');
+    QCOMPARE(lines.count(), 6);
+    const QByteArray stamp = QDateTime(QDate(2016, 1, 2), QTime(3, 4, 5)).toString(Qt::ISODate).toLatin1();
+    for (int i = 0; i < 4; ++i)
+        QCOMPARE(lines.at(i), "[" + stamp + " writer] -> PRIVMSG #communi :" + QByteArray::number(i));
+    QVERIFY(lines.at(4).startsWith('['));
+    QVERIFY(lines.at(4).endsWith(" ] !! 2 trace records dropped"));
+    QVERIFY(lines.at(5).isEmpty());
+
+    file.close();
+    QFile::remove(fileName);
+}
+
+QTEST_MAIN(tst_IrcDebug)
+
+#include "tst_ircdebug.moc"
@@ -9,6 +9,8 @@
 
 #include "irclagtimer.h"
 #include "ircconnection.h"
+#include "irccommandqueue.h"
+#include "irccommand.h"
 #include "tst_ircclientserver.h"
 #include "tst_ircdata.h"
 #include <QtTest/QtTest>
@@ -22,6 +24,8 @@ private slots:
     void testInterval();
     void testConnection();
     void testLag();
+    void testStatistics();
+    void testPassive();
 };
 
 void tst_IrcLagTimer::testDefaults()
@@ -30,6 +34,9 @@ void tst_IrcLagTimer::testDefaults()
     QCOMPARE(timer.lag(), qint64(-1));
     QVERIFY(!timer.connection());
     QCOMPARE(timer.interval(), 60);
+    QCOMPARE(timer.window(), 128);
+    QVERIFY(!timer.isPassive());
+    QCOMPARE(timer.statistics().value("samples").toInt(), 0);
 }
 
 void tst_IrcLagTimer::testInterval()
@@ -104,6 +111,101 @@ void tst_IrcLagTimer::testLag()
 #endif // QT_VERSION >= 0x040700
 }
 
+void tst_IrcLagTimer::testStatistics()
+{
+#if QT_VERSION >= 0x040700
+    IrcLagTimer timer(connection);
+
+    QSignalSpy statsSpy(&timer, SIGNAL(statisticsChanged(QVariantMap)));
+    QVERIFY(statsSpy.isValid());
+
+    connection->open();
+    QVERIFY(waitForOpened());
+    QVERIFY(waitForWritten(tst_IrcData::welcome()));
+
+    QMetaObject::invokeMethod(&timer, "_irc_pingServer");
+    QVERIFY(clientSocket->waitForBytesWritten(1000));
+    QVERIFY(serverSocket->waitForReadyRead(1000));
+
+    QRegExp rx("PING (communi/\\d+)");
+    QString written = QString::fromUtf8(serverSocket->readAll());
+    QVERIFY(rx.indexIn(written) != -1);
+
+    // measured with the monotonic clock
+    waitForWritten(QString(":irc.ser.ver PONG communi %1").arg(rx.cap(1)).toUtf8());
+    QCOMPARE(statsSpy.count(), 1);
+    QVariantMap stats = timer.statistics();
+    QCOMPARE(stats.value("samples").toInt(), 1);
+    QVERIFY(stats.value("last").toDouble() >= 0.0);
+    QCOMPARE(stats.value("min").toDouble(), stats.value("last").toDouble());
+    QCOMPARE(stats.value("max").toDouble(), stats.value("last").toDouble());
+
+    timer.resetStatistics();
+    QCOMPARE(timer.statistics().value("samples").toInt(), 0);
+
+    timer.setWindow(10);
+    QCOMPARE(timer.window(), 10);
+
+    for (int i = 1; i <= 20; ++i)
+        waitForWritten(QString(":irc.ser.ver PONG communi communi/%1").arg(QDateTime::currentMSecsSinceEpoch() - i * 100ll).toUtf8());
+
+    // the window holds the last 10 measurements: 1100-2000ms
+    stats = timer.statistics();
+    QCOMPARE(stats.value("samples").toInt(), 10);
+    QVERIFY(stats.value("min").toDouble() >= 1100.0);
+    QVERIFY(stats.value("max").toDouble() >= 2000.0);
+    QVERIFY(stats.value("max").toDouble() < 2500.0);
+    QVERIFY(stats.value("p50").toDouble() >= stats.value("min").toDouble());
+    QVERIFY(stats.value("p50").toDouble() <= stats.value("p99").toDouble());
+    QVERIFY(stats.value("p99").toDouble() <= stats.value("max").toDouble());
+    QVERIFY(qAbs(stats.value("p50").toDouble() - 1500.0) < 150.0);
+#endif // QT_VERSION >= 0x040700
+}
+
+void tst_IrcLagTimer::testPassive()
+{
+#if QT_VERSION >= 0x040700
+    IrcLagTimer timer(connection);
+    timer.setPassive(true);
+    QVERIFY(timer.isPassive());
+
+    connection->open();
+    QVERIFY(waitForOpened());
+    QVERIFY(waitForWritten(tst_IrcData::welcome()));
+    QVERIFY(waitForWritten(":irc.ser.ver CAP communi ACK :echo-message"));
+    QVERIFY(connection->network()->isCapable("echo-message"));
+
+    // queued messages are timed from when they are written
+    IrcCommandQueue queue(connection);
+    queue.setInterval(1);
+    queue.setBatch(1);
+    connection->sendCommand(IrcCommand::createMessage("#communi", "first"));
+    connection->sendCommand(IrcCommand::createMessage("#communi", "second"));
+    QCOMPARE(queue.size(), 2);
+
+    QTRY_COMPARE(queue.size(), 1);
+    QVERIFY(waitForWritten(":communi!user@host PRIVMSG #communi :first"));
+    QTRY_COMPARE(queue.size(), 0);
+    QVERIFY(waitForWritten(":communi!user@host PRIVMSG #communi :second"));
+
+    // each echo adds a single sample, which excludes the queue delay
+    QVariantMap stats = timer.statistics();
+    QCOMPARE(stats.value("samples").toInt(), 2);
+    QVERIFY(stats.value("max").toDouble() < 1000.0);
+
+    // nothing is pending after all messages have been echoed
+    QVERIFY(waitForWritten(":communi!user@host PRIVMSG #communi :second"));
+    QCOMPARE(timer.statistics().value("samples").toInt(), 2);
+
+    // not measured without echo-message
+    QVERIFY(waitForWritten(":irc.ser.ver CAP communi DEL :echo-message"));
+    connection->sendCommand(IrcCommand::createMessage("#communi", "third"));
+    QTRY_COMPARE(queue.size(), 0);
+    QVERIFY(waitForWritten(":communi!user@host PRIVMSG #communi :third"));
+    QCOMPARE(timer.statistics().value("samples").toInt(), 2);
+#endif // QT_VERSION >= 0x040700
+}
+
 QTEST_MAIN(tst_IrcLagTimer)
 
 #include "tst_irclagtimer.moc"
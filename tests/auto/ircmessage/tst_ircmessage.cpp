@@ -974,6 +974,17 @@ void tst_IrcMessage::testPrivateMessage()
     QCOMPARE(privateMessage->isAction(), action);
     QCOMPARE(privateMessage->isRequest(), request);
     QCOMPARE(static_cast<uint>(privateMessage->flags()), flags);
+
+    // the cached classification follows explicit parameters
+    privateMessage->setParameters(QStringList() << target << "\1ACTION waves\1");
+    QVERIFY(privateMessage->isAction());
+    QVERIFY(!privateMessage->isRequest());
+    QCOMPARE(privateMessage->content(), QString("waves"));
+
+    privateMessage->setParameters(QStringList() << target << "\1VERSION\1");
+    QVERIFY(!privateMessage->isAction());
+    QVERIFY(privateMessage->isRequest());
+    QCOMPARE(privateMessage->content(), QString("VERSION"));
 }
 
 void tst_IrcMessage::testQuitMessage_data()
@@ -33,6 +33,8 @@ private slots:
 
     void testCapNotify();
 
+    void testSharedInfo();
+
     void testDebug();
 };
 
@@ -45,6 +47,7 @@ void tst_IrcNetwork::testDefaults()
     QCOMPARE(network->modes(), QStringList() << "o" << "v");
     QCOMPARE(network->prefixes(), QStringList() << "@" << "+");
     QCOMPARE(network->channelTypes(), QStringList() << "#");
+    QCOMPARE(network->caseMapping(), QString("rfc1459"));
     QVERIFY(network->availableCapabilities().isEmpty());
     QVERIFY(network->requestedCapabilities().isEmpty());
     QVERIFY(network->activeCapabilities().isEmpty());
@@ -57,10 +60,11 @@ void tst_IrcNetwork::testInfo_data()
     QTest::addColumn<QString>("modes");
     QTest::addColumn<QString>("prefixes");
     QTest::addColumn<QString>("channelTypes");
+    QTest::addColumn<QString>("caseMapping");
 
-    QTest::newRow("freenode") << tst_IrcData::welcome("freenode") << "freenode" << "ov" << "@+" << "#";
-    QTest::newRow("ircnet") << tst_IrcData::welcome("ircnet") << "IRCNet" << "ov" << "@+" << "#&!+";
-    QTest::newRow("euirc") << tst_IrcData::welcome("euirc") << "euIRCnet" << "qaohv" << "*!@%+" << "#&+";
+    QTest::newRow("freenode") << tst_IrcData::welcome("freenode") << "freenode" << "ov" << "@+" << "#" << "rfc1459";
+    QTest::newRow("ircnet") << tst_IrcData::welcome("ircnet") << "IRCNet" << "ov" << "@+" << "#&!+" << "ascii";
+    QTest::newRow("euirc") << tst_IrcData::welcome("euirc") << "euIRCnet" << "qaohv" << "*!@%+" << "#&+" << "rfc1459";
 }
 
 void tst_IrcNetwork::testInfo()
@@ -70,6 +74,7 @@ void tst_IrcNetwork::testInfo()
     QFETCH(QString, modes);
     QFETCH(QString, prefixes);
     QFETCH(QString, channelTypes);
+    QFETCH(QString, caseMapping);
 
     IrcNetwork* network = connection->network();
 
@@ -95,6 +100,7 @@ void tst_IrcNetwork::testInfo()
     QCOMPARE(network->modes(), modes.split("", QString::SkipEmptyParts));
     QCOMPARE(network->prefixes(), prefixes.split("", QString::SkipEmptyParts));
     QCOMPARE(network->channelTypes(), channelTypes.split("", QString::SkipEmptyParts));
+    QCOMPARE(network->caseMapping(), caseMapping);
 
     QCOMPARE(network->prefixes().count(), network->modes().count());
     for (int i = 0; i < network->prefixes().count(); ++i) {
@@ -401,6 +407,64 @@ void tst_IrcNetwork::testCapNotify()
     QVERIFY(network->hasCapability("foo-bar"));
 }
 
+void tst_IrcNetwork::testSharedInfo()
+{
+#ifdef Q_OS_LINUX
+    IrcConnection connection1;
+    IrcConnection connection2;
+    IrcNetworkPrivate* network1 = IrcNetworkPrivate::get(connection1.network());
+    IrcNetworkPrivate* network2 = IrcNetworkPrivate::get(connection2.network());
+    QCOMPARE(network1->info.data(), network2->info.data());
+
+    QHash<QString, QString> info;
+    info.insert("NETWORK", "net");
+    info.insert("PREFIX", "(qaohv)~&@%+");
+    info.insert("CHANTYPES", "#&");
+    info.insert("STATUSMSG", "@+");
+    network1->setInfo(info);
+    QVERIFY(network1->info.data() != network2->info.data());
+
+    // the same tokens are interned into the same snapshot
+    QHash<QString, QString> first, second;
+    first.insert("NETWORK", "net");
+    first.insert("PREFIX", "(qaohv)~&@%+");
+    second.insert("CHANTYPES", "#&");
+    second.insert("STATUSMSG", "@+");
+    network2->setInfo(first);
+    network2->setInfo(second);
+    QCOMPARE(network1->info.data(), network2->info.data());
+
+    IrcNetwork* network = connection2.network();
+    QCOMPARE(network->name(), QString("net"));
+    QCOMPARE(network->modeToPrefix("q"), QString("~"));
+    QCOMPARE(network->modeToPrefix("v"), QString("+"));
+    QCOMPARE(network->modeToPrefix("x"), QString());
+    QCOMPARE(network->modeToPrefix("ov"), QString());
+    QCOMPARE(network->prefixToMode("&"), QString("a"));
+    QCOMPARE(network->prefixToMode("!"), QString());
+    QVERIFY(network->isChannel("#foo"));
+    QVERIFY(network->isChannel("&foo"));
+    QVERIFY(network->isChannel("@#foo"));
+    QVERIFY(network->isChannel("@+#foo"));
+    QVERIFY(!network->isChannel("foo"));
+    QVERIFY(!network->isChannel("@foo"));
+    QVERIFY(!network->isChannel("@"));
+    QVERIFY(!network->isChannel(QString()));
+
+    // released snapshots are dropped from the registry
+    QHash<QString, QString> unique;
+    unique.insert("NETWORK", "unique");
+    QWeakPointer<const IrcNetworkInfo> weak;
+    {
+        QSharedPointer<const IrcNetworkInfo> snapshot = IrcNetworkInfo::intern(unique);
+        QCOMPARE(IrcNetworkInfo::intern(unique).data(), snapshot.data());
+        weak = snapshot;
+    }
+    QVERIFY(weak.isNull());
+    QCOMPARE(IrcNetworkInfo::intern(unique)->name, QString("unique"));
+#endif // Q_OS_LINUX
+}
+
 void tst_IrcNetwork::testDebug()
 {
     QString str;
@@ -422,7 +486,9 @@ void tst_IrcNetwork::testDebug()
 
 #ifdef Q_OS_LINUX
     // others have problems with symbols (win) or private headers (osx frameworks)
-    IrcNetworkPrivate::get(connection.network())->name = "net";
+    QHash<QString, QString> info;
+    info.insert("NETWORK", "net");
+    IrcNetworkPrivate::get(connection.network())->setInfo(info);
     dbg << connection.network();
     QVERIFY(QRegExp("IrcNetwork\\(0x[0-9A-Fa-f]+, name=obj, network=net\\) ").exactMatch(str));
     str.clear();
@@ -0,0 +1,132 @@
+/*
+ * Copyright (C) 2008-2016 The Communi Project
+ *
+ * This test is free, and not covered by the BSD license. There is no
+ * restriction applied to their modification, redistribution, using and so on.
+ * You can study them, modify them, use them in your own program - either
+ * completely or partially.
+ */
+
+#include "ircreplaysocket.h"
+#include "irctrafficrecorder.h"
+#include "ircconnection.h"
+#include "ircmessage.h"
+#include "irc.h"
+#include "tst_ircclientserver.h"
+#include "tst_ircdata.h"
+#include <QtTest/QtTest>
+
+class tst_IrcReplaySocket : public tst_IrcClientServer
+{
+    Q_OBJECT
+
+private slots:
+    void testRecorder();
+    void testLoad();
+    void testReplay_data();
+    void testReplay();
+};
+
+void tst_IrcReplaySocket::testRecorder()
+{
+    IrcTrafficRecorder recorder(connection);
+    QCOMPARE(recorder.connection(), connection.data());
+    QVERIFY(!recorder.device());
+    recorder.setConnection(0);
+    QVERIFY(!recorder.connection());
+
+    QBuffer buffer;
+    QVERIFY(buffer.open(QIODevice::WriteOnly));
+    recorder.setDevice(&buffer);
+    QCOMPARE(recorder.device(), &buffer);
+    const qint64 header = buffer.size();
+    QVERIFY(header > 0);
+
+    // nothing is recorded without a connection
+    connection->open();
+    QVERIFY(waitForOpened());
+    QVERIFY(waitForWritten(tst_IrcData::welcome()));
+    QCOMPARE(buffer.size(), header);
+
+    recorder.setConnection(connection);
+    QVERIFY(waitForWritten(":communi!~communi@hidd.en JOIN #communi"));
+    QVERIFY(buffer.size() > header);
+
+    recorder.close();
+    QVERIFY(!recorder.device());
+}
+
+void tst_IrcReplaySocket::testLoad()
+{
+    IrcReplaySocket socket;
+    QVERIFY(!socket.isRealTime());
+
+    QByteArray garbage("garbage");
+    QBuffer buffer(&garbage);
+    QVERIFY(buffer.open(QIODevice::ReadOnly));
+    QTest::ignoreMessage(QtWarningMsg, "IrcReplaySocket::load(): unsupported recording");
+    QVERIFY(!socket.load(&buffer));
+
+    QVERIFY(!socket.load(static_cast<QIODevice*>(0)));
+}
+
+void tst_IrcReplaySocket::testReplay_data()
+{
+    QTest::addColumn<bool>("realTime");
+
+    QTest::newRow("fast") << false;
+    QTest::newRow("real-time") << true;
+}
+
+void tst_IrcReplaySocket::testReplay()
+{
+    QFETCH(bool, realTime);
+
+    Irc::registerMetaTypes();
+
+    QBuffer buffer;
+    QVERIFY(buffer.open(QIODevice::ReadWrite));
+    IrcTrafficRecorder recorder(connection);
+    recorder.setDevice(&buffer);
+
+    connection->open();
+    QVERIFY(waitForOpened());
+    QVERIFY(waitForWritten(tst_IrcData::welcome()));
+    QVERIFY(waitForWritten(":communi!~communi@hidd.en JOIN #communi"));
+    QVERIFY(waitForWritten(":nick!user@host PRIVMSG #communi :hello"));
+    connection->close();
+    recorder.close();
+
+    QVERIFY(buffer.seek(0));
+    IrcConnection replay;
+    replay.setUserName("user");
+    replay.setNickName("nick");
+    replay.setRealName("real");
+    replay.setHost("irc.ser.ver");
+
+    IrcReplaySocket* socket = new IrcReplaySocket(&replay);
+    socket->setRealTime(realTime);
+    QVERIFY(socket->load(&buffer));
+    replay.setSocket(socket);
+
+    QSignalSpy joinSpy(&replay, SIGNAL(joinMessageReceived(IrcJoinMessage*)));
+    QSignalSpy privateSpy(&replay, SIGNAL(privateMessageReceived(IrcPrivateMessage*)));
+    QSignalSpy finishedSpy(socket, SIGNAL(finished()));
+    QVERIFY(joinSpy.isValid());
+    QVERIFY(privateSpy.isValid());
+    QVERIFY(finishedSpy.isValid());
+
+    replay.open();
+    for (int i = 0; i < 200 && finishedSpy.isEmpty(); ++i)
+        QTest::qWait(10);
+
+    QCOMPARE(finishedSpy.count(), 1);
+    QCOMPARE(joinSpy.count(), 1);
+    QCOMPARE(privateSpy.count(), 1);
+    QCOMPARE(replay.nickName(), QString("communi"));
+    QCOMPARE(socket->state(), QAbstractSocket::UnconnectedState);
+}
+
+QTEST_MAIN(tst_IrcReplaySocket)
+
+#include "tst_ircreplaysocket.moc"
@@ -6,3 +6,5 @@ SOURCES += tst_ircusermodel.cpp
 
 include(../shared/shared.pri)
 include(../auto.pri)
+
+greaterThan(QT_MAJOR_VERSION, 4):qtHaveModule(qml):QT += qml
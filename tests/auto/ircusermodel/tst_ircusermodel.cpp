@@ -8,6 +8,7 @@
  */
 
 #include "ircusermodel.h"
+#include "ircusermodel_p.h"
 #include "ircconnection.h"
 #include "ircbuffermodel.h"
 #include "ircchannel.h"
@@ -18,6 +19,10 @@
 #include "tst_ircclientserver.h"
 
 #include <QtTest/QtTest>
+#ifdef QT_QML_LIB
+#include <QtQml/QQmlEngine>
+#include <QtQml/QQmlComponent>
+#endif
 
 static bool caseInsensitiveLessThan(const QString& s1, const QString& s2)
 {
@@ -29,6 +34,20 @@ static bool caseInsensitiveGreaterThan(const QString& s1, const QString& s2)
     return s1.compare(s2, Qt::CaseInsensitive) > 0;
 }
 
+class ReversedUserModel : public IrcUserModel
+{
+    Q_OBJECT
+
+public:
+    ReversedUserModel(QObject* parent = 0) : IrcUserModel(parent) { }
+
+protected:
+    bool lessThan(IrcUser* one, IrcUser* another, Irc::SortMethod method) const
+    {
+        return IrcUserModel::lessThan(another, one, method);
+    }
+};
+
 class tst_IrcUserModel : public tst_IrcClientServer
 {
     Q_OBJECT
@@ -46,6 +65,12 @@ private slots:
     void testActivity_euirc();
     void testChanges();
     void testRoles();
+    void testTitles();
+    void testFilters();
+    void testSharing();
+#ifdef QT_QML_LIB
+    void testQmlSharing();
+#endif
     void testAIM();
     void testUser();
 };
@@ -1448,6 +1473,240 @@ void tst_IrcUserModel::testRoles()
     QVERIFY(roles.isEmpty());
 }
 
+void tst_IrcUserModel::testTitles()
+{
+    IrcBufferModel bufferModel;
+    bufferModel.setConnection(connection);
+
+    connection->open();
+    QVERIFY(waitForOpened());
+
+    QVERIFY(waitForWritten(tst_IrcData::welcome()));
+    QVERIFY(waitForWritten(":communi!~communi@hidd.en JOIN :#communi"));
+    QVERIFY(waitForWritten(":irc.ifi.uio.no 353 communi = #communi :communi @ChanServ +qtassistant Guest1234 +qout"));
+    QVERIFY(waitForWritten(":irc.ifi.uio.no 366 communi #communi :End of NAMES list."));
+    IrcChannel* channel = bufferModel.get(0)->toChannel();
+    QVERIFY(channel);
+
+    // nobody listens to titlesChanged(), the titles are built when read
+    IrcUserModel userModel(channel);
+    QCOMPARE(userModel.titles(), QStringList() << "communi" << "@ChanServ" << "+qtassistant" << "Guest1234" << "+qout");
+
+    QVERIFY(waitForWritten(":Guest5678!~Guest5678@hidd.en JOIN :#communi"));
+    QVERIFY(waitForWritten(":ChanServ!ChanServ@services. MODE #communi +v Guest1234"));
+    QCOMPARE(userModel.titles(), QStringList() << "communi" << "@ChanServ" << "+qtassistant" << "+Guest1234" << "+qout" << "Guest5678");
+
+    QSignalSpy titlesChangedSpy(&userModel, SIGNAL(titlesChanged(QStringList)));
+    QVERIFY(titlesChangedSpy.isValid());
+
+    QVERIFY(waitForWritten(":Guest5678!~Guest5678@hidd.en PART #communi"));
+    QCOMPARE(titlesChangedSpy.count(), 1);
+    QCOMPARE(titlesChangedSpy.last().at(0).toStringList(), QStringList() << "communi" << "@ChanServ" << "+qtassistant" << "+Guest1234" << "+qout");
+    QCOMPARE(userModel.titles(), titlesChangedSpy.last().at(0).toStringList());
+
+    QVERIFY(waitForWritten(":ChanServ!ChanServ@services. MODE #communi -v Guest1234"));
+    QCOMPARE(titlesChangedSpy.count(), 2);
+    QCOMPARE(titlesChangedSpy.last().at(0).toStringList(), QStringList() << "communi" << "@ChanServ" << "+qtassistant" << "Guest1234" << "+qout");
+
+    userModel.clear();
+    QVERIFY(userModel.titles().isEmpty());
+}
+
+void tst_IrcUserModel::testFilters()
+{
+    IrcBufferModel bufferModel;
+    bufferModel.setConnection(connection);
+
+    connection->open();
+    QVERIFY(waitForOpened());
+
+    QVERIFY(waitForWritten(tst_IrcData::welcome()));
+    QVERIFY(waitForWritten(":communi!~communi@hidd.en JOIN :#communi"));
+    QVERIFY(waitForWritten(":irc.ifi.uio.no 353 communi = #communi :communi @ChanServ +qtassistant Guest1234 +qout"));
+    QVERIFY(waitForWritten(":irc.ifi.uio.no 366 communi #communi :End of NAMES list."));
+    IrcChannel* channel = bufferModel.get(0)->toChannel();
+    QVERIFY(channel);
+
+    // prefix
+    IrcUserModel opModel(channel);
+    QSignalSpy filterChangedSpy(&opModel, SIGNAL(filterChanged()));
+    QVERIFY(filterChangedSpy.isValid());
+    opModel.setPrefixFilter("@");
+    QCOMPARE(filterChangedSpy.count(), 1);
+    QCOMPARE(opModel.prefixFilter(), QString("@"));
+    QCOMPARE(opModel.names(), QStringList() << "ChanServ");
+    QVERIFY(opModel.contains("ChanServ"));
+    QVERIFY(!opModel.contains("communi"));
+    QVERIFY(!opModel.find("qout"));
+
+    QVERIFY(waitForWritten(":ChanServ!ChanServ@services. MODE #communi +o Guest1234"));
+    QCOMPARE(opModel.names(), QStringList() << "ChanServ" << "Guest1234");
+
+    QVERIFY(waitForWritten(":ChanServ!ChanServ@services. MODE #communi -o ChanServ"));
+    QCOMPARE(opModel.names(), QStringList() << "Guest1234");
+
+    opModel.setPrefixFilter("@+");
+    QCOMPARE(filterChangedSpy.count(), 2);
+    QCOMPARE(opModel.names(), QStringList() << "Guest1234" << "qout" << "qtassistant");
+
+    // away
+    IrcUserModel awayModel(channel);
+    awayModel.setFilterFlags(IrcUserModel::AwayFilter);
+    QCOMPARE(awayModel.filterFlags(), IrcUserModel::FilterFlags(IrcUserModel::AwayFilter));
+    QCOMPARE(awayModel.count(), 0);
+
+    QVERIFY(waitForWritten(":qout!~qout@hidd.en AWAY :gone"));
+    QCOMPARE(awayModel.count(), 1);
+    QCOMPARE(awayModel.get(0)->name(), QString("qout"));
+
+    QVERIFY(waitForWritten(":qout!~qout@hidd.en AWAY"));
+    QCOMPARE(awayModel.count(), 0);
+
+    // name
+    IrcUserModel guestModel(channel);
+    guestModel.setSortMethod(Irc::SortByName);
+    guestModel.setNameFilter("guest");
+    QCOMPARE(guestModel.names(), QStringList() << "Guest1234");
+
+    QVERIFY(waitForWritten(":Guest1234!~Guest1234@hidd.en NICK :jpnurmi"));
+    QCOMPARE(guestModel.count(), 0);
+
+    QVERIFY(waitForWritten(":Guest9999!~Guest9999@hidd.en JOIN :#communi"));
+    QVERIFY(waitForWritten(":Guest5678!~Guest5678@hidd.en JOIN :#communi"));
+    QCOMPARE(guestModel.names(), QStringList() << "Guest5678" << "Guest9999");
+    QCOMPARE(guestModel.get(0)->name(), QString("Guest5678"));
+
+    guestModel.setNameFilter(QString());
+    QCOMPARE(guestModel.count(), 7);
+}
+
+static QList<IrcUser*> reversed(const QList<IrcUser*>& users)
+{
+    QList<IrcUser*> list;
+    foreach (IrcUser* user, users)
+        list.prepend(user);
+    return list;
+}
+
+void tst_IrcUserModel::testSharing()
+{
+    IrcBufferModel bufferModel;
+    bufferModel.setConnection(connection);
+
+    connection->open();
+    QVERIFY(waitForOpened());
+
+    QVERIFY(waitForWritten(tst_IrcData::welcome()));
+    QVERIFY(waitForWritten(":communi!~communi@hidd.en JOIN :#communi"));
+    QVERIFY(waitForWritten(":irc.ifi.uio.no 353 communi = #communi :communi @ChanServ +qtassistant Guest1234 +qout"));
+    QVERIFY(waitForWritten(":irc.ifi.uio.no 366 communi #communi :End of NAMES list."));
+    IrcChannel* channel = bufferModel.get(0)->toChannel();
+    QVERIFY(channel);
+
+    IrcUserModel titleModel1(channel);
+    titleModel1.setSortMethod(Irc::SortByTitle);
+    IrcUserModel titleModel2(channel);
+    titleModel2.setSortMethod(Irc::SortByTitle);
+    IrcUserModel nameModel(channel);
+    nameModel.setSortMethod(Irc::SortByName);
+
+    QCOMPARE(titleModel1.titles(), QStringList() << "@ChanServ" << "+qout" << "+qtassistant" << "communi" << "Guest1234");
+    QCOMPARE(titleModel2.users(), titleModel1.users());
+    QCOMPARE(nameModel.titles(), QStringList() << "@ChanServ" << "communi" << "Guest1234" << "+qout" << "+qtassistant");
+
+    // a subclass that reimplements lessThan() sorts on its own
+    ReversedUserModel reversedModel(channel);
+    reversedModel.setSortMethod(Irc::SortByName);
+    QCOMPARE(reversedModel.users(), reversed(nameModel.users()));
+    reversedModel.setSortMethod(Irc::SortByTitle);
+    QCOMPARE(reversedModel.users(), reversed(titleModel1.users()));
+    IrcUserModel activityModel(channel);
+    activityModel.setSortMethod(Irc::SortByActivity);
+    reversedModel.setSortMethod(Irc::SortByActivity);
+    QCOMPARE(reversedModel.users(), reversed(activityModel.users()));
+    reversedModel.setChannel(0);
+
+    QSignalSpy rowsInsertedSpy(&titleModel2, SIGNAL(rowsInserted(QModelIndex,int,int)));
+    QSignalSpy rowsRemovedSpy(&titleModel2, SIGNAL(rowsRemoved(QModelIndex,int,int)));
+    QVERIFY(rowsInsertedSpy.isValid());
+    QVERIFY(rowsRemovedSpy.isValid());
+
+    QVERIFY(waitForWritten(":Bot!~Bot@hidd.en JOIN :#communi"));
+    QCOMPARE(rowsInsertedSpy.count(), 1);
+    QCOMPARE(rowsInsertedSpy.last().at(1).toInt(), 3);
+    QCOMPARE(titleModel1.titles(), QStringList() << "@ChanServ" << "+qout" << "+qtassistant" << "Bot" << "communi" << "Guest1234");
+    QCOMPARE(titleModel2.users(), titleModel1.users());
+    QCOMPARE(nameModel.titles(), QStringList() << "Bot" << "@ChanServ" << "communi" << "Guest1234" << "+qout" << "+qtassistant");
+
+    QVERIFY(waitForWritten(":ChanServ!ChanServ@services. MODE #communi +o Guest1234"));
+    QCOMPARE(rowsRemovedSpy.count(), 1);
+    QCOMPARE(rowsRemovedSpy.last().at(1).toInt(), 5);
+    QCOMPARE(rowsInsertedSpy.count(), 2);
+    QCOMPARE(rowsInsertedSpy.last().at(1).toInt(), 1);
+    QCOMPARE(titleModel1.titles(), QStringList() << "@ChanServ" << "@Guest1234" << "+qout" << "+qtassistant" << "Bot" << "communi");
+    QCOMPARE(titleModel2.users(), titleModel1.users());
+    QCOMPARE(nameModel.titles(), QStringList() << "Bot" << "@ChanServ" << "communi" << "@Guest1234" << "+qout" << "+qtassistant");
+
+    QVERIFY(waitForWritten(":qout!~qout@hidd.en NICK :aardvark"));
+    QCOMPARE(titleModel1.titles(), QStringList() << "@ChanServ" << "@Guest1234" << "+aardvark" << "+qtassistant" << "Bot" << "communi");
+    QCOMPARE(titleModel2.users(), titleModel1.users());
+    QCOMPARE(nameModel.titles(), QStringList() << "+aardvark" << "Bot" << "@ChanServ" << "communi" << "@Guest1234" << "+qtassistant");
+
+    QVERIFY(waitForWritten(":Bot!~Bot@hidd.en PART #communi"));
+    QCOMPARE(rowsRemovedSpy.last().at(1).toInt(), 4);
+    QCOMPARE(titleModel1.titles(), QStringList() << "@ChanServ" << "@Guest1234" << "+aardvark" << "+qtassistant" << "communi");
+    QCOMPARE(titleModel2.users(), titleModel1.users());
+
+    titleModel2.setSortOrder(Qt::DescendingOrder);
+    QCOMPARE(titleModel2.users(), reversed(titleModel1.users()));
+
+    QVERIFY(waitForWritten(":Guest5678!~Guest5678@hidd.en JOIN :#communi"));
+    QCOMPARE(titleModel1.titles(), QStringList() << "@ChanServ" << "@Guest1234" << "+aardvark" << "+qtassistant" << "communi" << "Guest5678");
+    QCOMPARE(titleModel2.users(), reversed(titleModel1.users()));
+
+    titleModel1.clear();
+    QVERIFY(waitForWritten(":Guest5678!~Guest5678@hidd.en PART #communi"));
+    QCOMPARE(titleModel2.count(), 5);
+    QCOMPARE(nameModel.count(), 5);
+}
+
+#ifdef QT_QML_LIB
+void tst_IrcUserModel::testQmlSharing()
+{
+    qmlRegisterType<IrcUserModel>("Communi", 3, 0, "IrcUserModel");
+
+    IrcBufferModel bufferModel;
+    bufferModel.setConnection(connection);
+
+    connection->open();
+    QVERIFY(waitForOpened());
+
+    QVERIFY(waitForWritten(tst_IrcData::welcome()));
+    QVERIFY(waitForWritten(":communi!~communi@hidd.en JOIN :#communi"));
+    QVERIFY(waitForWritten(":irc.ifi.uio.no 353 communi = #communi :communi @ChanServ +qtassistant Guest1234 +qout"));
+    QVERIFY(waitForWritten(":irc.ifi.uio.no 366 communi #communi :End of NAMES list."));
+    IrcChannel* channel = bufferModel.get(0)->toChannel();
+    QVERIFY(channel);
+
+    QQmlEngine engine;
+    QQmlComponent component(&engine);
+    component.setData("import Communi 3.0; IrcUserModel { }", QUrl());
+    QScopedPointer<QObject> object(component.create());
+    IrcUserModel* qmlModel = qobject_cast<IrcUserModel*>(object.data());
+    QVERIFY(qmlModel);
+    qmlModel->setSortMethod(Irc::SortByTitle);
+    qmlModel->setChannel(channel);
+
+    IrcUserModel model(channel);
+    model.setSortMethod(Irc::SortByTitle);
+
+    // models created by QML share the sorted users of the channel
+    QVERIFY(IrcUserModelPrivate::get(qmlModel)->shared);
+    QCOMPARE(IrcUserModelPrivate::get(qmlModel)->shared, IrcUserModelPrivate::get(&model)->shared);
+    QCOMPARE(qmlModel->users(), model.users());
+}
+#endif // QT_QML_LIB
+
 void tst_IrcUserModel::testAIM()
 {
     IrcBufferModel bufferModel;
@@ -4,6 +4,9 @@
 
 TEMPLATE = subdirs
 
+SUBDIRS += ircbuffermodel
+SUBDIRS += irccommand
+SUBDIRS += irccommandparser
 SUBDIRS += ircmessage
 SUBDIRS += irctextformat
 
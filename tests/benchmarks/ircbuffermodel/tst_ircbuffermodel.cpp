@@ -0,0 +1,138 @@
+/*
+ * Copyright (C) 2008-2016 The Communi Project
+ *
+ * This test is free, and not covered by the BSD license. There is no
+ * restriction applied to their modification, redistribution, using and so on.
+ * You can study them, modify them, use them in your own program - either
+ * completely or partially.
+ */
+
+#include "ircbuffermodel.h"
+#include "ircconnection.h"
+#include "ircbuffer.h"
+#include "ircmessage.h"
+#include <QtTest/QtTest>
+
+class tst_IrcBufferModel : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void testSave_data();
+    void testSave();
+
+    void testRestore_data();
+    void testRestore();
+
+    void testFindUsers_data();
+    void testFindUsers();
+
+private:
+    void populate(IrcBufferModel* model, int count);
+    void populateUsers(IrcBufferModel* model, int channels, int users);
+};
+
+void tst_IrcBufferModel::populate(IrcBufferModel* model, int count)
+{
+    QVariantMap userData;
+    userData.insert("lastSeen", 1234567890);
+    for (int i = 0; i < count; ++i) {
+        model->add(QString("#channel%1").arg(i));
+        IrcBuffer* query = model->add(QString("nick%1").arg(i));
+        query->setUserData(userData);
+    }
+}
+
+void tst_IrcBufferModel::populateUsers(IrcBufferModel* model, int channels, int users)
+{
+    for (int i = 0; i < channels; ++i) {
+        const QString channel = QString("#channel%1").arg(i);
+        model->add(channel);
+        for (int j = 0; j < users; ++j) {
+            // 10000 different nicks, one in a hundred is a bot
+            const int n = (i * users + j) % 10000;
+            const QString nick = QString(n % 100 ? "nick%1" : "bot%1").arg(n);
+            const QString join = QString(":%1!user@host%2.example.com JOIN %3").arg(nick).arg(n).arg(channel);
+            QScopedPointer<IrcMessage> message(IrcMessage::fromData(join.toUtf8(), model->connection()));
+            model->receiveMessage(message.data());
+        }
+    }
+}
+
+void tst_IrcBufferModel::testSave_data()
+{
+    QTest::addColumn<int>("count");
+    QTest::addColumn<bool>("snapshot");
+
+    QTest::newRow("state 100") << 100 << false;
+    QTest::newRow("snapshot 100") << 100 << true;
+    QTest::newRow("state 5000") << 5000 << false;
+    QTest::newRow("snapshot 5000") << 5000 << true;
+}
+
+void tst_IrcBufferModel::testSave()
+{
+    QFETCH(int, count);
+    QFETCH(bool, snapshot);
+
+    IrcConnection connection;
+    IrcBufferModel model(&connection);
+    populate(&model, count);
+
+    QBENCHMARK {
+        if (snapshot)
+            model.saveSnapshot();
+        else
+            model.saveState();
+    }
+}
+
+void tst_IrcBufferModel::testRestore_data()
+{
+    testSave_data();
+}
+
+void tst_IrcBufferModel::testRestore()
+{
+    QFETCH(int, count);
+    QFETCH(bool, snapshot);
+
+    IrcConnection connection;
+    IrcBufferModel model(&connection);
+    populate(&model, count);
+    const QByteArray state = snapshot ? model.saveSnapshot() : model.saveState();
+
+    QBENCHMARK {
+        IrcBufferModel restored;
+        restored.restoreState(state);
+    }
+}
+
+void tst_IrcBufferModel::testFindUsers_data()
+{
+    QTest::addColumn<QString>("pattern");
+
+    QTest::newRow("substring") << "nick1234";
+    QTest::newRow("short") << "k1";
+    QTest::newRow("wildcard") << "*bot*";
+    QTest::newRow("host") << "*@host1234.example.com";
+    QTest::newRow("no match") << "nobody";
+}
+
+void tst_IrcBufferModel::testFindUsers()
+{
+    QFETCH(QString, pattern);
+
+    // 2000 channels with 25 users each
+    IrcConnection connection;
+    IrcBufferModel model(&connection);
+    populateUsers(&model, 2000, 25);
+
+    QBENCHMARK {
+        model.findUsers(pattern);
+    }
+}
+
+QTEST_MAIN(tst_IrcBufferModel)
+
+#include "tst_ircbuffermodel.moc"
@@ -0,0 +1,7 @@
+######################################################################
+# Communi
+######################################################################
+
+SOURCES += tst_irccommand.cpp
+
+include(../benchmarks.pri)
@@ -0,0 +1,151 @@
+/*
+ * Copyright (C) 2008-2016 The Communi Project
+ *
+ * This test is free, and not covered by the BSD license. There is no
+ * restriction applied to their modification, redistribution, using and so on.
+ * You can study them, modify them, use them in your own program - either
+ * completely or partially.
+ */
+
+#include "irccommand.h"
+#include "ircconnection.h"
+#include "ircreplaysocket.h"
+#include <QtTest/QtTest>
+#include <QtCore/QTextCodec>
+#include <QtCore/QStringList>
+
+static const QString MSG_32_5("Vestibulum eu libero eget metus.");
+static const QString MSG_128_19("Ut porttitor volutpat tristique. Aenean semper ligula eget nulla condimentum tempor in quis felis. Sed sem diam, tincidunt amet.");
+static const QString MSG_UNICODE = QString::fromUtf8("H\xc3\xa4ll\xc3\xb6 w\xc3\xb6rld, \xe2\x82\xac 42 \xf0\x9f\x98\x80");
+
+class tst_IrcCommand : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void initTestCase();
+    void cleanupTestCase();
+
+    void testSend_data();
+    void testSend();
+
+    void testSendValue_data();
+    void testSendValue();
+
+    void testToString_data();
+    void testToString();
+
+private:
+    QPointer<IrcConnection> connection;
+};
+
+void tst_IrcCommand::initTestCase()
+{
+    // the replay socket discards everything that is written, and without
+    // an event loop the connection stays active for the whole benchmark
+    connection = new IrcConnection(this);
+    connection->setSocket(new IrcReplaySocket(connection));
+    connection->setHost("127.0.0.1");
+    connection->setUserName("communi");
+    connection->setNickName("communi");
+    connection->setRealName("communi");
+    connection->open();
+    QVERIFY(connection->isActive());
+}
+
+void tst_IrcCommand::cleanupTestCase()
+{
+    delete connection;
+}
+
+static void addRows()
+{
+    QTest::addColumn<int>("type");
+    QTest::addColumn<QStringList>("parameters");
+
+    QTest::newRow("message 32") << static_cast<int>(IrcCommand::Message) << (QStringList() << "#communi" << MSG_32_5);
+    QTest::newRow("message 128") << static_cast<int>(IrcCommand::Message) << (QStringList() << "#communi" << MSG_128_19);
+    QTest::newRow("message unicode") << static_cast<int>(IrcCommand::Message) << (QStringList() << "#communi" << MSG_UNICODE);
+    QTest::newRow("join") << static_cast<int>(IrcCommand::Join) << (QStringList() << "#communi");
+    QTest::newRow("ctcp action") << static_cast<int>(IrcCommand::CtcpAction) << (QStringList() << "#communi" << MSG_32_5);
+    QTest::newRow("quote") << static_cast<int>(IrcCommand::Quote) << (QStringList() << "PRIVMSG" << "#communi" << MSG_128_19);
+}
+
+// the factories mark the commands for direct serialization
+static IrcCommand* createCommand(int type, const QStringList& parameters)
+{
+    switch (type) {
+    case IrcCommand::Message:
+        return IrcCommand::createMessage(parameters.value(0), parameters.value(1));
+    case IrcCommand::Join:
+        return IrcCommand::createJoin(parameters.value(0));
+    case IrcCommand::CtcpAction:
+        return IrcCommand::createCtcpAction(parameters.value(0), parameters.value(1));
+    case IrcCommand::Quote:
+        return IrcCommand::createQuote(parameters);
+    default:
+        return 0;
+    }
+}
+
+void tst_IrcCommand::testSend_data()
+{
+    addRows();
+}
+
+void tst_IrcCommand::testSend()
+{
+    QFETCH(int, type);
+    QFETCH(QStringList, parameters);
+
+    // a parented command is reused instead of being deleted later
+    QScopedPointer<IrcCommand> command(createCommand(type, parameters));
+    QVERIFY(command);
+    command->setParent(this);
+
+    QBENCHMARK {
+        connection->sendCommand(command.data());
+    }
+}
+
+void tst_IrcCommand::testSendValue_data()
+{
+    addRows();
+}
+
+void tst_IrcCommand::testSendValue()
+{
+    QFETCH(int, type);
+    QFETCH(QStringList, parameters);
+
+    const IrcCommandValue command(static_cast<IrcCommand::Type>(type), parameters.value(0), parameters.value(1), parameters.value(2));
+
+    QBENCHMARK {
+        connection->sendCommand(command);
+    }
+}
+
+void tst_IrcCommand::testToString_data()
+{
+    addRows();
+}
+
+void tst_IrcCommand::testToString()
+{
+    QFETCH(int, type);
+    QFETCH(QStringList, parameters);
+
+    IrcCommand command;
+    command.setType(static_cast<IrcCommand::Type>(type));
+    command.setParameters(parameters);
+
+    // the generic path that sendCommand() took for every command before
+    QTextCodec* codec = QTextCodec::codecForName("UTF-8");
+    QBENCHMARK {
+        connection->sendData(codec->fromUnicode(command.toString()));
+    }
+}
+
+QTEST_MAIN(tst_IrcCommand)
+
+#include "tst_irccommand.moc"
@@ -0,0 +1,7 @@
+######################################################################
+# Communi
+######################################################################
+
+SOURCES += tst_irccommandparser.cpp
+
+include(../benchmarks.pri)
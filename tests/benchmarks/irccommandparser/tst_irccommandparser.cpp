@@ -0,0 +1,58 @@
+/*
+ * Copyright (C) 2008-2016 The Communi Project
+ *
+ * This test is free, and not covered by the BSD license. There is no
+ * restriction applied to their modification, redistribution, using and so on.
+ * You can study them, modify them, use them in your own program - either
+ * completely or partially.
+ */
+
+#include "irccommandparser.h"
+#include "irccommand.h"
+#include <QtTest/QtTest>
+
+class tst_IrcCommandParser : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void testParse_data();
+    void testParse();
+};
+
+void tst_IrcCommandParser::testParse_data()
+{
+    QTest::addColumn<QString>("input");
+
+    QTest::newRow("message") << QString("Vestibulum eu libero eget metus.");
+    QTest::newRow("unknown") << QString("!vestibulum eu libero eget metus.");
+    QTest::newRow("command") << QString("!join #communi");
+    QTest::newRow("nick") << QString("bot: act loves communi");
+}
+
+void tst_IrcCommandParser::testParse()
+{
+    QFETCH(QString, input);
+
+    IrcCommandParser parser;
+    parser.setTarget("#communi");
+    parser.setChannels(QStringList() << "#communi");
+    parser.setTriggers(QStringList() << "!" << "bot:");
+    parser.addCommand(IrcCommand::CtcpAction, "ACT [target] <message...>");
+    parser.addCommand(IrcCommand::Custom, "HELP (<command...>)");
+    parser.addCommand(IrcCommand::Nick, "NICK <nick>");
+    parser.addCommand(IrcCommand::Join, "JOIN <#channel> (<key>)");
+    parser.addCommand(IrcCommand::Part, "PART (<#channel>) (<message...>)");
+    parser.addCommand(IrcCommand::Quit, "QUIT (<message...>)");
+    parser.addCommand(IrcCommand::Message, "SAY [target] <message...>");
+    for (int i = 0; i < 300; ++i)
+        parser.addCommand(IrcCommand::Custom, QString("CMD%1 <arg...>").arg(i));
+
+    QBENCHMARK {
+        delete parser.parse(input);
+    }
+}
+
+QTEST_MAIN(tst_IrcCommandParser)
+
+#include "tst_irccommandparser.moc"
@@ -11,6 +11,9 @@ CONFIG += install_name no_testcase_installs
 
 !verbose:CONFIG += silent
 
+# configure -no-metrics
+no_metrics:DEFINES += IRC_NO_METRICS
+
 CONFIG(debug, debug|release) {
     OBJECTS_DIR = debug
     MOC_DIR = debug